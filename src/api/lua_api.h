@@ -722,6 +722,20 @@ int lua_status(lua_State* L);
  */
 int lua_gc(lua_State* L, int what, int data);
 
+/**
+ * @brief 进入arena作用域，之后创建的临时表和长字符串在arena中分配
+ * @param L Lua状态指针
+ */
+void lua_arenaenter(lua_State* L);
+
+/**
+ * @brief 退出arena作用域；最外层退出时把写入全局变量、上值或堆对象的
+ *        arena对象复制到堆上，其余一次释放
+ * @param L Lua状态指针
+ * @return 复制到堆上的对象数量
+ */
+int lua_arenaexit(lua_State* L);
+
 /* ========================================================================== */
 /* 杂项函数 */
 /* ========================================================================== */
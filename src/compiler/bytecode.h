@@ -3,6 +3,7 @@
 #include "core/lua_common.h"
 #include "types/value.h"
 #include <vector>
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <optional>
@@ -298,6 +299,39 @@ inline int ConstantIndexToRK(int k) {
     return k | BITRK;
 }
 
+/* ========================================================================== */
+/* 浮点字节编码 */
+/* ========================================================================== */
+
+/**
+ * @brief 将整数编码为"浮点字节"（luaO_int2fb）
+ *
+ * 格式为(eeeeexxx)，值为(1xxx) * 2^(eeeee - 1)，eeeee为0时值为xxx。
+ * NEWTABLE的B/C操作数使用此编码，结果向上取整。
+ */
+inline int IntToFloatingByte(unsigned int x) {
+    int e = 0;
+    while (x >= 16) {
+        x = (x + 1) >> 1;
+        e++;
+    }
+    if (x < 8) {
+        return static_cast<int>(x);
+    }
+    return ((e + 1) << 3) | (static_cast<int>(x) - 8);
+}
+
+/**
+ * @brief 将"浮点字节"解码为整数（luaO_fb2int）
+ */
+inline Size FloatingByteToInt(int x) {
+    int e = (x >> 3) & 31;
+    if (e == 0) {
+        return static_cast<Size>(x);
+    }
+    return static_cast<Size>((x & 7) + 8) << (e - 1);
+}
+
 /**
  * @brief 从RK值中提取寄存器索引
  */
@@ -357,6 +391,34 @@ struct LineInfo {
     LineInfo(Size p, int l) : pc(p), line(l) {}
 };
 
+/**
+ * @brief 指令内联缓存
+ * 
+ * 记录常量字符串键上次命中的哈希节点下标。以相同方式构造的表哈希布局
+ * 相同，因此一个预测下标可以跨表对象命中；命中只需比较该节点的键指针，
+ * 无需计算哈希或探测。
+ */
+struct InlineCache {
+    static constexpr uint32_t kEmpty = UINT32_MAX;
+    
+    uint32_t node = kEmpty;     // 预测的哈希节点下标
+    
+    /**
+     * @brief 读取预测下标
+     * @note 原型可被多个状态并发执行，读写用宽松原子；预测错误只会导致未命中
+     */
+    uint32_t Predict() const {
+        return std::atomic_ref<uint32_t>(const_cast<uint32_t&>(node)).load(std::memory_order_relaxed);
+    }
+    
+    /**
+     * @brief 记录新的预测下标
+     */
+    void Record(uint32_t index) {
+        std::atomic_ref<uint32_t>(node).store(index, std::memory_order_relaxed);
+    }
+};
+
 /**
  * @brief 函数原型类 - 存储编译后的函数信息
  * 
@@ -424,6 +486,32 @@ public:
      */
     Size GetCodeSize() const { return code_.size(); }
     
+    /**
+     * @brief 获取每条指令的内联缓存槽（与代码等长，校验时分配）
+     * @note 仅对已校验的原型有效；缓存只是执行期的预测，不影响函数语义，
+     *       因此允许通过const原型更新
+     */
+    InlineCache* GetInlineCaches() const { return inline_caches_.data(); }
+    
+    /**
+     * @brief 检查字节码是否已通过加载期校验（见BytecodeVerifier）
+     * @note 校验后不应再修改代码：执行中的调用帧直接持有指令指针。
+     *       acquire读取与MarkVerified配对，看到已校验即看到分配好的内联缓存
+     */
+    bool IsVerified() const {
+        return std::atomic_ref<bool>(verified_).load(std::memory_order_acquire);
+    }
+    
+    /**
+     * @brief 按代码长度分配内联缓存并标记已校验（校验结论不改变函数语义，
+     *        允许通过const原型设置）
+     * @note 只由BytecodeVerifier在校验锁内调用，之后原型可被多个线程共享
+     */
+    void MarkVerified() const {
+        inline_caches_.assign(code_.size(), InlineCache{});
+        std::atomic_ref<bool>(verified_).store(true, std::memory_order_release);
+    }
+    
     /* ====================================================================== */
     /* 常量管理 */
     /* ====================================================================== */
@@ -597,6 +685,12 @@ private:
     // 指令序列
     std::vector<Instruction> code_;
     
+    // 内联缓存（每条指令一个，校验时分配）
+    mutable std::vector<InlineCache> inline_caches_;
+    
+    // 是否已通过加载期校验（经atomic_ref访问，保持原型可移动）
+    alignas(std::atomic_ref<bool>::required_alignment) mutable bool verified_ = false;
+    
     // 常量表
     std::vector<LuaValue> constants_;
     
@@ -194,7 +194,9 @@ Size InstructionEmitter::EmitSetTable(RegisterIndex table, int key_rk, int value
 }
 
 Size InstructionEmitter::EmitNewTable(RegisterIndex dst, int array_size, int hash_size) {
-    return generator_.EmitABC(OpCode::NEWTABLE, dst, array_size, hash_size);
+    return generator_.EmitABC(OpCode::NEWTABLE, dst,
+                              IntToFloatingByte(static_cast<unsigned int>(array_size)),
+                              IntToFloatingByte(static_cast<unsigned int>(hash_size)));
 }
 
 Size InstructionEmitter::EmitAdd(RegisterIndex dst, int left_rk, int right_rk) {
@@ -290,8 +290,8 @@ public:
     /**
      * @brief 发射NEWTABLE指令
      * @param dst 目标寄存器
-     * @param array_size 数组部分大小
-     * @param hash_size 哈希部分大小
+     * @param array_size 数组部分预期元素数（编码为浮点字节）
+     * @param hash_size 哈希部分预期元素数（编码为浮点字节）
      * @return 指令位置
      */
     Size EmitNewTable(RegisterIndex dst, int array_size = 0, int hash_size = 0);
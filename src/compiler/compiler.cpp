@@ -532,8 +532,21 @@ RegisterIndex ExpressionCompiler::CompileMemberExpression(const MemberExpression
 RegisterIndex ExpressionCompiler::CompileTableConstructor(const TableConstructor* expr) {
     RegisterIndex table_reg = context_.GetRegisterAllocator().Allocate();
     
+    // 统计数组/哈希字段数作为NEWTABLE的大小提示，避免构造过程中反复rehash
+    unsigned int array_count = 0;
+    unsigned int hash_count = 0;
+    for (Size i = 0; i < expr->GetFieldCount(); ++i) {
+        if (expr->GetField(i)->GetKey()) {
+            hash_count++;
+        } else {
+            array_count++;
+        }
+    }
+    
     // 创建新表
-    context_.GetGenerator().EmitInstruction(OpCode::NEWTABLE, table_reg, 0, 0);
+    context_.GetGenerator().EmitInstruction(OpCode::NEWTABLE, table_reg,
+                                            IntToFloatingByte(array_count),
+                                            IntToFloatingByte(hash_count));
     
     // 处理表字段
     int array_index = 1; // Lua数组从1开始
@@ -10,6 +10,7 @@
 
 #include "bytecode.h"
 #include "../types/value.h"
+#include "../memory/garbage_collector.h"
 #include "../core/lua_common.h"
 #include <vector>
 #include <unordered_map>
@@ -28,18 +29,14 @@ namespace lua_cpp {
  */
 struct LuaValueHash {
     std::size_t operator()(const LuaValue& value) const {
-        switch (value.GetType()) {
-            case LuaType::Nil:
-                return 0;
-            case LuaType::Bool:
-                return std::hash<bool>{}(value.AsBool());
-            case LuaType::Number:
-                return std::hash<double>{}(value.AsNumber());
-            case LuaType::String:
-                return std::hash<std::string>{}(value.AsString());
-            default:
-                return 0;
+        if (value.IsString()) {
+            // 使用StringObject上缓存的哈希，不再重新扫描字符串
+            return static_cast<std::size_t>(value.GetStringObject()->GetHash());
         }
+        if (value.IsNumber()) {
+            return std::hash<double>{}(value.GetNumber());
+        }
+        return std::hash<uint64_t>{}(value.GetRawBits());
     }
 };
 
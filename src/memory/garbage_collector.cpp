@@ -7,11 +7,19 @@
  */
 
 #include "garbage_collector.h"
+#include "string_table.h"
+#include "memory_manager.h"
+#include "object_arena.h"
 #include "vm/virtual_machine.h"
 #include "types/lua_table.h"
 #include <algorithm>
 #include <iostream>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <utility>
 
 namespace lua_cpp {
 
@@ -38,6 +46,31 @@ void GCObject::CallFinalizer() {
     }
 }
 
+void GCObject::RememberSlow() {
+    if (collector_) {
+        collector_->Remember(this);
+    }
+}
+
+void GCObject::BarrierBackSlow() {
+    if (collector_) {
+        collector_->BarrierBack(this);
+    }
+}
+
+void GCObject::RecordArenaEscapeSlow() {
+    if (ObjectArena* arena = ObjectArena::GetActive()) {
+        arena->RecordEscape(this);
+    }
+}
+
+std::vector<GCObject*> GCObject::GetReferences() const {
+    std::vector<GCObject*> refs;
+    GCMarker collector(refs);
+    Traverse(collector);
+    return refs;
+}
+
 std::string GCObject::ToString() const {
     std::ostringstream oss;
     oss << "GCObject[type=";
@@ -73,21 +106,64 @@ std::string GCObject::GetDebugInfo() const {
 
 StringObject::StringObject(const std::string& str)
     : GCObject(GCObjectType::String, str.length() + sizeof(StringObject))
-    , str_(str) {
+    , str_(str)
+    , hash_(0)
+    , has_hash_(false) {
+    if (str_.size() <= kMaxShortLength) {
+        hash_ = ComputeHash(str_.data(), str_.size());
+        has_hash_ = true;
+    }
+}
+
+StringObject::StringObject(const char* str, Size length, uint64_t hash)
+    : GCObject(GCObjectType::String, length + sizeof(StringObject))
+    , str_(str, length)
+    , hash_(hash)
+    , has_hash_(true) {
 }
 
-void StringObject::Mark(GarbageCollector* gc) {
-    // 字符串对象没有子引用，直接标记为黑色
-    SetColor(GCColor::Black);
+StringObject::StringObject(std::shared_ptr<std::string> buffer, Size length)
+    : GCObject(GCObjectType::String, length + sizeof(StringObject))
+    , hash_(0)
+    , has_hash_(false)
+    , builder_(std::move(buffer))
+    , builder_length_(length) {
 }
 
-std::vector<GCObject*> StringObject::GetReferences() const {
-    // 字符串对象没有子引用
-    return {};
+void StringObject::Flatten() const {
+    str_.assign(builder_->data(), builder_length_);
+    builder_.reset();
+}
+
+bool StringObject::Equals(const StringObject* other) const {
+    if (this == other) {
+        return true;
+    }
+    if (SharesInternTable(other)) {
+        return false;  // 同一驻留表中内容唯一
+    }
+    Size length = GetLength();
+    if (length != other->GetLength()) {
+        return false;
+    }
+    if (has_hash_ && other->has_hash_ && hash_ != other->hash_) {
+        return false;
+    }
+    return std::memcmp(GetData(), other->GetData(), length) == 0;
+}
+
+uint64_t StringObject::ComputeHash(const char* str, Size length) {
+    // 与luaS_newlstr相同：长字符串只采样不超过32个字符
+    uint64_t h = static_cast<uint64_t>(length);
+    Size step = (length >> 5) + 1;
+    for (Size l1 = length; l1 >= step; l1 -= step) {
+        h = h ^ ((h << 5) + (h >> 2) + static_cast<unsigned char>(str[l1 - 1]));
+    }
+    return h;
 }
 
 std::string StringObject::ToString() const {
-    return "\"" + str_ + "\"";
+    return "\"" + GetString() + "\"";
 }
 
 /* ========================================================================== */
@@ -96,69 +172,52 @@ std::string StringObject::ToString() const {
 
 TableObject::TableObject(Size array_size, Size hash_size)
     : GCObject(GCObjectType::Table, sizeof(TableObject))
-    , array_size_(array_size)
-    , hash_size_(hash_size)
-    , table_(std::make_shared<LuaTable>()) {
-    
-    // 估算表的内存大小
-    Size estimated_size = sizeof(TableObject) + 
-                         array_size * sizeof(LuaValue) +
-                         hash_size * (sizeof(LuaValue) + sizeof(LuaValue));
-    SetSize(estimated_size);
+    , table_(array_size, hash_size) {
+    UpdateSize();
 }
 
 void TableObject::Set(const LuaValue& key, const LuaValue& value) {
-    if (table_) {
-        table_->Set(key, value);
-        
-        // 更新大小估算
-        Size new_size = sizeof(TableObject) + 
-                       table_->GetArraySize() * sizeof(LuaValue) +
-                       table_->GetHashSize() * (sizeof(LuaValue) + sizeof(LuaValue));
-        SetSize(new_size);
+    Size array_before = table_.GetArraySize();
+    Size hash_before = table_.GetHashSize();
+    
+    table_.Set(key, value);
+    WriteBarrier(key);
+    WriteBarrier(value);
+    
+    // 只有rehash改变容量时才需要刷新大小估算
+    if (table_.GetArraySize() != array_before || table_.GetHashSize() != hash_before) {
+        UpdateSize();
     }
 }
 
 LuaValue TableObject::Get(const LuaValue& key) const {
-    if (table_) {
-        return table_->Get(key);
-    }
-    return LuaValue();
+    return table_.Get(key);
 }
 
-Size TableObject::Size() const {
-    return table_ ? table_->Size() : 0;
+void TableObject::ResizeArray(Size array_size) {
+    table_.ResizeArray(array_size);
+    UpdateSize();
 }
 
-void TableObject::Mark(GarbageCollector* gc) {
-    if (GetColor() != GCColor::White) {
-        return; // 已经标记过
-    }
-    
-    // 标记为灰色并加入灰色列表
-    SetColor(GCColor::Gray);
-    gc->AddToGrayList(this);
+void TableObject::UpdateSize() {
+    SetSize(sizeof(TableObject) - sizeof(LuaTable) + table_.GetMemoryFootprint());
 }
 
-std::vector<GCObject*> TableObject::GetReferences() const {
-    std::vector<GCObject*> refs;
+void TableObject::Traverse(GCMarker& marker) const {
+    // 表中所有键值的GC引用（包括墓碑键）
+    table_.ForEachSlotValue([&marker](const LuaValue& value) {
+        marker.Mark(value);
+    });
     
-    if (table_) {
-        // 收集表中所有值的GC引用
-        auto pairs = table_->GetAllPairs();
-        for (const auto& pair : pairs) {
-            // 检查键
-            if (pair.first.IsGCObject()) {
-                refs.push_back(pair.first.GetGCObject());
-            }
-            // 检查值
-            if (pair.second.IsGCObject()) {
-                refs.push_back(pair.second.GetGCObject());
-            }
-        }
+    marker.Mark(metatable_);
+}
+
+void TableObject::ForwardArenaReferences(ObjectArena& arena) {
+    arena.ForwardTable(table_);
+    if (metatable_ && metatable_->IsArenaAllocated()) {
+        metatable_ = arena.Forward(LuaValue(metatable_)).GetTable();
     }
-    
-    return refs;
+    UpdateSize();
 }
 
 /* ========================================================================== */
@@ -172,50 +231,94 @@ FunctionObject::FunctionObject(const Proto* proto)
     // 估算函数对象大小
     Size estimated_size = sizeof(FunctionObject);
     if (proto_) {
-        estimated_size += proto_->instructions.size() * sizeof(Instruction);
-        estimated_size += proto_->constants.size() * sizeof(LuaValue);
+        estimated_size += proto_->GetCodeSize() * sizeof(Instruction);
+        estimated_size += proto_->GetConstantCount() * sizeof(LuaValue);
     }
     SetSize(estimated_size);
 }
 
-void FunctionObject::Mark(GarbageCollector* gc) {
-    if (GetColor() != GCColor::White) {
-        return;
+void MarkProtoConstants(GCMarker& marker, const Proto& proto) {
+    for (const LuaValue& constant : proto.GetConstants()) {
+        marker.Mark(constant);
+    }
+    for (const auto& nested : proto.GetProtos()) {
+        if (nested) {
+            MarkProtoConstants(marker, *nested);
+        }
+    }
+}
+
+void FunctionObject::Traverse(GCMarker& marker) const {
+    if (proto_) {
+        MarkProtoConstants(marker, *proto_);
     }
     
-    SetColor(GCColor::Gray);
-    gc->AddToGrayList(this);
+    for (const auto& upvalue : upvalues_) {
+        marker.Mark(upvalue);
+    }
 }
 
-std::vector<GCObject*> FunctionObject::GetReferences() const {
-    std::vector<GCObject*> refs;
+void FunctionObject::ForwardArenaReferences(ObjectArena& arena) {
+    for (auto& upvalue : upvalues_) {
+        upvalue = arena.Forward(upvalue);
+    }
+}
+
+/* ========================================================================== */
+/* PauseHistogram实现 */
+/* ========================================================================== */
+
+void PauseHistogram::Record(double seconds) {
+    double micros = seconds * 1e6;
+    Size bucket = 0;
+    while (bucket + 1 < kBucketCount && micros >= static_cast<double>(Size{1} << bucket)) {
+        bucket++;
+    }
     
-    if (proto_) {
-        // 标记常量表中的GC对象
-        for (const auto& constant : proto_->constants) {
-            if (constant.IsGCObject()) {
-                refs.push_back(constant.GetGCObject());
-            }
-        }
-        
-        // 标记嵌套函数
-        for (const auto& nested : proto_->nested_functions) {
-            if (nested) {
-                // 这里需要将Proto*转换为GCObject*
-                // 实际实现中Proto也应该是GCObject的子类
-            }
-        }
+    buckets[bucket]++;
+    count++;
+    total_time += seconds;
+    max_time = std::max(max_time, seconds);
+}
+
+double PauseHistogram::Percentile(double fraction) const {
+    if (count == 0) {
+        return 0.0;
     }
     
-    return refs;
+    Size target = static_cast<Size>(std::ceil(fraction * static_cast<double>(count)));
+    target = std::clamp<Size>(target, 1, count);
+    
+    Size seen = 0;
+    for (Size bucket = 0; bucket < kBucketCount; bucket++) {
+        seen += buckets[bucket];
+        if (seen >= target) {
+            double upper = static_cast<double>(Size{1} << bucket) * 1e-6;
+            return std::min(upper, max_time);
+        }
+    }
+    return max_time;
 }
 
 /* ========================================================================== */
 /* GarbageCollector主类实现 */
 /* ========================================================================== */
 
+namespace {
+
+/**
+ * @brief 分配收集器编号，从1开始，0表示线程本地缓存为空
+ */
+uint64_t NextCollectorId() {
+    static std::atomic<uint64_t> next_id{1};
+    return next_id.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace
+
 GarbageCollector::GarbageCollector(VirtualMachine* vm)
     : vm_(vm)
+    , id_(NextCollectorId())
     , state_(GCState::Pause)
     , total_bytes_(0)
     , gc_threshold_(config_.initial_threshold)
@@ -223,10 +326,10 @@ GarbageCollector::GarbageCollector(VirtualMachine* vm)
     , collection_count_(0)
     , object_count_(0)
     , all_objects_(nullptr)
-    , gray_list_(nullptr)
-    , gray_count_(0)
     , sweep_current_(nullptr)
-    , pause_start_time_(std::chrono::steady_clock::now()) {
+    , pause_start_time_(std::chrono::steady_clock::now())
+    , string_table_(nullptr)
+    , object_allocator_(nullptr) {
     
     // 初始化统计信息
     stats_.collections_performed = 0;
@@ -248,56 +351,230 @@ GarbageCollector::~GarbageCollector() {
 void GarbageCollector::RegisterObject(GCObject* obj) {
     if (!obj) return;
     
-    std::lock_guard<std::mutex> lock(gc_mutex_);
+    obj->collector_ = this;
     
-    // 加入全局对象链表
-    obj->gc_next_ = all_objects_;
-    obj->gc_prev_ = nullptr;
-    
-    if (all_objects_) {
-        all_objects_->gc_prev_ = obj;
+    if (config_.threading_mode == GCThreadingMode::Concurrent) {
+        // 压入本线程的链表，统计和GC触发推迟到安全点
+        LocalObjectList& list = GetLocalObjectList();
+        GCObject* head = list.head.load(std::memory_order_relaxed);
+        do {
+            obj->gc_next_ = head;
+        } while (!list.head.compare_exchange_weak(head, obj, std::memory_order_release,
+                                                  std::memory_order_relaxed));
+        return;
     }
-    all_objects_ = obj;
     
-    // 更新统计
+    // 更新统计；一轮增量收集进行中时新分配计入债务
     total_bytes_ += obj->GetSize();
-    object_count_++;
+    if (state_ != GCState::Pause) {
+        gc_debt_ += obj->GetSize();
+    }
     
     if (total_bytes_ > stats_.max_memory_used) {
         stats_.max_memory_used = total_bytes_;
     }
     
-    // 检查是否需要触发GC
+    // 先推进收集再链接：新对象此时只被调用方持有，不能在本次触发的收集中被回收
     if (config_.enable_auto_gc && ShouldTriggerGC()) {
         TriggerGC();
     }
+    
+    // 单所有者模式：新对象直接进入新生代；一轮收集进行中分配的对象存活到下一轮
+    LinkObject(obj);
+    object_count_++;
+    if (state_ != GCState::Pause) {
+        obj->SetColor(GCColor::Black);
+    }
 }
 
 void GarbageCollector::UnregisterObject(GCObject* obj) {
     if (!obj) return;
     
-    std::lock_guard<std::mutex> lock(gc_mutex_);
+    auto lock = LockForMode();
+    
+    // 对象可能还在某个线程本地链表中，先全部拼接
+    SpliceLocalLists();
+    
+    // 灰色对象还在标记栈中
+    if (obj->GetColor() == GCColor::Gray) {
+        marker_.Remove(obj);
+    }
+    if (sweep_current_ == obj) {
+        sweep_current_ = obj->gc_next_;
+    }
     
     // 从链表中移除
+    UnlinkObject(obj);
+    obj->collector_ = nullptr;
+    ForgetArenaEscape(obj);
+    
+    // 更新统计
+    total_bytes_ -= obj->GetSize();
+    object_count_--;
+}
+
+void GarbageCollector::Safepoint() {
+    auto lock = LockForMode();
+    
+    SpliceLocalLists();
+    if (config_.enable_auto_gc && ShouldTriggerGC()) {
+        TriggerGC();
+    }
+}
+
+GarbageCollector::LocalObjectList& GarbageCollector::GetLocalObjectList() {
+    // 缓存本线程最近使用的链表；按收集器编号匹配，收集器销毁后地址被复用也不会误命中
+    thread_local uint64_t cached_id = 0;
+    thread_local LocalObjectList* cached_list = nullptr;
+    if (cached_id == id_) {
+        return *cached_list;
+    }
+    
+    std::lock_guard<std::mutex> lock(local_lists_mutex_);
+    auto& list = local_lists_[std::this_thread::get_id()];
+    if (!list) {
+        list = std::make_unique<LocalObjectList>();
+    }
+    cached_id = id_;
+    cached_list = list.get();
+    return *list;
+}
+
+void GarbageCollector::SpliceLocalLists() {
+    if (config_.threading_mode != GCThreadingMode::Concurrent) {
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(local_lists_mutex_);
+    for (auto& entry : local_lists_) {
+        GCObject* obj = entry.second->head.exchange(nullptr, std::memory_order_acquire);
+        while (obj) {
+            GCObject* next = obj->gc_next_;
+            LinkObject(obj);
+            total_bytes_ += obj->GetSize();
+            object_count_++;
+            if (state_ != GCState::Pause) {
+                gc_debt_ += obj->GetSize();
+                obj->SetColor(GCColor::Black);
+            }
+            obj = next;
+        }
+    }
+    
+    if (total_bytes_ > stats_.max_memory_used) {
+        stats_.max_memory_used = total_bytes_;
+    }
+}
+
+std::unique_lock<std::recursive_mutex> GarbageCollector::LockForMode() const {
+    if (config_.threading_mode == GCThreadingMode::Concurrent) {
+        return std::unique_lock<std::recursive_mutex>(gc_mutex_);
+    }
+    return std::unique_lock<std::recursive_mutex>();
+}
+
+void GarbageCollector::LinkObject(GCObject* obj) {
+    GCObject*& head = obj->IsOld() ? old_objects_ : all_objects_;
+    
+    obj->gc_next_ = head;
+    obj->gc_prev_ = nullptr;
+    if (head) {
+        head->gc_prev_ = obj;
+    }
+    head = obj;
+    
+    if (obj->IsOld()) {
+        old_count_++;
+        old_bytes_ += obj->GetSize();
+    }
+}
+
+void GarbageCollector::UnlinkObject(GCObject* obj) {
+    GCObject*& head = obj->IsOld() ? old_objects_ : all_objects_;
+    
     if (obj->gc_prev_) {
         obj->gc_prev_->gc_next_ = obj->gc_next_;
     } else {
-        all_objects_ = obj->gc_next_;
+        head = obj->gc_next_;
     }
-    
     if (obj->gc_next_) {
         obj->gc_next_->gc_prev_ = obj->gc_prev_;
     }
+    obj->gc_next_ = nullptr;
+    obj->gc_prev_ = nullptr;
     
-    // 从灰色列表中移除（如果在其中）
-    RemoveFromGrayList(obj);
+    if (obj->IsOld()) {
+        old_count_--;
+        old_bytes_ -= std::min(old_bytes_, obj->GetSize());  // 晋升后大小可能变化
+    }
+    if (obj->remembered_) {
+        obj->remembered_ = false;
+        remembered_set_.erase(std::find(remembered_set_.begin(), remembered_set_.end(), obj));
+    }
+}
+
+void GarbageCollector::FreeObject(GCObject* obj) {
+    // 调用清理函数
+    obj->Cleanup();
     
-    // 更新统计
+    // 从链表中移除
+    UnlinkObject(obj);
+    obj->collector_ = nullptr;
     total_bytes_ -= obj->GetSize();
     object_count_--;
     
-    obj->gc_next_ = nullptr;
-    obj->gc_prev_ = nullptr;
+    // 加入终结列表（如果有终结器）
+    if (obj->HasFinalizer()) {
+        finalization_list_.push_back(obj);
+    } else {
+        ReleaseObject(obj);
+    }
+}
+
+void GarbageCollector::ReleaseObject(GCObject* obj) {
+    ForgetArenaEscape(obj);
+    
+    uint8_t size_class = obj->size_class_;
+    if (size_class != SlabAllocator::kNoSizeClass && object_allocator_) {
+        obj->~GCObject();
+        object_allocator_->DeallocateBlock(obj, size_class);
+    } else {
+        delete obj;
+    }
+}
+
+void GarbageCollector::ForgetArenaEscape(GCObject* obj) {
+    if (obj->arena_escape_) {
+        if (ObjectArena* arena = ObjectArena::GetActive()) {
+            arena->ForgetEscape(obj);
+        }
+    }
+}
+
+void GarbageCollector::BarrierBack(GCObject* obj) {
+    // 只有传播阶段需要：原子阶段一次完成，清除阶段的黑色对象下一轮才重新置白
+    if (state_ != GCState::Propagate) {
+        return;
+    }
+    
+    auto lock = LockForMode();
+    if (obj->GetColor() == GCColor::Black) {
+        obj->SetColor(GCColor::Gray);
+        marker_.Push(obj);
+    }
+}
+
+void GarbageCollector::Remember(GCObject* obj) {
+    if (!obj || obj->remembered_ || !obj->IsOld()) {
+        return;
+    }
+    
+    auto lock = LockForMode();
+    if (obj->remembered_) {
+        return;  // 并发模式下其他线程已经加入
+    }
+    obj->remembered_ = true;
+    remembered_set_.push_back(obj);
 }
 
 /* ========================================================================== */
@@ -305,14 +582,17 @@ void GarbageCollector::UnregisterObject(GCObject* obj) {
 /* ========================================================================== */
 
 void GarbageCollector::Collect() {
-    std::lock_guard<std::mutex> lock(gc_mutex_);
+    auto lock = LockForMode();
+    SpliceLocalLists();
     
     auto start_time = std::chrono::steady_clock::now();
     Size start_bytes = total_bytes_;
     Size start_objects = object_count_;
     
     try {
-        if (config_.enable_incremental) {
+        if (config_.enable_generational) {
+            PerformGenerationalCollection();
+        } else if (config_.enable_incremental) {
             PerformIncrementalCollection();
         } else {
             PerformFullCollection();
@@ -322,6 +602,9 @@ void GarbageCollector::Collect() {
         auto end_time = std::chrono::steady_clock::now();
         auto duration = std::chrono::duration<double>(end_time - start_time).count();
         
+        statistics_.total_gc_time += duration;
+        statistics_.max_pause_time = std::max(statistics_.max_pause_time, duration);
+        
         stats_.collections_performed++;
         stats_.total_freed_bytes += start_bytes - total_bytes_;
         stats_.total_freed_objects += start_objects - object_count_;
@@ -352,22 +635,62 @@ void GarbageCollector::PerformFullCollection() {
 }
 
 void GarbageCollector::PerformIncrementalCollection() {
-    Size steps_performed = 0;
-    const Size max_steps_per_cycle = 100;
+    if (state_ == GCState::Pause) {
+        StartMarkPhase();
+        state_ = GCState::Propagate;
+    }
+    RunIncrementalWork(SIZE_MAX);
+}
+
+void GarbageCollector::PerformIncrementalStep() {
+    auto lock = LockForMode();
+    auto start_time = std::chrono::steady_clock::now();
+    
+    if (state_ == GCState::Pause) {
+        StartMarkPhase();
+        state_ = GCState::Propagate;
+        gc_debt_ = 0;
+    }
+    
+    Size work_limit = std::max<Size>(step_size_ / 100 * static_cast<Size>(config_.step_multiplier), 1);
+    bool finished = RunIncrementalWork(work_limit);
+    gc_debt_ = gc_debt_ > step_size_ ? gc_debt_ - step_size_ : 0;
+    
+    auto end_time = std::chrono::steady_clock::now();
+    double duration = std::chrono::duration<double>(end_time - start_time).count();
+    statistics_.incremental_steps++;
+    statistics_.step_pauses.Record(duration);
+    statistics_.total_gc_time += duration;
+    statistics_.max_pause_time = std::max(statistics_.max_pause_time, duration);
     
-    while (steps_performed < max_steps_per_cycle) {
+    if (finished) {
+        // 本轮的最后一步可能没有用满工作量，不据此调整步长
+        gc_debt_ = 0;
+        stats_.collections_performed++;
+        collection_count_++;
+        last_collection_time_ = end_time;
+    } else {
+        AdaptStepSize(duration);
+    }
+}
+
+bool GarbageCollector::RunIncrementalWork(Size work_limit) {
+    // 终结器等在收集中途的分配不能重入收集
+    collecting_ = true;
+    struct ResetFlag {
+        bool& flag;
+        ~ResetFlag() { flag = false; }
+    } reset{collecting_};
+    
+    Size work = 0;
+    
+    while (work < work_limit) {
         switch (state_) {
             case GCState::Pause:
-                if (ShouldStartCollection()) {
-                    StartMarkPhase();
-                    state_ = GCState::Propagate;
-                } else {
-                    return; // 不需要收集
-                }
-                break;
+                return true;
                 
             case GCState::Propagate:
-                if (PerformMarkStep()) {
+                if (PerformMarkStep(work, work_limit)) {
                     state_ = GCState::AtomicMark;
                 }
                 break;
@@ -378,7 +701,7 @@ void GarbageCollector::PerformIncrementalCollection() {
                 break;
                 
             case GCState::Sweep:
-                if (PerformSweepStep()) {
+                if (PerformSweepStep(work, work_limit)) {
                     state_ = GCState::Finalize;
                 }
                 break;
@@ -386,11 +709,170 @@ void GarbageCollector::PerformIncrementalCollection() {
             case GCState::Finalize:
                 PerformFinalize();
                 state_ = GCState::Pause;
-                return; // 完成一轮收集
+                return true; // 完成一轮收集
+        }
+    }
+    
+    return false;
+}
+
+/* ========================================================================== */
+/* 分代收集 */
+/* ========================================================================== */
+
+void GarbageCollector::PerformGenerationalCollection() {
+    auto start_time = std::chrono::steady_clock::now();
+    
+    bool major = NeedsMajorCollection();
+    if (major) {
+        PerformMajorCollection();
+    } else {
+        PerformMinorCollection();
+    }
+    
+    double pause = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    if (major) {
+        statistics_.major_pauses.Record(pause);
+    } else {
+        statistics_.minor_pauses.Record(pause);
+    }
+}
+
+bool GarbageCollector::NeedsMajorCollection() const {
+    Size base = std::max(major_base_bytes_, config_.initial_threshold);
+    return old_bytes_ > base + base / 100 * static_cast<Size>(config_.major_multiplier);
+}
+
+void GarbageCollector::PerformMinorCollection() {
+    // 1. 只把新生代置白，老年代保持黑色，标记不会进入老年代
+    for (GCObject* obj = all_objects_; obj; obj = obj->gc_next_) {
+        obj->SetColor(GCColor::White);
+    }
+    marker_.Clear();
+    
+    // 2. 根集合加上记忆集中老年代对象的直接引用
+    MarkRoots();
+    for (GCObject* obj : remembered_set_) {
+        obj->Traverse(marker_);
+    }
+    PropagateMarks();
+    
+    if (string_table_) {
+        string_table_->SweepDead();
+    }
+    
+    // 3. 清除新生代；存活足够次数的对象移入老年代链表
+    std::vector<GCObject*> promoted;
+    GCObject* obj = all_objects_;
+    while (obj) {
+        GCObject* next = obj->gc_next_;
+        
+        if (obj->GetColor() == GCColor::White) {
+            FreeObject(obj);
+        } else if (static_cast<int>(obj->age_) + 1 >= config_.promotion_age) {
+            UnlinkObject(obj);
+            obj->generation_ = GCGeneration::Old;
+            obj->SetColor(GCColor::Black);
+            LinkObject(obj);
+            promoted.push_back(obj);
+        } else if (obj->age_ < UINT8_MAX) {
+            obj->age_++;
         }
         
-        steps_performed++;
+        obj = next;
     }
+    
+    // 4. 重建记忆集：子对象都已晋升的老对象移出，仍引用新生代的新晋升对象加入
+    std::vector<GCObject*> remembered;
+    for (GCObject* old : remembered_set_) {
+        if (HasYoungReference(old)) {
+            remembered.push_back(old);
+        } else {
+            old->remembered_ = false;
+        }
+    }
+    for (GCObject* old : promoted) {
+        if (!old->remembered_ && HasYoungReference(old)) {
+            old->remembered_ = true;
+            remembered.push_back(old);
+        }
+    }
+    remembered_set_.swap(remembered);
+    
+    statistics_.minor_collections++;
+    statistics_.objects_promoted += promoted.size();
+    
+    FinalizePhase();
+}
+
+void GarbageCollector::PerformMajorCollection() {
+    // 全堆标记，记忆集在收集后不再需要
+    for (GCObject* obj : remembered_set_) {
+        obj->remembered_ = false;
+    }
+    remembered_set_.clear();
+    
+    MarkPhase();
+    
+    GCObject* obj = old_objects_;
+    while (obj) {
+        GCObject* next = obj->gc_next_;
+        if (obj->GetColor() == GCColor::White) {
+            FreeObject(obj);
+        }
+        obj = next;
+    }
+    
+    // 存活的新生代全部晋升，收集后新生代为空，老年代之间的引用不需要记忆集
+    obj = all_objects_;
+    while (obj) {
+        GCObject* next = obj->gc_next_;
+        if (obj->GetColor() == GCColor::White) {
+            FreeObject(obj);
+        } else {
+            UnlinkObject(obj);
+            obj->generation_ = GCGeneration::Old;
+            LinkObject(obj);
+            statistics_.objects_promoted++;
+        }
+        obj = next;
+    }
+    
+    // 重新统计老年代大小，修正晋升后对象大小变化带来的误差
+    old_bytes_ = 0;
+    for (obj = old_objects_; obj; obj = obj->gc_next_) {
+        old_bytes_ += obj->GetSize();
+    }
+    major_base_bytes_ = old_bytes_;
+    
+    statistics_.major_collections++;
+    
+    FinalizePhase();
+}
+
+bool GarbageCollector::HasYoungReference(const GCObject* obj) {
+    for (GCObject* ref : obj->GetReferences()) {
+        if (ref && !ref->IsOld()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void GarbageCollector::LeaveGenerationalMode() {
+    for (GCObject* obj : remembered_set_) {
+        obj->remembered_ = false;
+    }
+    remembered_set_.clear();
+    
+    while (old_objects_) {
+        GCObject* obj = old_objects_;
+        UnlinkObject(obj);
+        obj->generation_ = GCGeneration::Young;
+        obj->age_ = 0;
+        LinkObject(obj);
+    }
+    major_base_bytes_ = 0;
 }
 
 /* ========================================================================== */
@@ -406,21 +888,28 @@ void GarbageCollector::MarkPhase() {
     
     // 3. 传播标记
     PropagateMarks();
+    
+    // 4. 驻留表弱清扫，未标记的字符串随后在清除阶段释放
+    if (string_table_) {
+        string_table_->SweepDead();
+    }
 }
 
 void GarbageCollector::ResetColors() {
-    GCObject* obj = all_objects_;
-    while (obj) {
-        obj->SetColor(GCColor::White);
-        obj = obj->gc_next_;
+    for (GCObject* list : {all_objects_, old_objects_}) {
+        for (GCObject* obj = list; obj; obj = obj->gc_next_) {
+            obj->SetColor(GCColor::White);
+        }
     }
     
-    // 清空灰色列表
-    gray_list_ = nullptr;
-    gray_count_ = 0;
+    // 清空标记栈
+    marker_.Clear();
 }
 
 void GarbageCollector::MarkRoots() {
+    // arena对象不在对象链表中，作用域内总是视为根
+    MarkArenaObjects();
+    
     if (!vm_) return;
     
     // 标记虚拟机栈
@@ -439,49 +928,54 @@ void GarbageCollector::MarkRoots() {
 void GarbageCollector::MarkVMStack() {
     if (!vm_) return;
     
-    Size stack_top = vm_->GetStackTop();
+    vm_->MarkStacks(marker_);
+}
+
+void GarbageCollector::MarkArenaObjects() {
+    ObjectArena* arena = ObjectArena::GetActive();
+    if (!arena) return;
     
-    for (Size i = 0; i < stack_top; i++) {
-        const LuaValue& value = vm_->GetStack(i);
-        if (value.IsGCObject()) {
-            MarkObject(value.GetGCObject());
-        }
+    // arena对象先全部置黑，遍历时标记器跳过它们之间的引用；它们引用的
+    // 堆对象、疏散中的副本以及登记过的逃逸所有者都保持存活
+    for (GCObject* obj : arena->GetObjects()) {
+        obj->SetColor(GCColor::Black);
+    }
+    for (GCObject* obj : arena->GetObjects()) {
+        obj->Traverse(marker_);
+        MarkObject(ObjectArena::GetForwardingAddress(obj));
+    }
+    for (GCObject* owner : arena->GetEscapedOwners()) {
+        MarkObject(owner);
     }
 }
 
 void GarbageCollector::MarkGlobals() {
-    // 标记全局变量表
-    // 这里需要VM提供访问全局变量的接口
-    // 暂时跳过，等VM接口完善后再实现
+    if (!vm_) return;
+    
+    vm_->MarkGlobals(marker_);
 }
 
 void GarbageCollector::MarkCallStack() {
     if (!vm_) return;
     
-    // 通过VM的栈跟踪来标记调用栈中的对象
-    // 这里需要VM提供更详细的调用栈访问接口
-    // 暂时跳过
+    // 执行中原型的常量池（字符串常量等）不属于任何GC对象
+    vm_->MarkCallFrames(marker_);
 }
 
 void GarbageCollector::MarkRegistry() {
-    // 标记注册表中的对象
-    // 注册表通常是一个特殊的表对象
-    // 暂时跳过，等VM接口完善后再实现
+    if (!vm_) return;
+    
+    // 协程栈等由VM组件登记的额外根
+    vm_->MarkExternalRoots(marker_);
 }
 
 void GarbageCollector::MarkObject(GCObject* obj) {
-    if (!obj || obj->GetColor() != GCColor::White) {
-        return;
-    }
-    
-    // 调用对象的标记方法
-    obj->Mark(this);
+    marker_.Mark(obj);
 }
 
 void GarbageCollector::PropagateMarks() {
-    while (gray_list_) {
-        GCObject* obj = PopFromGrayList();
-        PropagateMarkFrom(obj);
+    while (!marker_.IsEmpty()) {
+        PropagateMarkFrom(marker_.Pop());
     }
 }
 
@@ -490,15 +984,8 @@ void GarbageCollector::PropagateMarkFrom(GCObject* obj) {
         return;
     }
     
-    // 获取所有引用的对象
-    auto refs = obj->GetReferences();
-    
-    // 标记所有引用的对象
-    for (GCObject* ref : refs) {
-        if (ref && ref->GetColor() == GCColor::White) {
-            ref->Mark(this);
-        }
-    }
+    // 白色子对象直接压入标记栈
+    obj->Traverse(marker_);
     
     // 将对象标记为黑色
     obj->SetColor(GCColor::Black);
@@ -509,35 +996,23 @@ void GarbageCollector::PropagateMarkFrom(GCObject* obj) {
 /* ========================================================================== */
 
 void GarbageCollector::SweepPhase() {
-    GCObject* obj = all_objects_;
-    GCObject* next;
-    
     Size freed_bytes = 0;
     Size freed_objects = 0;
     
-    while (obj) {
-        next = obj->gc_next_;
-        
-        if (obj->GetColor() == GCColor::White) {
-            // 未标记的对象，需要回收
-            freed_bytes += obj->GetSize();
-            freed_objects++;
-            
-            // 调用清理函数
-            obj->Cleanup();
+    for (GCObject* list : {all_objects_, old_objects_}) {
+        GCObject* obj = list;
+        while (obj) {
+            GCObject* next = obj->gc_next_;
             
-            // 从链表中移除
-            UnregisterObject(obj);
-            
-            // 加入终结列表（如果有终结器）
-            if (obj->HasFinalizer()) {
-                finalization_list_.push_back(obj);
-            } else {
-                delete obj;
+            if (obj->GetColor() == GCColor::White) {
+                // 未标记的对象，需要回收
+                freed_bytes += obj->GetSize();
+                freed_objects++;
+                FreeObject(obj);
             }
+            
+            obj = next;
         }
-        
-        obj = next;
     }
     
     // 更新统计
@@ -553,73 +1028,133 @@ void GarbageCollector::FinalizePhase() {
     for (GCObject* obj : finalization_list_) {
         if (obj) {
             obj->CallFinalizer();
-            delete obj;
+            ReleaseObject(obj);
         }
     }
     finalization_list_.clear();
 }
 
 /* ========================================================================== */
-/* 灰色列表管理 */
+/* 标记栈实现 */
 /* ========================================================================== */
 
-void GarbageCollector::AddToGrayList(GCObject* obj) {
-    if (!obj || obj->GetColor() != GCColor::Gray) {
-        return;
+GCMarker::~GCMarker() {
+    while (top_) {
+        Chunk* previous = top_->previous;
+        delete top_;
+        top_ = previous;
     }
-    
-    // 简单的链表实现
-    obj->gc_next_ = gray_list_;
-    gray_list_ = obj;
-    gray_count_++;
+    delete spare_;
 }
 
-GCObject* GarbageCollector::PopFromGrayList() {
-    if (!gray_list_) {
-        return nullptr;
+void GCMarker::PushSlow(GCObject* obj) {
+    Chunk* chunk = nullptr;
+    if (chunk_count_ < kMaxChunks) {
+        chunk = spare_ ? std::exchange(spare_, nullptr) : new(std::nothrow) Chunk;
     }
     
-    GCObject* obj = gray_list_;
-    gray_list_ = obj->gc_next_;
-    gray_count_--;
+    if (chunk) {
+        chunk->previous = top_;
+        chunk->count = 0;
+        top_ = chunk;
+        chunk_count_++;
+        top_->entries[top_->count++] = obj;
+    } else {
+        // 栈已满：挂到对象自己的链接上，标记照常进行
+        obj->gray_next_ = overflow_;
+        overflow_ = obj;
+        overflow_count_++;
+    }
     
-    obj->gc_next_ = nullptr;
-    return obj;
+    depth_++;
+    peak_depth_ = std::max(peak_depth_, depth_);
 }
 
-void GarbageCollector::RemoveFromGrayList(GCObject* obj) {
-    if (!obj || !gray_list_) {
-        return;
+GCObject* GCMarker::PopSlow() {
+    // 当前块已空，退回有对象的块；最底下的块保留复用
+    while (top_ && top_->count == 0 && top_->previous) {
+        Chunk* chunk = top_;
+        top_ = chunk->previous;
+        chunk_count_--;
+        ReleaseChunk(chunk);
+    }
+    if (top_ && top_->count > 0) {
+        depth_--;
+        return top_->entries[--top_->count];
     }
     
-    if (gray_list_ == obj) {
-        gray_list_ = obj->gc_next_;
-        gray_count_--;
-        obj->gc_next_ = nullptr;
-        return;
+    if (overflow_) {
+        GCObject* obj = overflow_;
+        overflow_ = obj->gray_next_;
+        obj->gray_next_ = nullptr;
+        depth_--;
+        return obj;
+    }
+    return nullptr;
+}
+
+void GCMarker::ReleaseChunk(Chunk* chunk) {
+    if (!spare_) {
+        spare_ = chunk;
+    } else {
+        delete chunk;
+    }
+}
+
+void GCMarker::Remove(GCObject* obj) {
+    // 留下空槽而不是移动元素，弹出时跳过
+    for (Chunk* chunk = top_; chunk; chunk = chunk->previous) {
+        for (Size i = 0; i < chunk->count; ++i) {
+            if (chunk->entries[i] == obj) {
+                chunk->entries[i] = nullptr;
+                return;
+            }
+        }
     }
     
-    GCObject* current = gray_list_;
-    while (current && current->gc_next_) {
-        if (current->gc_next_ == obj) {
-            current->gc_next_ = obj->gc_next_;
-            gray_count_--;
-            obj->gc_next_ = nullptr;
+    for (GCObject** link = &overflow_; *link; link = &(*link)->gray_next_) {
+        if (*link == obj) {
+            *link = obj->gray_next_;
+            obj->gray_next_ = nullptr;
+            depth_--;
             return;
         }
-        current = current->gc_next_;
     }
 }
 
+void GCMarker::Clear() {
+    while (top_ && top_->previous) {
+        Chunk* chunk = top_;
+        top_ = chunk->previous;
+        chunk_count_--;
+        ReleaseChunk(chunk);
+    }
+    if (top_) {
+        top_->count = 0;
+    }
+    
+    while (overflow_) {
+        GCObject* obj = overflow_;
+        overflow_ = obj->gray_next_;
+        obj->gray_next_ = nullptr;
+    }
+    depth_ = 0;
+}
+
 /* ========================================================================== */
 /* GC触发条件和阈值管理 */
 /* ========================================================================== */
 
 bool GarbageCollector::ShouldTriggerGC() const {
-    if (!config_.enable_auto_gc) {
+    if (!config_.enable_auto_gc || collecting_) {
         return false;
     }
     
+    // 增量收集进行中：分配债务达到一个步长时执行下一步
+    if (state_ != GCState::Pause && config_.enable_incremental && !config_.enable_generational) {
+        return gc_debt_ >= step_size_;
+    }
+    
     return total_bytes_ >= gc_threshold_;
 }
 
@@ -628,17 +1163,37 @@ bool GarbageCollector::ShouldStartCollection() const {
 }
 
 void GarbageCollector::TriggerGC() {
-    if (state_ == GCState::Pause) {
+    if (config_.enable_incremental && !config_.enable_generational) {
+        PerformIncrementalStep();
+    } else if (state_ == GCState::Pause) {
         Collect();
     }
 }
 
 void GarbageCollector::AdjustThreshold() {
+    if (config_.enable_generational) {
+        // 分代模式：新分配达到当前内存的minor_multiplier%时进行下一次次要收集
+        Size step = total_bytes_ / 100 * static_cast<Size>(config_.minor_multiplier);
+        gc_threshold_ = total_bytes_ + std::max(step, config_.initial_threshold);
+        return;
+    }
+    
     // 基于当前内存使用调整阈值
     Size base_threshold = total_bytes_ * config_.pause_multiplier / 100;
     gc_threshold_ = std::max(base_threshold, config_.initial_threshold);
 }
 
+void GarbageCollector::AdaptStepSize(double duration) {
+    if (config_.target_pause_time <= 0.0 || duration <= 0.0) {
+        return;
+    }
+    
+    // 每次最多减半或加倍，单次抖动（缓存未命中、原子阶段）不会让步长剧烈摆动
+    double ratio = std::clamp(config_.target_pause_time / duration, 0.5, 2.0);
+    double next = static_cast<double>(step_size_) * ratio;
+    step_size_ = std::clamp(static_cast<Size>(next), kMinStepSize, kMaxStepSize);
+}
+
 /* ========================================================================== */
 /* 增量GC步骤实现 */
 /* ========================================================================== */
@@ -649,17 +1204,17 @@ void GarbageCollector::StartMarkPhase() {
     pause_start_time_ = std::chrono::steady_clock::now();
 }
 
-bool GarbageCollector::PerformMarkStep() {
-    const Size steps_per_call = 10;
-    Size steps = 0;
-    
-    while (gray_list_ && steps < steps_per_call) {
-        GCObject* obj = PopFromGrayList();
+bool GarbageCollector::PerformMarkStep(Size& work, Size work_limit) {
+    while (!marker_.IsEmpty() && work < work_limit) {
+        GCObject* obj = marker_.Pop();
+        if (!obj) {
+            continue;  // 已注销对象留下的空槽
+        }
+        work += std::max<Size>(obj->GetSize(), 1);
         PropagateMarkFrom(obj);
-        steps++;
     }
     
-    return gray_list_ == nullptr; // 返回true表示标记完成
+    return marker_.IsEmpty(); // 返回true表示标记完成
 }
 
 void GarbageCollector::PerformAtomicMark() {
@@ -668,33 +1223,28 @@ void GarbageCollector::PerformAtomicMark() {
     
     // 完成剩余的标记传播
     PropagateMarks();
+    
+    // 驻留表弱清扫必须在清除开始前完成，之后驻留查找不会再命中死字符串
+    if (string_table_) {
+        string_table_->SweepDead();
+    }
 }
 
-bool GarbageCollector::PerformSweepStep() {
-    const Size objects_per_step = 50;
-    Size processed = 0;
-    
+bool GarbageCollector::PerformSweepStep(Size& work, Size work_limit) {
     if (!sweep_current_) {
         sweep_current_ = all_objects_;
     }
     
-    while (sweep_current_ && processed < objects_per_step) {
+    while (sweep_current_ && work < work_limit) {
         GCObject* next = sweep_current_->gc_next_;
+        work += std::max<Size>(sweep_current_->GetSize(), 1);
         
         if (sweep_current_->GetColor() == GCColor::White) {
             // 回收对象
-            sweep_current_->Cleanup();
-            
-            if (sweep_current_->HasFinalizer()) {
-                finalization_list_.push_back(sweep_current_);
-            } else {
-                UnregisterObject(sweep_current_);
-                delete sweep_current_;
-            }
+            FreeObject(sweep_current_);
         }
         
         sweep_current_ = next;
-        processed++;
     }
     
     if (!sweep_current_) {
@@ -715,31 +1265,44 @@ void GarbageCollector::PerformFinalize() {
 /* ========================================================================== */
 
 void GarbageCollector::FreeAllObjects() {
-    std::lock_guard<std::mutex> lock(gc_mutex_);
+    auto lock = LockForMode();
+    SpliceLocalLists();
+    
+    // 标记栈溢出链经由对象链接，先于释放对象清空
+    marker_.Clear();
     
     // 首先清理终结列表
     for (GCObject* obj : finalization_list_) {
         if (obj) {
-            delete obj;
+            ReleaseObject(obj);
         }
     }
     finalization_list_.clear();
     
+    if (string_table_) {
+        string_table_->Clear();
+    }
+    
     // 然后清理所有对象
-    GCObject* obj = all_objects_;
-    while (obj) {
-        GCObject* next = obj->gc_next_;
-        obj->Cleanup();
-        delete obj;
-        obj = next;
+    for (GCObject* list : {all_objects_, old_objects_}) {
+        GCObject* obj = list;
+        while (obj) {
+            GCObject* next = obj->gc_next_;
+            obj->Cleanup();
+            ReleaseObject(obj);
+            obj = next;
+        }
     }
     
     all_objects_ = nullptr;
-    gray_list_ = nullptr;
+    old_objects_ = nullptr;
+    old_count_ = 0;
+    old_bytes_ = 0;
+    major_base_bytes_ = 0;
+    remembered_set_.clear();
     sweep_current_ = nullptr;
     total_bytes_ = 0;
     object_count_ = 0;
-    gray_count_ = 0;
 }
 
 /* ========================================================================== */
@@ -747,7 +1310,16 @@ void GarbageCollector::FreeAllObjects() {
 /* ========================================================================== */
 
 void GarbageCollector::SetConfig(const GCConfig& config) {
-    std::lock_guard<std::mutex> lock(gc_mutex_);
+    // 切换线程模式时不能有其他线程在注册对象
+    std::lock_guard<std::recursive_mutex> lock(gc_mutex_);
+    SpliceLocalLists();
+    if (config_.enable_generational && !config.enable_generational) {
+        LeaveGenerationalMode();
+    }
+    // 不再按增量方式推进时，先完成进行中的一轮
+    if (state_ != GCState::Pause && (!config.enable_incremental || config.enable_generational)) {
+        RunIncrementalWork(SIZE_MAX);
+    }
     config_ = config;
     
     // 重新调整阈值
@@ -755,12 +1327,12 @@ void GarbageCollector::SetConfig(const GCConfig& config) {
 }
 
 GCConfig GarbageCollector::GetConfig() const {
-    std::lock_guard<std::mutex> lock(gc_mutex_);
+    auto lock = LockForMode();
     return config_;
 }
 
 GCStats GarbageCollector::GetStats() const {
-    std::lock_guard<std::mutex> lock(gc_mutex_);
+    auto lock = LockForMode();
     
     GCStats stats = stats_;
     stats.current_memory_usage = total_bytes_;
@@ -770,6 +1342,29 @@ GCStats GarbageCollector::GetStats() const {
     return stats;
 }
 
+GCStatistics GarbageCollector::GetStatistics() const {
+    auto lock = LockForMode();
+    
+    GCStatistics statistics = statistics_;
+    statistics.total_collections = stats_.collections_performed;
+    statistics.total_freed = stats_.total_freed_bytes;
+    statistics.peak_memory_usage = stats_.max_memory_used;
+    statistics.current_memory_usage = total_bytes_;
+    statistics.average_pause_time = stats_.average_pause_time;
+    statistics.remembered_set_size = remembered_set_.size();
+    statistics.young_objects = object_count_ - old_count_;
+    statistics.old_objects = old_count_;
+    statistics.old_bytes = old_bytes_;
+    statistics.step_pause_p50 = statistics_.step_pauses.Percentile(0.50);
+    statistics.step_pause_p99 = statistics_.step_pauses.Percentile(0.99);
+    statistics.step_size = step_size_;
+    statistics.gc_debt = gc_debt_;
+    statistics.mark_stack_peak = marker_.GetPeakDepth();
+    statistics.mark_stack_overflows = marker_.GetOverflowCount();
+    
+    return statistics;
+}
+
 /* ========================================================================== */
 /* 调试和诊断 */
 /* ========================================================================== */
@@ -789,47 +1384,69 @@ void GarbageCollector::DumpStats() const {
 }
 
 void GarbageCollector::DumpObjects() const {
-    std::lock_guard<std::mutex> lock(gc_mutex_);
+    auto lock = LockForMode();
     
     std::cout << "=== GC Object Dump ===" << std::endl;
     std::cout << "Total objects: " << object_count_ << std::endl;
     
-    GCObject* obj = all_objects_;
     Size index = 0;
-    
-    while (obj && index < 100) { // 限制输出数量
-        std::cout << "[" << index << "] " << obj->GetDebugInfo() << std::endl;
-        obj = obj->gc_next_;
-        index++;
+    bool truncated = false;
+    
+    for (GCObject* list : {all_objects_, old_objects_}) {
+        GCObject* obj = list;
+        while (obj && index < 100) { // 限制输出数量
+            std::cout << "[" << index << "] " << obj->GetDebugInfo()
+                      << (obj->IsOld() ? " (old)" : "") << std::endl;
+            obj = obj->gc_next_;
+            index++;
+        }
+        truncated = truncated || obj != nullptr;
     }
     
-    if (obj) {
+    if (truncated) {
         std::cout << "... and " << (object_count_ - index) << " more objects" << std::endl;
     }
 }
 
 bool GarbageCollector::CheckConsistency() const {
-    std::lock_guard<std::mutex> lock(gc_mutex_);
+    auto lock = LockForMode();
     
     // 检查对象链表的一致性
     Size counted_objects = 0;
     Size counted_bytes = 0;
+    Size counted_old = 0;
     
-    GCObject* obj = all_objects_;
-    GCObject* prev = nullptr;
-    
-    while (obj) {
-        // 检查双向链表指针
-        if (obj->gc_prev_ != prev) {
-            std::cerr << "GC consistency error: Invalid prev pointer" << std::endl;
-            return false;
-        }
+    for (GCObject* list : {all_objects_, old_objects_}) {
+        GCObject* obj = list;
+        GCObject* prev = nullptr;
         
-        counted_objects++;
-        counted_bytes += obj->GetSize();
-        
-        prev = obj;
-        obj = obj->gc_next_;
+        while (obj) {
+            // 检查双向链表指针
+            if (obj->gc_prev_ != prev) {
+                std::cerr << "GC consistency error: Invalid prev pointer" << std::endl;
+                return false;
+            }
+            
+            // 检查对象在所属代的链表中
+            if (obj->IsOld() != (list == old_objects_)) {
+                std::cerr << "GC consistency error: Object in wrong generation list" << std::endl;
+                return false;
+            }
+            
+            counted_objects++;
+            counted_bytes += obj->GetSize();
+            if (obj->IsOld()) {
+                counted_old++;
+            }
+            
+            prev = obj;
+            obj = obj->gc_next_;
+        }
+    }
+    
+    if (counted_old != old_count_) {
+        std::cerr << "GC consistency error: Old object count mismatch" << std::endl;
+        return false;
     }
     
     if (counted_objects != object_count_) {
@@ -2,14 +2,18 @@
 
 #include "core/lua_common.h"
 #include "types/value.h"
+#include "types/lua_table.h"
 #include "core/lua_errors.h"
 #include <memory>
 #include <vector>
 #include <functional>
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <unordered_set>
+#include <unordered_map>
 #include <mutex>
+#include <thread>
 
 namespace lua_cpp {
 
@@ -18,7 +22,11 @@ namespace lua_cpp {
 /* ========================================================================== */
 
 class VirtualMachine;
-class LuaTable;
+class GarbageCollector;
+class StringTable;
+class SlabAllocator;
+class ObjectArena;
+class GCMarker;
 
 /* ========================================================================== */
 /* GC错误类型 */
@@ -68,18 +76,38 @@ enum class WeakMode {
     KeysAndValues   // 键值都弱
 };
 
+/**
+ * @brief 对象所属的代（分代模式）
+ */
+enum class GCGeneration : uint8_t {
+    Young,          // 新生代：每次次要收集都会遍历
+    Old             // 老年代：只在主要收集时遍历，次要收集中视为已标记
+};
+
+/**
+ * @brief 对象注册的线程模式
+ */
+enum class GCThreadingMode {
+    SingleOwner,    // 单所有者：分配和收集都在同一线程，完全不加锁
+    Concurrent      // 并发：各线程注册到线程本地链表，在安全点拼接进对象链表
+};
+
 /**
  * @brief GC配置结构
  */
 struct GCConfig {
     Size initial_threshold = 1024;         // 初始GC阈值（字节）
-    int step_multiplier = 200;             // 步长乘数（百分比）
-    int pause_multiplier = 200;            // 暂停乘数（百分比）
+    int step_multiplier = 200;             // 步长乘数（百分比）：每偿还1字节分配债务完成的收集工作量
+    int pause_multiplier = 200;            // 暂停乘数（百分比）：内存增长到上轮结束时的此百分比才开始下一轮
     bool enable_incremental = true;        // 启用增量GC
-    bool enable_generational = false;      // 启用分代GC
+    bool enable_generational = false;      // 启用分代GC（启用后优先于增量GC）
+    int minor_multiplier = 20;             // 分代模式：新分配达到当前内存的此百分比时执行次要收集
+    int major_multiplier = 100;            // 分代模式：老年代比上次主要收集后增长超过此百分比时执行主要收集
+    int promotion_age = 2;                 // 分代模式：存活此次数的次要收集后晋升老年代
+    GCThreadingMode threading_mode = GCThreadingMode::SingleOwner;  // 对象注册的线程模式
     bool enable_auto_gc = true;           // 启用自动GC
     Size memory_limit = 0;                 // 内存限制（0为无限制）
-    double target_pause_time = 0.01;       // 目标暂停时间（秒）
+    double target_pause_time = 0.01;       // 目标暂停时间（秒）：增量步长按实测步骤耗时向它调整
 };
 
 /* ========================================================================== */
@@ -145,21 +173,93 @@ public:
      */
     bool IsMarked() const { return color_ != GCColor::White0 && color_ != GCColor::White1; }
     
+    /* ====================================================================== */
+    /* 分代支持 */
+    /* ====================================================================== */
+    
+    /**
+     * @brief 获取对象所属的代
+     */
+    GCGeneration GetGeneration() const { return generation_; }
+    
+    /**
+     * @brief 是否为老年代对象
+     */
+    bool IsOld() const { return generation_ == GCGeneration::Old; }
+    
+    /**
+     * @brief 获取已存活的次要收集次数
+     */
+    uint8_t GetAge() const { return age_; }
+    
+    /**
+     * @brief 是否在记忆集中
+     */
+    bool IsRemembered() const { return remembered_; }
+    
+    /**
+     * @brief 分代写屏障：老年代对象存入新生代对象的引用时，把自己加入记忆集
+     * 
+     * 次要收集只遍历新生代，老年代对象通过记忆集充当额外的根。
+     * 每个对象每轮只会进入一次记忆集，之后的写入只剩内联的几次比较。
+     */
+    void WriteBarrier(const GCObject* child) {
+        if (!child) {
+            return;
+        }
+        if (generation_ == GCGeneration::Old && !remembered_ &&
+            child->generation_ == GCGeneration::Young) {
+            RememberSlow();
+        }
+        // 增量标记：黑色对象存入白色对象时重新置灰，留到传播阶段再遍历
+        if (color_ == GCColor::Black && child->color_ == GCColor::White) {
+            BarrierBackSlow();
+        }
+        // arena对象存入arena外的对象即逃逸出作用域，登记一次供作用域结束时疏散
+        if (child->size_class_ == kArenaSizeClass && size_class_ != kArenaSizeClass &&
+            !arena_escape_) {
+            RecordArenaEscapeSlow();
+        }
+    }
+    
+    void WriteBarrier(const LuaValue& value) {
+        if (value.IsGCObject()) {
+            WriteBarrier(value.GetGCObject());
+        }
+    }
+    
+    /* ====================================================================== */
+    /* 分配来源 */
+    /* ====================================================================== */
+    
+    static constexpr uint8_t kNoSizeClass = 0xFF;     // 由new分配
+    static constexpr uint8_t kArenaSizeClass = 0xFE;  // 在arena作用域中分配
+    
+    /**
+     * @brief 是否是arena作用域中分配的临时对象
+     */
+    bool IsArenaAllocated() const { return size_class_ == kArenaSizeClass; }
+    
+    /**
+     * @brief 把引用的arena对象替换为疏散到堆上的副本（arena作用域结束时调用）
+     */
+    virtual void ForwardArenaReferences(ObjectArena&) {}
+    
     /* ====================================================================== */
     /* 标记和遍历 */
     /* ====================================================================== */
     
     /**
-     * @brief 标记对象（纯虚函数）
-     * @param gc 垃圾收集器实例
+     * @brief 遍历子对象（纯虚函数）：对引用的每个GC对象调用marker.Mark()
+     * @param marker 标记器，标记阶段直接压入收集器的标记栈
      */
-    virtual void Mark(class GarbageCollector* gc) = 0;
+    virtual void Traverse(GCMarker& marker) const = 0;
     
     /**
-     * @brief 获取对象引用的所有子对象
+     * @brief 获取对象引用的所有子对象（冷路径使用，标记阶段走Traverse）
      * @return 子对象列表
      */
-    virtual std::vector<GCObject*> GetReferences() const = 0;
+    std::vector<GCObject*> GetReferences() const;
     
     /**
      * @brief 清理对象内部资源（在回收前调用）
@@ -219,39 +319,332 @@ public:
     virtual std::string GetDebugInfo() const;
 
 private:
+    /**
+     * @brief 写屏障慢路径：加入所属收集器的记忆集
+     */
+    void RememberSlow();
+    
+    /**
+     * @brief 增量写屏障慢路径：通知所属收集器重新置灰
+     */
+    void BarrierBackSlow();
+    
+    /**
+     * @brief 逃逸屏障慢路径：登记到当前arena作用域
+     */
+    void RecordArenaEscapeSlow();
+    
     GCObjectType type_;         // 对象类型
     Size size_;                 // 对象大小
     GCColor color_;            // 对象颜色
+    GCGeneration generation_ = GCGeneration::Young;  // 所属的代
+    uint8_t age_ = 0;           // 已存活的次要收集次数
+    bool remembered_ = false;   // 是否在记忆集中
+    uint8_t size_class_ = kNoSizeClass;  // slab大小级别，或kNoSizeClass/kArenaSizeClass
+    bool arena_escape_ = false;  // 是否已登记为arena逃逸的所有者
     Finalizer finalizer_;       // 终结器函数
     
     // GC链表指针（由GC管理）
     friend class GarbageCollector;
+    friend class MemoryManager;
+    friend class ObjectArena;
+    friend class GCMarker;
+    GarbageCollector* collector_ = nullptr;  // 所属收集器（写屏障使用）
     GCObject* gc_next_;
     GCObject* gc_prev_;
+    GCObject* gray_next_ = nullptr;          // 标记栈溢出链接（不占用对象链表指针）
 };
 
+/* ========================================================================== */
+/* 标记栈 */
+/* ========================================================================== */
+
+/**
+ * @brief 标记器：收集器持有的分块标记栈
+ *
+ * 白色对象置灰后压栈，标记传播时弹出并调用Traverse()，子对象直接压入
+ * 同一个栈，整个标记过程不为单个对象分配内存。栈由固定大小的块组成，
+ * 块在收集之间保留复用；弹空的块只留一个备用，其余归还。
+ *
+ * 块数达到kMaxChunks或分配块失败时（极宽或极深的对象图），灰色对象
+ * 改挂到对象自带的溢出链接上，标记不会因为栈空间失败。字符串没有子对象，
+ * 直接置黑不入栈。
+ *
+ * 以收集模式构造时不改变颜色，只把遍历到的子对象追加到给定列表。
+ *
+ * 属于其他收集器（或不归任何收集器管理）的对象直接跳过：它们的颜色由
+ * 各自的收集器维护。多个状态共享的原型常量就是这种对象，若在这里改写
+ * 颜色，不同工作线程上的收集器会同时写同一个color_字段。
+ */
+class GCMarker {
+public:
+    static constexpr Size kChunkCapacity = 510;     // 每块的槽数（块大小4KB）
+    static constexpr Size kMaxChunks = 256;         // 块数上限，超出后溢出到对象链接
+    
+    /**
+     * @brief 标记模式
+     * @param owner 所属收集器，只标记该收集器注册的对象
+     */
+    explicit GCMarker(const GarbageCollector* owner) : owner_(owner) {}
+    
+    /**
+     * @brief 收集模式：只记录子对象，不标记
+     */
+    explicit GCMarker(std::vector<GCObject*>& sink) : sink_(&sink) {}
+    
+    ~GCMarker();
+    
+    // 禁用拷贝和移动（块链表由标记器独占）
+    LUA_NO_COPY_MOVE(GCMarker)
+    
+    /**
+     * @brief 标记对象：白色对象置灰入栈（字符串直接置黑），其他颜色或
+     *        不属于本收集器的对象忽略
+     */
+    void Mark(GCObject* obj) {
+        if (!obj) {
+            return;
+        }
+        if (sink_) {
+            sink_->push_back(obj);
+            return;
+        }
+        if (obj->collector_ != owner_) {
+            return;
+        }
+        if (obj->GetColor() != GCColor::White) {
+            return;
+        }
+        if (obj->GetType() == GCObjectType::String) {
+            obj->SetColor(GCColor::Black);
+            return;
+        }
+        obj->SetColor(GCColor::Gray);
+        Push(obj);
+    }
+    
+    void Mark(const LuaValue& value) {
+        if (value.IsGCObject()) {
+            Mark(value.GetGCObject());
+        }
+    }
+    
+    /**
+     * @brief 压入灰色对象
+     */
+    void Push(GCObject* obj) {
+        if (top_ && top_->count < kChunkCapacity) {
+            top_->entries[top_->count++] = obj;
+            depth_++;
+        } else {
+            PushSlow(obj);
+        }
+    }
+    
+    /**
+     * @brief 弹出一个灰色对象（可能是已移除对象留下的nullptr），栈空时返回nullptr
+     */
+    GCObject* Pop() {
+        if (top_ && top_->count > 0) {
+            depth_--;
+            return top_->entries[--top_->count];
+        }
+        return PopSlow();
+    }
+    
+    /**
+     * @brief 栈中是否还有灰色对象
+     */
+    bool IsEmpty() const { return depth_ == 0; }
+    
+    /**
+     * @brief 栈中的对象数（含溢出链上的对象）
+     */
+    Size GetDepth() const { return depth_; }
+    
+    /**
+     * @brief 移除对象（注销仍为灰色的对象时调用，线性扫描）
+     */
+    void Remove(GCObject* obj);
+    
+    /**
+     * @brief 丢弃所有灰色对象，保留一个块供下一轮复用
+     */
+    void Clear();
+    
+    /**
+     * @brief 栈深度峰值
+     */
+    Size GetPeakDepth() const { return peak_depth_; }
+    
+    /**
+     * @brief 溢出到对象链接的次数
+     */
+    Size GetOverflowCount() const { return overflow_count_; }
+
+private:
+    struct Chunk {
+        Chunk* previous;
+        Size count;
+        GCObject* entries[kChunkCapacity];
+    };
+    
+    /**
+     * @brief 当前块已满：换新块，无法换块时挂到溢出链
+     */
+    void PushSlow(GCObject* obj);
+    
+    /**
+     * @brief 当前块已空：退回上一块，块都空时从溢出链取
+     */
+    GCObject* PopSlow();
+    
+    /**
+     * @brief 归还一个空块（没有备用块时留作备用）
+     */
+    void ReleaseChunk(Chunk* chunk);
+    
+    Chunk* top_ = nullptr;                  // 栈顶块
+    Chunk* spare_ = nullptr;                // 备用空块
+    Size chunk_count_ = 0;                  // 栈中的块数
+    GCObject* overflow_ = nullptr;          // 溢出链（经gray_next_链接）
+    Size depth_ = 0;
+    Size peak_depth_ = 0;
+    Size overflow_count_ = 0;
+    std::vector<GCObject*>* sink_ = nullptr;  // 收集模式的输出列表
+    const GarbageCollector* owner_ = nullptr; // 标记模式的所属收集器
+};
+
+/**
+ * @brief 标记原型及其嵌套原型的常量（原型本身不是GC对象）
+ *
+ * 闭包与VM调用帧共用：正在执行的原型可能通过CLOSURE创建引用嵌套原型常量的闭包
+ */
+void MarkProtoConstants(GCMarker& marker, const class Proto& proto);
+
 /* ========================================================================== */
 /* 具体GC对象类型 */
 /* ========================================================================== */
 
 /**
  * @brief 字符串对象
+ *
+ * 短字符串（不超过kMaxShortLength）经StringTable驻留，相同内容只有一个对象，
+ * 哈希值在创建时计算；长字符串不驻留，哈希值在首次需要时计算。
  */
 class StringObject : public GCObject {
 public:
-    explicit StringObject(const std::string& str);
+    /**
+     * @brief 短字符串最大长度，不超过此长度的字符串会被驻留
+     */
+    static constexpr Size kMaxShortLength = 40;
+    
+    const std::string& GetString() const {
+        if (builder_) {
+            Flatten();
+        }
+        return str_;
+    }
+    
+    /**
+     * @brief 获取字符数据（不会展平拼接缓冲区）
+     */
+    const char* GetData() const { return builder_ ? builder_->data() : str_.data(); }
+    Size GetLength() const { return builder_ ? builder_length_ : str_.size(); }
+    
+    /**
+     * @brief 获取哈希值（短字符串创建时已计算，长字符串首次调用时计算）
+     */
+    uint64_t GetHash() const {
+        if (!has_hash_) {
+            hash_ = ComputeHash(GetData(), GetLength());
+            has_hash_ = true;
+        }
+        return hash_;
+    }
+    
+    /**
+     * @brief 是否仍是拼接缓冲区的视图
+     */
+    bool IsBuilder() const { return builder_ != nullptr; }
+    
+    /**
+     * @brief 是否可以直接在缓冲区末尾追加（本字符串是缓冲区的最长前缀）
+     */
+    bool CanAppendInPlace() const {
+        return builder_ && builder_->size() == builder_length_;
+    }
+    
+    /**
+     * @brief 获取拼接缓冲区（非视图时返回nullptr）
+     */
+    const std::shared_ptr<std::string>& GetBuilder() const { return builder_; }
+    
+    /**
+     * @brief 是否已驻留
+     */
+    bool IsInterned() const { return intern_table_ != nullptr; }
+    
+    /**
+     * @brief 两者是否驻留在同一张驻留表中（此时内容相同当且仅当指针相同）
+     *
+     * 每个状态有自己的驻留表，宿主在VM之外创建的字符串驻留在进程默认
+     * 管理器中，与VM执行中创建的同内容字符串是不同的对象。
+     */
+    bool SharesInternTable(const StringObject* other) const {
+        return intern_table_ && intern_table_ == other->intern_table_;
+    }
+    
+    /**
+     * @brief 内容相等比较，同一驻留表中的字符串只比较指针
+     */
+    bool Equals(const StringObject* other) const;
+    
+    /**
+     * @brief 计算字符串哈希（luaS_hash算法，长字符串按步长采样）
+     */
+    static uint64_t ComputeHash(const char* str, Size length);
     
-    const std::string& GetString() const { return str_; }
-    void Mark(GarbageCollector* gc) override;
-    std::vector<GCObject*> GetReferences() const override;
+    void Traverse(GCMarker&) const override {}
     std::string ToString() const override;
 
 private:
-    std::string str_;
+    // 只能经MemoryManager::NewString（短字符串先查驻留表）或arena创建，
+    // 不会出现未驻留的短字符串
+    friend class MemoryManager;
+    friend class ObjectArena;
+    friend class StringTable;
+    
+    explicit StringObject(const std::string& str);
+    StringObject(const char* str, Size length, uint64_t hash);
+    
+    /**
+     * @brief 构造拼接缓冲区视图（CONCAT的长字符串结果使用）
+     * @param buffer 共享的追加缓冲区
+     * @param length 本字符串对应的缓冲区前缀长度
+     *
+     * 内容在首次调用GetString()时才展平为独立的std::string
+     */
+    StringObject(std::shared_ptr<std::string> buffer, Size length);
+    
+    /**
+     * @brief 把缓冲区前缀复制为独立字符串并释放对缓冲区的引用
+     */
+    void Flatten() const;
+    
+    mutable std::string str_;
+    mutable uint64_t hash_;
+    mutable bool has_hash_;
+    mutable std::shared_ptr<std::string> builder_;  // 拼接缓冲区（展平后为空）
+    Size builder_length_ = 0;                       // 缓冲区中属于本字符串的前缀长度
+    const StringTable* intern_table_ = nullptr; // 所在的驻留表（未驻留为空）
+    StringObject* hash_next_ = nullptr;     // 驻留表桶链
 };
 
 /**
  * @brief 表对象
+ *
+ * GC包装的LuaTable，所有读写都直接落到内联的混合数组/哈希表上
  */
 class TableObject : public GCObject {
 public:
@@ -259,17 +652,43 @@ public:
     
     void Set(const LuaValue& key, const LuaValue& value);
     LuaValue Get(const LuaValue& key) const;
-    Size GetSize() const;
-    Size GetArraySize() const { return array_size_; }
-    Size GetHashSize() const { return hash_size_; }
+    LuaValue GetStr(StringObject* key) const { return table_.GetStr(key); }
+    Size GetSize() const { return table_.GetSize(); }
+    Size GetLength() const { return table_.Length(); }
+    Size GetArraySize() const { return table_.GetArraySize(); }
+    Size GetHashSize() const { return table_.GetHashSize(); }
+    
+    /**
+     * @brief 预先扩展数组部分（SETLIST使用）
+     */
+    void ResizeArray(Size array_size);
     
-    void Mark(GarbageCollector* gc) override;
-    std::vector<GCObject*> GetReferences() const override;
+    /**
+     * @brief 访问底层表
+     */
+    LuaTable& GetTable() { return table_; }
+    const LuaTable& GetTable() const { return table_; }
+    
+    /**
+     * @brief 元表（nil时为nullptr）
+     */
+    TableObject* GetMetatable() const { return metatable_; }
+    void SetMetatable(TableObject* metatable) {
+        metatable_ = metatable;
+        WriteBarrier(metatable);
+    }
+    
+    void Traverse(GCMarker& marker) const override;
+    void ForwardArenaReferences(ObjectArena& arena) override;
 
 private:
-    Size array_size_;
-    Size hash_size_;
-    std::shared_ptr<LuaTable> table_;
+    /**
+     * @brief 根据底层表的容量刷新对象大小估算
+     */
+    void UpdateSize();
+    
+    LuaTable table_;
+    TableObject* metatable_ = nullptr;
 };
 
 /**
@@ -280,8 +699,22 @@ public:
     explicit FunctionObject(const class Proto* proto);
     
     const class Proto* GetProto() const { return proto_; }
-    void Mark(GarbageCollector* gc) override;
-    std::vector<GCObject*> GetReferences() const override;
+    
+    /**
+     * @brief 上值访问（写入经过分代写屏障）
+     */
+    Size GetUpvalueCount() const { return upvalues_.size(); }
+    const LuaValue& GetUpvalue(Size index) const { return upvalues_[index]; }
+    void SetUpvalue(Size index, const LuaValue& value) {
+        if (index >= upvalues_.size()) {
+            upvalues_.resize(index + 1);
+        }
+        upvalues_[index] = value;
+        WriteBarrier(value);
+    }
+    
+    void Traverse(GCMarker& marker) const override;
+    void ForwardArenaReferences(ObjectArena& arena) override;
 
 private:
     const class Proto* proto_;
@@ -316,8 +749,7 @@ public:
     void* GetData() { return data_.get(); }
     const void* GetData() const { return data_.get(); }
     
-    void Mark(GarbageCollector* gc) override;
-    std::vector<GCObject*> GetReferences() const override;
+    void Traverse(GCMarker&) const override {}
 
 private:
     std::unique_ptr<uint8_t[]> data_;
@@ -333,7 +765,7 @@ public:
     bool IsWeak() const override { return true; }
     WeakMode GetWeakMode() const override { return weak_mode_; }
     
-    void Mark(GarbageCollector* gc) override;
+    void Traverse(GCMarker& marker) const override;
     void CleanWeakReferences(GarbageCollector* gc);
 
 private:
@@ -344,6 +776,35 @@ private:
 /* GC统计信息 */
 /* ========================================================================== */
 
+/**
+ * @brief 暂停时间直方图
+ * 
+ * 桶按2的幂划分（微秒）：桶0为小于1us，桶i为[2^(i-1), 2^i)us，最后一个桶不设上限。
+ */
+struct PauseHistogram {
+    static constexpr Size kBucketCount = 24;
+    
+    std::array<Size, kBucketCount> buckets = {};   // 各桶计数
+    Size count = 0;                                // 样本数
+    double total_time = 0.0;                       // 总暂停时间（秒）
+    double max_time = 0.0;                         // 最大暂停时间（秒）
+    
+    /**
+     * @brief 记录一次暂停
+     */
+    void Record(double seconds);
+    
+    /**
+     * @brief 估算百分位数（返回所在桶的上界，秒），没有样本时返回0
+     */
+    double Percentile(double fraction) const;
+    
+    /**
+     * @brief 平均暂停时间（秒）
+     */
+    double Average() const { return count ? total_time / static_cast<double>(count) : 0.0; }
+};
+
 /**
  * @brief GC统计信息
  */
@@ -362,6 +823,28 @@ struct GCStatistics {
     Size objects_marked = 0;           // 标记的对象数
     Size objects_swept = 0;            // 清除的对象数
     Size finalizers_run = 0;           // 运行的终结器数
+    
+    // 分代收集
+    Size minor_collections = 0;        // 次要收集次数
+    Size major_collections = 0;        // 主要收集次数
+    Size objects_promoted = 0;         // 晋升到老年代的对象数
+    Size remembered_set_size = 0;      // 当前记忆集大小
+    Size young_objects = 0;            // 当前新生代对象数
+    Size old_objects = 0;              // 当前老年代对象数
+    Size old_bytes = 0;                // 当前老年代字节数
+    PauseHistogram minor_pauses;       // 次要收集暂停分布
+    PauseHistogram major_pauses;       // 主要收集暂停分布
+    
+    // 增量收集
+    PauseHistogram step_pauses;        // 增量步骤暂停分布
+    double step_pause_p50 = 0.0;       // 增量步骤暂停中位数（秒）
+    double step_pause_p99 = 0.0;       // 增量步骤暂停99分位（秒）
+    Size step_size = 0;                // 当前步长：每步偿还的分配债务（字节）
+    Size gc_debt = 0;                  // 尚未偿还的分配债务（字节）
+    
+    // 标记栈
+    Size mark_stack_peak = 0;          // 标记栈深度峰值（对象数）
+    Size mark_stack_overflows = 0;     // 标记栈溢出到对象链接的次数
 };
 
 /* ========================================================================== */
@@ -374,8 +857,12 @@ struct GCStatistics {
  * 实现标记-清扫垃圾收集器，支持：
  * - 三色标记算法
  * - 增量垃圾回收
+ * - 分代垃圾回收
  * - 终结器管理
- * - 线程安全
+ * - 线程安全（并发模式）
+ * 
+ * 单所有者模式下所有操作都不加锁；并发模式下注册是无锁的，
+ * 收集和其他操作持有gc_mutex_，并且要求在安全点调用（除注册外没有线程在修改GC对象）。
  */
 class GarbageCollector {
 public:
@@ -407,6 +894,24 @@ public:
      */
     void UnregisterObject(GCObject* obj);
     
+    /**
+     * @brief 安全点：把各线程本地链表中新注册的对象拼接进对象链表，需要时触发GC
+     * 
+     * 并发模式下新注册的对象在拼接前不计入GetTotalBytes()/GetObjectCount()，
+     * 也不会被收集；单所有者模式下只检查是否需要触发GC。
+     */
+    void Safepoint();
+    
+    /**
+     * @brief 设置字符串驻留表（标记结束后对其做弱清扫）
+     */
+    void SetStringTable(StringTable* table) { string_table_ = table; }
+    
+    /**
+     * @brief 设置GC对象的slab分配器（清扫时把slab分配的对象内存归还给它）
+     */
+    void SetObjectAllocator(SlabAllocator* allocator) { object_allocator_ = allocator; }
+    
     /* ====================================================================== */
     /* 垃圾收集控制 */
     /* ====================================================================== */
@@ -422,10 +927,51 @@ public:
     void PerformFullCollection();
     
     /**
-     * @brief 执行增量收集
+     * @brief 完成当前一轮增量收集（没有进行中的一轮时开始新的一轮）
      */
     void PerformIncrementalCollection();
     
+    /**
+     * @brief 执行一个增量步骤（同Lua 5.1的luaC_step）
+     *
+     * 一轮收集进行中时，每注册一个对象就把它的大小计入分配债务，债务达到
+     * 步长时执行一步：偿还一个步长的债务，完成步长×step_multiplier%字节的
+     * 标记或清除工作。步骤结束后按实测耗时与target_pause_time的比值
+     * 缩放步长（每次最多减半或加倍），只改变每步的粒度，不改变收集相对
+     * 分配的速度。
+     */
+    void PerformIncrementalStep();
+    
+    /**
+     * @brief 增量写屏障：标记阶段中黑色对象引用了白色对象时重新置灰
+     */
+    void BarrierBack(GCObject* obj);
+    
+    /**
+     * @brief 执行一次分代收集（按老年代增长选择次要或主要收集），并记录暂停时间
+     */
+    void PerformGenerationalCollection();
+    
+    /**
+     * @brief 次要收集：只标记和清除新生代，老年代通过记忆集提供根
+     */
+    void PerformMinorCollection();
+    
+    /**
+     * @brief 主要收集：标记清除全部对象，存活者全部晋升老年代
+     */
+    void PerformMajorCollection();
+    
+    /**
+     * @brief 是否启用分代模式
+     */
+    bool IsGenerationalEnabled() const { return config_.enable_generational; }
+    
+    /**
+     * @brief 把老年代对象加入记忆集（写屏障慢路径）
+     */
+    void Remember(GCObject* obj);
+    
     /**
      * @brief 触发垃圾收集
      */
@@ -450,6 +996,11 @@ public:
      */
     void MarkRoots();
     
+    /**
+     * @brief 标记当前arena作用域中的对象（arena对象本身不回收）
+     */
+    void MarkArenaObjects();
+    
     /**
      * @brief 标记VM栈
      */
@@ -499,25 +1050,6 @@ public:
      */
     void FinalizePhase();
     
-    /* ====================================================================== */
-    /* 灰色列表管理 */
-    /* ====================================================================== */
-    
-    /**
-     * @brief 添加到灰色列表
-     */
-    void AddToGrayList(GCObject* obj);
-    
-    /**
-     * @brief 从灰色列表弹出
-     */
-    GCObject* PopFromGrayList();
-    
-    /**
-     * @brief 从灰色列表移除
-     */
-    void RemoveFromGrayList(GCObject* obj);
-    
     /* ====================================================================== */
     /* 增量GC步骤 */
     /* ====================================================================== */
@@ -528,9 +1060,16 @@ public:
     void StartMarkPhase();
     
     /**
-     * @brief 执行标记步骤
+     * @brief 推进增量收集，直到完成work_limit字节的工作或本轮结束
+     * @return 本轮是否结束
+     */
+    bool RunIncrementalWork(Size work_limit);
+    
+    /**
+     * @brief 执行标记步骤，按遍历对象的大小累计工作量
+     * @return 灰色列表是否已空
      */
-    bool PerformMarkStep();
+    bool PerformMarkStep(Size& work, Size work_limit);
     
     /**
      * @brief 执行原子标记
@@ -538,9 +1077,10 @@ public:
     void PerformAtomicMark();
     
     /**
-     * @brief 执行清除步骤
+     * @brief 执行清除步骤，按清除对象的大小累计工作量
+     * @return 清除是否完成
      */
-    bool PerformSweepStep();
+    bool PerformSweepStep(Size& work, Size work_limit);
     
     /**
      * @brief 执行终结
@@ -566,6 +1106,14 @@ public:
      */
     void AdjustThreshold();
     
+    /**
+     * @brief 按实测步骤耗时调整步长，使其接近target_pause_time
+     */
+    void AdaptStepSize(double duration);
+    
+    static constexpr Size kMinStepSize = 1024;              // 最小步长（同GCSTEPSIZE）
+    static constexpr Size kMaxStepSize = 16 * 1024 * 1024;  // 最大步长
+    
     /* ====================================================================== */
     /* 配置和状态 */
     /* ====================================================================== */
@@ -585,6 +1133,11 @@ public:
      */
     GCStats GetStats() const;
     
+    /**
+     * @brief 获取详细统计信息（含分代暂停直方图）
+     */
+    GCStatistics GetStatistics() const;
+    
     /**
      * @brief 获取当前状态
      */
@@ -625,17 +1178,82 @@ public:
     void FreeAllObjects();
 
 private:
+    /**
+     * @brief 线程本地注册链表（并发模式）
+     * 
+     * 所属线程用CAS压入，拼接方用exchange整体取走，双方都不加锁。
+     * 链表通过对象的gc_next_链接，拼接时才补上gc_prev_。
+     */
+    struct LocalObjectList {
+        std::atomic<GCObject*> head{nullptr};
+    };
+    
+    /**
+     * @brief 获取当前线程在本收集器中的本地链表（首次使用时创建）
+     */
+    LocalObjectList& GetLocalObjectList();
+    
+    /**
+     * @brief 把所有线程本地链表拼接进对象链表（调用方持有锁）
+     */
+    void SpliceLocalLists();
+    
+    /**
+     * @brief 按线程模式加锁：单所有者模式返回不持有锁的对象
+     */
+    std::unique_lock<std::recursive_mutex> LockForMode() const;
+    
+    /**
+     * @brief 按对象所属的代加入/移出对应链表（调用方持有锁）
+     */
+    void LinkObject(GCObject* obj);
+    void UnlinkObject(GCObject* obj);
+    
+    /**
+     * @brief 回收一个未标记的对象（有终结器的放入终结列表）
+     */
+    void FreeObject(GCObject* obj);
+    
+    /**
+     * @brief 析构对象并释放内存（slab分配的归还slab，其余delete）
+     */
+    void ReleaseObject(GCObject* obj);
+    
+    /**
+     * @brief 对象在arena作用域结束前释放时，撤销其逃逸登记
+     */
+    void ForgetArenaEscape(GCObject* obj);
+    
+    /**
+     * @brief 对象是否引用了新生代对象
+     */
+    static bool HasYoungReference(const GCObject* obj);
+    
+    /**
+     * @brief 老年代增长是否需要主要收集
+     */
+    bool NeedsMajorCollection() const;
+    
+    /**
+     * @brief 退出分代模式：老年代并回对象链表，清除年龄和记忆集
+     */
+    void LeaveGenerationalMode();
+
     /* ====================================================================== */
     /* 成员变量 */
     /* ====================================================================== */
     
     VirtualMachine* vm_;                        // 关联的虚拟机
+    uint64_t id_;                               // 收集器编号（线程本地链表缓存的键）
     GCConfig config_;                           // GC配置
     GCState state_;                             // 当前状态
     
     // 内存统计
     Size total_bytes_;                          // 总分配字节数
     Size gc_threshold_;                         // GC触发阈值
+    Size gc_debt_ = 0;                          // 本轮收集中尚未偿还的分配债务
+    Size step_size_ = kMinStepSize;             // 增量步长（字节）
+    bool collecting_ = false;                   // 正在推进增量收集（防止重入）
     
     // 时间统计
     std::chrono::steady_clock::time_point last_collection_time_;
@@ -644,9 +1262,13 @@ private:
     
     // 对象管理
     Size object_count_;                         // 对象总数
-    GCObject* all_objects_;                     // 所有对象链表头
-    GCObject* gray_list_;                       // 灰色对象列表头
-    Size gray_count_;                           // 灰色对象数量
+    GCObject* all_objects_;                     // 对象链表头（分代模式下只含新生代）
+    GCObject* old_objects_ = nullptr;           // 老年代对象链表头
+    Size old_count_ = 0;                        // 老年代对象数
+    Size old_bytes_ = 0;                        // 老年代字节数
+    Size major_base_bytes_ = 0;                 // 上次主要收集后的老年代字节数
+    std::vector<GCObject*> remembered_set_;     // 记忆集：可能引用新生代的老年代对象
+    GCMarker marker_{this};                     // 标记栈（灰色对象）
     
     // 清除状态
     GCObject* sweep_current_;                   // 当前清除位置
@@ -654,11 +1276,20 @@ private:
     // 终结列表
     std::vector<GCObject*> finalization_list_; // 待终结对象列表
     
+    // 字符串驻留表（弱引用，不作为根）
+    StringTable* string_table_;
+    
+    // GC对象的slab分配器（由内存管理器持有）
+    SlabAllocator* object_allocator_;
+    
     // 统计信息
     GCStats stats_;
+    GCStatistics statistics_;                   // 分代收集统计
     
     // 线程安全
-    mutable std::mutex gc_mutex_;
+    mutable std::recursive_mutex gc_mutex_;     // 并发模式下保护收集和对象链表（终结器可重入）
+    std::mutex local_lists_mutex_;              // 保护local_lists_的插入和遍历
+    std::unordered_map<std::thread::id, std::unique_ptr<LocalObjectList>> local_lists_;
 };
 
 /* ========================================================================== */
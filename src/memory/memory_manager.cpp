@@ -12,6 +12,7 @@
 #include <sstream>
 #include <cstdlib>
 #include <cstring>
+#include <algorithm>
 
 namespace lua_cpp {
 
@@ -106,6 +107,116 @@ void SystemAllocator::ResetStats() {
     stats_ = MemoryStats{};
 }
 
+/* ========================================================================== */
+/* FunctionAllocator实现 */
+/* ========================================================================== */
+
+void* DefaultAllocFunction(void* /*ud*/, void* ptr, Size /*osize*/, Size nsize) {
+    if (nsize == 0) {
+        std::free(ptr);
+        return nullptr;
+    }
+    return std::realloc(ptr, nsize);
+}
+
+FunctionAllocator::FunctionAllocator(AllocFunction function, void* userdata)
+    : function_(function)
+    , userdata_(userdata)
+    , bytes_in_use_(0)
+    , peak_usage_(0)
+    , total_allocated_(0)
+    , total_freed_(0)
+    , allocation_count_(0)
+    , deallocation_count_(0) {
+}
+
+void* FunctionAllocator::Allocate(Size size, Size alignment) {
+    if (size == 0 || alignment > alignof(std::max_align_t)) {
+        return nullptr;
+    }
+    
+    void* ptr = function_(userdata_, nullptr, 0, size);
+    if (ptr) {
+        RecordUsage(size, 0);
+    }
+    return ptr;
+}
+
+void FunctionAllocator::Deallocate(void* ptr, Size size) {
+    if (!ptr) return;
+    
+    function_(userdata_, ptr, size, 0);
+    RecordUsage(0, size);
+}
+
+void* FunctionAllocator::Reallocate(void* ptr, Size old_size, Size new_size, Size alignment) {
+    if (!ptr) {
+        return Allocate(new_size, alignment);
+    }
+    if (new_size == 0) {
+        Deallocate(ptr, old_size);
+        return nullptr;
+    }
+    if (alignment > alignof(std::max_align_t)) {
+        return nullptr;
+    }
+    
+    // 失败时原内存块不变，用量也不变
+    void* new_ptr = function_(userdata_, ptr, old_size, new_size);
+    if (new_ptr) {
+        RecordUsage(new_size, old_size);
+    }
+    return new_ptr;
+}
+
+void FunctionAllocator::RecordUsage(Size allocated, Size freed) {
+    if (allocated > 0) {
+        total_allocated_.fetch_add(allocated, std::memory_order_relaxed);
+        allocation_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (freed > 0) {
+        total_freed_.fetch_add(freed, std::memory_order_relaxed);
+        deallocation_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+    
+    Size usage = bytes_in_use_.fetch_add(allocated - freed, std::memory_order_relaxed) + allocated - freed;
+    Size peak = peak_usage_.load(std::memory_order_relaxed);
+    while (usage > peak && !peak_usage_.compare_exchange_weak(peak, usage, std::memory_order_relaxed)) {
+    }
+}
+
+void FunctionAllocator::SetFunction(AllocFunction function, void* userdata) {
+    function_ = function ? function : DefaultAllocFunction;
+    userdata_ = function ? userdata : nullptr;
+}
+
+AllocFunction FunctionAllocator::GetFunction(void** userdata) const {
+    if (userdata) {
+        *userdata = userdata_;
+    }
+    return function_;
+}
+
+MemoryStats FunctionAllocator::GetStats() const {
+    MemoryStats stats;
+    stats.total_allocated = total_allocated_.load(std::memory_order_relaxed);
+    stats.total_freed = total_freed_.load(std::memory_order_relaxed);
+    stats.current_usage = bytes_in_use_.load(std::memory_order_relaxed);
+    stats.peak_usage = peak_usage_.load(std::memory_order_relaxed);
+    stats.allocation_count = allocation_count_.load(std::memory_order_relaxed);
+    stats.deallocation_count = deallocation_count_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void FunctionAllocator::ResetStats() {
+    // 只清累计计数，使用中的量反映当前状态
+    total_allocated_ = 0;
+    total_freed_ = 0;
+    allocation_count_ = 0;
+    deallocation_count_ = 0;
+    peak_usage_ = bytes_in_use_.load();
+}
+
 /* ========================================================================== */
 /* FixedPoolAllocator实现 */
 /* ========================================================================== */
@@ -254,9 +365,10 @@ void FixedPoolAllocator::ResetStats() {
 /* StackAllocator实现 */
 /* ========================================================================== */
 
-StackAllocator::StackAllocator(Size capacity)
+StackAllocator::StackAllocator(Size capacity, bool thread_safe)
     : capacity_(capacity)
-    , current_position_(0) {
+    , current_position_(0)
+    , thread_safe_(thread_safe) {
     
     stack_memory_ = std::malloc(capacity);
     if (!stack_memory_) {
@@ -275,7 +387,7 @@ StackAllocator::~StackAllocator() {
 void* StackAllocator::Allocate(Size size, Size alignment) {
     if (size == 0) return nullptr;
     
-    std::lock_guard<std::mutex> lock(stack_mutex_);
+    auto lock = LockIfShared();
     
     // 计算对齐后的位置
     Size aligned_position = AlignTo(current_position_, alignment);
@@ -307,7 +419,7 @@ void StackAllocator::Deallocate(void* ptr, Size size) {
 
 void* StackAllocator::Reallocate(void* ptr, Size old_size, Size new_size, Size alignment) {
     // 检查是否是栈顶分配
-    std::lock_guard<std::mutex> lock(stack_mutex_);
+    auto lock = LockIfShared();
     
     char* stack_start = static_cast<char*>(stack_memory_);
     char* ptr_addr = static_cast<char*>(ptr);
@@ -334,12 +446,12 @@ void* StackAllocator::Reallocate(void* ptr, Size old_size, Size new_size, Size a
 }
 
 StackAllocator::Marker StackAllocator::GetMarker() const {
-    std::lock_guard<std::mutex> lock(stack_mutex_);
+    auto lock = LockIfShared();
     return Marker{current_position_};
 }
 
 void StackAllocator::RollbackToMarker(const Marker& marker) {
-    std::lock_guard<std::mutex> lock(stack_mutex_);
+    auto lock = LockIfShared();
     
     if (marker.position <= current_position_) {
         Size freed_bytes = current_position_ - marker.position;
@@ -352,7 +464,7 @@ void StackAllocator::RollbackToMarker(const Marker& marker) {
 }
 
 void StackAllocator::Clear() {
-    std::lock_guard<std::mutex> lock(stack_mutex_);
+    auto lock = LockIfShared();
     
     stats_.total_freed += current_position_;
     stats_.current_usage = 0;
@@ -363,8 +475,15 @@ void StackAllocator::Clear() {
     }
 }
 
+std::unique_lock<std::mutex> StackAllocator::LockIfShared() const {
+    if (thread_safe_) {
+        return std::unique_lock<std::mutex>(stack_mutex_);
+    }
+    return std::unique_lock<std::mutex>();
+}
+
 MemoryStats StackAllocator::GetStats() const {
-    std::lock_guard<std::mutex> lock(stack_mutex_);
+    auto lock = LockIfShared();
     
     MemoryStats stats = stats_;
     stats.largest_free_block = capacity_ - current_position_;
@@ -376,10 +495,238 @@ MemoryStats StackAllocator::GetStats() const {
 }
 
 void StackAllocator::ResetStats() {
-    std::lock_guard<std::mutex> lock(stack_mutex_);
+    auto lock = LockIfShared();
     stats_ = MemoryStats{};
 }
 
+/* ========================================================================== */
+/* SlabAllocator实现 */
+/* ========================================================================== */
+
+SlabAllocator::SlabAllocator(bool thread_safe, Allocator* upstream)
+    : upstream_(upstream)
+    , bytes_in_use_(0)
+    , peak_usage_(0)
+    , thread_safe_(thread_safe) {
+    
+    // 实际GC对象的大小各占一个级别，通用级别填补其间的空档
+    std::vector<Size> sizes = {
+        sizeof(StringObject), sizeof(TableObject), sizeof(FunctionObject),
+        sizeof(UserDataObject), sizeof(WeakTableObject),
+        16, 32, 48, 64, 96, 128, 192, 256, 384, kMaxBlockSize
+    };
+    for (Size& size : sizes) {
+        size = AlignTo(size, kBlockAlignment);
+    }
+    std::sort(sizes.begin(), sizes.end());
+    sizes.erase(std::unique(sizes.begin(), sizes.end()), sizes.end());
+    sizes.erase(std::remove_if(sizes.begin(), sizes.end(),
+                               [](Size size) { return size > kMaxBlockSize; }),
+                sizes.end());
+    
+    classes_.resize(sizes.size());
+    for (Size i = 0; i < sizes.size(); i++) {
+        classes_[i].block_size = sizes[i];
+        classes_[i].stats.block_size = sizes[i];
+    }
+    
+    // 每个对齐单位映射到能容纳它的最小级别
+    Size size_class = 0;
+    for (Size i = 0; i < class_lookup_.size(); i++) {
+        while (classes_[size_class].block_size < i * kBlockAlignment) {
+            size_class++;
+        }
+        class_lookup_[i] = static_cast<uint8_t>(size_class);
+    }
+}
+
+SlabAllocator::~SlabAllocator() {
+    for (void* slab : slabs_) {
+        if (upstream_) {
+            upstream_->Deallocate(slab, kSlabSize);
+            continue;
+        }
+#ifdef _WIN32
+        _aligned_free(slab);
+#else
+        free(slab);
+#endif
+    }
+}
+
+std::unique_lock<std::mutex> SlabAllocator::LockIfShared() const {
+    if (thread_safe_) {
+        return std::unique_lock<std::mutex>(slab_mutex_);
+    }
+    return std::unique_lock<std::mutex>();
+}
+
+void SlabAllocator::Refill(SizeClass& size_class) {
+    void* slab = nullptr;
+    
+    if (upstream_) {
+        // 块只需要kBlockAlignment对齐，slab本身不要求按页对齐
+        slab = upstream_->Allocate(kSlabSize, kBlockAlignment);
+    } else {
+#ifdef _WIN32
+        slab = _aligned_malloc(kSlabSize, kSlabSize);
+#else
+        if (posix_memalign(&slab, kSlabSize, kSlabSize) != 0) {
+            slab = nullptr;
+        }
+#endif
+    }
+    
+    if (!slab) {
+        throw OutOfMemoryError("Failed to allocate slab");
+    }
+    slabs_.push_back(slab);
+    
+    // 新slab从头按块切分，末尾不足一块的部分不用
+    Size block_count = kSlabSize / size_class.block_size;
+    size_class.bump = static_cast<char*>(slab);
+    size_class.bump_end = size_class.bump + block_count * size_class.block_size;
+    size_class.stats.slab_count++;
+    size_class.stats.bytes_reserved += kSlabSize;
+}
+
+void* SlabAllocator::AllocateBlock(uint8_t size_class) {
+    auto lock = LockIfShared();
+    SizeClass& cls = classes_[size_class];
+    
+    void* block = cls.free_list;
+    if (block) {
+        cls.free_list = *static_cast<void**>(block);
+    } else {
+        if (cls.bump == cls.bump_end) {
+            Refill(cls);
+        }
+        block = cls.bump;
+        cls.bump += cls.block_size;
+    }
+    
+    cls.stats.blocks_in_use++;
+    cls.stats.bytes_in_use += cls.block_size;
+    cls.stats.allocation_count++;
+    bytes_in_use_ += cls.block_size;
+    if (bytes_in_use_ > peak_usage_) {
+        peak_usage_ = bytes_in_use_;
+    }
+    
+    return block;
+}
+
+void SlabAllocator::DeallocateBlock(void* ptr, uint8_t size_class) {
+    auto lock = LockIfShared();
+    SizeClass& cls = classes_[size_class];
+    
+    *static_cast<void**>(ptr) = cls.free_list;
+    cls.free_list = ptr;
+    
+    cls.stats.blocks_in_use--;
+    cls.stats.bytes_in_use -= cls.block_size;
+    cls.stats.deallocation_count++;
+    bytes_in_use_ -= cls.block_size;
+}
+
+void* SlabAllocator::Allocate(Size size, Size alignment) {
+    if (size == 0 || alignment > kBlockAlignment) {
+        return nullptr;
+    }
+    
+    uint8_t size_class = GetSizeClass(size);
+    if (size_class == kNoSizeClass) {
+        return nullptr; // 请求的大小超过最大级别
+    }
+    
+    try {
+        return AllocateBlock(size_class);
+    } catch (const OutOfMemoryError&) {
+        return nullptr;
+    }
+}
+
+void SlabAllocator::Deallocate(void* ptr, Size size) {
+    // 块本身不记录级别，必须传入分配时的大小
+    uint8_t size_class = GetSizeClass(size);
+    if (!ptr || size == 0 || size_class == kNoSizeClass) {
+        return;
+    }
+    DeallocateBlock(ptr, size_class);
+}
+
+void* SlabAllocator::Reallocate(void* ptr, Size old_size, Size new_size, Size alignment) {
+    if (!ptr) {
+        return Allocate(new_size, alignment);
+    }
+    if (new_size == 0) {
+        Deallocate(ptr, old_size);
+        return nullptr;
+    }
+    if (GetSizeClass(old_size) == GetSizeClass(new_size)) {
+        return ptr; // 新大小仍在同一级别的块内
+    }
+    
+    void* new_ptr = Allocate(new_size, alignment);
+    if (new_ptr) {
+        std::memcpy(new_ptr, ptr, std::min(old_size, new_size));
+        Deallocate(ptr, old_size);
+    }
+    
+    return new_ptr;
+}
+
+MemoryStats SlabAllocator::GetStats() const {
+    auto lock = LockIfShared();
+    
+    MemoryStats stats;
+    Size bytes_reserved = 0;
+    for (const SizeClass& cls : classes_) {
+        const SizeClassStats& class_stats = cls.stats;
+        stats.total_allocated += class_stats.allocation_count * cls.block_size;
+        stats.total_freed += class_stats.deallocation_count * cls.block_size;
+        stats.allocation_count += class_stats.allocation_count;
+        stats.deallocation_count += class_stats.deallocation_count;
+        bytes_reserved += class_stats.bytes_reserved;
+        
+        // 已切分和未切分的空闲块
+        Size capacity = class_stats.slab_count * (kSlabSize / cls.block_size);
+        Size free_blocks = capacity - class_stats.blocks_in_use;
+        if (free_blocks > 0) {
+            stats.free_block_count += free_blocks;
+            stats.largest_free_block = std::max(stats.largest_free_block, cls.block_size);
+            if (stats.smallest_free_block == 0 || cls.block_size < stats.smallest_free_block) {
+                stats.smallest_free_block = cls.block_size;
+            }
+        }
+        
+        stats.size_classes.push_back(class_stats);
+    }
+    
+    stats.current_usage = bytes_in_use_;
+    stats.peak_usage = peak_usage_;
+    stats.fragmentation_ratio = bytes_reserved > 0 ?
+        1.0 - static_cast<double>(bytes_in_use_) / bytes_reserved : 0.0;
+    
+    return stats;
+}
+
+Size SlabAllocator::GetBytesInUse() const {
+    auto lock = LockIfShared();
+    return bytes_in_use_;
+}
+
+void SlabAllocator::ResetStats() {
+    auto lock = LockIfShared();
+    
+    // 只清累计计数，使用中和已申请的量反映当前状态
+    for (SizeClass& cls : classes_) {
+        cls.stats.allocation_count = 0;
+        cls.stats.deallocation_count = 0;
+    }
+    peak_usage_ = bytes_in_use_;
+}
+
 /* ========================================================================== */
 /* MemoryManager实现 */
 /* ========================================================================== */
@@ -390,6 +737,10 @@ MemoryManager::MemoryManager()
     , total_deallocated_(0) {
     
     InitializeDefaultAllocators();
+    
+    // 未接入GC前不知道线程模式，先按并发加锁；slab经宿主分配函数申请
+    state_allocator_ = std::make_unique<FunctionAllocator>();
+    object_allocator_ = std::make_unique<SlabAllocator>(true, state_allocator_.get());
 }
 
 MemoryManager::~MemoryManager() {
@@ -424,6 +775,40 @@ Allocator* MemoryManager::GetAllocator(const std::string& name) const {
     return (it != named_allocators_.end()) ? it->second.get() : nullptr;
 }
 
+void MemoryManager::SetAllocFunction(AllocFunction function, void* userdata) {
+    std::lock_guard<std::mutex> lock(manager_mutex_);
+    state_allocator_->SetFunction(function, userdata);
+}
+
+AllocFunction MemoryManager::GetAllocFunction(void** userdata) const {
+    return state_allocator_->GetFunction(userdata);
+}
+
+void* MemoryManager::AllocateStorage(Size size) {
+    CheckMemoryLimit(size);
+    
+    void* ptr = state_allocator_->Allocate(size, alignof(std::max_align_t));
+    if (!ptr) {
+        if (out_of_memory_callback_) {
+            out_of_memory_callback_(size);
+        }
+        throw OutOfMemoryError("Allocation function failed");
+    }
+    return ptr;
+}
+
+void MemoryManager::DeallocateStorage(void* ptr, Size size) {
+    state_allocator_->Deallocate(ptr, size);
+}
+
+void* AllocateStateStorage(MemoryManager& manager, Size size) {
+    return manager.AllocateStorage(size);
+}
+
+void DeallocateStateStorage(MemoryManager& manager, void* ptr, Size size) noexcept {
+    manager.DeallocateStorage(ptr, size);
+}
+
 void* MemoryManager::Allocate(Size size, Size alignment, const std::string& allocator_name) {
     CheckMemoryLimit(size);
     
@@ -507,6 +892,35 @@ void* MemoryManager::Reallocate(void* ptr, Size old_size, Size new_size, Size al
 void MemoryManager::SetGarbageCollector(std::unique_ptr<GarbageCollector> gc) {
     std::lock_guard<std::mutex> lock(manager_mutex_);
     garbage_collector_ = std::move(gc);
+    if (garbage_collector_) {
+        garbage_collector_->SetStringTable(&string_table_);
+        garbage_collector_->SetObjectAllocator(object_allocator_.get());
+        
+        // 单所有者模式下分配和回收都在同一线程，slab不加锁
+        bool concurrent = garbage_collector_->GetConfig().threading_mode == GCThreadingMode::Concurrent;
+        object_allocator_->SetThreadSafe(concurrent);
+        
+        // GC配置的内存限制按实际用量（GetCurrentUsage）检查
+        if (garbage_collector_->GetConfig().memory_limit > 0) {
+            memory_limit_ = garbage_collector_->GetConfig().memory_limit;
+        }
+    }
+}
+
+StringObject* MemoryManager::NewString(const char* str, Size length) {
+    if (length > StringObject::kMaxShortLength) {
+        // 长字符串不驻留，哈希延迟计算
+        return AllocateGCObject<StringObject>(std::string(str, length));
+    }
+    
+    uint64_t hash = StringObject::ComputeHash(str, length);
+    if (StringObject* existing = string_table_.Find(str, length, hash)) {
+        return existing;
+    }
+    
+    StringObject* created = AllocateGCObject<StringObject>(str, length, hash);
+    string_table_.Insert(created);
+    return created;
 }
 
 void MemoryManager::CollectGarbage() {
@@ -541,6 +955,21 @@ MemoryStats MemoryManager::GetTotalStats() const {
         total_stats.deallocation_count += stats.deallocation_count;
     }
     
+    // slab整页从宿主分配函数申请，字节数只在宿主分配函数处计入一次
+    if (state_allocator_) {
+        auto stats = state_allocator_->GetStats();
+        total_stats.total_allocated += stats.total_allocated;
+        total_stats.total_freed += stats.total_freed;
+        total_stats.current_usage += stats.current_usage;
+        total_stats.peak_usage = std::max(total_stats.peak_usage, stats.peak_usage);
+        total_stats.allocation_count += stats.allocation_count;
+        total_stats.deallocation_count += stats.deallocation_count;
+    }
+    
+    if (object_allocator_) {
+        total_stats.size_classes = object_allocator_->GetStats().size_classes;
+    }
+    
     return total_stats;
 }
 
@@ -557,6 +986,14 @@ std::map<std::string, MemoryStats> MemoryManager::GetAllocatorStats() const {
         stats_map[pair.first] = pair.second->GetStats();
     }
     
+    if (state_allocator_) {
+        stats_map["state"] = state_allocator_->GetStats();
+    }
+    
+    if (object_allocator_) {
+        stats_map["gc_objects"] = object_allocator_->GetStats();
+    }
+    
     return stats_map;
 }
 
@@ -564,8 +1001,12 @@ bool MemoryManager::IsMemoryLimitExceeded() const {
     Size limit = memory_limit_.load();
     if (limit == 0) return false;
     
-    Size current = total_allocated_.load() - total_deallocated_.load();
-    return current > limit;
+    return GetCurrentUsage() > limit;
+}
+
+Size MemoryManager::GetCurrentUsage() const {
+    // slab按整页计入：宿主分配函数看到的就是整页
+    return total_allocated_.load() - total_deallocated_.load() + state_allocator_->GetBytesInUse();
 }
 
 std::string MemoryManager::GenerateMemoryReport() const {
@@ -600,6 +1041,12 @@ std::string MemoryManager::GenerateMemoryReport() const {
         oss << "    Freed: " << stats.total_freed << " bytes" << std::endl;
         oss << "    Current: " << stats.current_usage << " bytes" << std::endl;
         oss << "    Peak: " << stats.peak_usage << " bytes" << std::endl;
+        for (const auto& size_class : stats.size_classes) {
+            oss << "    [" << size_class.block_size << "B] "
+                << size_class.blocks_in_use << " blocks, "
+                << size_class.bytes_in_use << "/" << size_class.bytes_reserved << " bytes, "
+                << size_class.slab_count << " slabs" << std::endl;
+        }
     }
     
     // GC统计
@@ -648,7 +1095,7 @@ void MemoryManager::CheckMemoryLimit(Size requested_size) {
     Size limit = memory_limit_.load();
     if (limit == 0) return;
     
-    Size current = total_allocated_.load() - total_deallocated_.load();
+    Size current = GetCurrentUsage();
     if (current + requested_size > limit) {
         if (out_of_memory_callback_) {
             out_of_memory_callback_(requested_size);
@@ -662,13 +1109,39 @@ void MemoryManager::CheckMemoryLimit(Size requested_size) {
 /* ========================================================================== */
 
 static std::unique_ptr<MemoryManager> g_memory_manager;
+static std::atomic<MemoryManager*> g_memory_manager_ptr{nullptr};
 static std::mutex g_memory_manager_mutex;
 
+// 当前线程绑定的管理器（VM执行期间为VM自己的管理器）
+static thread_local MemoryManager* t_current_manager = nullptr;
+
+MemoryManagerScope::MemoryManagerScope(MemoryManager& manager) noexcept
+    : previous_(t_current_manager) {
+    t_current_manager = &manager;
+}
+
+MemoryManagerScope::~MemoryManagerScope() {
+    t_current_manager = previous_;
+}
+
+MemoryManager& GetCurrentMemoryManager() {
+    if (t_current_manager) {
+        return *t_current_manager;
+    }
+    return GetGlobalMemoryManager();
+}
+
 MemoryManager& GetGlobalMemoryManager() {
+    // 没有绑定管理器时的回退路径，已创建时不加锁
+    if (MemoryManager* manager = g_memory_manager_ptr.load(std::memory_order_acquire)) {
+        return *manager;
+    }
+    
     std::lock_guard<std::mutex> lock(g_memory_manager_mutex);
     
     if (!g_memory_manager) {
         g_memory_manager = std::make_unique<MemoryManager>();
+        g_memory_manager_ptr.store(g_memory_manager.get(), std::memory_order_release);
     }
     
     return *g_memory_manager;
@@ -676,6 +1149,16 @@ MemoryManager& GetGlobalMemoryManager() {
 
 void SetGlobalMemoryManager(std::unique_ptr<MemoryManager> manager) {
     std::lock_guard<std::mutex> lock(g_memory_manager_mutex);
+    
+    // 表和堆栈的StateAllocator、slab中的对象都直接指向旧管理器，仍有存储
+    // 未归还时销毁它会留下悬空指针
+    if (MemoryManager* old = g_memory_manager.get()) {
+        if (old == t_current_manager || old->GetCurrentUsage() > 0) {
+            throw GCError("Cannot replace the default memory manager while it still owns memory");
+        }
+    }
+    
+    g_memory_manager_ptr.store(manager.get(), std::memory_order_release);
     g_memory_manager = std::move(manager);
 }
 
@@ -10,10 +10,14 @@
 
 #include "core/lua_common.h"
 #include "garbage_collector.h"
+#include "string_table.h"
+#include "state_allocator.h"
 #include <memory>
 #include <functional>
 #include <atomic>
 #include <mutex>
+#include <array>
+#include <vector>
 
 namespace lua_cpp {
 
@@ -45,6 +49,19 @@ enum class AlignmentStrategy {
 /* 内存统计信息 */
 /* ========================================================================== */
 
+/**
+ * @brief slab分配器单个大小级别的统计
+ */
+struct SizeClassStats {
+    Size block_size = 0;               // 块大小
+    Size slab_count = 0;               // 已申请的slab数量
+    Size blocks_in_use = 0;            // 使用中的块数量
+    Size bytes_in_use = 0;             // 使用中的字节数
+    Size bytes_reserved = 0;           // slab占用的字节数
+    Size allocation_count = 0;         // 累计分配次数
+    Size deallocation_count = 0;       // 累计释放次数
+};
+
 /**
  * @brief 内存使用统计
  */
@@ -59,6 +76,7 @@ struct MemoryStats {
     Size largest_free_block = 0;       // 最大自由块
     Size smallest_free_block = 0;      // 最小自由块
     Size free_block_count = 0;         // 自由块数量
+    std::vector<SizeClassStats> size_classes;  // 按大小级别的明细（仅slab分配器）
 };
 
 /* ========================================================================== */
@@ -138,6 +156,79 @@ private:
     MemoryStats stats_;
 };
 
+/* ========================================================================== */
+/* 宿主分配函数 */
+/* ========================================================================== */
+
+/**
+ * @brief 宿主分配函数（与lua_Alloc签名相同）
+ *
+ * nsize为0时释放ptr并返回nullptr；否则把ptr（可以为nullptr）调整为nsize字节，
+ * 失败时返回nullptr且原内存块不变
+ */
+using AllocFunction = void* (*)(void* ud, void* ptr, Size osize, Size nsize);
+
+/**
+ * @brief 默认分配函数（realloc/free，同lauxlib的l_alloc）
+ */
+void* DefaultAllocFunction(void* ud, void* ptr, Size osize, Size nsize);
+
+/**
+ * @brief 经宿主分配函数分配的分配器
+ *
+ * 解释器自身持有的内存（GC对象的slab、表的数组和哈希部分、VM栈）都经过它，
+ * 宿主可以用自己的分配函数按状态统计和限制内存。分配函数只保证基本对齐
+ * （max_align_t），更高的对齐要求返回nullptr。替换分配函数后，已分配的
+ * 内存块也交给新函数释放，与lua_setallocf的约定一致；替换时不能有并发分配。
+ */
+class FunctionAllocator : public Allocator {
+public:
+    /**
+     * @brief 构造函数
+     * @param function 分配函数
+     * @param userdata 传给分配函数的用户数据
+     */
+    explicit FunctionAllocator(AllocFunction function = DefaultAllocFunction, void* userdata = nullptr);
+    
+    void* Allocate(Size size, Size alignment = sizeof(void*)) override;
+    void Deallocate(void* ptr, Size size = 0) override;
+    void* Reallocate(void* ptr, Size old_size, Size new_size, Size alignment = sizeof(void*)) override;
+    
+    const char* GetName() const override { return "FunctionAllocator"; }
+    MemoryStats GetStats() const override;
+    void ResetStats() override;
+    
+    /**
+     * @brief 替换分配函数
+     */
+    void SetFunction(AllocFunction function, void* userdata);
+    
+    /**
+     * @brief 获取分配函数和用户数据
+     */
+    AllocFunction GetFunction(void** userdata) const;
+    
+    /**
+     * @brief 经分配函数持有的字节数
+     */
+    Size GetBytesInUse() const { return bytes_in_use_.load(std::memory_order_relaxed); }
+
+private:
+    /**
+     * @brief 记录一次分配或释放后的用量变化
+     */
+    void RecordUsage(Size allocated, Size freed);
+    
+    AllocFunction function_;
+    void* userdata_;
+    std::atomic<Size> bytes_in_use_;
+    std::atomic<Size> peak_usage_;
+    std::atomic<Size> total_allocated_;
+    std::atomic<Size> total_freed_;
+    std::atomic<Size> allocation_count_;
+    std::atomic<Size> deallocation_count_;
+};
+
 /* ========================================================================== */
 /* 内存池分配器 */
 /* ========================================================================== */
@@ -192,8 +283,9 @@ public:
     /**
      * @brief 构造函数
      * @param capacity 栈容量
+     * @param thread_safe 是否加锁（单线程独占时可关闭）
      */
-    explicit StackAllocator(Size capacity);
+    explicit StackAllocator(Size capacity, bool thread_safe = true);
     ~StackAllocator() override;
     
     void* Allocate(Size size, Size alignment = sizeof(void*)) override;
@@ -227,13 +319,150 @@ public:
     void Clear();
 
 private:
+    /**
+     * @brief 需要时加锁，单线程独占时返回空锁
+     */
+    std::unique_lock<std::mutex> LockIfShared() const;
+    
     void* stack_memory_;
     Size capacity_;
     Size current_position_;
+    bool thread_safe_;
     mutable std::mutex stack_mutex_;
     MemoryStats stats_;
 };
 
+/* ========================================================================== */
+/* 分级slab分配器 */
+/* ========================================================================== */
+
+/**
+ * @brief GC对象的分级slab分配器
+ *
+ * 大小级别由实际的GC对象大小（StringObject、TableObject、FunctionObject、
+ * UserDataObject、WeakTableObject，向上取整到块对齐）和若干通用级别组成。
+ * 每个级别有自己的自由链表，链表为空时申请一个页大小的slab并按需切分；
+ * 释放的块回到所属级别的自由链表，slab到分配器析构时才归还系统。
+ * 单所有者模式下不加锁，并发模式下由一把互斥锁保护。
+ */
+class SlabAllocator : public Allocator {
+public:
+    static constexpr Size kSlabSize = 4096;          // slab大小（一页）
+    static constexpr Size kBlockAlignment = 16;      // 块对齐
+    static constexpr Size kMaxBlockSize = 512;       // 超过此大小的请求不由slab分配
+    static constexpr uint8_t kNoSizeClass = GCObject::kNoSizeClass;  // 无对应大小级别
+
+    /**
+     * @brief 构造函数
+     * @param thread_safe 是否加锁（并发模式）
+     * @param upstream 申请slab的分配器（nullptr时直接向系统申请）
+     */
+    explicit SlabAllocator(bool thread_safe = true, Allocator* upstream = nullptr);
+    ~SlabAllocator() override;
+    
+    void* Allocate(Size size, Size alignment = sizeof(void*)) override;
+    void Deallocate(void* ptr, Size size = 0) override;
+    void* Reallocate(void* ptr, Size old_size, Size new_size, Size alignment = sizeof(void*)) override;
+    
+    const char* GetName() const override { return "SlabAllocator"; }
+    MemoryStats GetStats() const override;
+    void ResetStats() override;
+    
+    /**
+     * @brief 查找能容纳size字节的最小大小级别
+     * @return 大小级别，超过kMaxBlockSize时返回kNoSizeClass
+     */
+    uint8_t GetSizeClass(Size size) const {
+        return size <= kMaxBlockSize ? class_lookup_[(size + kBlockAlignment - 1) / kBlockAlignment]
+                                     : kNoSizeClass;
+    }
+    
+    /**
+     * @brief 获取大小级别数量
+     */
+    Size GetSizeClassCount() const { return classes_.size(); }
+    
+    /**
+     * @brief 获取大小级别的块大小
+     */
+    Size GetBlockSize(uint8_t size_class) const { return classes_[size_class].block_size; }
+    
+    /**
+     * @brief 从指定大小级别分配一个块
+     * @throws OutOfMemoryError 无法申请新的slab
+     */
+    void* AllocateBlock(uint8_t size_class);
+    
+    /**
+     * @brief 把块归还到所属大小级别的自由链表
+     */
+    void DeallocateBlock(void* ptr, uint8_t size_class);
+    
+    /**
+     * @brief 设置是否加锁（随GC线程模式切换）
+     */
+    void SetThreadSafe(bool thread_safe) { thread_safe_ = thread_safe; }
+    bool IsThreadSafe() const { return thread_safe_; }
+    
+    /**
+     * @brief 使用中的字节数（不构造分级明细）
+     */
+    Size GetBytesInUse() const;
+
+private:
+    /**
+     * @brief 单个大小级别
+     */
+    struct SizeClass {
+        Size block_size = 0;
+        void* free_list = nullptr;     // 已释放的块
+        char* bump = nullptr;          // 最新slab中尚未切分的部分
+        char* bump_end = nullptr;
+        SizeClassStats stats;
+    };
+    
+    /**
+     * @brief 申请新的slab作为该级别的切分区
+     */
+    void Refill(SizeClass& size_class);
+    
+    /**
+     * @brief 并发模式下加锁，单所有者模式下返回空锁
+     */
+    std::unique_lock<std::mutex> LockIfShared() const;
+    
+    std::vector<SizeClass> classes_;
+    std::array<uint8_t, kMaxBlockSize / kBlockAlignment + 1> class_lookup_;
+    std::vector<void*> slabs_;
+    Allocator* upstream_;
+    Size bytes_in_use_;
+    Size peak_usage_;
+    bool thread_safe_;
+    mutable std::mutex slab_mutex_;
+};
+
+/* ========================================================================== */
+/* 线程绑定的内存管理器 */
+/* ========================================================================== */
+
+/**
+ * @brief 在作用域内把内存管理器绑定到当前线程
+ *
+ * NewString、AllocateGCObject等便捷函数和未显式给出管理器的表、堆栈都从
+ * GetCurrentMemoryManager()分配。VM执行字节码期间绑定自己的管理器，对象
+ * 和容器存储因此落在所属状态上；作用域可以嵌套，析构时恢复之前的绑定。
+ */
+class MemoryManagerScope {
+public:
+    explicit MemoryManagerScope(MemoryManager& manager) noexcept;
+    ~MemoryManagerScope();
+    
+    LUA_NO_COPY_MOVE(MemoryManagerScope)
+
+private:
+    MemoryManager* previous_;
+};
+
 /* ========================================================================== */
 /* 内存管理器主类 */
 /* ========================================================================== */
@@ -282,6 +511,39 @@ public:
      */
     Allocator* GetAllocator(const std::string& name) const;
     
+    /* ====================================================================== */
+    /* 宿主分配函数 */
+    /* ====================================================================== */
+    
+    /**
+     * @brief 设置宿主分配函数（lua_newstate/lua_setallocf）
+     *
+     * GC对象的slab、表的存储和VM栈此后都经它分配；已分配的内存块也由它释放
+     */
+    void SetAllocFunction(AllocFunction function, void* userdata);
+    
+    /**
+     * @brief 获取宿主分配函数（lua_getallocf）
+     */
+    AllocFunction GetAllocFunction(void** userdata) const;
+    
+    /**
+     * @brief 获取经宿主分配函数分配的分配器
+     */
+    FunctionAllocator& GetStateAllocator() { return *state_allocator_; }
+    const FunctionAllocator& GetStateAllocator() const { return *state_allocator_; }
+    
+    /**
+     * @brief 为解释器内部容器分配存储（StateAllocator使用）
+     * @throws OutOfMemoryError 超出内存限制或分配函数失败
+     */
+    void* AllocateStorage(Size size);
+    
+    /**
+     * @brief 归还内部容器的存储
+     */
+    void DeallocateStorage(void* ptr, Size size);
+    
     /* ====================================================================== */
     /* 内存分配接口 */
     /* ====================================================================== */
@@ -307,17 +569,33 @@ public:
     
     /**
      * @brief 分配GC对象内存
+     *
+     * 能放进slab大小级别的对象从slab分配并记录级别，GC清扫时直接归还slab；
+     * 更大的对象用new分配，与GC的delete配对。构造期间绑定本管理器，
+     * 对象自身的容器存储（如表的数组和哈希部分）也由本管理器分配。
      */
     template<typename T, typename... Args>
     T* AllocateGCObject(Args&&... args) {
         static_assert(std::is_base_of_v<GCObject, T>, "T must inherit from GCObject");
         
-        void* memory = Allocate(sizeof(T), alignof(T));
-        if (!memory) {
-            throw OutOfMemoryError("Failed to allocate memory for GC object");
-        }
+        CheckMemoryLimit(sizeof(T));
+        MemoryManagerScope scope(*this);
         
-        T* obj = new(memory) T(std::forward<Args>(args)...);
+        T* obj;
+        if constexpr (sizeof(T) <= SlabAllocator::kMaxBlockSize &&
+                      alignof(T) <= SlabAllocator::kBlockAlignment) {
+            uint8_t size_class = object_allocator_->GetSizeClass(sizeof(T));
+            void* memory = object_allocator_->AllocateBlock(size_class);
+            try {
+                obj = new(memory) T(std::forward<Args>(args)...);
+            } catch (...) {
+                object_allocator_->DeallocateBlock(memory, size_class);
+                throw;
+            }
+            obj->size_class_ = size_class;
+        } else {
+            obj = new T(std::forward<Args>(args)...);
+        }
         
         if (garbage_collector_) {
             garbage_collector_->RegisterObject(obj);
@@ -326,6 +604,18 @@ public:
         return obj;
     }
     
+    /**
+     * @brief 创建字符串对象（短字符串经驻留表去重）
+     */
+    StringObject* NewString(const char* str, Size length);
+    StringObject* NewString(const std::string& str) { return NewString(str.data(), str.size()); }
+    
+    /**
+     * @brief 获取字符串驻留表
+     */
+    StringTable& GetStringTable() { return string_table_; }
+    const StringTable& GetStringTable() const { return string_table_; }
+    
     /**
      * @brief 释放GC对象内存
      */
@@ -335,12 +625,21 @@ public:
         
         if (!obj) return;
         
+        if constexpr (std::is_same_v<T, StringObject>) {
+            string_table_.Remove(obj);
+        }
+        
         if (garbage_collector_) {
             garbage_collector_->UnregisterObject(obj);
         }
         
-        obj->~T();
-        Deallocate(obj, sizeof(T));
+        uint8_t size_class = obj->size_class_;
+        if (size_class != SlabAllocator::kNoSizeClass) {
+            obj->~T();
+            object_allocator_->DeallocateBlock(obj, size_class);
+        } else {
+            delete obj;
+        }
     }
     
     /* ====================================================================== */
@@ -357,6 +656,12 @@ public:
      */
     GarbageCollector* GetGarbageCollector() const { return garbage_collector_.get(); }
     
+    /**
+     * @brief 获取GC对象的slab分配器
+     */
+    SlabAllocator& GetObjectAllocator() { return *object_allocator_; }
+    const SlabAllocator& GetObjectAllocator() const { return *object_allocator_; }
+    
     /**
      * @brief 触发垃圾收集
      */
@@ -391,6 +696,13 @@ public:
      */
     bool IsMemoryLimitExceeded() const;
     
+    /**
+     * @brief 当前使用量：通用分配加经宿主分配函数持有的字节（含slab整页）
+     *
+     * LUA_GCCOUNT/LUA_GCCOUNTB和内存限制都以此为准
+     */
+    Size GetCurrentUsage() const;
+    
     /* ====================================================================== */
     /* 内存报告和调试 */
     /* ====================================================================== */
@@ -467,6 +779,15 @@ private:
     std::unique_ptr<Allocator> default_allocator_;
     std::map<std::string, std::unique_ptr<Allocator>> named_allocators_;
     
+    // 宿主分配函数（slab从它申请，必须在slab分配器之前声明）
+    std::unique_ptr<FunctionAllocator> state_allocator_;
+    
+    // GC对象的slab分配器（必须在垃圾收集器之前声明，GC析构时还要归还对象）
+    std::unique_ptr<SlabAllocator> object_allocator_;
+    
+    // 字符串驻留表（必须在垃圾收集器之前声明，保证后析构）
+    StringTable string_table_;
+    
     // 垃圾收集器
     std::unique_ptr<GarbageCollector> garbage_collector_;
     
@@ -489,12 +810,21 @@ private:
 /* ========================================================================== */
 
 /**
- * @brief 获取全局内存管理器实例
+ * @brief 获取进程默认内存管理器实例
+ *
+ * 只在当前线程没有绑定管理器时使用（宿主在VM之外创建的值）；每个VM
+ * 拥有自己的管理器，见VirtualMachine::GetMemoryManager()。
  */
 MemoryManager& GetGlobalMemoryManager();
 
 /**
- * @brief 设置全局内存管理器
+ * @brief 当前线程绑定的内存管理器（见MemoryManagerScope），未绑定时为进程默认管理器
+ */
+MemoryManager& GetCurrentMemoryManager();
+
+/**
+ * @brief 替换进程默认内存管理器
+ * @throws GCError 旧管理器仍持有容器存储或GC对象内存，或仍绑定在当前线程上
  */
 void SetGlobalMemoryManager(std::unique_ptr<MemoryManager> manager);
 
@@ -507,7 +837,7 @@ void SetGlobalMemoryManager(std::unique_ptr<MemoryManager> manager);
  */
 template<typename T>
 T* AllocateMemory(Size count = 1) {
-    return static_cast<T*>(GetGlobalMemoryManager().Allocate(sizeof(T) * count, alignof(T)));
+    return static_cast<T*>(GetCurrentMemoryManager().Allocate(sizeof(T) * count, alignof(T)));
 }
 
 /**
@@ -515,7 +845,7 @@ T* AllocateMemory(Size count = 1) {
  */
 template<typename T>
 void DeallocateMemory(T* ptr, Size count = 1) {
-    GetGlobalMemoryManager().Deallocate(ptr, sizeof(T) * count);
+    GetCurrentMemoryManager().Deallocate(ptr, sizeof(T) * count);
 }
 
 /**
@@ -523,7 +853,18 @@ void DeallocateMemory(T* ptr, Size count = 1) {
  */
 template<typename T, typename... Args>
 T* AllocateGCObject(Args&&... args) {
-    return GetGlobalMemoryManager().AllocateGCObject<T>(std::forward<Args>(args)...);
+    return GetCurrentMemoryManager().AllocateGCObject<T>(std::forward<Args>(args)...);
+}
+
+/**
+ * @brief 创建字符串对象的便捷函数
+ */
+inline StringObject* NewString(const char* str, Size length) {
+    return GetCurrentMemoryManager().NewString(str, length);
+}
+
+inline StringObject* NewString(const std::string& str) {
+    return GetCurrentMemoryManager().NewString(str.data(), str.size());
 }
 
 /**
@@ -531,7 +872,7 @@ T* AllocateGCObject(Args&&... args) {
  */
 template<typename T>
 void DeallocateGCObject(T* obj) {
-    GetGlobalMemoryManager().DeallocateGCObject(obj);
+    GetCurrentMemoryManager().DeallocateGCObject(obj);
 }
 
 } // namespace lua_cpp
\ No newline at end of file
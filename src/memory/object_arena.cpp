@@ -0,0 +1,194 @@
+/**
+ * @file object_arena.cpp
+ * @brief 请求级对象arena实现
+ * @author Lua C++ Project
+ * @date 2025-09-30
+ */
+
+#include "object_arena.h"
+#include <algorithm>
+
+namespace lua_cpp {
+
+namespace {
+
+// 本线程正在使用的arena（arena对象只被所属VM的线程访问）
+thread_local ObjectArena* t_active_arena = nullptr;
+
+} // namespace
+
+/* ========================================================================== */
+/* 构造和析构 */
+/* ========================================================================== */
+
+ObjectArena::ObjectArena(Size capacity)
+    : allocator_(capacity, false)
+    , scope_start_(allocator_.GetMarker())
+    , drained_tables_(0)
+    , globals_escaped_(false)
+    , depth_(0)
+    , previous_active_(nullptr) {
+}
+
+ObjectArena::~ObjectArena() {
+    if (IsActive()) {
+        ReleaseObjects();
+        if (t_active_arena == this) {
+            t_active_arena = previous_active_;
+        }
+    }
+}
+
+ObjectArena* ObjectArena::GetActive() {
+    return t_active_arena;
+}
+
+/* ========================================================================== */
+/* 作用域 */
+/* ========================================================================== */
+
+void ObjectArena::Enter() {
+    if (depth_++ > 0) {
+        return;  // 内层作用域并入最外层
+    }
+
+    scope_start_ = allocator_.GetMarker();
+    previous_active_ = t_active_arena;
+    t_active_arena = this;
+}
+
+Size ObjectArena::Exit() {
+    if (depth_ == 0) {
+        throw GCError("Arena scope exit without matching enter");
+    }
+    if (--depth_ > 0) {
+        return 0;
+    }
+
+    // 堆对象和外部值槽中的引用指向疏散后的副本
+    Size evacuated_before = stats_.objects_evacuated;
+    // 疏散中的分配可能触发GC，按下标遍历，不持有迭代器
+    for (Size i = 0; i < escaped_owners_.size(); ++i) {
+        GCObject* owner = escaped_owners_[i];
+        owner->arena_escape_ = false;
+        owner->ForwardArenaReferences(*this);
+    }
+    for (Size i = 0; i < escaped_slots_.size(); ++i) {
+        *escaped_slots_[i] = Forward(*escaped_slots_[i]);
+    }
+    DrainEvacuation();
+
+    stats_.peak_usage = std::max(stats_.peak_usage, GetUsage());
+    stats_.scopes_completed++;
+
+    ReleaseObjects();
+    t_active_arena = previous_active_;
+    previous_active_ = nullptr;
+
+    return stats_.objects_evacuated - evacuated_before;
+}
+
+/* ========================================================================== */
+/* 逃逸登记 */
+/* ========================================================================== */
+
+void ObjectArena::RecordEscape(GCObject* owner) {
+    owner->arena_escape_ = true;
+    escaped_owners_.push_back(owner);
+}
+
+void ObjectArena::ForgetEscape(GCObject* owner) {
+    auto it = std::find(escaped_owners_.begin(), escaped_owners_.end(), owner);
+    if (it != escaped_owners_.end()) {
+        *it = escaped_owners_.back();
+        escaped_owners_.pop_back();
+    }
+    owner->arena_escape_ = false;
+}
+
+void ObjectArena::RecordEscapedSlot(LuaValue* slot) {
+    if (escaped_slots_.empty() || escaped_slots_.back() != slot) {
+        escaped_slots_.push_back(slot);
+    }
+}
+
+void ObjectArena::ForgetEscapedSlot(LuaValue* slot) {
+    escaped_slots_.erase(std::remove(escaped_slots_.begin(), escaped_slots_.end(), slot),
+                         escaped_slots_.end());
+}
+
+/* ========================================================================== */
+/* 疏散 */
+/* ========================================================================== */
+
+LuaValue ObjectArena::Forward(const LuaValue& value) {
+    GCObject* obj = value.GetGCObject();
+    if (!obj || !obj->IsArenaAllocated()) {
+        return value;
+    }
+
+    GCObject* copy = Evacuate(obj);
+    if (copy->GetType() == GCObjectType::String) {
+        return LuaValue(static_cast<StringObject*>(copy));
+    }
+    return LuaValue(static_cast<TableObject*>(copy));
+}
+
+void ObjectArena::ForwardTable(LuaTable& table) {
+    table.ForwardReferences([this](const LuaValue& value) { return Forward(value); });
+}
+
+GCObject* ObjectArena::Evacuate(GCObject* obj) {
+    if (GCObject* copy = GetForwardingAddress(obj)) {
+        return copy;
+    }
+
+    GCObject* copy;
+    if (obj->GetType() == GCObjectType::String) {
+        // 经NewString复制，短字符串副本与同内容的堆字符串是同一个驻留对象
+        auto* str = static_cast<StringObject*>(obj);
+        copy = NewString(str->GetData(), str->GetLength());
+    } else {
+        // 先建空表并记录转发地址，环和共享引用都指向同一个副本
+        auto* table = static_cast<TableObject*>(obj);
+        copy = AllocateGCObject<TableObject>(table->GetArraySize(), table->GetHashSize());
+        evacuated_tables_.push_back(table);
+    }
+
+    obj->gc_next_ = copy;
+    stats_.objects_evacuated++;
+    return copy;
+}
+
+void ObjectArena::DrainEvacuation() {
+    // 复制内容时可能疏散更多的表，按下标遍历以处理新追加的元素
+    while (drained_tables_ < evacuated_tables_.size()) {
+        TableObject* source = evacuated_tables_[drained_tables_++];
+        auto* copy = static_cast<TableObject*>(GetForwardingAddress(source));
+
+        source->GetTable().ForEach([this, copy](const LuaValue& key, const LuaValue& value) {
+            copy->Set(Forward(key), Forward(value));
+        });
+        if (TableObject* metatable = source->GetMetatable()) {
+            copy->SetMetatable(Forward(LuaValue(metatable)).GetTable());
+        }
+    }
+}
+
+void ObjectArena::ReleaseObjects() {
+    // 逆序析构，最后一次回滚释放全部内存
+    for (auto it = objects_.rbegin(); it != objects_.rend(); ++it) {
+        (*it)->~GCObject();
+    }
+    stats_.objects_released += objects_.size();
+
+    objects_.clear();
+    escaped_owners_.clear();
+    escaped_slots_.clear();
+    evacuated_tables_.clear();
+    drained_tables_ = 0;
+    globals_escaped_ = false;
+    allocator_.RollbackToMarker(scope_start_);
+}
+
+} // namespace lua_cpp
@@ -0,0 +1,245 @@
+/**
+ * @file object_arena.h
+ * @brief 请求级对象arena
+ * @description 作用域内的临时对象在StackAllocator中顺序分配，作用域结束时
+ *              疏散逃逸对象并一次回滚释放其余对象
+ * @author Lua C++ Project
+ * @date 2025-09-30
+ */
+
+#pragma once
+
+#include "core/lua_common.h"
+#include "garbage_collector.h"
+#include "memory_manager.h"
+#include <vector>
+
+namespace lua_cpp {
+
+/* ========================================================================== */
+/* arena统计信息 */
+/* ========================================================================== */
+
+/**
+ * @brief arena作用域统计
+ */
+struct ArenaStats {
+    Size scopes_completed = 0;          // 已结束的最外层作用域数
+    Size objects_allocated = 0;         // arena中分配的对象数
+    Size bytes_allocated = 0;           // arena中分配的字节数
+    Size objects_released = 0;          // 随回滚析构的对象数（含已疏散的原对象）
+    Size objects_evacuated = 0;         // 逃逸后复制到堆上的对象数
+    Size fallback_allocations = 0;      // arena空间不足改由堆分配的次数
+    Size peak_usage = 0;                // 单个作用域的arena用量峰值
+};
+
+/* ========================================================================== */
+/* 对象arena */
+/* ========================================================================== */
+
+/**
+ * @brief 请求级对象arena
+ *
+ * 服务端一次脚本调用对应一个作用域：作用域内VM创建的临时表和拼接字符串
+ * 从StackAllocator顺序分配（不加锁），不登记到GC，也不进入对象链表。
+ * 作用域内arena对象一律存活，GC把它们当作根标记，以保持其引用的堆对象；
+ * 登记过的逃逸所有者同样保持到作用域结束。
+ *
+ * 作用域结束时找出仍然可见的arena对象并复制到堆上（疏散），其余对象
+ * 析构后整体回滚到作用域开始的位置。可见性来自：
+ * - 堆对象：写屏障在arena对象存入arena外的对象时登记所有者
+ * - 全局变量：SETGLOBAL写入arena对象时登记
+ * - 闭合上值：上值闭合或写入arena对象时登记其值槽
+ * - VM栈：栈顶以下的槽位由VM在退出作用域时修正
+ * 疏散按Cheney算法进行，转发地址记在原对象空闲的链表指针中，
+ * 对象图中的环和共享引用都只复制一次。
+ *
+ * 嵌套的作用域并入最外层，只有最外层退出时才疏散和回滚。
+ * 短字符串经驻留表去重，始终在堆上分配。
+ */
+class ObjectArena {
+public:
+    static constexpr Size kDefaultCapacity = 1024 * 1024;  // 默认arena容量（1MB）
+
+    /**
+     * @brief 构造函数
+     * @param capacity arena容量，超出后作用域内的分配退回堆上
+     */
+    explicit ObjectArena(Size capacity = kDefaultCapacity);
+
+    /**
+     * @brief 析构函数（仍在作用域内时直接释放全部arena对象）
+     */
+    ~ObjectArena();
+
+    // 禁用拷贝和移动（对象和线程本地指针引用arena地址）
+    LUA_NO_COPY_MOVE(ObjectArena)
+
+    /* ====================================================================== */
+    /* 作用域 */
+    /* ====================================================================== */
+
+    /**
+     * @brief 进入作用域
+     */
+    void Enter();
+
+    /**
+     * @brief 退出作用域；最外层退出时疏散已登记的逃逸对象并回滚
+     *
+     * 调用方需要先用Forward()修正自己持有的值（VM栈等）
+     * @return 本次疏散的对象数量（内层退出时为0）
+     */
+    Size Exit();
+
+    /**
+     * @brief 是否在作用域内
+     */
+    bool IsActive() const { return depth_ > 0; }
+
+    /**
+     * @brief 获取嵌套深度
+     */
+    Size GetDepth() const { return depth_; }
+
+    /**
+     * @brief 获取当前线程正在使用的arena（没有时返回nullptr）
+     */
+    static ObjectArena* GetActive();
+
+    /* ====================================================================== */
+    /* 分配 */
+    /* ====================================================================== */
+
+    /**
+     * @brief 在arena中创建对象（不在作用域内或空间不足时在堆上创建）
+     */
+    template<typename T, typename... Args>
+    T* Allocate(Args&&... args) {
+        static_assert(std::is_base_of_v<GCObject, T>, "T must inherit from GCObject");
+
+        void* memory = IsActive() ? allocator_.Allocate(sizeof(T), alignof(T)) : nullptr;
+        if (!memory) {
+            if (IsActive()) {
+                stats_.fallback_allocations++;
+            }
+            return AllocateGCObject<T>(std::forward<Args>(args)...);
+        }
+
+        T* obj;
+        try {
+            obj = new(memory) T(std::forward<Args>(args)...);
+        } catch (...) {
+            allocator_.Deallocate(memory, sizeof(T));
+            throw;
+        }
+        obj->size_class_ = GCObject::kArenaSizeClass;
+        objects_.push_back(obj);
+
+        stats_.objects_allocated++;
+        stats_.bytes_allocated += sizeof(T);
+        return obj;
+    }
+
+    /**
+     * @brief 当前作用域中的arena对象
+     */
+    const std::vector<GCObject*>& GetObjects() const { return objects_; }
+
+    /**
+     * @brief 已登记的逃逸所有者（GC在作用域内保持其存活，疏散时不会失效）
+     */
+    const std::vector<GCObject*>& GetEscapedOwners() const { return escaped_owners_; }
+
+    /* ====================================================================== */
+    /* 逃逸与疏散 */
+    /* ====================================================================== */
+
+    /**
+     * @brief 登记引用了arena对象的堆对象
+     */
+    void RecordEscape(GCObject* owner);
+
+    /**
+     * @brief 已登记的所有者在作用域结束前被释放时撤销登记
+     */
+    void ForgetEscape(GCObject* owner);
+
+    /**
+     * @brief 登记存放了arena对象、生命周期由外部管理的值槽（闭合上值）
+     */
+    void RecordEscapedSlot(LuaValue* slot);
+
+    /**
+     * @brief 值槽在作用域结束前失效时撤销登记
+     */
+    void ForgetEscapedSlot(LuaValue* slot);
+
+    /**
+     * @brief 标记全局表写入过arena对象
+     */
+    void RecordGlobalEscape() { globals_escaped_ = true; }
+
+    /**
+     * @brief 全局表是否可能引用arena对象
+     */
+    bool HasGlobalEscape() const { return globals_escaped_; }
+
+    /**
+     * @brief 修正一个值：arena对象返回其堆上副本（必要时先疏散），其他值原样返回
+     */
+    LuaValue Forward(const LuaValue& value);
+
+    /**
+     * @brief 修正表中的全部键和值
+     */
+    void ForwardTable(LuaTable& table);
+
+    /**
+     * @brief 获取已疏散对象的堆上副本（尚未疏散时返回nullptr）
+     */
+    static GCObject* GetForwardingAddress(const GCObject* obj) {
+        return obj->IsArenaAllocated() ? obj->gc_next_ : nullptr;
+    }
+
+    /* ====================================================================== */
+    /* 统计 */
+    /* ====================================================================== */
+
+    const ArenaStats& GetStats() const { return stats_; }
+
+    /**
+     * @brief 当前作用域的arena用量
+     */
+    Size GetUsage() const { return allocator_.GetStats().current_usage; }
+
+private:
+    /**
+     * @brief 疏散一个arena对象，返回堆上副本（表的内容留到DrainEvacuation复制）
+     */
+    GCObject* Evacuate(GCObject* obj);
+
+    /**
+     * @brief 复制已疏散表的内容，直到没有新的疏散对象
+     */
+    void DrainEvacuation();
+
+    /**
+     * @brief 析构全部arena对象并回滚到作用域开始的位置
+     */
+    void ReleaseObjects();
+
+    StackAllocator allocator_;
+    StackAllocator::Marker scope_start_;
+    std::vector<GCObject*> objects_;            // 作用域内的arena对象
+    std::vector<GCObject*> escaped_owners_;     // 引用了arena对象的堆对象
+    std::vector<LuaValue*> escaped_slots_;      // 存放了arena对象的外部值槽
+    std::vector<TableObject*> evacuated_tables_; // 待复制内容的已疏散表（原对象）
+    Size drained_tables_;
+    bool globals_escaped_;
+    Size depth_;
+    ObjectArena* previous_active_;              // 外层（其他VM）的arena
+    ArenaStats stats_;
+};
+
+} // namespace lua_cpp
@@ -0,0 +1,81 @@
+/**
+ * @file state_allocator.h
+ * @brief 解释器内部容器的STL分配器适配
+ * @description 表和VM栈等容器的存储经内存管理器的宿主分配函数分配，计入内存统计和限制
+ * @author Lua C++ Project
+ * @date 2025-10-01
+ */
+
+#pragma once
+
+#include "core/lua_common.h"
+#include <cstddef>
+#include <type_traits>
+
+namespace lua_cpp {
+
+class MemoryManager;
+
+/**
+ * @brief 当前线程绑定的内存管理器（未绑定时为进程默认管理器）
+ */
+MemoryManager& GetCurrentMemoryManager();
+
+/**
+ * @brief 经内存管理器分配容器存储
+ * @throws OutOfMemoryError 超出内存限制或分配函数失败
+ */
+void* AllocateStateStorage(MemoryManager& manager, Size size);
+
+/**
+ * @brief 归还容器存储
+ */
+void DeallocateStateStorage(MemoryManager& manager, void* ptr, Size size) noexcept;
+
+/**
+ * @brief 解释器内部容器的STL分配器
+ *
+ * 满足Allocator要求的适配层，只记录所属的内存管理器，构造时必须显式
+ * 给出（通常是所属VM的管理器），已分配的存储总是归还原管理器。分配器
+ * 随容器移动、拷贝和交换传播，元素不会落到另一个管理器上。
+ */
+template<typename T>
+class StateAllocator {
+public:
+    static_assert(alignof(T) <= alignof(std::max_align_t),
+                  "StateAllocator only provides fundamental alignment");
+
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+    using is_always_equal = std::false_type;
+
+    explicit StateAllocator(MemoryManager& manager) noexcept : manager_(&manager) {}
+
+    template<typename U>
+    StateAllocator(const StateAllocator<U>& other) noexcept : manager_(other.GetManager()) {}
+
+    T* allocate(std::size_t count) {
+        return static_cast<T*>(AllocateStateStorage(*manager_, count * sizeof(T)));
+    }
+
+    void deallocate(T* ptr, std::size_t count) noexcept {
+        DeallocateStateStorage(*manager_, ptr, count * sizeof(T));
+    }
+
+    /**
+     * @brief 所属的内存管理器
+     */
+    MemoryManager* GetManager() const noexcept { return manager_; }
+
+    template<typename U>
+    bool operator==(const StateAllocator<U>& other) const noexcept {
+        return manager_ == other.GetManager();
+    }
+
+private:
+    MemoryManager* manager_;
+};
+
+} // namespace lua_cpp
@@ -0,0 +1,131 @@
+/**
+ * @file string_table.cpp
+ * @brief 字符串驻留表实现
+ * @description 链式哈希表，算法与Lua 5.1 lstring.c一致
+ * @author Lua C++ Project
+ * @date 2025-09-21
+ */
+
+#include "string_table.h"
+#include "garbage_collector.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace lua_cpp {
+
+/* ========================================================================== */
+/* 构造 */
+/* ========================================================================== */
+
+StringTable::StringTable(Size initial_buckets)
+    : buckets_(std::bit_ceil(std::max(initial_buckets, kMinBuckets)), nullptr) {
+}
+
+/* ========================================================================== */
+/* 查找与插入 */
+/* ========================================================================== */
+
+StringObject* StringTable::Find(const char* str, Size length, uint64_t hash) const {
+    for (StringObject* node = buckets_[BucketIndex(hash)]; node; node = node->hash_next_) {
+        if (node->hash_ == hash && node->str_.size() == length &&
+            std::memcmp(node->str_.data(), str, length) == 0) {
+            return node;
+        }
+    }
+    return nullptr;
+}
+
+void StringTable::Insert(StringObject* str) {
+    // 与luaS_newlstr相同：负载因子超过1时桶数翻倍
+    if (count_ >= buckets_.size()) {
+        Resize(buckets_.size() * 2);
+    }
+
+    Size index = BucketIndex(str->GetHash());
+    str->hash_next_ = buckets_[index];
+    str->intern_table_ = this;
+    buckets_[index] = str;
+    count_++;
+}
+
+void StringTable::Remove(StringObject* str) {
+    if (str->intern_table_ != this) {
+        return;
+    }
+
+    StringObject** link = &buckets_[BucketIndex(str->hash_)];
+    while (*link) {
+        if (*link == str) {
+            *link = str->hash_next_;
+            str->hash_next_ = nullptr;
+            str->intern_table_ = nullptr;
+            count_--;
+            return;
+        }
+        link = &(*link)->hash_next_;
+    }
+}
+
+/* ========================================================================== */
+/* GC支持 */
+/* ========================================================================== */
+
+Size StringTable::SweepDead() {
+    Size removed = 0;
+
+    for (StringObject*& bucket : buckets_) {
+        StringObject** link = &bucket;
+        while (*link) {
+            StringObject* node = *link;
+            if (node->GetColor() == GCColor::White) {
+                *link = node->hash_next_;
+                node->hash_next_ = nullptr;
+                node->intern_table_ = nullptr;
+                removed++;
+            } else {
+                link = &node->hash_next_;
+            }
+        }
+    }
+    count_ -= removed;
+
+    // 与checkSizes相同：使用率低于1/4时收缩
+    if (count_ < buckets_.size() / 4 && buckets_.size() > kMinBuckets) {
+        Resize(buckets_.size() / 2);
+    }
+    return removed;
+}
+
+void StringTable::Clear() {
+    for (StringObject*& bucket : buckets_) {
+        while (bucket) {
+            StringObject* next = bucket->hash_next_;
+            bucket->hash_next_ = nullptr;
+            bucket->intern_table_ = nullptr;
+            bucket = next;
+        }
+    }
+    count_ = 0;
+}
+
+/* ========================================================================== */
+/* 内部方法 */
+/* ========================================================================== */
+
+void StringTable::Resize(Size new_size) {
+    std::vector<StringObject*> old_buckets(new_size, nullptr);
+    old_buckets.swap(buckets_);
+
+    for (StringObject* node : old_buckets) {
+        while (node) {
+            StringObject* next = node->hash_next_;
+            Size index = BucketIndex(node->hash_);
+            node->hash_next_ = buckets_[index];
+            buckets_[index] = node;
+            node = next;
+        }
+    }
+}
+
+} // namespace lua_cpp
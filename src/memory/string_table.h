@@ -0,0 +1,104 @@
+/**
+ * @file string_table.h
+ * @brief 字符串驻留表
+ * @description 每个状态一个的短字符串驻留表，对应Lua的global_State::strt
+ * @author Lua C++ Project
+ * @date 2025-09-21
+ */
+
+#pragma once
+
+#include "core/lua_common.h"
+#include <vector>
+#include <cstdint>
+
+namespace lua_cpp {
+
+class StringObject;
+
+/**
+ * @brief 短字符串驻留表
+ *
+ * 长度不超过StringObject::kMaxShortLength的字符串在创建时查表，
+ * 内容相同的短字符串全局只有一个StringObject，因此：
+ * - 哈希值在创建时计算一次并缓存在对象上
+ * - 相等比较退化为指针比较
+ *
+ * 表本身不持有引用（弱表语义），GC在原子标记结束后调用SweepDead()
+ * 摘除未被标记的字符串，随后的清扫阶段再释放它们。
+ *
+ * 桶使用StringObject内嵌的链指针串联，不额外分配节点。
+ * 驻留表属于单个状态，不做内部加锁。
+ */
+class StringTable {
+public:
+    /**
+     * @brief 构造函数
+     * @param initial_buckets 初始桶数（会向上取2的幂）
+     */
+    explicit StringTable(Size initial_buckets = kMinBuckets);
+    ~StringTable() = default;
+
+    StringTable(const StringTable&) = delete;
+    StringTable& operator=(const StringTable&) = delete;
+
+    /* ====================================================================== */
+    /* 查找与插入 */
+    /* ====================================================================== */
+
+    /**
+     * @brief 按内容查找已驻留的字符串
+     * @param hash StringObject::ComputeHash(str, length)的结果
+     * @return 找到的字符串对象，不存在时返回nullptr
+     */
+    StringObject* Find(const char* str, Size length, uint64_t hash) const;
+
+    /**
+     * @brief 插入新字符串（调用者保证内容未驻留）
+     */
+    void Insert(StringObject* str);
+
+    /**
+     * @brief 移除指定字符串（显式释放时使用）
+     */
+    void Remove(StringObject* str);
+
+    /* ====================================================================== */
+    /* GC支持 */
+    /* ====================================================================== */
+
+    /**
+     * @brief 弱清扫：摘除所有未标记（白色）的字符串
+     * @return 摘除的字符串数量
+     */
+    Size SweepDead();
+
+    /**
+     * @brief 清空表（不释放字符串对象）
+     */
+    void Clear();
+
+    /* ====================================================================== */
+    /* 统计信息 */
+    /* ====================================================================== */
+
+    Size GetCount() const { return count_; }
+    Size GetBucketCount() const { return buckets_.size(); }
+
+private:
+    /**
+     * @brief 调整桶数并重新分布所有字符串
+     */
+    void Resize(Size new_size);
+
+    Size BucketIndex(uint64_t hash) const {
+        return static_cast<Size>(hash) & (buckets_.size() - 1);
+    }
+
+    static constexpr Size kMinBuckets = 32;     // MINSTRTABSIZE
+
+    std::vector<StringObject*> buckets_;        // 桶数组（大小为2的幂）
+    Size count_ = 0;                            // 驻留字符串数量
+};
+
+} // namespace lua_cpp
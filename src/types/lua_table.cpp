@@ -1,29 +1,452 @@
 /**
  * @file lua_table.cpp
  * @brief Lua表类型实现
- * @description 简单的Lua表类型实现，用于GC测试
+ * @description 混合数组/哈希表实现，算法与Lua 5.1 ltable.c一致
  * @author Lua C++ Project
  * @date 2025-09-21
  */
 
 #include "lua_table.h"
+#include "memory/garbage_collector.h"
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
 
 namespace lua_cpp {
 
-void LuaTable::Set(const LuaValue& key, const LuaValue& value) {
-    // 简化实现：将key转为字符串
-    std::string key_str = "key"; // 简化
-    data_[key_str] = value;
+namespace {
+
+/**
+ * @brief 64位整数混淆（splitmix64终结器）
+ */
+inline uint64_t MixBits(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+/**
+ * @brief 满足 2^(i-1) < k <= 2^i 的i
+ */
+inline int CeilLog2(Size k) {
+    return static_cast<int>(std::bit_width(k - 1));
+}
+
+} // namespace
+
+/* ========================================================================== */
+/* 构造 */
+/* ========================================================================== */
+
+LuaTable::LuaTable(Size array_size, Size hash_size, MemoryManager& manager)
+    : array_(StateAllocator<LuaValue>(manager))
+    , nodes_(StateAllocator<Node>(manager)) {
+    if (array_size > 0 || hash_size > 0) {
+        Resize(array_size, hash_size);
+    }
+}
+
+/* ========================================================================== */
+/* 键哈希 */
+/* ========================================================================== */
+
+uint64_t LuaTable::HashKey(const LuaValue& key) {
+    if (key.IsNumber()) {
+        double d = key.GetNumber();
+        if (d == 0.0) {
+            d = 0.0;  // -0和+0必须落在同一个桶
+        }
+        return MixBits(std::bit_cast<uint64_t>(d));
+    }
+    if (key.IsString()) {
+        return key.GetStringObject()->GetHash();
+    }
+    // 布尔值和其他GC对象按身份哈希
+    return MixBits(key.GetRawBits());
+}
+
+Size LuaTable::ArrayIndexOf(const LuaValue& key) {
+    if (!key.IsNumber()) {
+        return 0;
+    }
+    double d = key.GetNumber();
+    if (!(d >= 1.0 && d <= static_cast<double>(Size(1) << kMaxBits))) {
+        return 0;
+    }
+    Size k = static_cast<Size>(d);
+    return static_cast<double>(k) == d ? k : 0;
+}
+
+/* ========================================================================== */
+/* 查找 */
+/* ========================================================================== */
+
+Size LuaTable::FindNode(const LuaValue& key, uint64_t hash) const {
+    if (nodes_.empty()) {
+        return npos;
+    }
+
+    Size i = static_cast<Size>(hash) & node_mask_;
+    for (Size probes = 0; probes <= node_mask_; ++probes) {
+        const Node& node = nodes_[i];
+        if (node.key.IsNil()) {
+            return npos;  // 空槽终止探测链
+        }
+        if (node.key == key) {
+            return i;
+        }
+        i = (i + 1) & node_mask_;
+    }
+    return npos;
+}
+
+Size LuaTable::FindStrNode(StringObject* key) const {
+    if (nodes_.empty()) {
+        return npos;
+    }
+
+    const uint64_t key_bits = LuaValue(key).GetRawBits();
+    Size i = static_cast<Size>(key->GetHash()) & node_mask_;
+    for (Size probes = 0; probes <= node_mask_; ++probes) {
+        const Node& node = nodes_[i];
+        if (node.key.IsNil()) {
+            return npos;
+        }
+        if (node.key.GetRawBits() == key_bits) {
+            return i;
+        }
+        // 长字符串和来自另一个状态驻留表的字符串需要比较内容
+        if (node.key.IsString() && key->Equals(node.key.GetStringObject())) {
+            return i;
+        }
+        i = (i + 1) & node_mask_;
+    }
+    return npos;
+}
+
+LuaValue LuaTable::GetStr(StringObject* key) const {
+    Size slot = FindStrNode(key);
+    return slot == npos ? LuaValue() : nodes_[slot].value;
+}
+
+const LuaValue* LuaTable::Find(const LuaValue& key) const {
+    if (key.IsString()) {
+        Size slot = FindStrNode(key.GetStringObject());
+        return slot == npos ? nullptr : &nodes_[slot].value;
+    }
+
+    Size index = ArrayIndexOf(key);
+    if (index != 0 && index <= array_.size()) {
+        return &array_[index - 1];
+    }
+    if (key.IsNil() || nodes_.empty()) {
+        return nullptr;
+    }
+
+    Size slot = FindNode(key, HashKey(key));
+    return slot == npos ? nullptr : &nodes_[slot].value;
 }
 
 LuaValue LuaTable::Get(const LuaValue& key) const {
-    // 简化实现
-    std::string key_str = "key"; // 简化
-    auto it = data_.find(key_str);
-    if (it != data_.end()) {
-        return it->second;
+    const LuaValue* slot = Find(key);
+    return slot ? *slot : LuaValue();
+}
+
+LuaValue LuaTable::GetInt(Size index) const {
+    if (index - 1 < array_.size()) {
+        return array_[index - 1];
+    }
+    if (nodes_.empty()) {
+        return LuaValue();
+    }
+
+    LuaValue key(static_cast<double>(index));
+    Size slot = FindNode(key, HashKey(key));
+    return slot == npos ? LuaValue() : nodes_[slot].value;
+}
+
+/* ========================================================================== */
+/* 写入 */
+/* ========================================================================== */
+
+void LuaTable::Set(const LuaValue& key, const LuaValue& value) {
+    Size index = ArrayIndexOf(key);
+    if (index != 0 && index <= array_.size()) {
+        array_[index - 1] = value;
+        return;
+    }
+
+    if (key.IsNil()) {
+        throw std::runtime_error("table index is nil");
+    }
+    if (key.IsNumber() && key.GetNumber() != key.GetNumber()) {
+        throw std::runtime_error("table index is NaN");
+    }
+
+    Size slot = FindNode(key, HashKey(key));
+    if (slot != npos) {
+        nodes_[slot].value = value;  // 已存在（或墓碑）的键直接覆盖
+        return;
+    }
+
+    if (value.IsNil()) {
+        return;  // 删除不存在的键
+    }
+
+    InsertNew(key, value);
+}
+
+void LuaTable::SetInt(Size index, const LuaValue& value) {
+    if (index - 1 < array_.size()) {
+        array_[index - 1] = value;
+        return;
+    }
+    Set(LuaValue(static_cast<double>(index)), value);
+}
+
+void LuaTable::InsertNew(const LuaValue& key, const LuaValue& value) {
+    // 负载因子上限75%，超出时按键分布重新规划两部分大小
+    if ((used_nodes_ + 1) * 4 > nodes_.size() * 3) {
+        Rehash(key);
+
+        Size index = ArrayIndexOf(key);
+        if (index != 0 && index <= array_.size()) {
+            array_[index - 1] = value;
+            return;
+        }
+    }
+
+    RawInsertNode(key, value);
+}
+
+void LuaTable::RawInsertNode(const LuaValue& key, const LuaValue& value) {
+    Size i = static_cast<Size>(HashKey(key)) & node_mask_;
+    while (true) {
+        Node& node = nodes_[i];
+        if (node.key.IsNil()) {
+            node.key = key;
+            node.value = value;
+            used_nodes_++;
+            return;
+        }
+        if (node.value.IsNil()) {
+            // 复用墓碑槽（调用者保证键不存在）
+            node.key = key;
+            node.value = value;
+            return;
+        }
+        i = (i + 1) & node_mask_;
+    }
+}
+
+/* ========================================================================== */
+/* Rehash */
+/* ========================================================================== */
+
+void LuaTable::Rehash(const LuaValue& extra_key) {
+    Size nums[kMaxBits + 1] = {};
+    Size int_keys = 0;
+
+    // 统计数组部分的整数键（numusearray）
+    Size i = 1;
+    for (int lg = 0, ttlg = 1; lg <= kMaxBits; lg++, ttlg *= 2) {
+        Size limit = std::min<Size>(static_cast<Size>(ttlg), array_.size());
+        if (i > limit) {
+            break;
+        }
+        Size count = 0;
+        for (; i <= limit; i++) {
+            if (!array_[i - 1].IsNil()) {
+                count++;
+            }
+        }
+        nums[lg] += count;
+        int_keys += count;
+    }
+    Size total = int_keys;
+
+    // 统计哈希部分（numusehash）
+    for (const Node& node : nodes_) {
+        if (!node.key.IsNil() && !node.value.IsNil()) {
+            total++;
+            Size k = ArrayIndexOf(node.key);
+            if (k != 0) {
+                nums[CeilLog2(k)]++;
+                int_keys++;
+            }
+        }
+    }
+
+    // 计入即将插入的键
+    total++;
+    Size extra = ArrayIndexOf(extra_key);
+    if (extra != 0) {
+        nums[CeilLog2(extra)]++;
+        int_keys++;
+    }
+
+    // computesizes：选择使用率超过一半的最大2的幂
+    Size array_size = 0;
+    Size in_array = 0;
+    Size accumulated = 0;
+    for (int lg = 0, twotoi = 1; lg <= kMaxBits && static_cast<Size>(twotoi / 2) < int_keys;
+         lg++, twotoi *= 2) {
+        if (nums[lg] > 0) {
+            accumulated += nums[lg];
+            if (accumulated > static_cast<Size>(twotoi / 2)) {
+                array_size = static_cast<Size>(twotoi);
+                in_array = accumulated;
+            }
+        }
+    }
+
+    Resize(array_size, total - in_array);
+}
+
+void LuaTable::Resize(Size array_size, Size hash_size) {
+    // 哈希部分容量取2的幂，保证负载不超过75%
+    Size capacity = 0;
+    if (hash_size > 0) {
+        capacity = std::bit_ceil(hash_size + hash_size / 3 + 1);
+    }
+
+    // 先申请新的哈希部分：分配失败或超出内存限制时抛出，表保持原样
+    NodeVector old_nodes(capacity, Node{}, nodes_.get_allocator());
+
+    // 收集将被截断的数组元素（暂存区同样经由表的内存管理器计量）
+    NodeVector overflow(nodes_.get_allocator());
+    for (Size i = array_size; i < array_.size(); ++i) {
+        if (!array_[i].IsNil()) {
+            overflow.push_back({LuaValue(static_cast<double>(i + 1)), array_[i]});
+        }
+    }
+    array_.resize(array_size);
+
+    nodes_.swap(old_nodes);
+    node_mask_ = capacity > 0 ? capacity - 1 : 0;
+    used_nodes_ = 0;
+
+    for (const Node& node : overflow) {
+        Set(node.key, node.value);
+    }
+    for (const Node& node : old_nodes) {
+        if (!node.key.IsNil() && !node.value.IsNil()) {
+            Set(node.key, node.value);
+        }
+    }
+}
+
+void LuaTable::ResizeArray(Size array_size) {
+    Size hash_count = 0;
+    for (const Node& node : nodes_) {
+        if (!node.key.IsNil() && !node.value.IsNil()) {
+            hash_count++;
+        }
+    }
+    Resize(array_size, hash_count);
+}
+
+/* ========================================================================== */
+/* 长度与遍历 */
+/* ========================================================================== */
+
+Size LuaTable::Length() const {
+    Size j = array_.size();
+    if (j > 0 && array_[j - 1].IsNil()) {
+        // 数组部分内存在边界，二分查找
+        Size i = 0;
+        while (j - i > 1) {
+            Size m = (i + j) / 2;
+            if (array_[m - 1].IsNil()) {
+                j = m;
+            } else {
+                i = m;
+            }
+        }
+        return i;
+    }
+    if (nodes_.empty()) {
+        return j;
+    }
+    return UnboundSearch(j);
+}
+
+Size LuaTable::UnboundSearch(Size j) const {
+    Size i = j;
+    j++;
+    while (!GetInt(j).IsNil()) {
+        i = j;
+        if (j > (Size(1) << (kMaxBits + 4))) {
+            // 病态情况，退化为线性搜索
+            i = 1;
+            while (!GetInt(i).IsNil()) {
+                i++;
+            }
+            return i - 1;
+        }
+        j *= 2;
+    }
+    while (j - i > 1) {
+        Size m = (i + j) / 2;
+        if (GetInt(m).IsNil()) {
+            j = m;
+        } else {
+            i = m;
+        }
+    }
+    return i;
+}
+
+bool LuaTable::Next(LuaValue& key, LuaValue& value) const {
+    Size position = 0;  // 下一个要检查的位置：[0, array) 数组，[array, array+nodes) 哈希
+
+    if (!key.IsNil()) {
+        Size index = ArrayIndexOf(key);
+        if (index != 0 && index <= array_.size()) {
+            position = index;
+        } else {
+            Size slot = FindNode(key, HashKey(key));
+            if (slot == npos) {
+                throw std::runtime_error("invalid key to 'next'");
+            }
+            position = array_.size() + slot + 1;
+        }
+    }
+
+    for (; position < array_.size(); ++position) {
+        if (!array_[position].IsNil()) {
+            key = LuaValue(static_cast<double>(position + 1));
+            value = array_[position];
+            return true;
+        }
+    }
+    for (Size slot = position - array_.size(); slot < nodes_.size(); ++slot) {
+        const Node& node = nodes_[slot];
+        if (!node.key.IsNil() && !node.value.IsNil()) {
+            key = node.key;
+            value = node.value;
+            return true;
+        }
+    }
+    return false;
+}
+
+Size LuaTable::GetSize() const {
+    Size count = 0;
+    for (const LuaValue& value : array_) {
+        if (!value.IsNil()) {
+            count++;
+        }
+    }
+    for (const Node& node : nodes_) {
+        if (!node.key.IsNil() && !node.value.IsNil()) {
+            count++;
+        }
     }
-    return LuaValue(); // 返回nil
+    return count;
 }
 
-} // namespace lua_cpp
\ No newline at end of file
+} // namespace lua_cpp
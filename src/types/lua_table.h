@@ -1,7 +1,7 @@
 /**
  * @file lua_table.h
  * @brief Lua表类型定义
- * @description 简单的Lua表类型定义，用于GC依赖
+ * @description Lua 5.1风格的混合表：数组部分 + 开放寻址哈希部分
  * @author Lua C++ Project
  * @date 2025-09-21
  */
@@ -10,35 +10,306 @@
 
 #include "core/lua_common.h"
 #include "value.h"
-#include <unordered_map>
+#include "memory/state_allocator.h"
 #include <vector>
+#include <cstdint>
 
 namespace lua_cpp {
 
 /**
- * @brief 简单的Lua表实现（用于GC测试）
+ * @brief Lua表实现
+ *
+ * 与Lua 5.1的ltable.c相同的混合结构：
+ * - 数组部分：存放整数键1..n，直接下标访问
+ * - 哈希部分：以LuaValue本身为键的开放寻址（线性探测）哈希表，
+ *   字符串键使用StringObject中缓存的哈希值
+ *
+ * 哈希部分满时执行rehash：统计所有整数键，选择使数组部分
+ * 利用率超过50%的最大2的幂作为新数组大小，其余键进入哈希部分。
  */
 class LuaTable {
 public:
-    LuaTable() = default;
-    ~LuaTable() = default;
+    /**
+     * @brief 哈希节点
+     *
+     * 空槽：key为nil；已删除槽（墓碑）：key非nil且value为nil
+     */
+    struct Node {
+        LuaValue key;
+        LuaValue value;
+    };
     
-    // 基本操作
-    void Set(const LuaValue& key, const LuaValue& value);
+    // 数组和哈希部分经内存管理器的宿主分配函数分配，计入内存统计和限制
+    using ValueVector = std::vector<LuaValue, StateAllocator<LuaValue>>;
+    using NodeVector = std::vector<Node, StateAllocator<Node>>;
+
+    /**
+     * @brief 构造函数
+     * @param array_size 数组部分预分配大小（来自NEWTABLE的B操作数）
+     * @param hash_size 哈希部分预分配大小（来自NEWTABLE的C操作数）
+     * @param manager 分配数组和哈希部分的内存管理器（默认为当前线程绑定的管理器）
+     */
+    explicit LuaTable(Size array_size = 0, Size hash_size = 0,
+                      MemoryManager& manager = GetCurrentMemoryManager());
+    ~LuaTable() = default;
+
+    LuaTable(const LuaTable&) = delete;
+    LuaTable& operator=(const LuaTable&) = delete;
+    LuaTable(LuaTable&&) noexcept = default;
+    LuaTable& operator=(LuaTable&&) noexcept = default;
+
+    /* ====================================================================== */
+    /* 基本操作 */
+    /* ====================================================================== */
+
+    /**
+     * @brief 获取键对应的值（不存在时返回nil）
+     */
     LuaValue Get(const LuaValue& key) const;
-    
-    // 大小信息
-    Size GetSize() const { return data_.size(); }
-    bool IsEmpty() const { return data_.empty(); }
-    
-    // 遍历支持
-    auto begin() { return data_.begin(); }
-    auto end() { return data_.end(); }
-    auto begin() const { return data_.begin(); }
-    auto end() const { return data_.end(); }
-    
+
+    /**
+     * @brief 设置键值对（value为nil时删除）
+     * @throws std::runtime_error 键为nil或NaN
+     */
+    void Set(const LuaValue& key, const LuaValue& value);
+
+    /**
+     * @brief 整数键快速读取（1-based）
+     */
+    LuaValue GetInt(Size index) const;
+
+    /**
+     * @brief 整数键快速写入（1-based）
+     */
+    void SetInt(Size index, const LuaValue& value);
+
+    /**
+     * @brief 字符串键快速读取
+     *
+     * 直接使用StringObject缓存的哈希，驻留字符串只比较指针。
+     * 用于GETGLOBAL/GETTABLE的常量字符串键。
+     */
+    LuaValue GetStr(StringObject* key) const;
+
+    /**
+     * @brief 查找键对应的值槽
+     * @return 值槽指针，键不存在时返回nullptr
+     */
+    const LuaValue* Find(const LuaValue& key) const;
+
+    /* ====================================================================== */
+    /* 内联缓存支持 */
+    /* ====================================================================== */
+
+    static constexpr uint32_t kNoNode = UINT32_MAX;
+
+    /**
+     * @brief 按预测的节点下标访问字符串键的值槽
+     * @return 该节点的键正是key时返回值槽，否则返回nullptr（调用者回退到完整查找）
+     */
+    LuaValue* GetNodeValueIfKey(uint32_t node, StringObject* key) {
+        if (node < nodes_.size() && nodes_[node].key.GetRawBits() == LuaValue(key).GetRawBits()) {
+            return &nodes_[node].value;
+        }
+        return nullptr;
+    }
+    const LuaValue* GetNodeValueIfKey(uint32_t node, StringObject* key) const {
+        return const_cast<LuaTable*>(this)->GetNodeValueIfKey(node, key);
+    }
+
+    /**
+     * @brief 查找字符串键所在的哈希节点下标
+     * @return 节点下标，键不存在时返回kNoNode
+     */
+    uint32_t FindStrNodeIndex(StringObject* key) const {
+        Size node = FindStrNode(key);
+        return node == npos ? kNoNode : static_cast<uint32_t>(node);
+    }
+
+    /* ====================================================================== */
+    /* 长度与遍历 */
+    /* ====================================================================== */
+
+    /**
+     * @brief 长度操作符#（边界搜索，与luaH_getn一致）
+     */
+    Size Length() const;
+
+    /**
+     * @brief 遍历下一个键值对（lua_next语义）
+     * @param key 输入上一个键（nil表示开始），输出下一个键
+     * @param value 输出对应的值
+     * @return 是否还有元素
+     */
+    bool Next(LuaValue& key, LuaValue& value) const;
+
+    /**
+     * @brief 对所有非nil键值对调用fn(key, value)
+     */
+    template<typename Fn>
+    void ForEach(Fn&& fn) const {
+        for (Size i = 0; i < array_.size(); ++i) {
+            if (!array_[i].IsNil()) {
+                fn(LuaValue(static_cast<double>(i + 1)), array_[i]);
+            }
+        }
+        for (const Node& node : nodes_) {
+            if (!node.key.IsNil() && !node.value.IsNil()) {
+                fn(node.key, node.value);
+            }
+        }
+    }
+
+    /**
+     * @brief 对所有存活槽位调用fn(value)，包括墓碑槽的键
+     *
+     * 墓碑键仍参与探测比较，GC遍历时必须保持其存活
+     */
+    template<typename Fn>
+    void ForEachSlotValue(Fn&& fn) const {
+        for (const LuaValue& value : array_) {
+            if (!value.IsNil()) {
+                fn(value);
+            }
+        }
+        for (const Node& node : nodes_) {
+            if (!node.key.IsNil()) {
+                fn(node.key);
+                if (!node.value.IsNil()) {
+                    fn(node.value);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief 用fn(value)的返回值替换全部键和值
+     *
+     * 对象arena疏散时把引用改为堆上副本。非字符串键按地址哈希，
+     * 键对象发生变化时重建哈希部分（同时丢弃墓碑）。
+     */
+    template<typename Fn>
+    void ForwardReferences(Fn&& fn) {
+        for (LuaValue& value : array_) {
+            if (!value.IsNil()) {
+                value = fn(value);
+            }
+        }
+        bool rehash = false;
+        for (Node& node : nodes_) {
+            if (node.key.IsNil()) {
+                continue;
+            }
+            if (node.value.IsNil()) {
+                rehash = true;  // 墓碑键可能引用即将释放的对象，重建时丢弃
+                continue;
+            }
+            LuaValue key = fn(node.key);
+            if (!key.IsString() && key.GetGCObject() != node.key.GetGCObject()) {
+                rehash = true;
+            }
+            node.key = key;
+            node.value = fn(node.value);
+        }
+        if (rehash) {
+            ResizeArray(array_.size());
+        }
+    }
+
+    /* ====================================================================== */
+    /* 大小信息 */
+    /* ====================================================================== */
+
+    /**
+     * @brief 调整数组和哈希部分的大小
+     */
+    void Resize(Size array_size, Size hash_size);
+
+    /**
+     * @brief 只调整数组部分大小，哈希部分按现有元素数重建（luaH_resizearray）
+     */
+    void ResizeArray(Size array_size);
+
+    /**
+     * @brief 非nil元素数量
+     */
+    Size GetSize() const;
+    bool IsEmpty() const { return GetSize() == 0; }
+
+    /**
+     * @brief 数组部分容量
+     */
+    Size GetArraySize() const { return array_.size(); }
+
+    /**
+     * @brief 哈希部分容量（槽数）
+     */
+    Size GetHashSize() const { return nodes_.size(); }
+
+    /**
+     * @brief 估算占用的字节数
+     */
+    Size GetMemoryFootprint() const {
+        return sizeof(LuaTable) + array_.capacity() * sizeof(LuaValue) +
+               nodes_.capacity() * sizeof(Node);
+    }
+
+    /* ====================================================================== */
+    /* 键哈希 */
+    /* ====================================================================== */
+
+    /**
+     * @brief 计算键的哈希值（字符串使用缓存哈希）
+     */
+    static uint64_t HashKey(const LuaValue& key);
+
 private:
-    std::unordered_map<std::string, LuaValue> data_;
+    /* ====================================================================== */
+    /* 内部方法 */
+    /* ====================================================================== */
+
+    /**
+     * @brief 如果key是可放入数组部分的正整数，返回其值，否则返回0
+     */
+    static Size ArrayIndexOf(const LuaValue& key);
+
+    /**
+     * @brief 在哈希部分查找键，返回槽位下标或npos
+     */
+    Size FindNode(const LuaValue& key, uint64_t hash) const;
+
+    /**
+     * @brief 在哈希部分查找字符串键，返回槽位下标或npos
+     */
+    Size FindStrNode(StringObject* key) const;
+
+    /**
+     * @brief 在哈希部分插入新键（必要时rehash）
+     */
+    void InsertNew(const LuaValue& key, const LuaValue& value);
+
+    /**
+     * @brief 根据整数键分布重新计算数组/哈希大小（ltable.c rehash）
+     */
+    void Rehash(const LuaValue& extra_key);
+
+    /**
+     * @brief 直接写入哈希部分（调用者保证有空位）
+     */
+    void RawInsertNode(const LuaValue& key, const LuaValue& value);
+
+    /**
+     * @brief 哈希部分无界边界搜索
+     */
+    Size UnboundSearch(Size j) const;
+
+    static constexpr Size npos = static_cast<Size>(-1);
+    static constexpr int kMaxBits = 26;         // 数组部分最大2^26个元素
+
+    ValueVector array_;                         // 数组部分
+    NodeVector nodes_;                          // 哈希部分（容量为2的幂）
+    Size node_mask_ = 0;                        // nodes_.size() - 1
+    Size used_nodes_ = 0;                       // 已占用槽位（含墓碑）
 };
 
-} // namespace lua_cpp
\ No newline at end of file
+} // namespace lua_cpp
@@ -0,0 +1,151 @@
+/**
+ * @file value.cpp
+ * @brief Lua值类型实现
+ * @description 实现需要完整GC对象类型的LuaValue慢路径
+ * @author Lua C++ Project
+ * @date 2025-09-21
+ */
+
+#include "value.h"
+#include "memory/garbage_collector.h"
+#include "memory/memory_manager.h"
+#include "compiler/bytecode.h"
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <cstring>
+
+namespace lua_cpp {
+
+/* ========================================================================== */
+/* 字符串构造 */
+/* ========================================================================== */
+
+LuaValue::LuaValue(const std::string& value)
+    : LuaValue(NewString(value.data(), value.size())) {
+}
+
+LuaValue::LuaValue(const char* value)
+    : LuaValue(NewString(value ? value : "", value ? std::strlen(value) : 0)) {
+}
+
+LuaValue LuaValue::FromGCObject(GCObject* obj) {
+    if (!obj) {
+        return LuaValue();
+    }
+
+    LuaValue result;
+    switch (obj->GetType()) {
+        case GCObjectType::String:
+            result.bits_ = EncodeObject(value_encoding::kTagString, obj);
+            break;
+        case GCObjectType::Table:
+            result.bits_ = EncodeObject(value_encoding::kTagTable, obj);
+            break;
+        case GCObjectType::Function:
+            result.bits_ = EncodeObject(value_encoding::kTagFunction, obj);
+            break;
+        case GCObjectType::UserData:
+            result.bits_ = EncodeObject(value_encoding::kTagUserdata, obj);
+            break;
+        case GCObjectType::Thread:
+            result.bits_ = EncodeObject(value_encoding::kTagThread, obj);
+            break;
+        case GCObjectType::Proto:
+            throw std::runtime_error("Proto objects are not first-class Lua values");
+    }
+    return result;
+}
+
+/* ========================================================================== */
+/* 值获取 */
+/* ========================================================================== */
+
+const std::string& LuaValue::AsString() const {
+    if (IsString()) {
+        return DecodeObject<StringObject>()->GetString();
+    }
+    throw std::runtime_error("Value is not a string");
+}
+
+const Proto* LuaValue::GetFunctionProto() const {
+    FunctionObject* function = GetFunction();
+    return function ? function->GetProto() : nullptr;
+}
+
+/* ========================================================================== */
+/* 慢路径 */
+/* ========================================================================== */
+
+bool LuaValue::StringContentEquals(const LuaValue& other) const {
+    return DecodeObject<StringObject>()->Equals(other.DecodeObject<StringObject>());
+}
+
+std::optional<double> LuaValue::StringToNumber() const {
+    const std::string& str = DecodeObject<StringObject>()->GetString();
+    if (str.empty()) {
+        return std::nullopt;
+    }
+
+    // 与lua_str2number一致：允许前后空白，整个字符串必须被消耗
+    const char* begin = str.c_str();
+    char* end = nullptr;
+    errno = 0;
+    double result = std::strtod(begin, &end);
+    if (end == begin) {
+        return std::nullopt;
+    }
+    while (*end == ' ' || *end == '\t' || *end == '\n' || *end == '\r' ||
+           *end == '\f' || *end == '\v') {
+        ++end;
+    }
+    if (*end != '\0') {
+        return std::nullopt;
+    }
+    return result;
+}
+
+std::string LuaValue::ToString() const {
+    switch (GetType()) {
+        case LuaType::Nil:
+            return "nil";
+        case LuaType::Boolean:
+            return GetBoolean() ? "true" : "false";
+        case LuaType::Number: {
+            char buffer[kNumberBufferSize];
+            return std::string(buffer, FormatNumber(GetNumber(), buffer));
+        }
+        case LuaType::String:
+            return AsString();
+        default: {
+            char buffer[64];
+            std::snprintf(buffer, sizeof(buffer), "%s: %p", TypeName().c_str(),
+                          static_cast<void*>(GetGCObject()));
+            return buffer;
+        }
+    }
+}
+
+/* ========================================================================== */
+/* 数值格式化 */
+/* ========================================================================== */
+
+Size FormatNumber(double value, char* buffer) {
+    // %.14g对绝对值小于1e14的整数不使用指数形式；-0需要保留符号，走通用路径
+    if (value > -1e14 && value < 1e14) {
+        int64_t integer = static_cast<int64_t>(value);
+        if (static_cast<double>(integer) == value && !(integer == 0 && std::signbit(value))) {
+            auto result = std::to_chars(buffer, buffer + kNumberBufferSize, integer);
+            return static_cast<Size>(result.ptr - buffer);
+        }
+    }
+
+    // 指定精度的general格式与printf("%.14g")输出相同
+    auto result = std::to_chars(buffer, buffer + kNumberBufferSize, value,
+                                std::chars_format::general, 14);
+    return static_cast<Size>(result.ptr - buffer);
+}
+
+} // namespace lua_cpp
@@ -1,7 +1,7 @@
 /**
  * @file value.h
  * @brief Lua值类型定义
- * @description 定义Lua中的所有值类型
+ * @description 定义Lua中的所有值类型（NaN-boxing 8字节表示）
  * @author Lua C++ Project
  * @date 2025-09-21
  */
@@ -11,8 +11,11 @@
 #include "../core/lua_common.h"
 #include <string>
 #include <memory>
-#include <variant>
+#include <optional>
 #include <stdexcept>
+#include <bit>
+#include <cstdint>
+#include <type_traits>
 
 namespace lua_cpp {
 
@@ -23,6 +26,13 @@ namespace lua_cpp {
 class LuaTable;
 class LuaFunction;
 class LuaUserdata;
+class Proto;
+
+class GCObject;
+class StringObject;
+class TableObject;
+class FunctionObject;
+class UserDataObject;
 
 /* ========================================================================== */
 /* Lua值类型枚举 */
@@ -30,6 +40,58 @@ class LuaUserdata;
 
 // LuaType已在lua_common.h中定义，此处不重复定义
 
+/* ========================================================================== */
+/* NaN-boxing编码 */
+/* ========================================================================== */
+
+/**
+ * @brief NaN-boxing编码常量
+ *
+ * 64位布局：
+ * - 普通double：原样存储（所有NaN规范化为kCanonicalNaN，即正的quiet NaN）
+ * - 装箱值：高13位全为1（符号位 + 指数 + quiet位），[50:48]为类型标签，
+ *   [47:0]为负载（布尔值或GC对象指针）
+ *
+ * 硬件产生的NaN在装箱前会被规范化，因此不会与装箱值冲突。
+ * 48位负载足以容纳x86-64/AArch64用户态指针。
+ */
+namespace value_encoding {
+
+constexpr uint64_t kBoxMask       = 0xFFF8000000000000ull;   // 装箱前缀
+constexpr uint64_t kTagMask       = 0x0007000000000000ull;   // 类型标签
+constexpr uint64_t kPayloadMask   = 0x0000FFFFFFFFFFFFull;   // 48位负载
+constexpr int      kTagShift      = 48;
+constexpr uint64_t kCanonicalNaN  = 0x7FF8000000000000ull;   // 规范化NaN
+
+/**
+ * @brief 装箱值类型标签
+ */
+enum Tag : uint64_t {
+    kTagNil         = 0,
+    kTagBoolean     = 1,
+    kTagString      = 2,
+    kTagTable       = 3,
+    kTagFunction    = 4,
+    kTagUserdata    = 5,
+    kTagThread      = 6,
+    kTagReserved    = 7
+};
+
+constexpr uint64_t MakeBoxed(Tag tag, uint64_t payload) {
+    return kBoxMask | (static_cast<uint64_t>(tag) << kTagShift) | (payload & kPayloadMask);
+}
+
+constexpr uint64_t kNilBits   = MakeBoxed(kTagNil, 0);
+constexpr uint64_t kFalseBits = MakeBoxed(kTagBoolean, 0);
+constexpr uint64_t kTrueBits  = MakeBoxed(kTagBoolean, 1);
+
+/**
+ * @brief 第一个GC类型标签，标签>=此值的装箱值负载均为GCObject指针
+ */
+constexpr uint64_t kFirstGCTag = kTagString;
+
+} // namespace value_encoding
+
 /* ========================================================================== */
 /* Lua值类 */
 /* ========================================================================== */
@@ -37,190 +99,298 @@ class LuaUserdata;
 /**
  * @brief Lua值类
  * @description 表示Lua中的任何值
+ *
+ * 使用NaN-boxing将所有值压缩到8字节：数值直接以double存储，
+ * 其余类型装箱在quiet NaN空间中。字符串、表、函数、用户数据和协程
+ * 都由GC管理，值中只保存GC对象指针，因此拷贝是平凡的（无构造/析构开销）。
  */
 class LuaValue {
 public:
     /**
      * @brief 默认构造函数（创建nil值）
      */
-    LuaValue() : type_(LuaType::Nil) {}
-    
+    constexpr LuaValue() : bits_(value_encoding::kNilBits) {}
+
     /**
      * @brief 布尔值构造函数
      */
-    explicit LuaValue(bool value) : type_(LuaType::Boolean), boolean_(value) {}
-    
+    explicit constexpr LuaValue(bool value)
+        : bits_(value ? value_encoding::kTrueBits : value_encoding::kFalseBits) {}
+
     /**
      * @brief 数值构造函数
      */
-    explicit LuaValue(double value) : type_(LuaType::Number), number_(value) {}
-    
+    explicit LuaValue(double value) : bits_(EncodeNumber(value)) {}
+
     /**
      * @brief 整数构造函数
      */
-    explicit LuaValue(int value) : type_(LuaType::Number), number_(static_cast<double>(value)) {}
-    
+    explicit LuaValue(int value) : bits_(EncodeNumber(static_cast<double>(value))) {}
+
     /**
      * @brief 字符串构造函数
+     * @note 通过全局内存管理器创建StringObject，短字符串会被驻留
      */
-    explicit LuaValue(const std::string& value) : type_(LuaType::String), string_(value) {}
-    
+    explicit LuaValue(const std::string& value);
+
     /**
      * @brief 字符串构造函数
+     * @note 通过全局内存管理器创建StringObject，短字符串会被驻留
+     */
+    explicit LuaValue(const char* value);
+
+    /**
+     * @brief GC对象构造函数
      */
-    explicit LuaValue(const char* value) : type_(LuaType::String), string_(value) {}
-    
-    // 拷贝构造和赋值
+    explicit LuaValue(StringObject* str)
+        : bits_(EncodeObject(value_encoding::kTagString, str)) {}
+    explicit LuaValue(TableObject* table)
+        : bits_(EncodeObject(value_encoding::kTagTable, table)) {}
+    explicit LuaValue(FunctionObject* function)
+        : bits_(EncodeObject(value_encoding::kTagFunction, function)) {}
+    explicit LuaValue(UserDataObject* userdata)
+        : bits_(EncodeObject(value_encoding::kTagUserdata, userdata)) {}
+
+    /**
+     * @brief 从任意GC对象创建值（根据对象类型选择标签）
+     */
+    static LuaValue FromGCObject(GCObject* obj);
+
+    // 拷贝构造和赋值（平凡拷贝）
     LuaValue(const LuaValue& other) = default;
     LuaValue& operator=(const LuaValue& other) = default;
-    
+
     // 移动构造和赋值
     LuaValue(LuaValue&& other) noexcept = default;
     LuaValue& operator=(LuaValue&& other) noexcept = default;
-    
+
     /**
      * @brief 析构函数
      */
     ~LuaValue() = default;
-    
+
     /* ===== 类型检查方法 ===== */
-    
+
     /**
      * @brief 获取值类型
      */
-    LuaType GetType() const { return type_; }
-    
+    LuaType GetType() const {
+        if (IsNumber()) return LuaType::Number;
+        switch (GetTag()) {
+            case value_encoding::kTagNil:       return LuaType::Nil;
+            case value_encoding::kTagBoolean:   return LuaType::Boolean;
+            case value_encoding::kTagString:    return LuaType::String;
+            case value_encoding::kTagTable:     return LuaType::Table;
+            case value_encoding::kTagFunction:  return LuaType::Function;
+            case value_encoding::kTagUserdata:  return LuaType::Userdata;
+            case value_encoding::kTagThread:    return LuaType::Thread;
+            default:                            return LuaType::Nil;
+        }
+    }
+
     /**
      * @brief 检查是否为nil
      */
-    bool IsNil() const { return type_ == LuaType::Nil; }
-    
+    bool IsNil() const { return bits_ == value_encoding::kNilBits; }
+
     /**
      * @brief 检查是否为布尔值
      */
-    bool IsBoolean() const { return type_ == LuaType::Boolean; }
-    
+    bool IsBoolean() const { return HasTag(value_encoding::kTagBoolean); }
+
     /**
      * @brief 检查是否为数值
      */
-    bool IsNumber() const { return type_ == LuaType::Number; }
-    
+    bool IsNumber() const {
+        return (bits_ & value_encoding::kBoxMask) != value_encoding::kBoxMask;
+    }
+
+    /**
+     * @brief 用一次标签检查判断两个值是否都是数值（算术快速路径）
+     *
+     * 任一操作数装箱时按位或的结果必然带满装箱前缀，因此不会误判为真；
+     * 极少数两个数值按位或后恰好带满前缀（如-inf与1.5）的组合会返回false，
+     * 由慢路径逐个检查后照常计算。
+     */
+    static bool BothNumbers(const LuaValue& a, const LuaValue& b) {
+        return ((a.bits_ | b.bits_) & value_encoding::kBoxMask) != value_encoding::kBoxMask;
+    }
+
     /**
      * @brief 检查是否为字符串
      */
-    bool IsString() const { return type_ == LuaType::String; }
-    
+    bool IsString() const { return HasTag(value_encoding::kTagString); }
+
     /**
      * @brief 检查是否为表
      */
-    bool IsTable() const { return type_ == LuaType::Table; }
-    
+    bool IsTable() const { return HasTag(value_encoding::kTagTable); }
+
     /**
      * @brief 检查是否为函数
      */
-    bool IsFunction() const { return type_ == LuaType::Function; }
-    
+    bool IsFunction() const { return HasTag(value_encoding::kTagFunction); }
+
     /**
      * @brief 检查是否为用户数据
      */
-    bool IsUserdata() const { return type_ == LuaType::Userdata; }
-    
+    bool IsUserdata() const { return HasTag(value_encoding::kTagUserdata); }
+
+    /**
+     * @brief 检查是否为协程
+     */
+    bool IsThread() const { return HasTag(value_encoding::kTagThread); }
+
+    /**
+     * @brief 检查是否引用GC对象
+     */
+    bool IsGCObject() const {
+        return !IsNumber() && GetTag() >= value_encoding::kFirstGCTag &&
+               GetTag() != value_encoding::kTagReserved;
+    }
+
     /* ===== 值获取方法 ===== */
-    
+
     /**
      * @brief 获取布尔值
      */
     bool AsBoolean() const {
-        if (type_ == LuaType::Boolean) return boolean_;
+        if (IsBoolean()) return bits_ == value_encoding::kTrueBits;
         return IsTruthy();
     }
-    
+
     /**
      * @brief 获取数值
      */
     double AsNumber() const {
-        if (type_ == LuaType::Number) return number_;
+        if (IsNumber()) return std::bit_cast<double>(bits_);
         throw std::runtime_error("Value is not a number");
     }
-    
+
     /**
      * @brief 获取字符串
      */
-    const std::string& AsString() const {
-        if (type_ == LuaType::String) return string_;
-        throw std::runtime_error("Value is not a string");
+    const std::string& AsString() const;
+
+    /**
+     * @brief 获取数值（调用者已确认IsNumber()）
+     */
+    double GetNumber() const { return std::bit_cast<double>(bits_); }
+
+    /**
+     * @brief 获取布尔值（调用者已确认IsBoolean()）
+     */
+    bool GetBoolean() const { return bits_ == value_encoding::kTrueBits; }
+
+    /**
+     * @brief 获取字符串（调用者已确认IsString()）
+     */
+    const std::string& GetString() const { return AsString(); }
+
+    /**
+     * @brief 尝试转换为数值（Lua语义：数字字符串可强制转换）
+     */
+    std::optional<double> ToNumber() const {
+        if (IsNumber()) return GetNumber();
+        if (IsString()) return StringToNumber();
+        return std::nullopt;
+    }
+
+    /**
+     * @brief 获取GC对象指针（非GC值返回nullptr）
+     */
+    GCObject* GetGCObject() const {
+        return IsGCObject() ? DecodeObject<GCObject>() : nullptr;
+    }
+
+    /**
+     * @brief 获取字符串对象
+     */
+    StringObject* GetStringObject() const {
+        return IsString() ? DecodeObject<StringObject>() : nullptr;
+    }
+
+    /**
+     * @brief 获取表对象
+     */
+    TableObject* GetTable() const {
+        return IsTable() ? DecodeObject<TableObject>() : nullptr;
+    }
+
+    /**
+     * @brief 获取函数对象
+     */
+    FunctionObject* GetFunction() const {
+        return IsFunction() ? DecodeObject<FunctionObject>() : nullptr;
+    }
+
+    /**
+     * @brief 获取函数原型
+     */
+    const Proto* GetFunctionProto() const;
+
+    /**
+     * @brief 获取用户数据对象
+     */
+    UserDataObject* GetUserdata() const {
+        return IsUserdata() ? DecodeObject<UserDataObject>() : nullptr;
     }
-    
+
+    /**
+     * @brief 获取原始64位编码（用于哈希和调试）
+     */
+    uint64_t GetRawBits() const { return bits_; }
+
     /* ===== Lua真值性检查 ===== */
-    
+
     /**
      * @brief 检查值的真值性（Lua语义）
      */
     bool IsTruthy() const {
-        switch (type_) {
-            case LuaType::Nil:
-                return false;
-            case LuaType::Boolean:
-                return boolean_;
-            default:
-                return true; // 所有其他值都为真
-        }
+        // 只有nil和false为假
+        return bits_ != value_encoding::kNilBits && bits_ != value_encoding::kFalseBits;
     }
-    
+
     /* ===== 比较操作 ===== */
-    
+
     /**
      * @brief 相等比较
      */
     bool operator==(const LuaValue& other) const {
-        if (type_ != other.type_) return false;
-        
-        switch (type_) {
-            case LuaType::Nil:
-                return true;
-            case LuaType::Boolean:
-                return boolean_ == other.boolean_;
-            case LuaType::Number:
-                return number_ == other.number_;
-            case LuaType::String:
-                return string_ == other.string_;
-            default:
-                return false; // 复杂类型需要额外处理
+        if (IsNumber() || other.IsNumber()) {
+            // IEEE比较：NaN不等于自身，+0等于-0
+            return IsNumber() && other.IsNumber() && GetNumber() == other.GetNumber();
         }
+        if (bits_ == other.bits_) return true;
+
+        // 驻留的短字符串已由上面的位比较判定；只有长字符串需要比较内容
+        return IsString() && other.IsString() && StringContentEquals(other);
     }
-    
+
     /**
      * @brief 不等比较
      */
     bool operator!=(const LuaValue& other) const {
         return !(*this == other);
     }
-    
+
+    /**
+     * @brief 原始相等（按位比较，不比较字符串内容）
+     */
+    bool RawIdentical(const LuaValue& other) const { return bits_ == other.bits_; }
+
     /* ===== 转换方法 ===== */
-    
+
     /**
      * @brief 转换为字符串表示
      */
-    std::string ToString() const {
-        switch (type_) {
-            case LuaType::Nil:
-                return "nil";
-            case LuaType::Boolean:
-                return boolean_ ? "true" : "false";
-            case LuaType::Number:
-                return std::to_string(number_);
-            case LuaType::String:
-                return string_;
-            default:
-                return "<" + TypeName() + ">";
-        }
-    }
-    
+    std::string ToString() const;
+
     /**
      * @brief 获取类型名称
      */
     std::string TypeName() const {
-        switch (type_) {
+        switch (GetType()) {
             case LuaType::Nil: return "nil";
             case LuaType::Boolean: return "boolean";
             case LuaType::Number: return "number";
@@ -234,19 +404,59 @@ public:
     }
 
 private:
-    LuaType type_;
-    
-    union {
-        bool boolean_;
-        double number_;
-    };
-    
-    std::string string_;
-    
-    // TODO: 添加对复杂类型（table、function等）的支持
-    // std::shared_ptr<LuaTable> table_;
-    // std::shared_ptr<LuaFunction> function_;
-    // std::shared_ptr<LuaUserdata> userdata_;
+    /* ===== 编码辅助方法 ===== */
+
+    static uint64_t EncodeNumber(double value) {
+        // 规范化NaN，避免与装箱值冲突
+        if (value != value) return value_encoding::kCanonicalNaN;
+        return std::bit_cast<uint64_t>(value);
+    }
+
+    static uint64_t EncodeObject(value_encoding::Tag tag, const void* ptr) {
+        if (!ptr) return value_encoding::kNilBits;
+        return value_encoding::MakeBoxed(tag, reinterpret_cast<uintptr_t>(ptr));
+    }
+
+    template<typename T>
+    T* DecodeObject() const {
+        return reinterpret_cast<T*>(static_cast<uintptr_t>(bits_ & value_encoding::kPayloadMask));
+    }
+
+    uint64_t GetTag() const {
+        return (bits_ & value_encoding::kTagMask) >> value_encoding::kTagShift;
+    }
+
+    bool HasTag(value_encoding::Tag tag) const {
+        return (bits_ & (value_encoding::kBoxMask | value_encoding::kTagMask)) ==
+               value_encoding::MakeBoxed(tag, 0);
+    }
+
+    /* ===== 非内联慢路径（需要完整的GC对象类型） ===== */
+
+    bool StringContentEquals(const LuaValue& other) const;
+    std::optional<double> StringToNumber() const;
+
+    uint64_t bits_;
 };
 
-} // namespace lua_cpp
\ No newline at end of file
+static_assert(sizeof(LuaValue) == 8, "LuaValue must be NaN-boxed into 8 bytes");
+static_assert(std::is_trivially_copyable_v<LuaValue>, "LuaValue must be trivially copyable");
+
+/* ========================================================================== */
+/* 数值格式化 */
+/* ========================================================================== */
+
+/**
+ * @brief 数值转字符串所需的缓冲区大小（LUAI_MAXNUMBER2STR）
+ */
+constexpr Size kNumberBufferSize = 32;
+
+/**
+ * @brief 按"%.14g"格式化数值（lua_number2str），返回写入的字符数（不含结尾0）
+ *
+ * 绝对值小于1e14的整数直接输出十进制，其余使用std::to_chars，
+ * 两者都不经过printf的格式串解析和locale。
+ */
+Size FormatNumber(double value, char* buffer);
+
+} // namespace lua_cpp
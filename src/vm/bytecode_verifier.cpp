@@ -0,0 +1,315 @@
+/**
+ * @file bytecode_verifier.cpp
+ * @brief 加载期字节码校验器实现
+ * @description 函数第一次执行前一次性检查控制流和操作数，之后解释器不再逐条检查
+ * @author Lua C++ Project
+ * @date 2025-09-28
+ */
+
+#include "bytecode_verifier.h"
+
+namespace lua_cpp {
+
+/* ========================================================================== */
+/* 校验入口 */
+/* ========================================================================== */
+
+void BytecodeVerifier::Verify(const Proto& proto) {
+    // 校验每个原型只发生一次，一把全局锁足够；锁内复查，其他线程可能已完成
+    static std::mutex verify_mutex;
+    std::lock_guard<std::mutex> lock(verify_mutex);
+    if (!proto.IsVerified()) {
+        VerifyLocked(proto);
+    }
+}
+
+void BytecodeVerifier::VerifyLocked(const Proto& proto) {
+    VerifyControlFlow(proto);
+    VerifyOperands(proto);
+
+    for (const auto& sub_proto : proto.GetProtos()) {
+        if (!sub_proto) {
+            Fail(proto, 0, "null nested function");
+        }
+        if (!sub_proto->IsVerified()) {
+            VerifyLocked(*sub_proto);
+        }
+    }
+
+    proto.MarkVerified();
+}
+
+/* ========================================================================== */
+/* 控制流检查 */
+/* ========================================================================== */
+
+void BytecodeVerifier::VerifyControlFlow(const Proto& proto) {
+    const std::vector<Instruction>& code = proto.GetCode();
+    Size size = code.size();
+
+    if (size == 0) {
+        Fail(proto, 0, "function has no instructions");
+    }
+    if (GetOpCode(code[size - 1]) != OpCode::RETURN) {
+        Fail(proto, size - 1, "function does not end with RETURN");
+    }
+
+    for (Size pc = 0; pc < size; ++pc) {
+        Instruction inst = code[pc];
+        OpCode op = GetOpCode(inst);
+
+        switch (op) {
+            case OpCode::JMP:
+            case OpCode::FORLOOP:
+            case OpCode::FORPREP:
+                CheckJumpTarget(proto, pc, GetArgsBx(inst));
+                break;
+
+            case OpCode::EQ:
+            case OpCode::LT:
+            case OpCode::LE:
+            case OpCode::TEST:
+            case OpCode::TESTSET:
+            case OpCode::TFORLOOP:
+                // 条件成立时跳过的下一条指令必须是JMP（末尾的RETURN保证pc+1存在）
+                if (pc + 1 >= size || GetOpCode(code[pc + 1]) != OpCode::JMP) {
+                    Fail(proto, pc, "conditional instruction not followed by JMP");
+                }
+                break;
+
+            case OpCode::LOADBOOL:
+                if (GetArgC(inst) != 0 && pc + 2 >= size) {
+                    Fail(proto, pc, "LOADBOOL skips past end of code");
+                }
+                break;
+
+            default:
+                if (static_cast<int>(op) >= static_cast<int>(OpCode::NUM_OPCODES)) {
+                    Fail(proto, pc, "invalid opcode " + std::to_string(static_cast<int>(op)));
+                }
+                break;
+        }
+    }
+}
+
+/* ========================================================================== */
+/* 操作数检查 */
+/* ========================================================================== */
+
+void BytecodeVerifier::VerifyOperands(const Proto& proto) {
+    const std::vector<Instruction>& code = proto.GetCode();
+    Size size = code.size();
+
+    if (proto.GetParameterCount() > proto.GetMaxStackSize()) {
+        Fail(proto, 0, "parameter count exceeds max stack size");
+    }
+
+    for (Size pc = 0; pc < size; ++pc) {
+        Instruction inst = code[pc];
+        int a = GetArgA(inst);
+        int b = GetArgB(inst);
+        int c = GetArgC(inst);
+
+        switch (GetOpCode(inst)) {
+            case OpCode::MOVE:
+            case OpCode::UNM:
+            case OpCode::NOT:
+            case OpCode::LEN:
+                CheckRegister(proto, pc, a);
+                CheckRegister(proto, pc, b);
+                break;
+
+            case OpCode::LOADK:
+                CheckRegister(proto, pc, a);
+                CheckConstant(proto, pc, GetArgBx(inst));
+                break;
+
+            case OpCode::LOADBOOL:
+            case OpCode::NEWTABLE:
+            case OpCode::CLOSE:
+            case OpCode::TEST:
+                CheckRegister(proto, pc, a);
+                break;
+
+            case OpCode::LOADNIL:
+                // R(A)..R(B)
+                CheckRegister(proto, pc, a);
+                CheckRegister(proto, pc, b);
+                break;
+
+            case OpCode::GETUPVAL:
+            case OpCode::SETUPVAL:
+                CheckRegister(proto, pc, a);
+                CheckUpvalue(proto, pc, b);
+                break;
+
+            case OpCode::GETGLOBAL:
+            case OpCode::SETGLOBAL:
+                CheckRegister(proto, pc, a);
+                CheckConstant(proto, pc, GetArgBx(inst), true);
+                break;
+
+            case OpCode::GETTABLE:
+                CheckRegister(proto, pc, a);
+                CheckRegister(proto, pc, b);
+                CheckRK(proto, pc, c);
+                break;
+
+            case OpCode::SETTABLE:
+            case OpCode::ADD:
+            case OpCode::SUB:
+            case OpCode::MUL:
+            case OpCode::DIV:
+            case OpCode::MOD:
+            case OpCode::POW:
+                CheckRegister(proto, pc, a);
+                CheckRK(proto, pc, b);
+                CheckRK(proto, pc, c);
+                break;
+
+            case OpCode::SELF:
+                // R(A+1) := R(B); R(A) := R(B)[RK(C)]
+                CheckRegister(proto, pc, a + 1);
+                CheckRegister(proto, pc, b);
+                CheckRK(proto, pc, c);
+                break;
+
+            case OpCode::CONCAT:
+                // R(A) := R(B).. ... ..R(C)，至少两个操作数
+                if (b >= c) {
+                    Fail(proto, pc, "CONCAT needs at least two operands");
+                }
+                CheckRegister(proto, pc, a);
+                CheckRegister(proto, pc, c);
+                break;
+
+            case OpCode::EQ:
+            case OpCode::LT:
+            case OpCode::LE:
+                CheckRK(proto, pc, b);
+                CheckRK(proto, pc, c);
+                break;
+
+            case OpCode::TESTSET:
+                CheckRegister(proto, pc, a);
+                CheckRegister(proto, pc, b);
+                break;
+
+            case OpCode::CALL:
+            case OpCode::TAILCALL:
+                // B=0/C=0表示参数/返回值到开放栈顶为止，只需检查函数寄存器
+                CheckRegister(proto, pc, a);
+                if (b > 0) {
+                    CheckRegister(proto, pc, a + b - 1);
+                }
+                if (c > 1) {
+                    CheckRegister(proto, pc, a + c - 2);
+                }
+                break;
+
+            case OpCode::RETURN:
+                if (b == 0) {
+                    CheckRegister(proto, pc, a);
+                } else if (b > 1) {
+                    CheckRegister(proto, pc, a + b - 2);
+                }
+                break;
+
+            case OpCode::FORLOOP:
+            case OpCode::FORPREP:
+                // 内部索引、上限、步长和外部循环变量
+                CheckRegister(proto, pc, a + 3);
+                break;
+
+            case OpCode::TFORLOOP:
+                if (c < 1) {
+                    Fail(proto, pc, "TFORLOOP needs at least one loop variable");
+                }
+                CheckRegister(proto, pc, a + 2 + c);
+                break;
+
+            case OpCode::SETLIST:
+                CheckRegister(proto, pc, a + b);
+                break;
+
+            case OpCode::CLOSURE: {
+                CheckRegister(proto, pc, a);
+                int index = GetArgBx(inst);
+                if (static_cast<Size>(index) >= proto.GetSubProtoCount()) {
+                    Fail(proto, pc, "CLOSURE proto index " + std::to_string(index) + " out of range");
+                }
+                // 子函数的每个上值由一条MOVE（捕获局部变量）或GETUPVAL（转发上值）描述
+                Size upvalue_count = proto.GetProtos()[index]->GetUpvalueCount();
+                if (pc + upvalue_count >= size) {
+                    Fail(proto, pc, "CLOSURE upvalue descriptions past end of code");
+                }
+                for (Size j = 1; j <= upvalue_count; ++j) {
+                    OpCode pseudo = GetOpCode(code[pc + j]);
+                    if (pseudo != OpCode::MOVE && pseudo != OpCode::GETUPVAL) {
+                        Fail(proto, pc + j, "expected MOVE or GETUPVAL describing a CLOSURE upvalue");
+                    }
+                }
+                break;
+            }
+
+            case OpCode::VARARG:
+                if (!proto.IsVariadic()) {
+                    Fail(proto, pc, "VARARG in a non-variadic function");
+                }
+                CheckRegister(proto, pc, a);
+                if (b > 1) {
+                    CheckRegister(proto, pc, a + b - 2);
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+void BytecodeVerifier::CheckJumpTarget(const Proto& proto, Size pc, int offset) {
+    // 跳转相对于下一条指令（分派循环取指后pc已前进一格）
+    int64_t target = static_cast<int64_t>(pc) + 1 + offset;
+    if (target < 0 || target >= static_cast<int64_t>(proto.GetCodeSize())) {
+        Fail(proto, pc, "jump target " + std::to_string(target) + " out of range");
+    }
+}
+
+void BytecodeVerifier::CheckRegister(const Proto& proto, Size pc, int reg) {
+    if (reg < 0 || static_cast<Size>(reg) >= proto.GetMaxStackSize()) {
+        Fail(proto, pc, "register " + std::to_string(reg) + " exceeds max stack size " +
+                        std::to_string(proto.GetMaxStackSize()));
+    }
+}
+
+void BytecodeVerifier::CheckRK(const Proto& proto, Size pc, int rk) {
+    if (IsConstant(rk)) {
+        CheckConstant(proto, pc, RKToConstantIndex(rk));
+    } else {
+        CheckRegister(proto, pc, rk);
+    }
+}
+
+void BytecodeVerifier::CheckConstant(const Proto& proto, Size pc, int index, bool require_string) {
+    if (index < 0 || static_cast<Size>(index) >= proto.GetConstantCount()) {
+        Fail(proto, pc, "constant index " + std::to_string(index) + " out of range");
+    }
+    if (require_string && !proto.GetConstants()[index].IsString()) {
+        Fail(proto, pc, "global variable name is not a string");
+    }
+}
+
+void BytecodeVerifier::CheckUpvalue(const Proto& proto, Size pc, int index) {
+    if (index < 0 || static_cast<Size>(index) >= proto.GetUpvalueCount()) {
+        Fail(proto, pc, "upvalue index " + std::to_string(index) + " out of range");
+    }
+}
+
+void BytecodeVerifier::Fail(const Proto& proto, Size pc, const std::string& reason) {
+    throw BytecodeVerificationError("Invalid bytecode in " + proto.GetSourceName() + ":" +
+                                    std::to_string(proto.GetLineDefined()) +
+                                    " at pc " + std::to_string(pc) + ": " + reason);
+}
+
+} // namespace lua_cpp
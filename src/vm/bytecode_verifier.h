@@ -0,0 +1,118 @@
+#pragma once
+
+#include "core/lua_common.h"
+#include "core/lua_errors.h"
+#include "compiler/bytecode.h"
+#include <mutex>
+#include <string>
+
+namespace lua_cpp {
+
+/* ========================================================================== */
+/* 字节码校验错误类型 */
+/* ========================================================================== */
+
+/**
+ * @brief 字节码校验错误
+ */
+class BytecodeVerificationError : public LuaError {
+public:
+    explicit BytecodeVerificationError(const std::string& message = "Invalid bytecode")
+        : LuaError(message, ErrorType::RUNTIME_ERROR) {}
+};
+
+/* ========================================================================== */
+/* 字节码校验器 */
+/* ========================================================================== */
+
+/**
+ * @brief 加载期字节码校验器（同Lua 5.1的luaG_checkcode）
+ *
+ * 函数第一次执行前对原型（连同全部子函数）做一次静态检查，通过后
+ * 标记为已校验。快速循环只执行已校验的原型，因此调用帧和分派循环
+ * 可以直接持有const Instruction*，取指和跳转时不再做越界检查；指令
+ * 处理函数遇到已校验的原型时也跳过操作数检查。不可信的字节码在
+ * 执行任何指令之前被整体拒绝，而不是运行到一半才出错。
+ *
+ * 控制流检查：
+ * - 代码非空且以RETURN结尾（顺序执行不会越过末尾）
+ * - 操作码都是已定义的取值
+ * - JMP/FORLOOP/FORPREP的目标（pc+1+sBx）位于代码范围内
+ * - EQ/LT/LE/TEST/TESTSET/TFORLOOP之后紧跟JMP（条件跳过的正是它）
+ * - LOADBOOL跳过的下一条指令存在
+ *
+ * 操作数检查：
+ * - 每条指令实际访问的寄存器（含CALL/RETURN/FORLOOP等的寄存器区间）
+ *   都小于最大栈大小，形参数量不超过最大栈大小
+ * - Bx常量索引和RK编码中的常量索引位于常量表内，全局变量名是字符串
+ * - CLOSURE的子函数索引有效，之后紧跟与子函数上值数量相同的
+ *   MOVE/GETUPVAL伪指令；GETUPVAL/SETUPVAL的上值索引有效
+ * - VARARG只出现在可变参数函数中
+ */
+class BytecodeVerifier {
+public:
+    /**
+     * @brief 校验原型及其全部子函数，通过后分配内联缓存并标记为已校验
+     * @param proto 函数原型
+     * @throws BytecodeVerificationError 字节码不合法
+     * @note 在全局校验锁内进行，多个状态可以同时加载同一原型
+     */
+    static void Verify(const Proto& proto);
+
+    /**
+     * @brief 原型未校验时校验（已校验的直接返回）
+     */
+    static void EnsureVerified(const Proto& proto) {
+        if (!proto.IsVerified()) {
+            Verify(proto);
+        }
+    }
+
+private:
+    /**
+     * @brief 持锁校验原型及其未校验的子函数
+     */
+    static void VerifyLocked(const Proto& proto);
+
+    /**
+     * @brief 校验单个函数的控制流
+     */
+    static void VerifyControlFlow(const Proto& proto);
+
+    /**
+     * @brief 校验单个函数的操作数
+     */
+    static void VerifyOperands(const Proto& proto);
+
+    /**
+     * @brief 检查跳转目标位于代码范围内
+     */
+    static void CheckJumpTarget(const Proto& proto, Size pc, int offset);
+
+    /**
+     * @brief 检查寄存器小于最大栈大小
+     */
+    static void CheckRegister(const Proto& proto, Size pc, int reg);
+
+    /**
+     * @brief 检查RK操作数（常量索引或寄存器）
+     */
+    static void CheckRK(const Proto& proto, Size pc, int rk);
+
+    /**
+     * @brief 检查常量索引，require_string时还要求常量是字符串
+     */
+    static void CheckConstant(const Proto& proto, Size pc, int index, bool require_string = false);
+
+    /**
+     * @brief 检查上值索引
+     */
+    static void CheckUpvalue(const Proto& proto, Size pc, int index);
+
+    /**
+     * @brief 抛出带函数位置和指令位置的校验错误
+     */
+    [[noreturn]] static void Fail(const Proto& proto, Size pc, const std::string& reason);
+};
+
+} // namespace lua_cpp
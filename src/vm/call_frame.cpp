@@ -7,227 +7,87 @@
  */
 
 #include "call_frame.h"
+#include <algorithm>
+#include <iterator>
 #include <sstream>
 
 namespace lua_cpp {
 
 /* ========================================================================== */
-/* CallFrame构造和析构 */
+/* CallFrame函数信息 */
 /* ========================================================================== */
 
-CallFrame::CallFrame(const LuaFunction* function, Size base_stack_index, Size return_count)
-    : function_(function)
-    , base_stack_index_(base_stack_index)
-    , return_count_(return_count)
-    , pc_(0)
-    , local_count_(0)
-    , is_lua_function_(true)
-    , is_tail_call_(false)
-    , debug_info_{} {
-    
-    if (function_) {
-        local_count_ = function_->max_stack_size;
-        debug_info_.function_name = function_->debug_name;
-        debug_info_.source = function_->source;
-        debug_info_.line_defined = function_->line_defined;
-        debug_info_.last_line_defined = function_->last_line_defined;
-    }
-}
-
-CallFrame::CallFrame(LuaCFunction c_function, Size base_stack_index, Size return_count)
-    : function_(nullptr)
-    , c_function_(c_function)
-    , base_stack_index_(base_stack_index)
-    , return_count_(return_count)
-    , pc_(0)
-    , local_count_(0)
-    , is_lua_function_(false)
-    , is_tail_call_(false)
-    , debug_info_{} {
-    
-    debug_info_.function_name = "[C function]";
-    debug_info_.source = "[C]";
-    debug_info_.line_defined = 0;
-    debug_info_.last_line_defined = 0;
-}
-
-/* ========================================================================== */
-/* 访问器方法 */
-/* ========================================================================== */
-
-const LuaFunction* CallFrame::GetFunction() const {
-    return function_;
-}
-
-LuaCFunction CallFrame::GetCFunction() const {
-    return c_function_;
-}
-
-Size CallFrame::GetBaseStackIndex() const {
-    return base_stack_index_;
-}
-
-Size CallFrame::GetReturnCount() const {
-    return return_count_;
-}
-
-Size CallFrame::GetPC() const {
-    return pc_;
-}
-
-void CallFrame::SetPC(Size pc) {
-    pc_ = pc;
-    
-    // 更新调试信息中的当前行号
-    if (function_ && pc < function_->instructions.size()) {
-        UpdateCurrentLine();
+std::string CallFrame::GetFunctionName() const {
+    if (!proto_) {
+        return "?";
     }
-}
-
-void CallFrame::IncrementPC() {
-    pc_++;
-    
-    if (function_ && pc_ < function_->instructions.size()) {
-        UpdateCurrentLine();
+    if (proto_->GetLineDefined() == 0) {
+        return "main chunk";
     }
+    return "function <" + proto_->GetSourceName() + ":" +
+           std::to_string(proto_->GetLineDefined()) + ">";
 }
 
-Size CallFrame::GetLocalCount() const {
-    return local_count_;
-}
-
-void CallFrame::SetLocalCount(Size count) {
-    local_count_ = count;
-}
-
-bool CallFrame::IsLuaFunction() const {
-    return is_lua_function_;
-}
-
-bool CallFrame::IsCFunction() const {
-    return !is_lua_function_;
+std::string CallFrame::GetSourceName() const {
+    return proto_ ? proto_->GetSourceName() : "[C]";
 }
 
-/* ========================================================================== */
-/* 尾调用支持 */
-/* ========================================================================== */
-
-bool CallFrame::IsTailCall() const {
-    return is_tail_call_;
-}
-
-void CallFrame::SetTailCall(bool is_tail_call) {
-    is_tail_call_ = is_tail_call;
-}
-
-/* ========================================================================== */
-/* 变量管理 */
-/* ========================================================================== */
-
-void CallFrame::AddLocal(const std::string& name, Size stack_index, Size start_pc, Size end_pc) {
-    LocalVariable local;
-    local.name = name;
-    local.stack_index = stack_index;
-    local.start_pc = start_pc;
-    local.end_pc = end_pc;
-    
-    locals_.push_back(local);
-}
-
-const CallFrame::LocalVariable* CallFrame::FindLocal(const std::string& name, Size pc) const {
-    for (const auto& local : locals_) {
-        if (local.name == name && pc >= local.start_pc && pc < local.end_pc) {
-            return &local;
-        }
+int CallFrame::GetCurrentLine() const {
+    if (!proto_) {
+        return 0;
     }
-    return nullptr;
-}
-
-const std::vector<CallFrame::LocalVariable>& CallFrame::GetLocals() const {
-    return locals_;
-}
-
-void CallFrame::AddUpvalue(const std::string& name, Size index) {
-    UpvalueInfo upvalue;
-    upvalue.name = name;
-    upvalue.index = index;
     
-    upvalues_.push_back(upvalue);
-}
-
-const CallFrame::UpvalueInfo* CallFrame::FindUpvalue(const std::string& name) const {
-    for (const auto& upvalue : upvalues_) {
-        if (upvalue.name == name) {
-            return &upvalue;
-        }
-    }
-    return nullptr;
-}
-
-const std::vector<CallFrame::UpvalueInfo>& CallFrame::GetUpvalues() const {
-    return upvalues_;
+    // 只在报错或调试钩子需要时由指针换算指令位置；行号表按pc递增，取不超过当前pc的最后一项
+    const std::vector<LineInfo>& lines = proto_->GetLineInfo();
+    auto it = std::upper_bound(lines.begin(), lines.end(), GetInstructionPointer(),
+                               [](Size pc, const LineInfo& info) { return pc < info.pc; });
+    return it == lines.begin() ? 0 : std::prev(it)->line;
 }
 
 /* ========================================================================== */
-/* 调试信息 */
+/* CallFrame调试信息 */
 /* ========================================================================== */
 
-const CallFrame::DebugInfo& CallFrame::GetDebugInfo() const {
-    return debug_info_;
+CallFrame::FrameInfo CallFrame::GetFrameInfo() const {
+    FrameInfo info;
+    info.proto = proto_;
+    info.base = base_;
+    info.function_slot = func_;
+    info.instruction_pointer = GetInstructionPointer();
+    info.param_count = GetParameterCount();
+    info.expected_results = expected_results_;
+    info.function_name = GetFunctionName();
+    info.source_name = GetSourceName();
+    info.current_line = GetCurrentLine();
+    info.definition_line = GetDefinitionLine();
+    info.is_vararg = IsVariadic();
+    info.is_tail_call = IsTailCall();
+    return info;
 }
 
-void CallFrame::SetDebugInfo(const DebugInfo& debug_info) {
-    debug_info_ = debug_info;
-}
-
-Size CallFrame::GetCurrentLine() const {
-    return debug_info_.current_line;
-}
-
-void CallFrame::UpdateCurrentLine() {
-    if (!function_ || pc_ >= function_->instructions.size()) {
-        return;
-    }
-    
-    // 从行号信息中查找当前PC对应的行号
-    if (!function_->line_info.empty()) {
-        // 二分查找最接近的行号
-        Size line = 0;
-        for (Size i = 0; i < function_->line_info.size() && i <= pc_; i++) {
-            line = function_->line_info[i];
-        }
-        debug_info_.current_line = line;
-    }
-}
-
-/* ========================================================================== */
-/* 字符串表示 */
-/* ========================================================================== */
-
 std::string CallFrame::ToString() const {
     std::ostringstream oss;
     
-    oss << "CallFrame[";
-    
-    if (is_lua_function_) {
-        oss << "Lua function: " << debug_info_.function_name;
-        if (!debug_info_.source.empty()) {
-            oss << " (" << debug_info_.source;
-            if (debug_info_.current_line > 0) {
-                oss << ":" << debug_info_.current_line;
-            }
-            oss << ")";
+    oss << "CallFrame[" << GetFunctionName();
+    if (proto_) {
+        oss << " (" << GetSourceName();
+        int line = GetCurrentLine();
+        if (line > 0) {
+            oss << ":" << line;
         }
-        oss << ", PC=" << pc_;
-    } else {
-        oss << "C function";
+        oss << "), PC=" << GetInstructionPointer();
     }
     
-    oss << ", base=" << base_stack_index_;
-    oss << ", returns=" << return_count_;
-    oss << ", locals=" << local_count_;
+    oss << ", base=" << base_;
+    oss << ", func=" << func_;
+    oss << ", returns=";
+    if (expected_results_ == VM_MULTRET) {
+        oss << "multi";
+    } else {
+        oss << expected_results_;
+    }
     
-    if (is_tail_call_) {
+    if (IsTailCall()) {
         oss << ", tail call";
     }
     
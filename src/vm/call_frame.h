@@ -3,7 +3,10 @@
 #include "core/lua_common.h"
 #include "compiler/bytecode.h"
 #include "core/lua_errors.h"
+#include <algorithm>
 #include <memory>
+#include <string>
+#include <type_traits>
 #include <vector>
 
 namespace lua_cpp {
@@ -46,42 +49,54 @@ public:
  */
 constexpr Size VM_MAX_CALL_STACK_DEPTH = 1000;  // 最大调用栈深度
 constexpr Size VM_DEFAULT_CALL_STACK_SIZE = 100; // 默认调用栈大小
+constexpr Size VM_INLINE_CALL_FRAMES = 16;       // 调用帧栈内联缓冲区的帧数（含基础帧）
+constexpr uint32_t VM_NO_PROFILE_SLOT = UINT32_MAX; // 调用帧未参与剖析
+constexpr int VM_MULTRET = -1;                   // 调用者接收全部返回值（同LUA_MULTRET）
+
+/**
+ * @brief 调用帧标志位
+ */
+constexpr uint16_t VM_FRAME_TAIL_CALL = 0x0001;  // 帧被尾调用复用过（同CIST_TAIL）
+constexpr uint16_t VM_FRAME_SAMPLED = 0x0002;    // 剖析采样计时中，开始时间在剖析器的采样栈上
 
 /* ========================================================================== */
 /* 调用帧类 */
 /* ========================================================================== */
 
 /**
- * @brief 调用帧类
+ * @brief 调用帧（同Lua的CallInfo）
+ * 
+ * 可平凡复制的32字节记录：函数原型、保存的指令指针、寄存器基址、
+ * 函数槽、期望返回值数量、标志位和剖析槽。参数数量、函数名等信息都从
+ * 原型按需推导，不随每次调用复制。栈位置以32位保存（堆栈不超过
+ * VM_MAX_STACK_SIZE），帧本身存放在CallFrameStack的连续数组中。
  * 
- * 表示函数调用的执行上下文，包含：
- * - 函数原型指针
- * - 指令指针
- * - 堆栈基址
- * - 参数和局部变量信息
- * - 返回地址
+ * 指令指针直接指向原型的代码数组，取指不做越界检查：跳转目标由
+ * BytecodeVerifier在加载时校验，行号等信息只在需要时由指针换算。
+ * 帧存活期间原型的代码不得修改。
  */
 class CallFrame {
 public:
     /**
-     * @brief 构造函数
-     * @param proto 函数原型
-     * @param base 堆栈基址
-     * @param param_count 参数数量
-     * @param return_address 返回地址（调用点的下一条指令）
+     * @brief 默认构造（不初始化，供帧数组预留空间）
      */
-    CallFrame(const Proto* proto, Size base, Size param_count, Size return_address = 0);
+    CallFrame() = default;
     
     /**
-     * @brief 析构函数
-     */
-    ~CallFrame() = default;
-    
-    // 允许拷贝和移动
-    CallFrame(const CallFrame&) = default;
-    CallFrame& operator=(const CallFrame&) = default;
-    CallFrame(CallFrame&&) = default;
-    CallFrame& operator=(CallFrame&&) = default;
+     * @brief 构造函数
+     * @param proto 函数原型
+     * @param base 堆栈基址
+     * @param func 函数槽位置（返回值从这里开始存放）
+     * @param expected_results 调用者期望的返回值数量（VM_MULTRET表示全部）
+     */
+    CallFrame(const Proto* proto, Size base, Size func = 0, int expected_results = VM_MULTRET)
+        : proto_(proto)
+        , saved_pc_(proto ? proto->GetCode().data() : nullptr)
+        , base_(static_cast<uint32_t>(base))
+        , func_(static_cast<uint32_t>(func))
+        , expected_results_(static_cast<int16_t>(expected_results))
+        , flags_(0)
+        , profile_slot_(VM_NO_PROFILE_SLOT) {}
     
     /* ====================================================================== */
     /* 基本属性访问 */
@@ -98,95 +113,101 @@ public:
     Size GetBase() const { return base_; }
     
     /**
-     * @brief 获取参数数量
+     * @brief 获取函数槽位置（返回值从这里开始存放，同Lua的ci->func）
      */
-    Size GetParameterCount() const { return param_count_; }
+    Size GetFunctionSlot() const { return func_; }
     
     /**
-     * @brief 获取返回地址
+     * @brief 获取调用者期望的返回值数量（VM_MULTRET表示全部）
      */
-    Size GetReturnAddress() const { return return_address_; }
+    int GetExpectedResults() const { return expected_results_; }
     
     /**
-     * @brief 设置返回地址
+     * @brief 获取形参数量（由原型决定）
      */
-    void SetReturnAddress(Size address) { return_address_ = address; }
+    Size GetParameterCount() const { return proto_ ? proto_->GetParameterCount() : 0; }
     
     /* ====================================================================== */
-    /* 指令指针管理 */
+    /* 标志位 */
     /* ====================================================================== */
     
     /**
-     * @brief 获取当前指令指针
+     * @brief 检查标志位
      */
-    Size GetInstructionPointer() const { return instruction_pointer_; }
+    bool HasFlag(uint16_t flag) const { return (flags_ & flag) != 0; }
     
     /**
-     * @brief 设置指令指针
-     * @param pc 新的指令指针位置
+     * @brief 设置标志位
      */
-    void SetInstructionPointer(Size pc);
+    void SetFlag(uint16_t flag) { flags_ |= flag; }
     
     /**
-     * @brief 递增指令指针
-     * @param offset 偏移量（默认为1）
+     * @brief 清除标志位
      */
-    void AdvanceInstructionPointer(int offset = 1);
+    void ClearFlag(uint16_t flag) { flags_ &= static_cast<uint16_t>(~flag); }
     
     /**
-     * @brief 跳转到指定位置
-     * @param target 目标位置
+     * @brief 检查帧是否被尾调用复用过
      */
-    void JumpTo(Size target);
+    bool IsTailCall() const { return HasFlag(VM_FRAME_TAIL_CALL); }
+    
+    /* ====================================================================== */
+    /* 指令指针管理 */
+    /* ====================================================================== */
     
     /**
-     * @brief 相对跳转
-     * @param offset 跳转偏移量
+     * @brief 获取保存的指令指针（同Lua的ci->savedpc，分派循环切换帧时读写）
      */
-    void RelativeJump(int offset);
+    const Instruction* GetSavedPC() const { return saved_pc_; }
     
     /**
-     * @brief 获取当前指令
-     * @return 当前指令，如果超出范围返回nullptr
+     * @brief 保存指令指针
      */
-    std::optional<Instruction> GetCurrentInstruction() const;
+    void SetSavedPC(const Instruction* pc) { saved_pc_ = pc; }
     
     /**
-     * @brief 检查是否到达函数末尾
+     * @brief 获取当前指令位置（由指针按需换算，供调试和错误信息使用）
      */
-    bool IsAtEnd() const;
+    Size GetInstructionPointer() const {
+        return proto_ ? static_cast<Size>(saved_pc_ - proto_->GetCode().data()) : 0;
+    }
     
-    /* ====================================================================== */
-    /* 栈管理 */
-    /* ====================================================================== */
+    /**
+     * @brief 设置指令位置
+     * @param pc 新的指令位置
+     */
+    void SetInstructionPointer(Size pc) {
+        if (proto_) {
+            saved_pc_ = proto_->GetCode().data() + pc;
+        }
+    }
     
     /**
-     * @brief 获取局部变量的堆栈索引
-     * @param local_index 局部变量索引
-     * @return 堆栈索引
+     * @brief 移动指令指针
+     * @param offset 偏移量（默认为1）
      */
-    Size GetLocalStackIndex(Size local_index) const;
+    void AdvanceInstructionPointer(int offset = 1) { saved_pc_ += offset; }
     
     /**
-     * @brief 获取参数的堆栈索引
-     * @param param_index 参数索引
-     * @return 堆栈索引
+     * @brief 获取当前指令（不做越界检查，调用前需保证!IsAtEnd()）
      */
-    Size GetParameterStackIndex(Size param_index) const;
+    Instruction GetCurrentInstruction() const { return *saved_pc_; }
     
     /**
-     * @brief 获取寄存器的堆栈索引
-     * @param register_index 寄存器索引
-     * @return 堆栈索引
+     * @brief 检查是否到达函数末尾
      */
-    Size GetRegisterStackIndex(RegisterIndex register_index) const;
+    bool IsAtEnd() const {
+        return !proto_ || GetInstructionPointer() >= proto_->GetCodeSize();
+    }
     
     /**
-     * @brief 检查寄存器索引是否有效
+     * @brief 获取寄存器的堆栈索引
      * @param register_index 寄存器索引
-     * @return 如果有效返回true
+     * @return 堆栈索引
      */
-    bool IsValidRegister(RegisterIndex register_index) const;
+    Size GetRegisterStackIndex(RegisterIndex register_index) const {
+        return base_ + static_cast<Size>(register_index);
+    }
     
     /* ====================================================================== */
     /* 函数信息 */
@@ -210,12 +231,26 @@ public:
     /**
      * @brief 获取函数定义行号
      */
-    int GetDefinitionLine() const;
+    int GetDefinitionLine() const { return proto_ ? proto_->GetLineDefined() : 0; }
     
     /**
      * @brief 检查函数是否为可变参数函数
      */
-    bool IsVariadic() const;
+    bool IsVariadic() const { return proto_ && proto_->IsVariadic(); }
+    
+    /* ====================================================================== */
+    /* 性能剖析 */
+    /* ====================================================================== */
+    
+    /**
+     * @brief 获取剖析计数槽（VM_NO_PROFILE_SLOT表示未参与剖析）
+     */
+    uint32_t GetProfileSlot() const { return profile_slot_; }
+    
+    /**
+     * @brief 设置剖析计数槽
+     */
+    void SetProfileSlot(uint32_t slot) { profile_slot_ = slot; }
     
     /* ====================================================================== */
     /* 调试信息 */
@@ -227,14 +262,16 @@ public:
     struct FrameInfo {
         const Proto* proto;                 // 函数原型
         Size base;                         // 堆栈基址
+        Size function_slot;                // 函数槽位置
         Size instruction_pointer;          // 指令指针
         Size param_count;                  // 参数数量
-        Size return_address;               // 返回地址
+        int expected_results;              // 期望返回值数量
         std::string function_name;         // 函数名
         std::string source_name;           // 源文件名
         int current_line;                  // 当前行号
         int definition_line;               // 定义行号
         bool is_vararg;                   // 是否可变参数
+        bool is_tail_call;                // 是否被尾调用复用过
     };
     
     /**
@@ -246,22 +283,189 @@ public:
      * @brief 获取调用帧的字符串表示
      */
     std::string ToString() const;
-    
-    /**
-     * @brief 获取堆栈跟踪字符串
-     */
-    std::string GetStackTrace() const;
 
 private:
     /* ====================================================================== */
     /* 成员变量 */
     /* ====================================================================== */
     
-    const Proto* proto_;                // 函数原型
-    Size base_;                        // 堆栈基址
-    Size param_count_;                 // 参数数量
-    Size return_address_;              // 返回地址
-    Size instruction_pointer_;         // 当前指令指针
+    const Proto* proto_;               // 函数原型
+    const Instruction* saved_pc_;      // 保存的指令指针（切换帧时写回）
+    uint32_t base_;                    // 堆栈基址
+    uint32_t func_;                    // 函数槽位置
+    int16_t expected_results_;         // 调用者期望的返回值数量（C字段最大511）
+    uint16_t flags_;                   // VM_FRAME_*标志位
+    uint32_t profile_slot_;            // 剖析计数槽
+};
+
+static_assert(std::is_trivially_copyable_v<CallFrame>, "CallFrame must be trivially copyable");
+static_assert(sizeof(CallFrame) <= 32, "CallFrame must fit in 32 bytes");
+
+/* ========================================================================== */
+/* 调用帧栈 */
+/* ========================================================================== */
+
+/**
+ * @brief 调用帧栈（同Lua的base_ci..end_ci数组）
+ * 
+ * 调用帧存放在一块连续内存中：前VM_INLINE_CALL_FRAMES帧位于对象内的
+ * 内联缓冲区，更深的调用才迁移到堆上并按倍数扩容。0号帧是基础帧（同
+ * base_ci），不属于任何函数。VirtualMachine持有唯一的帧栈，
+ * AdvancedCallStackManager可以挂接到同一个帧栈上，每次调用只记录一次。
+ * 
+ * 扩容会移动帧数组，调用者持有的CallFrame引用在Push之后需要重新获取。
+ */
+class CallFrameStack {
+public:
+    /**
+     * @brief 构造函数
+     * @param max_depth 最大调用深度（含基础帧）
+     */
+    explicit CallFrameStack(Size max_depth = VM_MAX_CALL_STACK_DEPTH)
+        : frames_(inline_frames_)
+        , capacity_(VM_INLINE_CALL_FRAMES)
+        , current_(0)
+        , max_depth_(max_depth) {
+        frames_[0] = CallFrame(nullptr, 0);
+    }
+    
+    ~CallFrameStack() = default;
+    
+    // 禁用拷贝；移动时内联缓冲区中的帧需要逐个复制
+    CallFrameStack(const CallFrameStack&) = delete;
+    CallFrameStack& operator=(const CallFrameStack&) = delete;
+    
+    CallFrameStack(CallFrameStack&& other) noexcept
+        : CallFrameStack(other.max_depth_) {
+        *this = std::move(other);
+    }
+    
+    CallFrameStack& operator=(CallFrameStack&& other) noexcept {
+        if (this != &other) {
+            if (other.IsInline()) {
+                std::copy(other.inline_frames_, other.inline_frames_ + other.current_ + 1, inline_frames_);
+                frames_ = inline_frames_;
+                heap_frames_.reset();
+            } else {
+                heap_frames_ = std::move(other.heap_frames_);
+                frames_ = heap_frames_.get();
+            }
+            capacity_ = other.capacity_;
+            current_ = other.current_;
+            max_depth_ = other.max_depth_;
+            other.frames_ = other.inline_frames_;
+            other.capacity_ = VM_INLINE_CALL_FRAMES;
+            other.Clear();
+        }
+        return *this;
+    }
+    
+    /* ====================================================================== */
+    /* 帧操作 */
+    /* ====================================================================== */
+    
+    /**
+     * @brief 推入新帧（同incr_ci）
+     * @return 新的当前帧
+     * @throws CallStackOverflowError 超过最大调用深度
+     */
+    CallFrame& Push(const Proto* proto, Size base, Size func = 0, int expected_results = VM_MULTRET) {
+        if (current_ + 1 >= max_depth_) {
+            throw CallStackOverflowError("Call stack overflow");
+        }
+        if (current_ + 1 >= capacity_) {
+            Grow();
+        }
+        CallFrame& frame = frames_[++current_];
+        frame = CallFrame(proto, base, func, expected_results);
+        return frame;
+    }
+    
+    /**
+     * @brief 弹出当前帧
+     * @return 被弹出的帧（在下一次Push之前有效）
+     * @throws CallFrameError 调用栈为空
+     */
+    CallFrame& Pop() {
+        if (current_ == 0) {
+            throw CallFrameError("Cannot pop from empty call stack");
+        }
+        return frames_[current_--];
+    }
+    
+    /**
+     * @brief 获取当前帧（同L->ci）
+     */
+    CallFrame& Top() { return frames_[current_]; }
+    const CallFrame& Top() const { return frames_[current_]; }
+    
+    /**
+     * @brief 按索引访问帧（0为基础帧）
+     */
+    CallFrame& operator[](Size index) { return frames_[index]; }
+    const CallFrame& operator[](Size index) const { return frames_[index]; }
+    
+    /**
+     * @brief 重置为只有基础帧，保留已分配的容量
+     */
+    void Clear() {
+        current_ = 0;
+        frames_[0] = CallFrame(nullptr, 0);
+    }
+    
+    /* ====================================================================== */
+    /* 状态查询 */
+    /* ====================================================================== */
+    
+    /**
+     * @brief 获取当前帧索引（同ci - base_ci）
+     */
+    Size GetCurrentIndex() const { return current_; }
+    
+    /**
+     * @brief 获取帧数量（含基础帧）
+     */
+    Size GetDepth() const { return current_ + 1; }
+    
+    /**
+     * @brief 获取最大调用深度
+     */
+    Size GetMaxDepth() const { return max_depth_; }
+    
+    /**
+     * @brief 获取当前容量
+     */
+    Size GetCapacity() const { return capacity_; }
+    
+    /**
+     * @brief 检查是否只有基础帧
+     */
+    bool IsEmpty() const { return current_ == 0; }
+    
+    /**
+     * @brief 检查帧是否仍在内联缓冲区中
+     */
+    bool IsInline() const { return frames_ == inline_frames_; }
+
+private:
+    /**
+     * @brief 扩容（同luaD_reallocCI），首次扩容时离开内联缓冲区
+     */
+    void Grow() {
+        Size new_capacity = std::min(capacity_ * 2, max_depth_);
+        auto grown = std::make_unique<CallFrame[]>(new_capacity);
+        std::copy(frames_, frames_ + current_ + 1, grown.get());
+        heap_frames_ = std::move(grown);
+        frames_ = heap_frames_.get();
+        capacity_ = new_capacity;
+    }
+    
+    CallFrame* frames_;                         // 当前使用的帧数组（内联或堆上）
+    Size capacity_;                             // 帧数组容量
+    Size current_;                              // 当前帧索引
+    Size max_depth_;                            // 最大调用深度
+    std::unique_ptr<CallFrame[]> heap_frames_;  // 超出内联容量后的堆上数组
+    CallFrame inline_frames_[VM_INLINE_CALL_FRAMES]; // 内联缓冲区
 };
 
 /* ========================================================================== */
@@ -24,20 +24,29 @@ namespace lua_cpp {
 /* ========================================================================== */
 
 AdvancedCallStackManager::AdvancedCallStackManager(Size max_depth)
-    : frames_()
-    , current_frame_index_(0)
-    , max_depth_(max_depth)
+    : AdvancedCallStackManager(std::make_unique<CallFrameStack>(max_depth), nullptr) {}
+
+AdvancedCallStackManager::AdvancedCallStackManager(CallFrameStack& frames)
+    : AdvancedCallStackManager(nullptr, &frames) {}
+
+AdvancedCallStackManager::AdvancedCallStackManager(std::unique_ptr<CallFrameStack> owned_frames,
+                                                   CallFrameStack* shared_frames)
+    : owned_frames_(std::move(owned_frames))
+    , frames_(owned_frames_ ? owned_frames_.get() : shared_frames)
     , metrics_()
     , pattern_stats_()
-    , call_start_times_()
-    , recursion_depths_()
+    , profiling_enabled_(false)
+    , sample_interval_(1)
+    , sample_countdown_(1)
+    , sample_start_ns_()
+    , function_profiles_()
+    , profile_slots_()
+    , depth_sum_(0)
+    , sampled_time_total_ns_(0)
+    , sampled_call_count_(0)
     , call_history_()
     , frame_memory_overhead_(sizeof(CallFrame)) {
     
-    // 预分配初始调用帧空间（Lua 5.1.5 风格）
-    frames_.reserve(std::min<Size>(8, max_depth));
-    frames_.resize(1, CallFrame(nullptr, 0, 0, 0));  // 基础帧
-    
     // 初始化性能指标
     ResetMetrics();
     
@@ -90,29 +99,32 @@ bool AdvancedCallStackManager::CanOptimizeTailCall(const Proto* proto, Size para
     return true;
 }
 
-void AdvancedCallStackManager::ExecuteTailCallOptimization(const Proto* proto, Size param_count,
-                                                  const std::vector<LuaValue>& args) {
+void AdvancedCallStackManager::ExecuteTailCallOptimization(const Proto* proto, Size param_count) {
     if (!CanOptimizeTailCall(proto, param_count)) {
         throw RuntimeError("Cannot execute tail call optimization");
     }
     
-    // 记录优化开始
-    auto optimization_start = std::chrono::steady_clock::now();
-    
     // 获取当前帧信息
     CallFrame& current_frame = GetCurrentFrame();
     Size current_base = current_frame.GetBase();
-    Size return_address = current_frame.GetReturnAddress();
     
     // 计算内存节省
     Size memory_saved = CalculateMemorySavings(1); // 避免创建一个新帧
     metrics_.memory_saves_from_tail_calls += memory_saved;
     
-    // 更新当前帧而不是创建新帧（这是尾调用优化的核心）
-    current_frame = CallFrame(proto, current_base, param_count, return_address);
+    // 被替换的帧就此结束
+    if (current_frame.GetProfileSlot() != VM_NO_PROFILE_SLOT || profiling_enabled_) {
+        RecordCallEnd(current_frame);
+    }
     
-    // 重置指令指针到新函数开头
-    current_frame.SetInstructionPointer(0);
+    // 原地改写当前帧而不是创建新帧（这是尾调用优化的核心），返回目标不变，
+    // 新帧的指令指针从0开始
+    current_frame = CallFrame(proto, current_base, current_frame.GetFunctionSlot(),
+                              current_frame.GetExpectedResults());
+    current_frame.SetFlag(VM_FRAME_TAIL_CALL);
+    if (profiling_enabled_) {
+        RecordCallStart(current_frame);
+    }
     
     // 更新统计信息
     metrics_.tail_calls_optimized++;
@@ -124,20 +136,6 @@ void AdvancedCallStackManager::ExecuteTailCallOptimization(const Proto* proto, S
     } else {
         UpdateCallPatternStats(CallPattern::NORMAL);
     }
-    
-    // 记录优化时间
-    auto optimization_end = std::chrono::steady_clock::now();
-    auto optimization_duration = std::chrono::duration<double, std::milli>(
-        optimization_end - optimization_start).count();
-    
-    // 更新平均调用持续时间（尾调用优化应该更快）
-    if (metrics_.total_function_calls > 0) {
-        double total_time = metrics_.avg_call_duration * metrics_.total_function_calls;
-        metrics_.avg_call_duration = (total_time + optimization_duration) / 
-                                   (metrics_.total_function_calls + 1);
-    } else {
-        metrics_.avg_call_duration = optimization_duration;
-    }
 }
 
 void AdvancedCallStackManager::PrepareTailCall(RegisterIndex func_reg, Size param_count) {
@@ -211,23 +209,25 @@ void AdvancedCallStackManager::ResetMetrics() {
     
     // 清空调用历史
     call_history_.clear();
-    call_start_times_.clear();
-    recursion_depths_.clear();
+    
+    // 清零剖析计数；栈上的帧仍引用各自的槽，因此保留槽分配和活动帧数
+    for (auto& profile : function_profiles_) {
+        profile.call_count = 0;
+        profile.sampled_calls = 0;
+        profile.sampled_time_ns = 0;
+        profile.max_recursion_depth = profile.active_frames;
+    }
+    depth_sum_ = 0;
+    sampled_time_total_ns_ = 0;
+    sampled_call_count_ = 0;
 }
 
-void AdvancedCallStackManager::UpdateCallTiming(std::chrono::steady_clock::time_point call_start_time) {
-    auto call_end_time = std::chrono::steady_clock::now();
-    auto call_duration = std::chrono::duration<double, std::milli>(
-        call_end_time - call_start_time).count();
+void AdvancedCallStackManager::UpdateCallTiming(uint64_t duration_ns) {
+    sampled_time_total_ns_ += duration_ns;
+    sampled_call_count_++;
     
-    // 更新平均调用持续时间
-    if (metrics_.total_function_calls > 0) {
-        double total_time = metrics_.avg_call_duration * metrics_.total_function_calls;
-        metrics_.avg_call_duration = (total_time + call_duration) / 
-                                   (metrics_.total_function_calls + 1);
-    } else {
-        metrics_.avg_call_duration = call_duration;
-    }
+    metrics_.avg_call_duration = static_cast<double>(sampled_time_total_ns_) / 1e6 /
+                               static_cast<double>(sampled_call_count_);
 }
 
 void AdvancedCallStackManager::UpdateMemoryUsage(Size current_usage) {
@@ -235,6 +235,11 @@ void AdvancedCallStackManager::UpdateMemoryUsage(Size current_usage) {
     metrics_.peak_memory_usage = std::max(metrics_.peak_memory_usage, current_usage);
 }
 
+void AdvancedCallStackManager::SetProfileSampleInterval(Size interval) {
+    sample_interval_ = std::max<Size>(interval, 1);
+    sample_countdown_ = sample_interval_;
+}
+
 /* ========================================================================== */
 /* 调用模式分析 */
 /* ========================================================================== */
@@ -458,110 +463,39 @@ std::string AdvancedCallStackManager::ExportCallGraphToDot() const {
 /* 基础调用栈方法实现（独立实现，不依赖继承）*/
 /* ========================================================================== */
 
-void AdvancedCallStackManager::PushFrame(const Proto* proto, Size base, Size param_count, 
-                                 Size return_address) {
-    // 检查深度
-    if (current_frame_index_ + 1 >= max_depth_) {
-        throw CallStackOverflowError("Call stack overflow in advanced manager");
-    }
-    
-    // 如果需要，扩容数组
-    if (current_frame_index_ + 1 >= frames_.size()) {
-        Size new_size = frames_.empty() ? 8 : frames_.size() * 2;
-        new_size = std::min(new_size, max_depth_);
-        frames_.resize(new_size, CallFrame(nullptr, 0, 0, 0));
-    }
-    
-    // 记录调用开始（T026 统计）
-    RecordCallStart(proto);
-    
-    // 更新 T026 统计
-    metrics_.total_function_calls++;
-    metrics_.current_depth = current_frame_index_ + 2;  // +2 因为马上要递增
-    metrics_.max_depth_reached = std::max(metrics_.max_depth_reached, metrics_.current_depth);
-    
-    // 计算平均调用深度
-    if (metrics_.total_function_calls > 0) {
-        double total_depth = metrics_.avg_call_depth * (metrics_.total_function_calls - 1);
-        metrics_.avg_call_depth = (total_depth + metrics_.current_depth) / 
-                                metrics_.total_function_calls;
-    } else {
-        metrics_.avg_call_depth = metrics_.current_depth;
-    }
-    
-    // 更新递归深度
-    if (proto && IsRecursiveCall(proto)) {
-        metrics_.recursive_calls++;
-        recursion_depths_[proto] = GetRecursionDepth(proto) + 1;
-        metrics_.max_recursion_depth = std::max(metrics_.max_recursion_depth,
-                                              recursion_depths_[proto]);
-    }
+void AdvancedCallStackManager::PushFrame(const Proto* proto, Size base, Size func,
+                                         int expected_results) {
+    // 深度检查和扩容由帧栈完成（Lua 5.1.5 风格）
+    CallFrame& frame = frames_->Push(proto, base, func, expected_results);
     
-    // 更新调用历史
-    if (proto) {
-        call_history_.push_back(proto);
-        if (call_history_.size() > MAX_CALL_HISTORY) {
-            call_history_.erase(call_history_.begin());
-        }
+    // 剖析关闭时调用的开销只有上面的帧推入
+    if (profiling_enabled_) {
+        RecordCallStart(frame);
     }
-    
-    // 更新内存使用
-    Size new_memory = metrics_.current_memory_usage + frame_memory_overhead_;
-    UpdateMemoryUsage(new_memory);
-    
-    // 分析并更新调用模式
-    CallPattern pattern = AnalyzeCallPattern();
-    UpdateCallPatternStats(pattern);
-    
-    // 递增索引并初始化帧（Lua 5.1.5 风格）
-    current_frame_index_++;
-    frames_[current_frame_index_] = CallFrame(proto, base, param_count, return_address);
 }
 
 CallFrame AdvancedCallStackManager::PopFrame() {
-    if (current_frame_index_ == 0) {
+    if (frames_->IsEmpty()) {
         throw CallFrameError("Cannot pop from empty call stack");
     }
     
-    // 获取当前帧信息
-    const CallFrame& current_frame = frames_[current_frame_index_];
-    const Proto* proto = current_frame.GetProto();
-    
-    // 记录调用结束（T026 统计）
-    RecordCallEnd(proto);
+    const CallFrame& current_frame = frames_->Top();
     
-    // 更新 T026 统计
-    metrics_.total_function_returns++;
-    metrics_.current_depth = current_frame_index_;  // 即将递减后的深度
-    
-    // 更新递归深度
-    if (proto && recursion_depths_.count(proto)) {
-        recursion_depths_[proto]--;
-        if (recursion_depths_[proto] == 0) {
-            recursion_depths_.erase(proto);
-        }
+    // 开启剖析前推入的帧没有剖析槽；关闭剖析后仍需结清已计数的帧
+    if (current_frame.GetProfileSlot() != VM_NO_PROFILE_SLOT || profiling_enabled_) {
+        RecordCallEnd(current_frame);
     }
     
-    // 更新内存使用
-    Size new_memory = metrics_.current_memory_usage - frame_memory_overhead_;
-    UpdateMemoryUsage(new_memory);
-    
     // 简单递减并返回帧（Lua 5.1.5 风格）
-    return frames_[current_frame_index_--];
+    return frames_->Pop();
 }
 
 CallFrame& AdvancedCallStackManager::GetCurrentFrame() {
-    if (current_frame_index_ >= frames_.size()) {
-        throw CallFrameError("No active call frame");
-    }
-    return frames_[current_frame_index_];
+    return frames_->Top();
 }
 
 const CallFrame& AdvancedCallStackManager::GetCurrentFrame() const {
-    if (current_frame_index_ >= frames_.size()) {
-        throw CallFrameError("No active call frame");
-    }
-    return frames_[current_frame_index_];
+    return frames_->Top();
 }
 
 void AdvancedCallStackManager::Clear() {
@@ -569,14 +503,13 @@ void AdvancedCallStackManager::Clear() {
     ResetMetrics();
     
     // 重置调用栈（保持一个基础帧）
-    current_frame_index_ = 0;
-    frames_.clear();
-    frames_.resize(1, CallFrame(nullptr, 0, 0, 0));
+    frames_->Clear();
+    sample_start_ns_.clear();
     
-    // 清空历史和递归跟踪
+    // 栈已清空，不再有帧引用剖析槽
     call_history_.clear();
-    recursion_depths_.clear();
-    call_start_times_.clear();
+    function_profiles_.clear();
+    profile_slots_.clear();
 }
 
 /* ========================================================================== */
@@ -588,15 +521,10 @@ AdvancedCallStackManager::ValidationResult AdvancedCallStackManager::ValidateInt
     result.is_valid = true;
     
     // 基础完整性检查
-    if (current_frame_index_ >= frames_.size()) {
+    if (frames_->GetCurrentIndex() >= frames_->GetCapacity()) {
         result.is_valid = false;
         result.issues.push_back("Current frame index out of bounds");
     }
-    
-    if (frames_.empty()) {
-        result.is_valid = false;
-        result.issues.push_back("Frame array is empty");
-    }
     if (!basic_valid) {
         result.is_valid = false;
         result.issues.push_back("基础调用栈完整性检查失败");
@@ -616,18 +544,18 @@ AdvancedCallStackManager::ValidationResult AdvancedCallStackManager::ValidateInt
         result.issues.push_back("尾调用统计异常: 优化次数超过尝试次数");
     }
     
-    // 检查内存统计
+    // 检查内存统计（仅在剖析开启时维护）
     Size expected_memory = GetDepth() * frame_memory_overhead_;
-    if (metrics_.current_memory_usage < expected_memory) {
+    if (profiling_enabled_ && metrics_.current_memory_usage < expected_memory) {
         result.warnings.push_back("内存使用统计可能偏低");
     }
     
-    // 检查递归深度
-    for (const auto& pair : recursion_depths_) {
-        Size actual_depth = GetRecursionDepth(pair.first);
-        if (pair.second != actual_depth) {
+    // 检查递归深度：开启剖析前推入的帧不计数，因此活动帧数只能偏少
+    for (const auto& profile : function_profiles_) {
+        Size actual_depth = GetRecursionDepth(profile.proto);
+        if (profile.active_frames > actual_depth) {
             result.issues.push_back("递归深度统计不一致: 函数=" + 
-                                   std::to_string(reinterpret_cast<uintptr_t>(pair.first)));
+                                   std::to_string(reinterpret_cast<uintptr_t>(profile.proto)));
             result.is_valid = false;
         }
     }
@@ -803,18 +731,86 @@ Size AdvancedCallStackManager::CalculateMemorySavings(Size avoided_frames) const
     return avoided_frames * frame_memory_overhead_;
 }
 
-void AdvancedCallStackManager::RecordCallStart(const Proto* proto) {
-    if (proto) {
-        call_start_times_[proto] = std::chrono::steady_clock::now();
+void AdvancedCallStackManager::RecordCallStart(CallFrame& frame) {
+    Size depth = GetDepth();
+    metrics_.total_function_calls++;
+    metrics_.current_depth = depth;
+    metrics_.max_depth_reached = std::max(metrics_.max_depth_reached, depth);
+    depth_sum_ += depth;
+    metrics_.avg_call_depth = static_cast<double>(depth_sum_) / metrics_.total_function_calls;
+    UpdateMemoryUsage(depth * frame_memory_overhead_);
+    
+    const Proto* proto = frame.GetProto();
+    if (!proto) {
+        return;
+    }
+    
+    // 递归深度由原型的活动帧数直接得到，无需扫描调用栈
+    uint32_t slot = GetProfileSlot(proto);
+    FunctionProfile& profile = function_profiles_[slot];
+    profile.call_count++;
+    profile.active_frames++;
+    if (profile.active_frames > 1) {
+        metrics_.recursive_calls++;
+        profile.max_recursion_depth = std::max(profile.max_recursion_depth, profile.active_frames);
+        metrics_.max_recursion_depth = std::max(metrics_.max_recursion_depth, profile.active_frames);
+    }
+    
+    frame.SetProfileSlot(slot);
+    
+    // 只有被采样的调用读取时钟并做调用模式分析；开始时间不占用帧记录，
+    // 放在与采样帧同步进出的采样栈上
+    if (--sample_countdown_ == 0) {
+        sample_countdown_ = sample_interval_;
+        frame.SetFlag(VM_FRAME_SAMPLED);
+        sample_start_ns_.push_back(ProfileClockNow());
+        
+        call_history_.push_back(proto);
+        if (call_history_.size() > MAX_CALL_HISTORY) {
+            call_history_.erase(call_history_.begin());
+        }
+        UpdateCallPatternStats(AnalyzeCallPattern());
     }
 }
 
-void AdvancedCallStackManager::RecordCallEnd(const Proto* proto) {
-    if (proto && call_start_times_.count(proto)) {
-        auto start_time = call_start_times_[proto];
-        UpdateCallTiming(start_time);
-        call_start_times_.erase(proto);
+void AdvancedCallStackManager::RecordCallEnd(const CallFrame& frame) {
+    metrics_.total_function_returns++;
+    metrics_.current_depth = GetDepth() - 1;
+    UpdateMemoryUsage(metrics_.current_depth * frame_memory_overhead_);
+    
+    uint32_t slot = frame.GetProfileSlot();
+    if (slot == VM_NO_PROFILE_SLOT) {
+        return;
     }
+    
+    FunctionProfile& profile = function_profiles_[slot];
+    if (profile.active_frames > 0) {
+        profile.active_frames--;
+    }
+    
+    if (frame.HasFlag(VM_FRAME_SAMPLED) && !sample_start_ns_.empty()) {
+        uint64_t duration_ns = ProfileClockNow() - sample_start_ns_.back();
+        sample_start_ns_.pop_back();
+        profile.sampled_calls++;
+        profile.sampled_time_ns += duration_ns;
+        UpdateCallTiming(duration_ns);
+    }
+}
+
+uint32_t AdvancedCallStackManager::GetProfileSlot(const Proto* proto) {
+    auto [it, inserted] = profile_slots_.try_emplace(
+        proto, static_cast<uint32_t>(function_profiles_.size()));
+    if (inserted) {
+        FunctionProfile profile;
+        profile.proto = proto;
+        function_profiles_.push_back(profile);
+    }
+    return it->second;
+}
+
+uint64_t AdvancedCallStackManager::ProfileClockNow() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
 }
 
 /* ========================================================================== */
@@ -836,6 +832,8 @@ std::unique_ptr<AdvancedCallStackManager> CreateDebugCallStack() {
     // 调试版本，最详细的统计和跟踪
     auto stack = std::make_unique<AdvancedCallStackManager>(VM_MAX_CALL_STACK_DEPTH / 2);
     stack->ResetMetrics();
+    stack->SetProfilingEnabled(true);
+    stack->SetProfileSampleInterval(1);
     return stack;
 }
 
@@ -6,6 +6,7 @@
 #include <memory>
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <chrono>
 
 namespace lua_cpp {
@@ -28,7 +29,8 @@ class LuaValue;
  * 
  * 设计哲学：
  * - 不继承基础 CallStack（避免过度抽象）
- * - 独立管理自己的 CallFrame 数组（组合而非继承）
+ * - 帧存放在 CallFrameStack 中：独立使用时自己持有，也可挂接到
+ *   VirtualMachine 的帧栈上，与VM共享同一份调用帧（组合而非继承）
  * - 提供 T026 特有的高级功能
  * - 可被 EnhancedVirtualMachine 选择性使用
  * 
@@ -41,11 +43,17 @@ class LuaValue;
 class AdvancedCallStackManager {
 public:
     /**
-     * @brief 构造函数
+     * @brief 构造函数（持有独立的帧栈）
      * @param max_depth 最大调用深度
      */
     explicit AdvancedCallStackManager(Size max_depth = VM_MAX_CALL_STACK_DEPTH);
     
+    /**
+     * @brief 构造函数（挂接到已有的帧栈，如VirtualMachine::GetCallFrameStack()）
+     * @param frames 共享的帧栈，生命周期必须长于管理器
+     */
+    explicit AdvancedCallStackManager(CallFrameStack& frames);
+    
     /**
      * @brief 析构函数
      */
@@ -65,10 +73,10 @@ public:
      * @brief 推入新的调用帧
      * @param proto 函数原型
      * @param base 堆栈基址
-     * @param param_count 参数数量
-     * @param return_address 返回地址
+     * @param func 函数槽位置
+     * @param expected_results 调用者期望的返回值数量
      */
-    void PushFrame(const Proto* proto, Size base, Size param_count, Size return_address = 0);
+    void PushFrame(const Proto* proto, Size base, Size func = 0, int expected_results = VM_MULTRET);
     
     /**
      * @brief 弹出当前调用帧
@@ -82,20 +90,33 @@ public:
     CallFrame& GetCurrentFrame();
     const CallFrame& GetCurrentFrame() const;
     
+    /**
+     * @brief 获取指定深度的调用帧
+     * @param depth 深度（0为当前帧，GetDepth()-1为基础帧）
+     */
+    const CallFrame& GetFrame(Size depth) const {
+        return (*frames_)[frames_->GetCurrentIndex() - depth];
+    }
+    
     /**
      * @brief 获取调用栈深度
      */
-    Size GetDepth() const { return current_frame_index_ + 1; }
+    Size GetDepth() const { return frames_->GetDepth(); }
     
     /**
      * @brief 获取最大深度
      */
-    Size GetMaxDepth() const { return max_depth_; }
+    Size GetMaxDepth() const { return frames_->GetMaxDepth(); }
     
     /**
      * @brief 检查调用栈是否为空
      */
-    bool IsEmpty() const { return current_frame_index_ == 0; }
+    bool IsEmpty() const { return frames_->IsEmpty(); }
+    
+    /**
+     * @brief 获取底层帧栈
+     */
+    const CallFrameStack& GetFrameStack() const { return *frames_; }
     
     /**
      * @brief 清空调用栈
@@ -117,11 +138,9 @@ public:
     /**
      * @brief 执行尾调用优化
      * @param proto 目标函数原型
-     * @param param_count 参数数量
-     * @param args 参数数组（从栈中移动）
+     * @param param_count 参数数量（参数已由VM下移到当前帧的寄存器窗口）
      */
-    void ExecuteTailCallOptimization(const Proto* proto, Size param_count, 
-                                   const std::vector<LuaValue>& args);
+    void ExecuteTailCallOptimization(const Proto* proto, Size param_count);
     
     /**
      * @brief 准备尾调用（参数移动和栈调整）
@@ -150,6 +169,7 @@ public:
     
     /**
      * @brief 调用栈性能指标
+     * @note 除尾调用统计外，仅在开启剖析时更新
      */
     struct CallStackMetrics {
         // 尾调用统计
@@ -170,7 +190,7 @@ public:
         // 性能统计
         Size total_function_calls = 0;        // 总函数调用次数
         Size total_function_returns = 0;      // 总函数返回次数
-        double avg_call_duration = 0.0;       // 平均调用持续时间(ms)
+        double avg_call_duration = 0.0;       // 采样调用的平均持续时间(ms)
         std::chrono::steady_clock::time_point measurement_start; // 测量开始时间
         
         // 内存统计
@@ -191,9 +211,9 @@ public:
     
     /**
      * @brief 更新调用时间统计
-     * @param call_start_time 调用开始时间
+     * @param duration_ns 一次采样调用的持续时间(ns)
      */
-    void UpdateCallTiming(std::chrono::steady_clock::time_point call_start_time);
+    void UpdateCallTiming(uint64_t duration_ns);
     
     /**
      * @brief 更新内存使用统计
@@ -201,6 +221,51 @@ public:
      */
     void UpdateMemoryUsage(Size current_usage);
     
+    /* ====================================================================== */
+    /* 采样剖析 */
+    /* ====================================================================== */
+    
+    /**
+     * @brief 单个函数原型的剖析计数
+     */
+    struct FunctionProfile {
+        const Proto* proto = nullptr;         // 函数原型
+        Size call_count = 0;                  // 调用次数
+        Size sampled_calls = 0;               // 被采样计时的调用次数
+        uint64_t sampled_time_ns = 0;         // 采样调用累计耗时(ns，含被调函数)
+        Size active_frames = 0;               // 当前位于栈上的帧数
+        Size max_recursion_depth = 0;         // 最大递归深度
+    };
+    
+    /**
+     * @brief 开启或关闭剖析
+     * 
+     * 关闭时PushFrame/PopFrame只做帧的推入和弹出；开启后每次调用
+     * 累加所属原型的计数，每sample_interval次调用记录一次时间戳并做
+     * 调用模式分析。开启前已在栈上的帧不参与剖析。
+     */
+    void SetProfilingEnabled(bool enabled) { profiling_enabled_ = enabled; }
+    
+    /**
+     * @brief 检查是否开启剖析
+     */
+    bool IsProfilingEnabled() const { return profiling_enabled_; }
+    
+    /**
+     * @brief 设置采样间隔（1表示每次调用都计时）
+     */
+    void SetProfileSampleInterval(Size interval);
+    
+    /**
+     * @brief 获取采样间隔
+     */
+    Size GetProfileSampleInterval() const { return sample_interval_; }
+    
+    /**
+     * @brief 获取按原型聚合的剖析计数（按首次出现顺序）
+     */
+    const std::vector<FunctionProfile>& GetFunctionProfiles() const { return function_profiles_; }
+    
     /* ====================================================================== */
     /* 调用模式分析 */
     /* ====================================================================== */
@@ -276,26 +341,6 @@ public:
      */
     std::string ExportCallGraphToDot() const;
     
-    /* ====================================================================== */
-    /* 重写基类方法以添加统计 */
-    /* ====================================================================== */
-    
-    /**
-     * @brief 推入调用帧（带统计）
-     */
-    void PushFrame(const Proto* proto, Size base, Size param_count, 
-                   Size return_address = 0);
-    
-    /**
-     * @brief 弹出调用帧（带统计）
-     */
-    CallFrame PopFrame();
-    
-    /**
-     * @brief 清空调用栈（带统计重置）
-     */
-    void Clear();
-    
     /* ====================================================================== */
     /* 调用栈验证和诊断 */
     /* ====================================================================== */
@@ -333,6 +378,12 @@ private:
     /* 内部方法 */
     /* ====================================================================== */
     
+    /**
+     * @brief 公共构造：持有owned_frames，否则挂接到shared_frames
+     */
+    AdvancedCallStackManager(std::unique_ptr<CallFrameStack> owned_frames,
+                             CallFrameStack* shared_frames);
+    
     /**
      * @brief 更新调用模式统计
      * @param pattern 检测到的模式
@@ -354,25 +405,35 @@ private:
     Size CalculateMemorySavings(Size avoided_frames) const;
     
     /**
-     * @brief 记录函数调用开始
-     * @param proto 函数原型
+     * @brief 记录函数调用开始（仅在开启剖析时调用）
+     * @param frame 刚推入的调用帧，写入剖析槽；被采样时设置VM_FRAME_SAMPLED
+     *              并把开始时间压入采样栈
      */
-    void RecordCallStart(const Proto* proto);
+    void RecordCallStart(CallFrame& frame);
     
     /**
      * @brief 记录函数调用结束
-     * @param proto 函数原型
+     * @param frame 即将弹出或被尾调用替换的调用帧
      */
-    void RecordCallEnd(const Proto* proto);
+    void RecordCallEnd(const CallFrame& frame);
+    
+    /**
+     * @brief 获取原型对应的剖析计数槽，首次出现时分配
+     */
+    uint32_t GetProfileSlot(const Proto* proto);
+    
+    /**
+     * @brief 剖析时钟（单调递增，ns）
+     */
+    static uint64_t ProfileClockNow();
     
     /* ====================================================================== */
     /* 成员变量 */
     /* ====================================================================== */
     
     // 基础调用栈数据（Lua 5.1.5 风格）
-    std::vector<CallFrame> frames_;         // 调用帧数组
-    Size current_frame_index_;              // 当前帧索引
-    Size max_depth_;                        // 最大深度
+    std::unique_ptr<CallFrameStack> owned_frames_; // 独立使用时持有的帧栈
+    CallFrameStack* frames_;                // 当前使用的帧栈（自有或共享）
     
     // T026 性能统计
     CallStackMetrics metrics_;
@@ -380,11 +441,16 @@ private:
     // 调用模式统计
     std::map<CallPattern, Size> pattern_stats_;
     
-    // 调用计时
-    std::map<const Proto*, std::chrono::steady_clock::time_point> call_start_times_;
-    
-    // 递归检测
-    std::map<const Proto*, Size> recursion_depths_;
+    // 采样剖析（平铺的按原型计数数组，槽号记录在调用帧中）
+    bool profiling_enabled_;
+    Size sample_interval_;
+    Size sample_countdown_;
+    std::vector<uint64_t> sample_start_ns_; // 被采样帧的开始时间（与带VM_FRAME_SAMPLED的帧一一对应）
+    std::vector<FunctionProfile> function_profiles_;
+    std::unordered_map<const Proto*, uint32_t> profile_slots_;
+    Size depth_sum_;                        // 调用深度累计（计算平均深度）
+    uint64_t sampled_time_total_ns_;        // 采样调用累计耗时
+    Size sampled_call_count_;               // 采样调用次数
     
     // 调用历史（用于模式分析）
     std::vector<const Proto*> call_history_;
@@ -25,98 +25,74 @@ std::string CoroutineStateToString(CoroutineState state) {
 /* CoroutineContext 实现 */
 /* ========================================================================== */
 
-CoroutineContext::CoroutineContext(Size initial_stack_size, Size max_call_depth)
+CoroutineContext::CoroutineContext(Size initial_stack_size, Size max_call_depth,
+                                   MemoryManager& manager)
     : state_(CoroutineState::SUSPENDED)
+    , lua_stack_(std::make_unique<LuaStack>(initial_stack_size, VM_MAX_STACK_SIZE, manager))
+    , call_stack_(std::make_unique<AdvancedCallStackManager>(max_call_depth))
+    , upvalue_manager_(std::make_unique<UpvalueManager>(lua_stack_.get()))
+    , thread_(lua_stack_.get(), max_call_depth)
     , instruction_pointer_(0)
-    , current_proto_(nullptr) {
-    
-    // 创建执行上下文组件
-    call_stack_ = std::make_unique<AdvancedCallStack>(max_call_depth);
-    lua_stack_ = std::make_unique<LuaStack>(initial_stack_size);
-    upvalue_manager_ = std::make_unique<UpvalueManager>();
+    , current_proto_(nullptr)
+    , id_(0)
+    , resumer_(nullptr)
+    , transfer_count_(0) {
     
     // 初始化统计信息
     stats_.created_time = std::chrono::steady_clock::now();
-    stats_.last_run_time = stats_.created_time;
 }
 
 /* ====================================================================== */
-/* 上下文保存和恢复 */
+/* 值传递 */
 /* ====================================================================== */
 
-void CoroutineContext::SaveContextTo(CoroutineContext& target) const {
-    // 保存状态
-    target.state_ = state_;
-    target.instruction_pointer_ = instruction_pointer_;
-    target.current_proto_ = current_proto_;
-    
-    // 深拷贝栈状态（简化实现，实际需要根据具体Stack类接口）
-    // 这里假设Stack有Clone方法
-    // target.lua_stack_ = std::make_unique<LuaStack>(*lua_stack_);
-    
-    // 保存参数和返回值
-    target.arguments_ = arguments_;
-    target.return_values_ = return_values_;
-    target.yield_values_ = yield_values_;
-    
-    // 保存统计信息
-    target.stats_ = stats_;
-}
-
-void CoroutineContext::RestoreContextFrom(const CoroutineContext& source) {
-    // 恢复状态
-    state_ = source.state_;
-    instruction_pointer_ = source.instruction_pointer_;
-    current_proto_ = source.current_proto_;
-    
-    // 恢复参数和返回值
-    arguments_ = source.arguments_;
-    return_values_ = source.return_values_;
-    yield_values_ = source.yield_values_;
+void CoroutineContext::XMove(CoroutineContext& from, CoroutineContext& to, Size count) {
+    if (count == 0) {
+        return;
+    }
     
-    // 恢复统计信息
-    stats_ = source.stats_;
-}
-
-void CoroutineContext::SwapContext(CoroutineContext& other) {
-    // 交换状态
-    std::swap(state_, other.state_);
-    std::swap(instruction_pointer_, other.instruction_pointer_);
-    std::swap(current_proto_, other.current_proto_);
+    LuaStack& source = *from.lua_stack_;
+    LuaStack& target = *to.lua_stack_;
     
-    // 交换栈（需要特殊处理）
-    call_stack_.swap(other.call_stack_);
-    lua_stack_.swap(other.lua_stack_);
-    upvalue_manager_.swap(other.upvalue_manager_);
+    Size source_top = source.GetTop();
+    if (count > source_top) {
+        throw CoroutineError("Not enough values on stack to transfer: " + std::to_string(count));
+    }
     
-    // 交换数据
-    arguments_.swap(other.arguments_);
-    return_values_.swap(other.return_values_);
-    yield_values_.swap(other.yield_values_);
+    // 先扩展目标栈，再取两边的存储地址（扩展可能使指针失效）
+    Size target_top = target.GetTop();
+    target.EnsureSpace(count);
+    target.SetTop(target_top + count);
     
-    // 交换统计信息
-    std::swap(stats_, other.stats_);
+    LuaValue* values = source.GetData() + (source_top - count);
+    std::move(values, values + count, target.GetData() + target_top);
+    source.SetTop(source_top - count);
 }
 
-/* ====================================================================== */
-/* 协程参数和返回值 */
-/* ====================================================================== */
-
 void CoroutineContext::SetArguments(const std::vector<LuaValue>& args) {
-    arguments_ = args;
-    
     // 将参数压入Lua栈
+    lua_stack_->EnsureSpace(args.size());
     for (const auto& arg : args) {
         lua_stack_->Push(arg);
     }
+    transfer_count_ = args.size();
 }
 
-void CoroutineContext::SetReturnValues(const std::vector<LuaValue>& values) {
-    return_values_ = values;
-}
-
-void CoroutineContext::SetYieldValues(const std::vector<LuaValue>& values) {
-    yield_values_ = values;
+void CoroutineContext::Reset() {
+    // 先闭合Upvalue（需要读取栈上的值），再清空栈和调用帧，容量都保留
+    upvalue_manager_->Clear();
+    lua_stack_->Clear();
+    call_stack_->Clear();
+    thread_.Reset();
+    
+    state_ = CoroutineState::SUSPENDED;
+    instruction_pointer_ = 0;
+    current_proto_ = nullptr;
+    id_ = 0;
+    resumer_ = nullptr;
+    transfer_count_ = 0;
+    
+    ResetStats();
 }
 
 /* ====================================================================== */
@@ -126,43 +102,19 @@ void CoroutineContext::SetYieldValues(const std::vector<LuaValue>& values) {
 void CoroutineContext::ResetStats() {
     stats_ = CoroutineStats{};
     stats_.created_time = std::chrono::steady_clock::now();
-    stats_.last_run_time = stats_.created_time;
 }
 
-void CoroutineContext::UpdateRunTimeStats(std::chrono::steady_clock::time_point run_start) {
-    auto run_end = std::chrono::steady_clock::now();
-    auto run_duration = std::chrono::duration<double>(run_end - run_start).count();
-    
-    stats_.total_run_time += run_duration;
-    stats_.avg_run_time = stats_.total_run_time / std::max(Size{1}, stats_.resume_count);
-    stats_.last_run_time = run_end;
-    
-    // 更新最大使用量统计
-    if (lua_stack_) {
-        stats_.max_stack_usage = std::max(stats_.max_stack_usage, lua_stack_->GetSize());
-    }
-    if (call_stack_) {
-        stats_.max_call_depth = std::max(stats_.max_call_depth, call_stack_->GetDepth());
-    }
+void CoroutineContext::UpdateUsageStats() {
+    stats_.max_stack_usage = std::max(stats_.max_stack_usage, lua_stack_->GetTop());
+    stats_.max_call_depth = std::max(stats_.max_call_depth, thread_.call_frames.GetCurrentIndex());
 }
 
 Size CoroutineContext::GetMemoryUsage() const {
     Size usage = sizeof(*this);
     
-    if (call_stack_) {
-        usage += call_stack_->GetMemoryUsage();
-    }
-    if (lua_stack_) {
-        usage += lua_stack_->GetMemoryUsage();
-    }
-    if (upvalue_manager_) {
-        usage += upvalue_manager_->GetMemoryUsage();
-    }
-    
-    // 添加向量的内存使用
-    usage += arguments_.capacity() * sizeof(LuaValue);
-    usage += return_values_.capacity() * sizeof(LuaValue);
-    usage += yield_values_.capacity() * sizeof(LuaValue);
+    usage += lua_stack_->GetCapacity() * sizeof(LuaValue);
+    usage += sizeof(AdvancedCallStackManager);
+    usage += upvalue_manager_->GetMemoryUsage();
     
     return usage;
 }
@@ -173,13 +125,11 @@ std::string CoroutineContext::GetDebugInfo() const {
     oss << "  State: " << CoroutineStateToString(state_) << "\n";
     oss << "  Instruction Pointer: " << instruction_pointer_ << "\n";
     oss << "  Current Proto: " << (current_proto_ ? "Valid" : "Null") << "\n";
-    oss << "  Arguments: " << arguments_.size() << "\n";
-    oss << "  Return Values: " << return_values_.size() << "\n";
-    oss << "  Yield Values: " << yield_values_.size() << "\n";
+    oss << "  Stack: " << lua_stack_->GetTop() << "/" << lua_stack_->GetCapacity() << "\n";
+    oss << "  Last Transfer: " << transfer_count_ << "\n";
     oss << "  Resume Count: " << stats_.resume_count << "\n";
     oss << "  Yield Count: " << stats_.yield_count << "\n";
-    oss << "  Total Run Time: " << std::fixed << std::setprecision(6) << stats_.total_run_time << "s\n";
-    oss << "  Average Run Time: " << std::fixed << std::setprecision(6) << stats_.avg_run_time << "s\n";
+    oss << "  Switch Count: " << stats_.switch_count << "\n";
     oss << "  Max Stack Usage: " << stats_.max_stack_usage << "\n";
     oss << "  Max Call Depth: " << stats_.max_call_depth << "\n";
     oss << "  Memory Usage: " << GetMemoryUsage() << " bytes\n";
@@ -198,13 +148,13 @@ bool CoroutineContext::ValidateIntegrity() const {
         return false;
     }
     
-    if (!call_stack_->ValidateIntegrity() || 
-        !upvalue_manager_->ValidateIntegrity()) {
+    if (!call_stack_->ValidateIntegrityAdvanced().is_valid || 
+        !upvalue_manager_->ValidateIntegrity().is_valid) {
         return false;
     }
     
-    // 检查统计信息合理性
-    if (stats_.resume_count < 0 || stats_.yield_count < 0) {
+    // 只有正在运行或处于正常状态的协程才有恢复者
+    if (resumer_ && state_ == CoroutineState::SUSPENDED) {
         return false;
     }
     
@@ -215,14 +165,20 @@ bool CoroutineContext::ValidateIntegrity() const {
 /* CoroutineScheduler 实现 */
 /* ========================================================================== */
 
-CoroutineScheduler::CoroutineScheduler()
-    : next_coroutine_id_(1)
+CoroutineScheduler::CoroutineScheduler(MemoryManager& manager)
+    : memory_manager_(manager)
+    , next_coroutine_id_(1)
     , current_coroutine_id_(0)  // 0表示主线程
+    , current_context_(nullptr)
+    , max_pooled_contexts_(VM_COROUTINE_POOL_DEFAULT_SIZE)
+    , max_pooled_stack_size_(VM_COROUTINE_POOL_MAX_STACK_SIZE)
     , scheduling_policy_(SchedulingPolicy::COOPERATIVE) {
     
     // 创建主线程上下文
-    main_thread_context_ = std::make_unique<CoroutineContext>();
+    main_thread_context_ = std::make_unique<CoroutineContext>(
+        VM_DEFAULT_STACK_SIZE, VM_COROUTINE_DEFAULT_CALL_DEPTH, memory_manager_);
     main_thread_context_->SetState(CoroutineState::RUNNING);
+    current_context_ = main_thread_context_.get();
     
     // 初始化统计信息
     ResetStats();
@@ -241,8 +197,9 @@ CoroutineScheduler::CoroutineId CoroutineScheduler::CreateCoroutine(
     
     auto id = GenerateCoroutineId();
     
-    // 创建协程上下文
-    auto context = std::make_shared<CoroutineContext>();
+    // 取出协程上下文（优先复用空闲链表，否则小栈起步新建）
+    auto context = AcquireContext();
+    context->id_ = id;
     context->SetState(CoroutineState::SUSPENDED);
     context->SetCurrentProto(proto);
     context->SetArguments(args);
@@ -280,8 +237,10 @@ void CoroutineScheduler::DestroyCoroutine(CoroutineId id) {
         SwitchToMainThread();
     }
     
-    // 移除协程
+    // 移除协程，上下文回收到空闲链表
+    auto context = std::move(it->second.context);
     coroutines_.erase(it);
+    RecycleContext(std::move(context));
     
     // 更新统计信息
     stats_.total_coroutines_destroyed++;
@@ -316,71 +275,63 @@ bool CoroutineScheduler::CoroutineExists(CoroutineId id) const {
 /* 协程调度 */
 /* ====================================================================== */
 
-std::vector<LuaValue> CoroutineScheduler::ResumeCoroutine(
-    CoroutineId id, const std::vector<LuaValue>& args) {
-    
-    auto coroutine = GetCoroutine(id);
-    if (!coroutine) {
+Size CoroutineScheduler::Resume(CoroutineId id, Size nargs) {
+    CoroutineContext* target = FindContext(id);
+    if (!target || id == 0) {
         throw CoroutineError("Coroutine does not exist");
     }
     
-    if (!coroutine->CanResume()) {
+    if (!target->CanResume()) {
         throw CoroutineStateError("Coroutine cannot be resumed in current state: " + 
-                                 CoroutineStateToString(coroutine->GetState()));
+                                 CoroutineStateToString(target->GetState()));
     }
     
-    // 记录恢复开始时间
-    auto resume_start = std::chrono::steady_clock::now();
+    if (!executor_) {
+        throw CoroutineError("No coroutine executor installed");
+    }
     
-    // 保存当前上下文
-    auto old_current_id = current_coroutine_id_;
+    CoroutineContext* caller = current_context_;
     
+    // 参数直接从恢复者栈顶移到协程栈顶，然后切换活动上下文
+    CoroutineContext::XMove(*caller, *target, nargs);
+    target->transfer_count_ = nargs;
+    target->resumer_ = caller;
+    target->stats_.resume_count++;
+    stats_.total_resumes++;
+    PerformContextSwitch(caller, target);
+    
+    Size nresults;
     try {
-        // 切换到目标协程
-        SwitchToCoroutine(id);
-        
-        // 设置resume参数
-        coroutine->SetArguments(args);
-        coroutine->SetState(CoroutineState::RUNNING);
-        
-        // 更新统计信息
-        coroutine->stats_.resume_count++;
-        stats_.total_resumes++;
-        
-        // 这里应该执行协程的字节码
-        // 实际实现中需要调用VM的执行器
-        // 暂时返回空值作为占位
-        std::vector<LuaValue> result;
-        
-        // 模拟执行完成或yield
-        if (coroutine->GetState() == CoroutineState::RUNNING) {
-            // 如果还在运行状态，说明协程执行完毕
-            coroutine->SetState(CoroutineState::DEAD);
-            result = coroutine->GetReturnValues();
-        } else {
-            // 协程被yield了
-            result = coroutine->GetYieldValues();
-        }
-        
-        // 更新运行时统计
-        coroutine->UpdateRunTimeStats(resume_start);
-        
-        return result;
-        
+        nresults = executor_(*target);
     } catch (...) {
-        // 恢复原来的上下文
-        current_coroutine_id_ = old_current_id;
-        if (auto current = GetCurrentCoroutine()) {
-            current->SetState(CoroutineState::RUNNING);
-        }
+        // 协程内的错误使其死亡，控制权回到恢复者
+        target->SetState(CoroutineState::DEAD);
+        target->resumer_ = nullptr;
+        PerformContextSwitch(target, caller);
         throw;
     }
+    
+    if (target->IsRunning()) {
+        // 执行器返回而没有yield：函数体结束
+        target->SetState(CoroutineState::DEAD);
+        target->transfer_count_ = nresults;
+    }
+    
+    // yield值或返回值移回恢复者栈顶
+    nresults = target->transfer_count_;
+    CoroutineContext::XMove(*target, *caller, nresults);
+    caller->transfer_count_ = nresults;
+    target->resumer_ = nullptr;
+    target->UpdateUsageStats();
+    PerformContextSwitch(target, caller);
+    
+    return nresults;
 }
 
-std::vector<LuaValue> CoroutineScheduler::YieldCoroutine(const std::vector<LuaValue>& yield_values) {
-    auto coroutine = GetCurrentCoroutine();
-    if (!coroutine) {
-        throw CoroutineError("No current coroutine to yield");
+void CoroutineScheduler::Yield(Size nresults) {
+    CoroutineContext* coroutine = current_context_;
+    if (coroutine == main_thread_context_.get()) {
+        throw CoroutineError("Attempt to yield from outside a coroutine");
     }
     
     if (!coroutine->CanYield()) {
@@ -388,26 +339,46 @@ std::vector<LuaValue> CoroutineScheduler::YieldCoroutine(const std::vector<LuaVa
                                  CoroutineStateToString(coroutine->GetState()));
     }
     
-    // 设置yield值
-    coroutine->SetYieldValues(yield_values);
-    coroutine->SetState(CoroutineState::SUSPENDED);
+    if (nresults > coroutine->GetLuaStack().GetTop()) {
+        throw CoroutineError("Not enough values on stack to yield: " + std::to_string(nresults));
+    }
     
-    // 更新统计信息
+    // 值留在协程栈顶，由Resume在执行器返回后移走
+    coroutine->SetState(CoroutineState::SUSPENDED);
+    coroutine->transfer_count_ = nresults;
     coroutine->stats_.yield_count++;
     stats_.total_yields++;
+}
+
+std::vector<LuaValue> CoroutineScheduler::ResumeCoroutine(
+    CoroutineId id, const std::vector<LuaValue>& args) {
     
-    // 切换回主线程或选择下一个协程
-    if (scheduling_policy_ == SchedulingPolicy::COOPERATIVE) {
-        SwitchToMainThread();
-    } else {
-        auto next_id = SelectNextCoroutine();
-        if (next_id != current_coroutine_id_) {
-            SwitchToCoroutine(next_id);
-        }
+    LuaStack& stack = current_context_->GetLuaStack();
+    stack.EnsureSpace(args.size());
+    for (const auto& arg : args) {
+        stack.Push(arg);
+    }
+    
+    Size nresults = Resume(id, args.size());
+    
+    // Resume返回时活动上下文已回到调用者
+    Size top = stack.GetTop();
+    LuaValue* values = stack.GetData() + (top - nresults);
+    std::vector<LuaValue> result(std::make_move_iterator(values),
+                                 std::make_move_iterator(values + nresults));
+    stack.SetTop(top - nresults);
+    
+    return result;
+}
+
+void CoroutineScheduler::YieldCoroutine(const std::vector<LuaValue>& yield_values) {
+    LuaStack& stack = current_context_->GetLuaStack();
+    stack.EnsureSpace(yield_values.size());
+    for (const auto& value : yield_values) {
+        stack.Push(value);
     }
     
-    // 返回resume时传入的参数
-    return coroutine->GetArguments();
+    Yield(yield_values.size());
 }
 
 void CoroutineScheduler::SwitchToCoroutine(CoroutineId id) {
@@ -415,21 +386,61 @@ void CoroutineScheduler::SwitchToCoroutine(CoroutineId id) {
         return;  // 已经是当前协程
     }
     
-    auto target = GetCoroutine(id);
+    CoroutineContext* target = FindContext(id);
     if (!target) {
         throw CoroutineError("Target coroutine does not exist");
     }
     
     // 执行上下文切换
-    PerformContextSwitch(current_coroutine_id_, id);
-    
-    current_coroutine_id_ = id;
+    PerformContextSwitch(current_context_, target);
 }
 
 void CoroutineScheduler::SwitchToMainThread() {
     SwitchToCoroutine(0);
 }
 
+void CoroutineScheduler::Schedule(CoroutineId id) {
+    if (id == 0 || !CoroutineExists(id)) {
+        throw CoroutineError("Coroutine does not exist");
+    }
+    ready_queue_.push_back(id);
+}
+
+Size CoroutineScheduler::RunReadyCoroutines(Size max_resumes) {
+    if (current_context_ != main_thread_context_.get()) {
+        throw CoroutineError("Ready coroutines can only be run from the main thread");
+    }
+    
+    LuaStack& stack = current_context_->GetLuaStack();
+    Size resumed = 0;
+    
+    while (resumed < max_resumes && !ready_queue_.empty()) {
+        CoroutineId id = ready_queue_.front();
+        ready_queue_.pop_front();
+        
+        // 排队后被销毁或已被手动恢复到其他状态的协程直接跳过
+        auto it = coroutines_.find(id);
+        if (it == coroutines_.end() || !it->second.context->CanResume()) {
+            continue;
+        }
+        
+        CoroutineContext* context = it->second.context.get();
+        it->second.total_run_count++;
+        
+        Size nresults = Resume(id, 0);
+        stack.SetTop(stack.GetTop() - nresults);
+        resumed++;
+        
+        if (context->CanResume()) {
+            ready_queue_.push_back(id);
+        } else if (context->IsDead()) {
+            DestroyCoroutine(id);
+        }
+    }
+    
+    return resumed;
+}
+
 /* ====================================================================== */
 /* 调度策略 */
 /* ====================================================================== */
@@ -484,7 +495,9 @@ Size CoroutineScheduler::CleanupDeadCoroutines() {
     auto it = coroutines_.begin();
     while (it != coroutines_.end()) {
         if (it->second.context->IsDead()) {
+            auto context = std::move(it->second.context);
             it = coroutines_.erase(it);
+            RecycleContext(std::move(context));
             cleaned++;
         } else {
             ++it;
@@ -512,14 +525,104 @@ void CoroutineScheduler::DestroyAllCoroutines() {
     // 销毁所有协程
     for (auto& pair : coroutines_) {
         pair.second.context->SetState(CoroutineState::DEAD);
+        RecycleContext(std::move(pair.second.context));
     }
     
     coroutines_.clear();
+    ready_queue_.clear();
     
     // 更新统计信息
     stats_.current_coroutine_count = 0;
 }
 
+/* ====================================================================== */
+/* 上下文池 */
+/* ====================================================================== */
+
+void CoroutineScheduler::SetContextPoolLimits(Size max_pooled_contexts, Size max_pooled_stack_size) {
+    max_pooled_contexts_ = max_pooled_contexts;
+    max_pooled_stack_size_ = max_pooled_stack_size;
+    
+    // 空闲链表中超过新高水位的上下文也一并释放
+    Size kept = 0;
+    for (auto& context : context_pool_) {
+        if (context->GetLuaStack().GetCapacity() <= max_pooled_stack_size_) {
+            context_pool_[kept++] = std::move(context);
+        }
+    }
+    stats_.context_pool_trimmed += context_pool_.size() - kept;
+    context_pool_.resize(kept);
+    
+    TrimContextPool(max_pooled_contexts_);
+}
+
+Size CoroutineScheduler::TrimContextPool(Size keep) {
+    if (context_pool_.size() <= keep) {
+        return 0;
+    }
+    
+    Size trimmed = context_pool_.size() - keep;
+    context_pool_.resize(keep);
+    stats_.context_pool_trimmed += trimmed;
+    return trimmed;
+}
+
+void CoroutineScheduler::MarkRoots(GCMarker& marker) const {
+    auto mark_context = [&marker](const CoroutineContext& context) {
+        // 运行中的协程与VM交换了线程状态，此时thread_里是被换出的一方
+        const VMThreadState& thread = context.thread_;
+        if (thread.stack) {
+            VirtualMachine::MarkStack(marker, *thread.stack);
+        }
+        VirtualMachine::MarkFrames(marker, thread.call_frames);
+        
+        // 尚未开始执行的协程只在这里引用自己的原型
+        if (context.current_proto_) {
+            MarkProtoConstants(marker, *context.current_proto_);
+        }
+    };
+    
+    if (main_thread_context_) {
+        mark_context(*main_thread_context_);
+    }
+    for (const auto& entry : coroutines_) {
+        mark_context(*entry.second.context);
+    }
+    // 空闲上下文的栈保留旧值，复用时会重新成为根
+    for (const auto& context : context_pool_) {
+        mark_context(*context);
+    }
+}
+
+std::shared_ptr<CoroutineContext> CoroutineScheduler::AcquireContext() {
+    if (!context_pool_.empty()) {
+        auto context = std::move(context_pool_.back());
+        context_pool_.pop_back();
+        stats_.context_pool_hits++;
+        return context;
+    }
+    
+    stats_.context_pool_misses++;
+    return std::make_shared<CoroutineContext>(
+        VM_COROUTINE_INITIAL_STACK_SIZE, VM_COROUTINE_DEFAULT_CALL_DEPTH, memory_manager_);
+}
+
+void CoroutineScheduler::RecycleContext(std::shared_ptr<CoroutineContext> context) {
+    // GetCoroutine()交出的引用仍在外部时不能复用
+    if (!context || context.use_count() != 1) {
+        return;
+    }
+    
+    if (context_pool_.size() >= max_pooled_contexts_ ||
+        context->GetLuaStack().GetCapacity() > max_pooled_stack_size_) {
+        stats_.context_pool_trimmed++;
+        return;
+    }
+    
+    context->Reset();
+    context_pool_.push_back(std::move(context));
+}
+
 /* ====================================================================== */
 /* 统计和监控 */
 /* ====================================================================== */
@@ -541,6 +644,10 @@ void CoroutineScheduler::UpdateStats() {
         stats_.memory_usage += sizeof(CoroutineEntry);
         stats_.memory_usage += pair.second.context->GetMemoryUsage();
     }
+    
+    for (const auto& context : context_pool_) {
+        stats_.memory_usage += context->GetMemoryUsage();
+    }
 }
 
 std::string CoroutineScheduler::GetStatusReport() const {
@@ -554,10 +661,11 @@ std::string CoroutineScheduler::GetStatusReport() const {
     oss << "  Total Context Switches: " << stats_.total_context_switches << "\n";
     oss << "  Total Resumes: " << stats_.total_resumes << "\n";
     oss << "  Total Yields: " << stats_.total_yields << "\n";
-    oss << "  Average Switch Time: " << std::fixed << std::setprecision(3) 
-        << stats_.avg_switch_time << " μs\n";
     oss << "  Max Concurrent Coroutines: " << stats_.max_concurrent_coroutines << "\n";
     oss << "  Memory Usage: " << stats_.memory_usage << " bytes\n";
+    oss << "  Context Pool: " << context_pool_.size() << "/" << max_pooled_contexts_
+        << " (hit rate " << std::fixed << std::setprecision(1)
+        << stats_.GetContextPoolHitRate() * 100.0 << "%)\n";
     oss << "  Scheduling Policy: ";
     
     switch (scheduling_policy_) {
@@ -570,6 +678,9 @@ std::string CoroutineScheduler::GetStatusReport() const {
         case SchedulingPolicy::PRIORITY:
             oss << "Priority";
             break;
+        case SchedulingPolicy::WORK_STEALING:
+            oss << "Work Stealing";
+            break;
     }
     oss << "\n";
     
@@ -666,31 +777,30 @@ CoroutineScheduler::CoroutineId CoroutineScheduler::GenerateCoroutineId() {
     return next_coroutine_id_++;
 }
 
-void CoroutineScheduler::PerformContextSwitch(CoroutineId from_id, CoroutineId to_id) {
-    auto switch_start = std::chrono::steady_clock::now();
-    
-    auto from_context = GetCoroutine(from_id);
-    auto to_context = GetCoroutine(to_id);
-    
-    if (!from_context || !to_context) {
-        throw CoroutineError("Invalid context in switch operation");
-    }
-    
+void CoroutineScheduler::PerformContextSwitch(CoroutineContext* from, CoroutineContext* to) {
     // 保存当前协程状态
-    if (from_context->GetState() == CoroutineState::RUNNING) {
-        from_context->SetState(CoroutineState::NORMAL);
+    if (from->GetState() == CoroutineState::RUNNING) {
+        from->SetState(CoroutineState::NORMAL);
     }
     
-    // 激活目标协程
-    to_context->SetState(CoroutineState::RUNNING);
-    
-    // 实际的上下文切换逻辑在这里
-    // 这里应该涉及CPU寄存器、栈指针等的保存和恢复
-    // 简化实现中我们跳过这些底层细节
+    // 激活目标协程：各自的栈和调用帧都留在原处，切换只改写活动指针；
+    // VM上的栈和帧由执行器在运行期间换入（见CoroutineSupport::ExecuteCoroutine）
+    to->SetState(CoroutineState::RUNNING);
+    current_context_ = to;
+    current_coroutine_id_ = to->id_;
     
     // 更新统计信息
+    to->stats_.switch_count++;
     stats_.total_context_switches++;
-    UpdateSwitchTimeStats(switch_start);
+}
+
+CoroutineContext* CoroutineScheduler::FindContext(CoroutineId id) const {
+    if (id == 0) {
+        return main_thread_context_.get();
+    }
+    
+    auto it = coroutines_.find(id);
+    return it != coroutines_.end() ? it->second.context.get() : nullptr;
 }
 
 CoroutineScheduler::CoroutineId CoroutineScheduler::SelectNextCoroutine() const {
@@ -702,14 +812,10 @@ CoroutineScheduler::CoroutineId CoroutineScheduler::SelectNextCoroutine() const
         case SchedulingPolicy::COOPERATIVE:
             return 0;  // 协作式调度总是返回主线程
             
-        case SchedulingPolicy::PREEMPTIVE: {
-            // 简单的轮转调度
-            auto it = coroutines_.upper_bound(current_coroutine_id_);
-            if (it == coroutines_.end()) {
-                it = coroutines_.begin();
-            }
-            return it->first;
-        }
+        case SchedulingPolicy::PREEMPTIVE:
+        case SchedulingPolicy::WORK_STEALING:
+            // 轮转调度：就绪队列队首
+            return ready_queue_.empty() ? 0 : ready_queue_.front();
         
         case SchedulingPolicy::PRIORITY: {
             // 优先级调度：选择优先级最高的可运行协程
@@ -732,25 +838,13 @@ CoroutineScheduler::CoroutineId CoroutineScheduler::SelectNextCoroutine() const
     }
 }
 
-void CoroutineScheduler::UpdateSwitchTimeStats(std::chrono::steady_clock::time_point switch_start) {
-    auto switch_end = std::chrono::steady_clock::now();
-    auto switch_time_us = std::chrono::duration<double, std::micro>(switch_end - switch_start).count();
-    
-    // 更新平均切换时间
-    if (stats_.total_context_switches > 0) {
-        stats_.avg_switch_time = (stats_.avg_switch_time * (stats_.total_context_switches - 1) + switch_time_us) 
-                               / stats_.total_context_switches;
-    } else {
-        stats_.avg_switch_time = switch_time_us;
-    }
-}
-
 /* ========================================================================== */
 /* CoroutineSupport 实现 */
 /* ========================================================================== */
 
 CoroutineSupport::CoroutineSupport(VirtualMachine* vm)
     : vm_(vm)
+    , scheduler_(vm ? vm->GetMemoryManager() : GetCurrentMemoryManager())
     , next_coroutine_handle_(1) {
     
     if (!vm_) {
@@ -759,6 +853,18 @@ CoroutineSupport::CoroutineSupport(VirtualMachine* vm)
     
     // 设置默认配置
     config_ = CoroutineConfig{};
+    
+    scheduler_.SetExecutor([this](CoroutineContext& context) {
+        return ExecuteCoroutine(context);
+    });
+    
+    root_marker_id_ = vm_->AddRootMarker([this](GCMarker& marker) {
+        scheduler_.MarkRoots(marker);
+    });
+}
+
+CoroutineSupport::~CoroutineSupport() {
+    vm_->RemoveRootMarker(root_marker_id_);
 }
 
 /* ====================================================================== */
@@ -767,15 +873,11 @@ CoroutineSupport::CoroutineSupport(VirtualMachine* vm)
 
 LuaValue CoroutineSupport::CreateCoroutine(const LuaValue& func, const std::vector<LuaValue>& args) {
     // 验证函数参数
-    if (func.GetType() != LuaValueType::Function) {
+    if (!func.IsFunction()) {
         throw CoroutineError("Coroutine function must be a function value");
     }
     
-    // 获取函数原型（这里需要根据实际的LuaValue实现）
-    // 假设LuaValue有GetProto方法
-    // const Proto* proto = func.GetProto();
-    const Proto* proto = nullptr;  // 占位实现
-    
+    const Proto* proto = func.GetFunctionProto();
     if (!proto) {
         throw CoroutineError("Cannot extract proto from function value");
     }
@@ -800,8 +902,36 @@ std::vector<LuaValue> CoroutineSupport::Resume(const LuaValue& coroutine, const
     return scheduler_.ResumeCoroutine(coroutine_id, args);
 }
 
-std::vector<LuaValue> CoroutineSupport::Yield(const std::vector<LuaValue>& yield_values) {
-    return scheduler_.YieldCoroutine(yield_values);
+void CoroutineSupport::Yield(const std::vector<LuaValue>& yield_values) {
+    scheduler_.YieldCoroutine(yield_values);
+}
+
+Size CoroutineSupport::ExecuteCoroutine(CoroutineContext& context) {
+    VMThreadState& thread = context.GetThreadState();
+    vm_->SwapThread(thread);
+    
+    Size nresults;
+    bool yielded;
+    try {
+        nresults = vm_->ResumeThread(context.GetCurrentProto(), context.GetTransferCount());
+        yielded = YieldIfPreempted();
+    } catch (...) {
+        vm_->SwapThread(thread);
+        throw;
+    }
+    
+    // 返回值留在协程栈上，由调度器移给恢复者
+    vm_->SwapThread(thread);
+    return yielded ? 0 : nresults;
+}
+
+bool CoroutineSupport::YieldIfPreempted() {
+    if (!vm_->WasPreempted() || !IsInCoroutine()) {
+        return false;
+    }
+    
+    scheduler_.Yield(0);
+    return true;
 }
 
 std::string CoroutineSupport::GetCoroutineStatus(const LuaValue& coroutine) {
@@ -826,7 +956,7 @@ bool CoroutineSupport::IsInCoroutine() const {
 LuaValue CoroutineSupport::GetRunningCoroutine() const {
     auto current_id = scheduler_.GetCurrentCoroutineId();
     if (current_id == 0) {
-        return LuaValue::Nil();  // 主线程返回nil
+        return LuaValue();  // 主线程返回nil
     }
     
     // 查找对应的句柄
@@ -836,7 +966,7 @@ LuaValue CoroutineSupport::GetRunningCoroutine() const {
         }
     }
     
-    return LuaValue::Nil();
+    return LuaValue();
 }
 
 /* ====================================================================== */
@@ -845,6 +975,18 @@ LuaValue CoroutineSupport::GetRunningCoroutine() const {
 
 void CoroutineSupport::SetSchedulingPolicy(CoroutineScheduler::SchedulingPolicy policy) {
     scheduler_.SetSchedulingPolicy(policy);
+    ApplyPreemptBudget();
+}
+
+void CoroutineSupport::SetConfig(const CoroutineConfig& config) {
+    config_ = config;
+    ApplyPreemptBudget();
+}
+
+void CoroutineSupport::ApplyPreemptBudget() {
+    bool preemptive = config_.enable_preemption ||
+        scheduler_.GetSchedulingPolicy() == CoroutineScheduler::SchedulingPolicy::PREEMPTIVE;
+    vm_->SetPreemptBudget(preemptive ? config_.preempt_budget : 0);
 }
 
 void CoroutineSupport::Cleanup() {
@@ -867,7 +1009,7 @@ std::string CoroutineSupport::GetStatisticsReport() const {
     oss << "  Default Stack Size: " << config_.default_stack_size << "\n";
     oss << "  Default Call Depth: " << config_.default_call_depth << "\n";
     oss << "  Enable Preemption: " << (config_.enable_preemption ? "Yes" : "No") << "\n";
-    oss << "  Time Slice: " << config_.time_slice_ms << " ms\n";
+    oss << "  Preempt Budget: " << config_.preempt_budget << " back-edges/calls\n";
     oss << "  Enable Priority Scheduling: " << (config_.enable_priority_scheduling ? "Yes" : "No") << "\n";
     oss << "  Enable Statistics: " << (config_.enable_statistics ? "Yes" : "No") << "\n";
     oss << "  Enable GC Integration: " << (config_.enable_gc_integration ? "Yes" : "No") << "\n";
@@ -882,12 +1024,12 @@ std::string CoroutineSupport::GetStatisticsReport() const {
 LuaValue CoroutineSupport::CoroutineIdToLuaValue(CoroutineScheduler::CoroutineId id) const {
     // 这里需要创建特殊的协程LuaValue
     // 简化实现中返回数字类型
-    return LuaValue::Number(static_cast<double>(id));
+    return LuaValue(static_cast<double>(id));
 }
 
 CoroutineScheduler::CoroutineId CoroutineSupport::LuaValueToCoroutineId(const LuaValue& value) const {
     // 从LuaValue中提取协程ID
-    if (value.GetType() == LuaValueType::Number) {
+    if (value.IsNumber()) {
         auto handle = static_cast<Size>(value.GetNumber());
         auto it = coroutine_map_.find(handle);
         if (it != coroutine_map_.end()) {
@@ -930,7 +1072,7 @@ std::unique_ptr<CoroutineSupport> CreateHighPerformanceCoroutineSupport(VirtualM
     config.default_stack_size = 512;
     config.default_call_depth = 200;
     config.enable_preemption = true;
-    config.time_slice_ms = 5;
+    config.preempt_budget = 5000;
     config.enable_priority_scheduling = true;
     config.enable_statistics = false;  // 关闭统计以提高性能
     config.enable_gc_integration = true;
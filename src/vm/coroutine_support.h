@@ -3,12 +3,14 @@
 #include "call_stack_advanced.h"
 #include "upvalue_manager.h"
 #include "stack.h"
+#include "virtual_machine.h"
 #include "core/lua_common.h"
 #include "types/value.h"
 #include "core/lua_errors.h"
 #include <memory>
 #include <vector>
 #include <unordered_map>
+#include <deque>
 #include <functional>
 
 namespace lua_cpp {
@@ -17,7 +19,6 @@ namespace lua_cpp {
 /* 前向声明 */
 /* ========================================================================== */
 
-class VirtualMachine;
 class Proto;
 
 /* ========================================================================== */
@@ -74,15 +75,33 @@ std::string CoroutineStateToString(CoroutineState state);
 /* 协程上下文 */
 /* ========================================================================== */
 
+/**
+ * @brief 协程默认初始栈大小（同Lua的BASIC_STACK_SIZE），栈按需增长
+ */
+constexpr Size VM_COROUTINE_INITIAL_STACK_SIZE = 2 * VM_MIN_STACK_SIZE;
+
+/**
+ * @brief 协程默认最大调用深度
+ */
+constexpr Size VM_COROUTINE_DEFAULT_CALL_DEPTH = 200;
+
+/**
+ * @brief 调度器空闲上下文池默认容量
+ */
+constexpr Size VM_COROUTINE_POOL_DEFAULT_SIZE = 64;
+
+/**
+ * @brief 回收上下文的栈容量高水位，超过此值的上下文直接释放而不入池
+ */
+constexpr Size VM_COROUTINE_POOL_MAX_STACK_SIZE = 16 * VM_COROUTINE_INITIAL_STACK_SIZE;
+
 /**
  * @brief 协程执行上下文
  * 
- * 保存协程的完整执行状态，包括：
- * - 调用栈
- * - Lua值栈
- * - Upvalue管理器
- * - 执行状态
- * - 调试信息
+ * 每个协程独占一个从小容量开始、按需增长的LuaStack，以及自己的调用栈和
+ * Upvalue管理器。resume/yield时参数和结果通过XMove在两个栈之间直接移动
+ * （同lua_xmove）。在VM上运行时，协程的栈指针和调用帧保存在线程状态中，
+ * 由VirtualMachine::SwapThread换入VM，让出时再换回，不复制栈上的值。
  */
 class CoroutineContext {
 public:
@@ -90,19 +109,22 @@ public:
      * @brief 构造函数
      * @param initial_stack_size 初始栈大小
      * @param max_call_depth 最大调用深度
+     * @param manager 分配协程栈的内存管理器
      */
-    CoroutineContext(Size initial_stack_size = 256, Size max_call_depth = 200);
+    CoroutineContext(Size initial_stack_size = VM_COROUTINE_INITIAL_STACK_SIZE,
+                     Size max_call_depth = VM_COROUTINE_DEFAULT_CALL_DEPTH,
+                     MemoryManager& manager = GetCurrentMemoryManager());
     
     /**
      * @brief 析构函数
      */
     ~CoroutineContext() = default;
     
-    // 禁用拷贝，允许移动
+    // 禁用拷贝和移动（调度器和恢复链通过地址引用上下文）
     CoroutineContext(const CoroutineContext&) = delete;
     CoroutineContext& operator=(const CoroutineContext&) = delete;
-    CoroutineContext(CoroutineContext&&) = default;
-    CoroutineContext& operator=(CoroutineContext&&) = default;
+    CoroutineContext(CoroutineContext&&) = delete;
+    CoroutineContext& operator=(CoroutineContext&&) = delete;
     
     /* ====================================================================== */
     /* 状态管理 */
@@ -145,8 +167,8 @@ public:
     /**
      * @brief 获取调用栈
      */
-    AdvancedCallStack& GetCallStack() { return *call_stack_; }
-    const AdvancedCallStack& GetCallStack() const { return *call_stack_; }
+    AdvancedCallStackManager& GetCallStack() { return *call_stack_; }
+    const AdvancedCallStackManager& GetCallStack() const { return *call_stack_; }
     
     /**
      * @brief 获取Lua栈
@@ -154,6 +176,14 @@ public:
     LuaStack& GetLuaStack() { return *lua_stack_; }
     const LuaStack& GetLuaStack() const { return *lua_stack_; }
     
+    /**
+     * @brief 获取VM线程状态（栈指针、调用帧和执行状态）
+     * 
+     * 协程在VM上运行期间，这里保存的是被换出的恢复者的状态。
+     */
+    VMThreadState& GetThreadState() { return thread_; }
+    const VMThreadState& GetThreadState() const { return thread_; }
+    
     /**
      * @brief 获取Upvalue管理器
      */
@@ -180,64 +210,44 @@ public:
      */
     void SetCurrentProto(const Proto* proto) { current_proto_ = proto; }
     
-    /* ====================================================================== */
-    /* 上下文保存和恢复 */
-    /* ====================================================================== */
-    
     /**
-     * @brief 保存上下文到另一个上下文对象
-     * @param target 目标上下文
+     * @brief 获取恢复本协程的上下文（未运行时为nullptr）
      */
-    void SaveContextTo(CoroutineContext& target) const;
-    
-    /**
-     * @brief 从另一个上下文恢复
-     * @param source 源上下文
-     */
-    void RestoreContextFrom(const CoroutineContext& source);
-    
-    /**
-     * @brief 交换上下文
-     * @param other 另一个上下文
-     */
-    void SwapContext(CoroutineContext& other);
+    CoroutineContext* GetResumer() const { return resumer_; }
     
     /* ====================================================================== */
-    /* 协程参数和返回值 */
+    /* 值传递 */
     /* ====================================================================== */
     
     /**
-     * @brief 设置协程参数
-     * @param args 参数列表
+     * @brief 把from栈顶的count个值按原顺序移动到to的栈顶（同lua_xmove）
+     * @param from 源上下文
+     * @param to 目标上下文，栈空间不足时自动增长
+     * @param count 移动的值数量
+     * @throws CoroutineError 如果源栈中的值不足count个
      */
-    void SetArguments(const std::vector<LuaValue>& args);
+    static void XMove(CoroutineContext& from, CoroutineContext& to, Size count);
     
     /**
-     * @brief 获取协程参数
-     */
-    const std::vector<LuaValue>& GetArguments() const { return arguments_; }
-    
-    /**
-     * @brief 设置返回值
-     * @param values 返回值列表
-     */
-    void SetReturnValues(const std::vector<LuaValue>& values);
-    
-    /**
-     * @brief 获取返回值
+     * @brief 把参数压入协程栈
+     * @param args 参数列表
      */
-    const std::vector<LuaValue>& GetReturnValues() const { return return_values_; }
+    void SetArguments(const std::vector<LuaValue>& args);
     
     /**
-     * @brief 设置yield值
-     * @param values yield的值列表
+     * @brief 获取最近一次切换传入本栈顶部的值数量
+     * 
+     * 刚被resume时为resume参数个数；作为恢复者重新获得控制时为对方
+     * yield或返回的值个数。
      */
-    void SetYieldValues(const std::vector<LuaValue>& values);
+    Size GetTransferCount() const { return transfer_count_; }
     
     /**
-     * @brief 获取yield值
+     * @brief 重置为新建状态以便复用
+     * 
+     * 清空Lua栈、调用栈和Upvalue，但保留它们已分配的容量。
      */
-    const std::vector<LuaValue>& GetYieldValues() const { return yield_values_; }
+    void Reset();
     
     /* ====================================================================== */
     /* 统计和诊断 */
@@ -250,12 +260,9 @@ public:
         Size resume_count = 0;          // resume次数
         Size yield_count = 0;           // yield次数
         Size switch_count = 0;          // 切换次数
-        double total_run_time = 0.0;    // 总运行时间（秒）
-        double avg_run_time = 0.0;      // 平均运行时间（秒）
         Size max_stack_usage = 0;       // 最大栈使用
         Size max_call_depth = 0;        // 最大调用深度
         std::chrono::steady_clock::time_point created_time;  // 创建时间
-        std::chrono::steady_clock::time_point last_run_time; // 上次运行时间
     };
     
     /**
@@ -269,10 +276,9 @@ public:
     void ResetStats();
     
     /**
-     * @brief 更新运行时统计
-     * @param run_start 运行开始时间
+     * @brief 协程让出控制时更新栈和调用深度峰值
      */
-    void UpdateRunTimeStats(std::chrono::steady_clock::time_point run_start);
+    void UpdateUsageStats();
     
     /**
      * @brief 获取内存使用量
@@ -290,6 +296,8 @@ public:
     bool ValidateIntegrity() const;
 
 private:
+    friend class CoroutineScheduler;
+    
     /* ====================================================================== */
     /* 成员变量 */
     /* ====================================================================== */
@@ -298,18 +306,19 @@ private:
     CoroutineState state_;
     
     // 执行上下文
-    std::unique_ptr<AdvancedCallStack> call_stack_;
     std::unique_ptr<LuaStack> lua_stack_;
+    std::unique_ptr<AdvancedCallStackManager> call_stack_;
     std::unique_ptr<UpvalueManager> upvalue_manager_;
+    VMThreadState thread_;                  // 与VM交换的线程状态，指向lua_stack_
     
     // 执行状态
     Size instruction_pointer_;
     const Proto* current_proto_;
     
-    // 协程数据
-    std::vector<LuaValue> arguments_;       // 协程参数
-    std::vector<LuaValue> return_values_;   // 返回值
-    std::vector<LuaValue> yield_values_;    // yield值
+    // 切换状态
+    Size id_;                               // 调度器分配的协程ID（主线程为0）
+    CoroutineContext* resumer_;             // 恢复本协程的上下文
+    Size transfer_count_;                   // 最近一次传入的值数量
     
     // 统计信息
     CoroutineStats stats_;
@@ -324,13 +333,19 @@ private:
  * 
  * 管理协程的创建、切换、销毁和调度策略
  * 支持协作式调度和优先级调度
+ * 
+ * 执行模型同Lua 5.1的lua_resume：Resume把参数移到协程栈上并把活动
+ * 上下文指向该协程，然后调用执行器在协程自己的栈上运行；协程内的Yield
+ * 只记录让出的值数量并让执行器返回，Resume再把这些值移回恢复者的栈。
+ * 协程的Lua帧保存在它自己的栈和调用栈中，下次Resume从保存处继续。
  */
 class CoroutineScheduler {
 public:
     /**
      * @brief 构造函数
+     * @param manager 分配协程栈的内存管理器（CoroutineSupport传入所属VM的管理器）
      */
-    CoroutineScheduler();
+    explicit CoroutineScheduler(MemoryManager& manager = GetCurrentMemoryManager());
     
     /**
      * @brief 析构函数
@@ -349,6 +364,14 @@ public:
     
     using CoroutineId = Size;
     
+    /**
+     * @brief 协程执行器
+     * 
+     * 在协程上下文上运行字节码，直到协程调用Yield（此时应立即返回，
+     * 返回值被忽略）或函数体返回（返回值为留在栈顶的结果数量）。
+     */
+    using CoroutineExecutor = std::function<Size(CoroutineContext& context)>;
+    
     /**
      * @brief 创建新协程
      * @param proto 协程函数原型
@@ -389,6 +412,28 @@ public:
     /* 协程调度 */
     /* ====================================================================== */
     
+    /**
+     * @brief 设置协程执行器
+     */
+    void SetExecutor(CoroutineExecutor executor) { executor_ = std::move(executor); }
+    
+    /**
+     * @brief 恢复协程执行（栈式接口，同lua_resume）
+     * @param id 协程ID
+     * @param nargs 当前活动栈顶作为参数移入协程的值数量
+     * @return 协程yield或返回后移到当前活动栈顶的值数量
+     * @throws CoroutineError 协程不存在或未设置执行器
+     * @throws CoroutineStateError 协程不处于挂起状态
+     */
+    Size Resume(CoroutineId id, Size nargs);
+    
+    /**
+     * @brief 挂起当前协程（栈式接口，同lua_yield）
+     * @param nresults 协程栈顶作为yield值交给恢复者的值数量
+     * @note 只记录让出状态，调用方（执行器）随后必须返回
+     */
+    void Yield(Size nresults);
+    
     /**
      * @brief 恢复协程执行
      * @param id 协程ID
@@ -400,12 +445,17 @@ public:
     /**
      * @brief 挂起当前协程
      * @param yield_values yield的值
-     * @return 下次resume时传入的参数
+     * @note 下次resume的参数出现在协程栈顶，数量见GetTransferCount()
+     */
+    void YieldCoroutine(const std::vector<LuaValue>& yield_values = {});
+    
+    /**
+     * @brief 获取当前活动的执行上下文（VM在其栈上执行）
      */
-    std::vector<LuaValue> YieldCoroutine(const std::vector<LuaValue>& yield_values = {});
+    CoroutineContext& GetActiveContext() const { return *current_context_; }
     
     /**
-     * @brief 切换到指定协程
+     * @brief 切换到指定协程（只改变活动上下文，不传递值）
      * @param id 目标协程ID
      */
     void SwitchToCoroutine(CoroutineId id);
@@ -415,6 +465,29 @@ public:
      */
     void SwitchToMainThread();
     
+    /**
+     * @brief 将协程加入就绪队列，由RunReadyCoroutines驱动
+     * @param id 协程ID
+     * @throws CoroutineError 协程不存在
+     */
+    void Schedule(CoroutineId id);
+    
+    /**
+     * @brief 检查就绪队列是否非空
+     */
+    bool HasReadyCoroutines() const { return !ready_queue_.empty(); }
+    
+    /**
+     * @brief 从主线程按就绪队列顺序恢复协程（不带参数，结果丢弃）
+     * 
+     * yield后仍可恢复的协程重新排到队尾，运行结束的协程立即销毁并
+     * 回收上下文。
+     * @param max_resumes 本次最多执行的resume次数
+     * @return 实际执行的resume次数
+     * @throws CoroutineError 不在主线程上调用
+     */
+    Size RunReadyCoroutines(Size max_resumes);
+    
     /* ====================================================================== */
     /* 调度策略 */
     /* ====================================================================== */
@@ -425,7 +498,8 @@ public:
     enum class SchedulingPolicy {
         COOPERATIVE,    // 协作式调度（手动yield/resume）
         PREEMPTIVE,     // 抢占式调度（时间片轮转）
-        PRIORITY        // 优先级调度
+        PRIORITY,       // 优先级调度
+        WORK_STEALING   // 工作窃取（由WorkStealingScheduler在工作线程上驱动）
     };
     
     /**
@@ -480,6 +554,40 @@ public:
      */
     void DestroyAllCoroutines();
     
+    /* ====================================================================== */
+    /* 上下文池 */
+    /* ====================================================================== */
+    
+    /**
+     * @brief 设置上下文池参数
+     * @param max_pooled_contexts 空闲链表最多保留的上下文数量（0表示不复用）
+     * @param max_pooled_stack_size 栈容量高水位，超过的上下文销毁时直接释放
+     * @note 缩小容量时立即裁剪多余的空闲上下文
+     */
+    void SetContextPoolLimits(Size max_pooled_contexts,
+                              Size max_pooled_stack_size = VM_COROUTINE_POOL_MAX_STACK_SIZE);
+    
+    /**
+     * @brief 获取空闲链表中的上下文数量
+     */
+    Size GetPooledContextCount() const { return context_pool_.size(); }
+    
+    /**
+     * @brief 裁剪空闲链表
+     * @param keep 保留的上下文数量
+     * @return 释放的上下文数量
+     */
+    Size TrimContextPool(Size keep = 0);
+    
+    /* ====================================================================== */
+    /* GC根 */
+    /* ====================================================================== */
+    
+    /**
+     * @brief 标记各上下文（含主线程和空闲链表）的栈、调用帧和协程原型常量
+     */
+    void MarkRoots(GCMarker& marker) const;
+    
     /* ====================================================================== */
     /* 统计和监控 */
     /* ====================================================================== */
@@ -494,9 +602,19 @@ public:
         Size total_context_switches = 0;        // 总上下文切换次数
         Size total_resumes = 0;                 // 总resume次数
         Size total_yields = 0;                  // 总yield次数
-        double avg_switch_time = 0.0;           // 平均切换时间（微秒）
         Size max_concurrent_coroutines = 0;     // 最大并发协程数
         Size memory_usage = 0;                  // 内存使用量
+        Size context_pool_hits = 0;             // 从空闲链表复用的上下文数
+        Size context_pool_misses = 0;           // 新分配的上下文数
+        Size context_pool_trimmed = 0;          // 超过容量或高水位而释放的上下文数
+        
+        /**
+         * @brief 上下文池命中率
+         */
+        double GetContextPoolHitRate() const {
+            Size total = context_pool_hits + context_pool_misses;
+            return total > 0 ? static_cast<double>(context_pool_hits) / total : 0.0;
+        }
     };
     
     /**
@@ -568,27 +686,41 @@ private:
     CoroutineId GenerateCoroutineId();
     
     /**
-     * @brief 执行上下文切换
-     * @param from_id 源协程ID
-     * @param to_id 目标协程ID
+     * @brief 执行上下文切换：仅重新指向活动上下文并更新状态
+     * @param from 源上下文
+     * @param to 目标上下文
      */
-    void PerformContextSwitch(CoroutineId from_id, CoroutineId to_id);
+    void PerformContextSwitch(CoroutineContext* from, CoroutineContext* to);
     
     /**
-     * @brief 选择下一个要运行的协程
+     * @brief 按ID查找协程上下文（含主线程）
      */
-    CoroutineId SelectNextCoroutine() const;
+    CoroutineContext* FindContext(CoroutineId id) const;
     
     /**
-     * @brief 更新切换时间统计
-     * @param switch_start 切换开始时间
+     * @brief 取出一个空闲上下文，池为空时新建
      */
-    void UpdateSwitchTimeStats(std::chrono::steady_clock::time_point switch_start);
+    std::shared_ptr<CoroutineContext> AcquireContext();
+    
+    /**
+     * @brief 回收已移出协程表的上下文
+     * 
+     * 仍被外部持有、池已满或栈超过高水位的上下文不入池，随引用释放。
+     */
+    void RecycleContext(std::shared_ptr<CoroutineContext> context);
+    
+    /**
+     * @brief 选择下一个要运行的协程
+     */
+    CoroutineId SelectNextCoroutine() const;
     
     /* ====================================================================== */
     /* 成员变量 */
     /* ====================================================================== */
     
+    // 协程栈所属的内存管理器
+    MemoryManager& memory_manager_;
+    
     // 协程存储
     std::unordered_map<CoroutineId, CoroutineEntry> coroutines_;
     CoroutineId next_coroutine_id_;
@@ -597,6 +729,18 @@ private:
     // 主线程上下文（用于切换回主线程）
     std::unique_ptr<CoroutineContext> main_thread_context_;
     
+    // 活动上下文（切换即改写此指针）和执行器
+    CoroutineContext* current_context_;
+    CoroutineExecutor executor_;
+    
+    // 就绪队列（RunReadyCoroutines按FIFO轮转）
+    std::deque<CoroutineId> ready_queue_;
+    
+    // 空闲上下文池
+    std::vector<std::shared_ptr<CoroutineContext>> context_pool_;
+    Size max_pooled_contexts_;
+    Size max_pooled_stack_size_;
+    
     // 调度策略
     SchedulingPolicy scheduling_policy_;
     
@@ -612,7 +756,8 @@ private:
  * @brief 协程支持系统
  * 
  * 为虚拟机提供协程功能的高级接口
- * 整合协程调度器和VM执行器
+ * 整合协程调度器和VM执行器：构造时向调度器安装ExecuteCoroutine，
+ * 每个协程在VM上以自己的栈和调用帧运行
  */
 class CoroutineSupport {
 public:
@@ -625,13 +770,13 @@ public:
     /**
      * @brief 析构函数
      */
-    ~CoroutineSupport() = default;
+    ~CoroutineSupport();
     
-    // 禁用拷贝，允许移动
+    // 禁用拷贝和移动（执行器和GC根回调捕获this）
     CoroutineSupport(const CoroutineSupport&) = delete;
     CoroutineSupport& operator=(const CoroutineSupport&) = delete;
-    CoroutineSupport(CoroutineSupport&&) = default;
-    CoroutineSupport& operator=(CoroutineSupport&&) = default;
+    CoroutineSupport(CoroutineSupport&&) = delete;
+    CoroutineSupport& operator=(CoroutineSupport&&) = delete;
     
     /* ====================================================================== */
     /* 协程操作接口 */
@@ -656,9 +801,18 @@ public:
     /**
      * @brief 挂起当前协程
      * @param yield_values yield值
-     * @return resume时传入的参数
+     * @note 下次resume的参数出现在协程栈顶
      */
-    std::vector<LuaValue> Yield(const std::vector<LuaValue>& yield_values = {});
+    void Yield(const std::vector<LuaValue>& yield_values = {});
+    
+    /**
+     * @brief VM因抢占预算耗尽而挂起时让出当前协程
+     * 
+     * 由协程执行器在VM退出解释器循环后、换回线程状态之前调用；随后执行器
+     * 返回，下次resume时VirtualMachine::ResumeThread()从协程保存的pc继续。
+     * @return 是否已让出
+     */
+    bool YieldIfPreempted();
     
     /**
      * @brief 获取协程状态
@@ -709,7 +863,7 @@ public:
         Size default_stack_size = 256;                 // 默认栈大小
         Size default_call_depth = 200;                 // 默认调用深度
         bool enable_preemption = false;                // 启用抢占式调度
-        Size time_slice_ms = 10;                       // 时间片（毫秒）
+        Size preempt_budget = 10000;                   // 时间片：回跳和调用计数点的数量
         bool enable_priority_scheduling = false;       // 启用优先级调度
         bool enable_statistics = true;                 // 启用统计
         bool enable_gc_integration = true;             // 启用GC集成
@@ -718,7 +872,7 @@ public:
     /**
      * @brief 设置配置
      */
-    void SetConfig(const CoroutineConfig& config) { config_ = config; }
+    void SetConfig(const CoroutineConfig& config);
     
     /**
      * @brief 获取配置
@@ -750,6 +904,20 @@ private:
      */
     bool IsValidCoroutine(const LuaValue& value) const;
     
+    /**
+     * @brief 按配置和调度策略设置VM的抢占预算
+     */
+    void ApplyPreemptBudget();
+    
+    /**
+     * @brief 调度器的执行器：把协程的线程状态换入VM并从保存处继续执行
+     * 
+     * 首次恢复时以协程函数建立第一帧，被抢占后从保存的pc继续；VM退出
+     * 解释器循环后（返回、抢占或出错）立即换回恢复者的线程状态。
+     * @return 协程体返回值数量，让出时为0
+     */
+    Size ExecuteCoroutine(CoroutineContext& context);
+    
     /* ====================================================================== */
     /* 成员变量 */
     /* ====================================================================== */
@@ -761,6 +929,9 @@ private:
     // 协程对象映射（LuaValue到协程ID）
     std::unordered_map<Size, CoroutineScheduler::CoroutineId> coroutine_map_;
     Size next_coroutine_handle_;
+    
+    // 在VM登记的GC根编号
+    Size root_marker_id_;
 };
 
 /* ========================================================================== */
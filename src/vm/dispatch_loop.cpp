@@ -0,0 +1,544 @@
+/**
+ * @file dispatch_loop.cpp
+ * @brief 虚拟机快速解释器循环
+ * @description 线程化分派的主循环：GCC/Clang使用computed goto，其他编译器使用switch
+ * @author Lua C++ Project
+ * @date 2025-09-26
+ */
+
+#include "virtual_machine.h"
+#include "inline_cache.h"
+#include "../compiler/bytecode.h"
+#include "../types/value.h"
+#include "../types/lua_table.h"
+#include "../memory/garbage_collector.h"
+#include <cmath>
+
+// 定义LUA_CPP_NO_COMPUTED_GOTO可在GCC/Clang下强制使用switch分派
+#if !defined(LUA_CPP_NO_COMPUTED_GOTO) && (defined(__GNUC__) || defined(__clang__))
+#define LUA_CPP_COMPUTED_GOTO 1
+#else
+#define LUA_CPP_COMPUTED_GOTO 0
+#endif
+
+namespace lua_cpp {
+
+namespace {
+
+/**
+ * @brief 帧加载结果
+ */
+enum class FrameLoad {
+    Continue,       // 继续在快速循环中执行
+    Stop,           // 执行结束或状态改变
+    SlowPath        // 当前函数不满足快速循环的前提，转入慢路径
+};
+
+static_assert(static_cast<int>(OpCode::NUM_OPCODES) <= (1 << SIZE_OP),
+              "opcode field too small for dispatch table");
+
+} // namespace
+
+/* ========================================================================== */
+/* 快速解释器循环 */
+/* ========================================================================== */
+
+// 标签地址（&&label）和goto *是GNU扩展，-pedantic下会报错；
+// VM_BREAK在整个函数体内展开为goto *，因此对整个函数关闭该诊断
+#if LUA_CPP_COMPUTED_GOTO
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+
+void VirtualMachine::ExecuteFastLoop() {
+    CallFrame* frame = nullptr;
+    const Instruction* code = nullptr;
+    const Instruction* pc = nullptr;
+    const LuaValue* k = nullptr;
+    InlineCache* ic = nullptr;
+    LuaValue* base = nullptr;
+    Instruction i = 0;
+    Size executed = 0;
+    FrameLoad load_result = FrameLoad::Continue;
+
+    // 从当前调用帧重新加载缓存的局部状态（函数调用/返回后调用）
+    auto load_frame = [&]() -> FrameLoad {
+        if (execution_state_ != ExecutionState::Running) {
+            return FrameLoad::Stop;
+        }
+        if (call_frames_.GetCurrentIndex() <= call_stop_depth_) {
+            // 主函数返回时执行结束；嵌套调用（元方法）返回时只退出本层循环
+            if (IsCallStackEmpty()) {
+                execution_state_ = ExecutionState::Finished;
+            }
+            return FrameLoad::Stop;
+        }
+
+        frame = &call_frames_.Top();
+        const Proto* proto = frame->GetProto();
+        if (!proto) {
+            return FrameLoad::SlowPath;
+        }
+
+        // 取指和跳转不做越界检查：已校验的代码以RETURN结尾且跳转目标都在范围内，
+        // 这里只确认帧保存的指针落在代码内（外部可能通过SetInstructionPointer改写）
+        if (!proto->IsVerified()) {
+            return FrameLoad::SlowPath;
+        }
+        const std::vector<Instruction>& instructions = proto->GetCode();
+        const Instruction* saved_pc = frame->GetSavedPC();
+        if (saved_pc < instructions.data() ||
+            saved_pc >= instructions.data() + instructions.size()) {
+            return FrameLoad::SlowPath;
+        }
+
+        // 保证整个寄存器窗口位于栈内，之后寄存器访问无需检查
+        bool full_window = EnsureFrameWindow();
+        RefreshFrameCache();
+        if (!full_window) {
+            return FrameLoad::SlowPath;
+        }
+
+        code = instructions.data();
+        pc = saved_pc;
+        k = proto->GetConstants().data();
+        ic = proto->GetInlineCaches();
+        base = register_base_;
+        return FrameLoad::Continue;
+    };
+
+/* 操作数按需解码，只在各指令内部使用 */
+#define VM_RA()         (base + GetArgA(i))
+#define VM_RB()         (base + GetArgB(i))
+#define VM_RK(x)        (IsConstant(x) ? k + RKToConstantIndex(x) : base + (x))
+#define VM_KBX()        (k + GetArgBx(i))
+#define VM_IC()         (ic[pc - code - 1])
+
+/* 调用可能扩展堆栈或抛出异常的慢速处理函数前保存pc，之后刷新base；
+   处理函数可能嵌套调用元方法，帧数组扩容后frame也需重新取址 */
+#define VM_SAVEPC()     frame->SetSavedPC(pc)
+#define VM_PROTECT(stmt) \
+    do { \
+        VM_SAVEPC(); \
+        stmt; \
+        RevalidateRegisterBase(); \
+        base = register_base_; \
+        frame = &call_frames_.Top(); \
+    } while (0)
+
+/* 可能切换调用帧的指令：之后整体重新加载 */
+#define VM_PROTECT_FRAME(stmt) \
+    do { \
+        VM_SAVEPC(); \
+        stmt; \
+        load_result = load_frame(); \
+        if (load_result != FrameLoad::Continue) goto exit_loop; \
+    } while (0)
+
+/* 数值快速路径：一次合并的标签检查后原地写入结果；
+   其余情况（字符串转换、元方法、错误）交给处理函数的慢路径 */
+#define VM_ARITH_IF(handler, guard, expr) \
+    do { \
+        const LuaValue* rb = VM_RK(GetArgB(i)); \
+        const LuaValue* rc = VM_RK(GetArgC(i)); \
+        if (LuaValue::BothNumbers(*rb, *rc) && (guard)) { \
+            double nb = rb->GetNumber(); \
+            double nc = rc->GetNumber(); \
+            *VM_RA() = LuaValue(expr); \
+        } else { \
+            VM_PROTECT(handler(GetArgA(i), GetArgB(i), GetArgC(i))); \
+        } \
+    } while (0)
+#define VM_ARITH(handler, expr)     VM_ARITH_IF(handler, true, expr)
+
+#define VM_FETCH()      do { i = *pc++; ++executed; } while (0)
+
+/* 抢占计数点（回跳和调用之后）：预算耗尽时保存pc并挂起，恢复时从pc继续 */
+#define VM_CHARGE_BUDGET() \
+    do { \
+        if (--preempt_budget_ <= 0 && PreemptionPoint()) { \
+            VM_SAVEPC(); \
+            load_result = FrameLoad::Stop; \
+            goto exit_loop; \
+        } \
+    } while (0)
+
+#if LUA_CPP_COMPUTED_GOTO
+    static const void* const kDispatchTable[1 << SIZE_OP] = {
+        &&L_MOVE, &&L_LOADK, &&L_LOADBOOL, &&L_LOADNIL,
+        &&L_GETUPVAL, &&L_GETGLOBAL, &&L_GETTABLE,
+        &&L_SETGLOBAL, &&L_SETUPVAL, &&L_SETTABLE,
+        &&L_NEWTABLE, &&L_SELF,
+        &&L_ADD, &&L_SUB, &&L_MUL, &&L_DIV, &&L_MOD, &&L_POW,
+        &&L_UNM, &&L_NOT, &&L_LEN, &&L_CONCAT,
+        &&L_JMP, &&L_EQ, &&L_LT, &&L_LE, &&L_TEST, &&L_TESTSET,
+        &&L_CALL, &&L_TAILCALL, &&L_RETURN,
+        &&L_FORLOOP, &&L_FORPREP, &&L_TFORLOOP,
+        &&L_SETLIST, &&L_CLOSE, &&L_CLOSURE, &&L_VARARG,
+        // 未使用的操作码取值
+        &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID,
+        &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID,
+        &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID,
+        &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID,
+        &&L_INVALID, &&L_INVALID
+    };
+    static_assert(static_cast<int>(OpCode::VARARG) == 37, "dispatch table out of sync with OpCode");
+
+#define VM_DISPATCH(inst)   goto *kDispatchTable[static_cast<int>(GetOpCode(inst))];
+#define VM_CASE(name)       L_##name:
+#define VM_DEFAULT          L_INVALID:
+#define VM_BREAK            do { VM_FETCH(); VM_DISPATCH(i) } while (0)
+#else
+#define VM_DISPATCH(inst)   switch (GetOpCode(inst))
+#define VM_CASE(name)       case OpCode::name:
+#define VM_DEFAULT          default:
+#define VM_BREAK            break
+#endif
+
+    try {
+        load_result = load_frame();
+        if (load_result != FrameLoad::Continue) {
+            goto exit_loop;
+        }
+
+        for (;;) {
+            VM_FETCH();
+            VM_DISPATCH(i) {
+                /* ===== 数据移动 ===== */
+
+                VM_CASE(MOVE) {
+                    *VM_RA() = *VM_RB();
+                    VM_BREAK;
+                }
+                VM_CASE(LOADK) {
+                    *VM_RA() = *VM_KBX();
+                    VM_BREAK;
+                }
+                VM_CASE(LOADBOOL) {
+                    *VM_RA() = LuaValue(GetArgB(i) != 0);
+                    if (GetArgC(i)) {
+                        pc++;
+                    }
+                    VM_BREAK;
+                }
+                VM_CASE(LOADNIL) {
+                    LuaValue* last = VM_RB();
+                    for (LuaValue* reg = VM_RA(); reg <= last; ++reg) {
+                        *reg = LuaValue();
+                    }
+                    VM_BREAK;
+                }
+
+                /* ===== 全局变量、上值与表访问 ===== */
+
+                VM_CASE(GETUPVAL) {
+                    VM_PROTECT(ExecuteGETUPVAL(GetArgA(i), GetArgB(i)));
+                    VM_BREAK;
+                }
+                VM_CASE(GETGLOBAL) {
+                    // 校验器保证Bx在常量表内且是字符串
+                    if (global_table_) {
+                        *VM_RA() = CachedGetStr(*global_table_, VM_KBX()->GetStringObject(),
+                                                VM_IC(), statistics_);
+                    } else {
+                        VM_PROTECT(ExecuteGETGLOBAL(GetArgA(i), GetArgBx(i)));
+                    }
+                    VM_BREAK;
+                }
+                VM_CASE(GETTABLE) {
+                    TableObject* table = VM_RB()->GetTable();
+                    int c = GetArgC(i);
+                    if (table && IsConstant(c) && k[RKToConstantIndex(c)].IsString()) {
+                        *VM_RA() = CachedGetStr(table->GetTable(),
+                                                k[RKToConstantIndex(c)].GetStringObject(),
+                                                VM_IC(), statistics_);
+                    } else if (table) {
+                        *VM_RA() = table->Get(*VM_RK(c));
+                    } else {
+                        VM_PROTECT(ExecuteGETTABLE(GetArgA(i), GetArgB(i), c));
+                    }
+                    VM_BREAK;
+                }
+                VM_CASE(SETGLOBAL) {
+                    if (global_table_) {
+                        NoteGlobalStore(*VM_RA());
+                        global_table_->Set(*VM_KBX(), *VM_RA());
+                    } else {
+                        VM_PROTECT(ExecuteSETGLOBAL(GetArgA(i), GetArgBx(i)));
+                    }
+                    VM_BREAK;
+                }
+                VM_CASE(SETUPVAL) {
+                    VM_PROTECT(ExecuteSETUPVAL(GetArgA(i), GetArgB(i)));
+                    VM_BREAK;
+                }
+                VM_CASE(SETTABLE) {
+                    int b = GetArgB(i);
+                    if (TableObject* table = VM_RA()->GetTable()) {
+                        if (IsConstant(b) && k[RKToConstantIndex(b)].IsString()) {
+                            CachedSetStr(*table, k[RKToConstantIndex(b)].GetStringObject(),
+                                         *VM_RK(GetArgC(i)), VM_IC(), statistics_);
+                        } else {
+                            VM_SAVEPC();  // nil/NaN键会抛出异常
+                            table->Set(*VM_RK(b), *VM_RK(GetArgC(i)));
+                        }
+                    } else {
+                        VM_PROTECT(ExecuteSETTABLE(GetArgA(i), GetArgB(i), GetArgC(i)));
+                    }
+                    VM_BREAK;
+                }
+                VM_CASE(NEWTABLE) {
+                    VM_PROTECT(ExecuteNEWTABLE(GetArgA(i), GetArgB(i), GetArgC(i)));
+                    VM_BREAK;
+                }
+                VM_CASE(SELF) {
+                    // R(A+1) := R(B); R(A) := R(B)[RK(C)]，常量方法名走内联缓存
+                    TableObject* table = VM_RB()->GetTable();
+                    int c = GetArgC(i);
+                    if (table && IsConstant(c) && k[RKToConstantIndex(c)].IsString()) {
+                        LuaValue* ra = VM_RA();
+                        LuaValue self = *VM_RB();
+                        ra[0] = CachedGetStr(table->GetTable(),
+                                             k[RKToConstantIndex(c)].GetStringObject(),
+                                             VM_IC(), statistics_);
+                        ra[1] = self;
+                    } else {
+                        VM_PROTECT(ExecuteSELF(GetArgA(i), GetArgB(i), c));
+                    }
+                    VM_BREAK;
+                }
+
+                /* ===== 算术运算 ===== */
+
+                VM_CASE(ADD) {
+                    VM_ARITH(ExecuteADD, nb + nc);
+                    VM_BREAK;
+                }
+                VM_CASE(SUB) {
+                    VM_ARITH(ExecuteSUB, nb - nc);
+                    VM_BREAK;
+                }
+                VM_CASE(MUL) {
+                    VM_ARITH(ExecuteMUL, nb * nc);
+                    VM_BREAK;
+                }
+                VM_CASE(DIV) {
+                    VM_ARITH_IF(ExecuteDIV, rc->GetNumber() != 0.0, nb / nc);
+                    VM_BREAK;
+                }
+                VM_CASE(MOD) {
+                    VM_ARITH_IF(ExecuteMOD, rc->GetNumber() != 0.0, nb - std::floor(nb / nc) * nc);
+                    VM_BREAK;
+                }
+                VM_CASE(POW) {
+                    VM_ARITH(ExecutePOW, std::pow(nb, nc));
+                    VM_BREAK;
+                }
+                VM_CASE(UNM) {
+                    const LuaValue* rb = VM_RB();
+                    if (rb->IsNumber()) {
+                        *VM_RA() = LuaValue(-rb->GetNumber());
+                    } else {
+                        VM_PROTECT(ExecuteUNM(GetArgA(i), GetArgB(i)));
+                    }
+                    VM_BREAK;
+                }
+                VM_CASE(NOT) {
+                    *VM_RA() = LuaValue(!VM_RB()->IsTruthy());
+                    VM_BREAK;
+                }
+                VM_CASE(LEN) {
+                    const LuaValue* rb = VM_RB();
+                    if (rb->IsString()) {
+                        *VM_RA() = LuaValue(static_cast<double>(rb->GetStringObject()->GetLength()));
+                    } else if (TableObject* table = rb->GetTable()) {
+                        *VM_RA() = LuaValue(static_cast<double>(table->GetLength()));
+                    } else {
+                        VM_PROTECT(ExecuteLEN(GetArgA(i), GetArgB(i)));
+                    }
+                    VM_BREAK;
+                }
+                VM_CASE(CONCAT) {
+                    VM_PROTECT(ExecuteCONCAT(GetArgA(i), GetArgB(i), GetArgC(i)));
+                    VM_BREAK;
+                }
+
+                /* ===== 跳转与比较 ===== */
+
+                VM_CASE(JMP) {
+                    int offset = GetArgsBx(i);
+                    pc += offset;
+                    if (offset < 0) {
+                        VM_CHARGE_BUDGET();
+                    }
+                    VM_BREAK;
+                }
+                VM_CASE(EQ) {
+                    bool equal = (*VM_RK(GetArgB(i)) == *VM_RK(GetArgC(i)));
+                    if (equal != (GetArgA(i) != 0)) {
+                        pc++;
+                    }
+                    VM_BREAK;
+                }
+                VM_CASE(LT) {
+                    const LuaValue* rb = VM_RK(GetArgB(i));
+                    const LuaValue* rc = VM_RK(GetArgC(i));
+                    bool result;
+                    if (rb->IsNumber() && rc->IsNumber()) {
+                        result = rb->GetNumber() < rc->GetNumber();
+                    } else if (rb->IsString() && rc->IsString()) {
+                        result = rb->GetString() < rc->GetString();
+                    } else {
+                        VM_PROTECT(ExecuteLT(GetArgA(i), GetArgB(i), GetArgC(i)));  // 抛出比较错误
+                        VM_BREAK;
+                    }
+                    if (result != (GetArgA(i) != 0)) {
+                        pc++;
+                    }
+                    VM_BREAK;
+                }
+                VM_CASE(LE) {
+                    const LuaValue* rb = VM_RK(GetArgB(i));
+                    const LuaValue* rc = VM_RK(GetArgC(i));
+                    bool result;
+                    if (rb->IsNumber() && rc->IsNumber()) {
+                        result = rb->GetNumber() <= rc->GetNumber();
+                    } else if (rb->IsString() && rc->IsString()) {
+                        result = rb->GetString() <= rc->GetString();
+                    } else {
+                        VM_PROTECT(ExecuteLE(GetArgA(i), GetArgB(i), GetArgC(i)));  // 抛出比较错误
+                        VM_BREAK;
+                    }
+                    if (result != (GetArgA(i) != 0)) {
+                        pc++;
+                    }
+                    VM_BREAK;
+                }
+                VM_CASE(TEST) {
+                    if (VM_RA()->IsTruthy() != (GetArgC(i) != 0)) {
+                        pc++;
+                    }
+                    VM_BREAK;
+                }
+                VM_CASE(TESTSET) {
+                    const LuaValue* rb = VM_RB();
+                    if (rb->IsTruthy() == (GetArgC(i) != 0)) {
+                        *VM_RA() = *rb;
+                    } else {
+                        pc++;
+                    }
+                    VM_BREAK;
+                }
+
+                /* ===== 函数调用 ===== */
+
+                VM_CASE(CALL) {
+                    VM_PROTECT_FRAME(ExecuteCALL(GetArgA(i), GetArgB(i), GetArgC(i)));
+                    VM_CHARGE_BUDGET();
+                    VM_BREAK;
+                }
+                VM_CASE(TAILCALL) {
+                    VM_PROTECT_FRAME(ExecuteTAILCALL(GetArgA(i), GetArgB(i), GetArgC(i)));
+                    VM_CHARGE_BUDGET();
+                    VM_BREAK;
+                }
+                VM_CASE(RETURN) {
+                    VM_PROTECT_FRAME(ExecuteRETURN(GetArgA(i), GetArgB(i)));
+                    VM_BREAK;
+                }
+
+                /* ===== 循环 ===== */
+
+                VM_CASE(FORLOOP) {
+                    // FORPREP已保证控制变量都是数值：每次迭代只有一次加法和一次比较
+                    LuaValue* ra = VM_RA();
+                    double step = ra[2].GetNumber();
+                    double index = ra[0].GetNumber() + step;
+                    double limit = ra[1].GetNumber();
+                    if (step > 0 ? index <= limit : limit <= index) {
+                        pc += GetArgsBx(i);
+                        ra[0] = LuaValue(index);
+                        ra[3] = LuaValue(index);  // 循环变量
+                        VM_CHARGE_BUDGET();
+                    }
+                    VM_BREAK;
+                }
+                VM_CASE(FORPREP) {
+                    LuaValue* ra = VM_RA();
+                    if (!LuaValue::BothNumbers(ra[0], ra[1]) || !ra[2].IsNumber()) {
+                        VM_PROTECT(CoerceForLoopValues(GetArgA(i)));
+                        ra = VM_RA();
+                    }
+                    ra[0] = LuaValue(ra[0].GetNumber() - ra[2].GetNumber());
+                    pc += GetArgsBx(i);
+                    VM_BREAK;
+                }
+                VM_CASE(TFORLOOP) {
+                    VM_PROTECT_FRAME(ExecuteTFORLOOP(GetArgA(i), GetArgC(i)));
+                    VM_CHARGE_BUDGET();
+                    VM_BREAK;
+                }
+
+                /* ===== 其他 ===== */
+
+                VM_CASE(SETLIST) {
+                    VM_PROTECT(ExecuteSETLIST(GetArgA(i), GetArgB(i), GetArgC(i)));
+                    VM_BREAK;
+                }
+                VM_CASE(CLOSE) {
+                    VM_PROTECT(ExecuteCLOSE(GetArgA(i)));
+                    VM_BREAK;
+                }
+                VM_CASE(CLOSURE) {
+                    VM_PROTECT(ExecuteCLOSURE(GetArgA(i), GetArgBx(i)));
+                    VM_BREAK;
+                }
+                VM_CASE(VARARG) {
+                    VM_PROTECT(ExecuteVARARG(GetArgA(i), GetArgB(i)));
+                    VM_BREAK;
+                }
+
+                VM_DEFAULT {
+                    VM_SAVEPC();
+                    throw InvalidInstructionError("Unknown opcode: " +
+                                                  std::to_string(static_cast<int>(GetOpCode(i))));
+                }
+            }
+        }
+    } catch (...) {
+        instruction_count_ += executed;
+        statistics_.total_instructions += executed;
+        throw;
+    }
+
+exit_loop:
+    instruction_count_ += executed;
+    statistics_.total_instructions += executed;
+
+    if (load_result == FrameLoad::SlowPath) {
+        ExecuteSlowLoop();
+    }
+
+#undef VM_RA
+#undef VM_RB
+#undef VM_RK
+#undef VM_KBX
+#undef VM_IC
+#undef VM_SAVEPC
+#undef VM_PROTECT
+#undef VM_PROTECT_FRAME
+#undef VM_ARITH_IF
+#undef VM_ARITH
+#undef VM_FETCH
+#undef VM_CHARGE_BUDGET
+#undef VM_DISPATCH
+#undef VM_CASE
+#undef VM_DEFAULT
+#undef VM_BREAK
+}
+
+#if LUA_CPP_COMPUTED_GOTO
+#pragma GCC diagnostic pop
+#endif
+
+} // namespace lua_cpp
@@ -22,10 +22,10 @@ EnhancedVirtualMachine::EnhancedVirtualMachine(const VMConfig& config, bool enab
 }
 
 void EnhancedVirtualMachine::InitializeT026Components() {
-    // 如果启用高级功能，创建高级调用栈管理器
+    // 如果启用高级功能，创建高级调用栈管理器（挂接到VM的帧栈，每次调用只记录一次）
     if (use_advanced_features_) {
         advanced_call_stack_manager_ = std::make_unique<AdvancedCallStackManager>(
-            GetConfig().max_call_depth
+            GetCallFrameStack()
         );
     }
     
@@ -326,7 +326,7 @@ void EnhancedVirtualMachine::ExecuteCLOSUREEnhanced(RegisterIndex a, int bx) {
     for (Size i = 0; i < num_upvalues; ++i) {
         auto upvalue_info = proto->GetUpvalueInfo(i);
         
-        std::shared_ptr<Upvalue> upvalue;
+        Upvalue* upvalue = nullptr;
         if (upvalue_info.instack) {
             // 在当前栈中创建Upvalue
             Size stack_index = GetCurrentFrame()->GetStackBase() + upvalue_info.idx;
@@ -349,14 +349,13 @@ void EnhancedVirtualMachine::ExecuteCLOSUREEnhanced(RegisterIndex a, int bx) {
     SetRegister(a, closure);
 }
 
-std::shared_ptr<Upvalue> EnhancedVirtualMachine::CreateUpvalue(Size stack_index) {
+Upvalue* EnhancedVirtualMachine::CreateUpvalue(Size stack_index) {
     if (!upvalue_manager_) {
-        return std::make_shared<Upvalue>(GetRegister(stack_index));
+        throw LuaException("Upvalue manager not initialized");
     }
     
-    return upvalue_manager_->GetOrCreateUpvalue(stack_index, [this](Size idx) {
-        return GetRegister(idx);
-    });
+    // 同一栈槽复用已有的开放Upvalue
+    return upvalue_manager_->GetUpvalue(stack_index);
 }
 
 void EnhancedVirtualMachine::CloseUpvalues(Size level) {
@@ -36,11 +36,11 @@ public:
      */
     ~EnhancedVirtualMachine() override = default;
     
-    // 禁用拷贝，允许移动
+    // 禁用拷贝和移动（高级调用栈管理器引用本VM的帧栈）
     EnhancedVirtualMachine(const EnhancedVirtualMachine&) = delete;
     EnhancedVirtualMachine& operator=(const EnhancedVirtualMachine&) = delete;
-    EnhancedVirtualMachine(EnhancedVirtualMachine&&) = default;
-    EnhancedVirtualMachine& operator=(EnhancedVirtualMachine&&) = default;
+    EnhancedVirtualMachine(EnhancedVirtualMachine&&) = delete;
+    EnhancedVirtualMachine& operator=(EnhancedVirtualMachine&&) = delete;
     
     /* ====================================================================== */
     /* T026组件访问 */
@@ -267,7 +267,7 @@ private:
     /**
      * @brief 处理Upvalue创建
      */
-    std::shared_ptr<Upvalue> CreateUpvalue(Size stack_index);
+    Upvalue* CreateUpvalue(Size stack_index);
     
     /**
      * @brief 处理Upvalue关闭
@@ -0,0 +1,65 @@
+/**
+ * @file inline_cache.h
+ * @brief 常量字符串键的内联缓存查找
+ * @description GETTABLE/SETTABLE/GETGLOBAL/SELF共用的带缓存表访问，
+ *              由快速解释器循环和指令处理函数包含
+ * @author Lua C++ Project
+ * @date 2025-09-28
+ */
+
+#pragma once
+
+#include "virtual_machine.h"
+#include "../compiler/bytecode.h"
+#include "../types/lua_table.h"
+#include "../memory/garbage_collector.h"
+
+namespace lua_cpp {
+
+/**
+ * @brief 带内联缓存读取字符串键
+ * 
+ * 命中时直接返回预测节点的值；未命中时完整查找并更新预测下标。
+ * 键不存在时结果为nil，缓存保持不变。
+ */
+inline LuaValue CachedGetStr(const LuaTable& table, StringObject* key,
+                             InlineCache& cache, ExecutionStatistics& stats) {
+    if (const LuaValue* slot = table.GetNodeValueIfKey(cache.Predict(), key)) {
+        stats.inline_cache_hits++;
+        return *slot;
+    }
+    
+    stats.inline_cache_misses++;
+    uint32_t node = table.FindStrNodeIndex(key);
+    if (node == LuaTable::kNoNode) {
+        return LuaValue();
+    }
+    cache.Record(node);
+    return *table.GetNodeValueIfKey(node, key);
+}
+
+/**
+ * @brief 带内联缓存写入字符串键
+ * 
+ * 命中时原地覆盖节点的值（与LuaTable::Set对已有键的处理相同，容量不变），
+ * 绕过了TableObject::Set，因此需要自己执行分代写屏障；
+ * 未命中时走完整的Set（可能rehash），之后重新记录节点下标。
+ */
+inline void CachedSetStr(TableObject& table, StringObject* key, const LuaValue& value,
+                         InlineCache& cache, ExecutionStatistics& stats) {
+    if (LuaValue* slot = table.GetTable().GetNodeValueIfKey(cache.Predict(), key)) {
+        stats.inline_cache_hits++;
+        *slot = value;
+        table.WriteBarrier(value);
+        return;
+    }
+    
+    stats.inline_cache_misses++;
+    table.Set(LuaValue(key), value);
+    uint32_t node = table.GetTable().FindStrNodeIndex(key);
+    if (node != LuaTable::kNoNode) {
+        cache.Record(node);
+    }
+}
+
+} // namespace lua_cpp
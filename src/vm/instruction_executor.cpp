@@ -7,9 +7,16 @@
  */
 
 #include "virtual_machine.h"
+#include "inline_cache.h"
 #include "../types/value.h"
+#include "../memory/memory_manager.h"
+#include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <memory>
+#include <optional>
 #include <string>
+#include <utility>
 
 namespace lua_cpp {
 
@@ -19,17 +26,22 @@ namespace lua_cpp {
 
 void VirtualMachine::ExecuteMOVE(RegisterIndex a, int b) {
     // MOVE A B: R(A) := R(B)
-    LuaValue value = GetRegister(static_cast<RegisterIndex>(b));
-    SetRegister(a, std::move(value));
+    Register(a) = GetRegister(static_cast<RegisterIndex>(b));
 }
 
 void VirtualMachine::ExecuteLOADK(RegisterIndex a, int bx) {
     // LOADK A Bx: R(A) := Kst(Bx)
+    SetRegister(a, ConstantOperand(bx, "LOADK"));
+}
+
+void VirtualMachine::CheckConstantOperand(int bx, const char* opname, bool require_string) const {
     if (!current_proto_ || static_cast<Size>(bx) >= current_proto_->GetConstantCount()) {
-        throw VMExecutionError("Invalid constant index in LOADK: " + std::to_string(bx));
+        throw VMExecutionError(std::string("Invalid constant index in ") + opname + ": " +
+                               std::to_string(bx));
+    }
+    if (require_string && !current_proto_->GetConstants()[bx].IsString()) {
+        throw TypeError("Global variable name must be a string");
     }
-    
-    SetRegister(a, current_proto_->GetConstant(bx));
 }
 
 void VirtualMachine::ExecuteLOADBOOL(RegisterIndex a, int b, int c) {
@@ -37,7 +49,7 @@ void VirtualMachine::ExecuteLOADBOOL(RegisterIndex a, int b, int c) {
     SetRegister(a, LuaValue(b != 0));
     
     if (c != 0) {
-        instruction_pointer_++; // 跳过下一条指令
+        call_frames_.Top().AdvanceInstructionPointer(); // 跳过下一条指令
     }
 }
 
@@ -61,19 +73,14 @@ void VirtualMachine::ExecuteGETUPVAL(RegisterIndex a, int b) {
 
 void VirtualMachine::ExecuteGETGLOBAL(RegisterIndex a, int bx) {
     // GETGLOBAL A Bx: R(A) := Gbl[Kst(Bx)]
-    if (!current_proto_ || static_cast<Size>(bx) >= current_proto_->GetConstantCount()) {
-        throw VMExecutionError("Invalid constant index in GETGLOBAL: " + std::to_string(bx));
-    }
+    const LuaValue& key = ConstantOperand(bx, "GETGLOBAL", true);
     
-    const LuaValue& key = current_proto_->GetConstant(bx);
-    if (!key.IsString()) {
-        throw TypeError("Global variable name must be a string");
-    }
-    
-    // 从全局表中获取值
+    // 从全局表中获取值（常量字符串已驻留，查找只用缓存哈希和指针比较）
     if (global_table_) {
-        LuaValue value = global_table_->Get(key);
-        SetRegister(a, std::move(value));
+        StringObject* name = key.GetStringObject();
+        InlineCache* cache = FindInlineCache(OpCode::GETGLOBAL);
+        SetRegister(a, cache ? CachedGetStr(*global_table_, name, *cache, statistics_)
+                             : global_table_->GetStr(name));
     } else {
         SetRegister(a, LuaValue()); // nil
     }
@@ -81,27 +88,19 @@ void VirtualMachine::ExecuteGETGLOBAL(RegisterIndex a, int bx) {
 
 void VirtualMachine::ExecuteSETGLOBAL(RegisterIndex a, int bx) {
     // SETGLOBAL A Bx: Gbl[Kst(Bx)] := R(A)
-    if (!current_proto_ || static_cast<Size>(bx) >= current_proto_->GetConstantCount()) {
-        throw VMExecutionError("Invalid constant index in SETGLOBAL: " + std::to_string(bx));
-    }
-    
-    const LuaValue& key = current_proto_->GetConstant(bx);
-    if (!key.IsString()) {
-        throw TypeError("Global variable name must be a string");
-    }
+    const LuaValue& key = ConstantOperand(bx, "SETGLOBAL", true);
     
-    LuaValue value = GetRegister(a);
+    const LuaValue& value = GetRegister(a);
     
     // 设置全局表中的值
     if (global_table_) {
-        global_table_->Set(key, std::move(value));
+        NoteGlobalStore(value);
+        global_table_->Set(key, value);
     }
 }
 
 void VirtualMachine::ExecuteSETUPVAL(RegisterIndex a, int b) {
     // SETUPVAL A B: UpValue[B] := R(A)
-    LuaValue value = GetRegister(a);
-    
     // TODO: 实现上值设置
 }
 
@@ -111,8 +110,8 @@ void VirtualMachine::ExecuteSETUPVAL(RegisterIndex a, int b) {
 
 void VirtualMachine::ExecuteGETTABLE(RegisterIndex a, int b, int c) {
     // GETTABLE A B C: R(A) := R(B)[RK(C)]
-    LuaValue table = GetRegister(static_cast<RegisterIndex>(b));
-    LuaValue key = GetRK(c);
+    const LuaValue& table = GetRegister(static_cast<RegisterIndex>(b));
+    const LuaValue& key = GetRK(c);
     
     if (!table.IsTable()) {
         throw TypeError("Attempt to index a " + table.TypeName() + " value");
@@ -121,8 +120,16 @@ void VirtualMachine::ExecuteGETTABLE(RegisterIndex a, int b, int c) {
     // 从表中获取值
     auto table_ptr = table.GetTable();
     if (table_ptr) {
-        LuaValue result = table_ptr->Get(key);
-        SetRegister(a, std::move(result));
+        LuaValue result;
+        InlineCache* cache = nullptr;
+        if (IsConstant(c) && key.IsString() && (cache = FindInlineCache(OpCode::GETTABLE))) {
+            result = CachedGetStr(table_ptr->GetTable(), key.GetStringObject(), *cache, statistics_);
+        } else if (key.IsString()) {
+            result = table_ptr->GetStr(key.GetStringObject());
+        } else {
+            result = table_ptr->Get(key);
+        }
+        SetRegister(a, result);
     } else {
         SetRegister(a, LuaValue()); // nil
     }
@@ -132,9 +139,9 @@ void VirtualMachine::ExecuteGETTABLE(RegisterIndex a, int b, int c) {
 
 void VirtualMachine::ExecuteSETTABLE(RegisterIndex a, int b, int c) {
     // SETTABLE A B C: R(A)[RK(B)] := RK(C)
-    LuaValue table = GetRegister(a);
-    LuaValue key = GetRK(b);
-    LuaValue value = GetRK(c);
+    const LuaValue& table = GetRegister(a);
+    const LuaValue& key = GetRK(b);
+    const LuaValue& value = GetRK(c);
     
     if (!table.IsTable()) {
         throw TypeError("Attempt to index a " + table.TypeName() + " value");
@@ -143,7 +150,12 @@ void VirtualMachine::ExecuteSETTABLE(RegisterIndex a, int b, int c) {
     // 设置表中的值
     auto table_ptr = table.GetTable();
     if (table_ptr) {
-        table_ptr->Set(key, std::move(value));
+        InlineCache* cache = nullptr;
+        if (IsConstant(b) && key.IsString() && (cache = FindInlineCache(OpCode::SETTABLE))) {
+            CachedSetStr(*table_ptr, key.GetStringObject(), value, *cache, statistics_);
+        } else {
+            table_ptr->Set(key, value);
+        }
     }
     
     statistics_.table_operations++;
@@ -151,11 +163,12 @@ void VirtualMachine::ExecuteSETTABLE(RegisterIndex a, int b, int c) {
 
 void VirtualMachine::ExecuteNEWTABLE(RegisterIndex a, int b, int c) {
     // NEWTABLE A B C: R(A) := {} (size = B,C)
-    // b = 数组部分大小, c = 哈希部分大小
-    Size array_size = (b == 0) ? 0 : (1 << (b - 1));
-    Size hash_size = (c == 0) ? 0 : (1 << (c - 1));
+    // b/c 为浮点字节编码的数组/哈希部分大小提示
+    Size array_size = FloatingByteToInt(b);
+    Size hash_size = FloatingByteToInt(c);
     
-    auto new_table = std::make_shared<LuaTable>(array_size, hash_size);
+    // arena作用域内在arena中分配，否则在堆上分配
+    TableObject* new_table = object_arena_.Allocate<TableObject>(array_size, hash_size);
     SetRegister(a, LuaValue(new_table));
     
     statistics_.table_operations++;
@@ -163,144 +176,241 @@ void VirtualMachine::ExecuteNEWTABLE(RegisterIndex a, int b, int c) {
 
 void VirtualMachine::ExecuteSELF(RegisterIndex a, int b, int c) {
     // SELF A B C: R(A+1) := R(B); R(A) := R(B)[RK(C)]
-    LuaValue table = GetRegister(static_cast<RegisterIndex>(b));
-    LuaValue key = GetRK(c);
-    
-    // 将表对象复制到 R(A+1) 作为 self 参数
-    SetRegister(a + 1, table);
+    // 先复制R(B)：写入R(A+1)可能覆盖R(B)所在的寄存器
+    const LuaValue& table = GetRegister(static_cast<RegisterIndex>(b));
+    const LuaValue& key = GetRK(c);
     
     if (!table.IsTable()) {
         throw TypeError("Attempt to index a " + table.TypeName() + " value");
     }
     
-    // 获取方法并存储到 R(A)
+    // 先查找方法：RK(C)可能就是R(A+1)
     auto table_ptr = table.GetTable();
-    if (table_ptr) {
-        LuaValue method = table_ptr->Get(key);
-        SetRegister(a, std::move(method));
-    } else {
-        SetRegister(a, LuaValue()); // nil
+    LuaValue method;
+    InlineCache* cache = nullptr;
+    if (table_ptr && IsConstant(c) && key.IsString() && (cache = FindInlineCache(OpCode::SELF))) {
+        method = CachedGetStr(table_ptr->GetTable(), key.GetStringObject(), *cache, statistics_);
+    } else if (table_ptr) {
+        method = table_ptr->Get(key);
     }
     
+    // 将表对象复制到 R(A+1) 作为 self 参数，方法存储到 R(A)
+    SetRegister(a + 1, table);
+    SetRegister(a, method);
+    
     statistics_.table_operations++;
 }
 
+/* ========================================================================== */
+/* 内联缓存 */
+/* ========================================================================== */
+
+InlineCache* VirtualMachine::FindInlineCache(OpCode op) const {
+    // 缓存槽在校验时分配，未校验的原型直接走完整查找
+    if (!current_proto_ || !current_proto_->IsVerified()) {
+        return nullptr;
+    }
+    
+    Size pc = GetCurrentCallFrame().GetInstructionPointer();
+    const std::vector<Instruction>& code = current_proto_->GetCode();
+    if (pc == 0 || pc > code.size() || GetOpCode(code[pc - 1]) != op) {
+        return nullptr;
+    }
+    return &current_proto_->GetInlineCaches()[pc - 1];
+}
+
 /* ========================================================================== */
 /* 算术运算指令 */
 /* ========================================================================== */
 
 void VirtualMachine::ExecuteADD(RegisterIndex a, int b, int c) {
     // ADD A B C: R(A) := RK(B) + RK(C)
-    LuaValue left = GetRK(b);
-    LuaValue right = GetRK(c);
-    
-    // 尝试转换为数字
-    std::optional<double> left_num = left.ToNumber();
-    std::optional<double> right_num = right.ToNumber();
+    const LuaValue& left = GetRK(b);
+    const LuaValue& right = GetRK(c);
     
-    if (left_num && right_num) {
-        double result = *left_num + *right_num;
-        SetRegister(a, LuaValue(result));
+    if (LuaValue::BothNumbers(left, right)) {
+        Register(a) = LuaValue(left.GetNumber() + right.GetNumber());
     } else {
-        // TODO: 元方法处理
-        throw TypeError("Attempt to perform arithmetic (" + left.TypeName() + 
-                       " + " + right.TypeName() + ")");
+        ArithSlowPath(a, left, right, MetaMethod::Add);
     }
 }
 
 void VirtualMachine::ExecuteSUB(RegisterIndex a, int b, int c) {
     // SUB A B C: R(A) := RK(B) - RK(C)
-    LuaValue left = GetRK(b);
-    LuaValue right = GetRK(c);
-    
-    std::optional<double> left_num = left.ToNumber();
-    std::optional<double> right_num = right.ToNumber();
+    const LuaValue& left = GetRK(b);
+    const LuaValue& right = GetRK(c);
     
-    if (left_num && right_num) {
-        double result = *left_num - *right_num;
-        SetRegister(a, LuaValue(result));
+    if (LuaValue::BothNumbers(left, right)) {
+        Register(a) = LuaValue(left.GetNumber() - right.GetNumber());
     } else {
-        throw TypeError("Attempt to perform arithmetic (" + left.TypeName() + 
-                       " - " + right.TypeName() + ")");
+        ArithSlowPath(a, left, right, MetaMethod::Sub);
     }
 }
 
 void VirtualMachine::ExecuteMUL(RegisterIndex a, int b, int c) {
     // MUL A B C: R(A) := RK(B) * RK(C)
-    LuaValue left = GetRK(b);
-    LuaValue right = GetRK(c);
+    const LuaValue& left = GetRK(b);
+    const LuaValue& right = GetRK(c);
     
-    std::optional<double> left_num = left.ToNumber();
-    std::optional<double> right_num = right.ToNumber();
-    
-    if (left_num && right_num) {
-        double result = *left_num * *right_num;
-        SetRegister(a, LuaValue(result));
+    if (LuaValue::BothNumbers(left, right)) {
+        Register(a) = LuaValue(left.GetNumber() * right.GetNumber());
     } else {
-        throw TypeError("Attempt to perform arithmetic (" + left.TypeName() + 
-                       " * " + right.TypeName() + ")");
+        ArithSlowPath(a, left, right, MetaMethod::Mul);
     }
 }
 
 void VirtualMachine::ExecuteDIV(RegisterIndex a, int b, int c) {
     // DIV A B C: R(A) := RK(B) / RK(C)
-    LuaValue left = GetRK(b);
-    LuaValue right = GetRK(c);
-    
-    std::optional<double> left_num = left.ToNumber();
-    std::optional<double> right_num = right.ToNumber();
+    const LuaValue& left = GetRK(b);
+    const LuaValue& right = GetRK(c);
     
-    if (left_num && right_num) {
-        double divisor = *right_num;
-        if (divisor == 0.0) {
-            throw VMExecutionError("Division by zero");
-        }
-        double result = *left_num / divisor;
-        SetRegister(a, LuaValue(result));
+    // 除数为0交给慢路径报错
+    if (LuaValue::BothNumbers(left, right) && right.GetNumber() != 0.0) {
+        Register(a) = LuaValue(left.GetNumber() / right.GetNumber());
     } else {
-        throw TypeError("Attempt to perform arithmetic (" + left.TypeName() + 
-                       " / " + right.TypeName() + ")");
+        ArithSlowPath(a, left, right, MetaMethod::Div);
     }
 }
 
 void VirtualMachine::ExecuteMOD(RegisterIndex a, int b, int c) {
     // MOD A B C: R(A) := RK(B) % RK(C)
-    LuaValue left = GetRK(b);
-    LuaValue right = GetRK(c);
+    const LuaValue& left = GetRK(b);
+    const LuaValue& right = GetRK(c);
     
-    if (left.IsNumber() && right.IsNumber()) {
-        double divisor = right.AsNumber();
-        if (divisor == 0.0) {
-            throw VMExecutionError("Division by zero in modulo operation");
-        }
-        double result = fmod(left.AsNumber(), divisor);
-        SetRegister(a, LuaValue(result));
+    // 除数为0交给慢路径报错
+    if (LuaValue::BothNumbers(left, right) && right.GetNumber() != 0.0) {
+        Register(a) = LuaValue(left.GetNumber() - std::floor(left.GetNumber() / right.GetNumber()) * right.GetNumber());
     } else {
-        throw TypeError("Attempt to perform arithmetic on non-number values");
+        ArithSlowPath(a, left, right, MetaMethod::Mod);
     }
 }
 
 void VirtualMachine::ExecutePOW(RegisterIndex a, int b, int c) {
     // POW A B C: R(A) := RK(B) ^ RK(C)
-    LuaValue left = GetRK(b);
-    LuaValue right = GetRK(c);
+    const LuaValue& left = GetRK(b);
+    const LuaValue& right = GetRK(c);
     
-    if (left.IsNumber() && right.IsNumber()) {
-        double result = pow(left.AsNumber(), right.AsNumber());
-        SetRegister(a, LuaValue(result));
+    if (LuaValue::BothNumbers(left, right)) {
+        Register(a) = LuaValue(std::pow(left.GetNumber(), right.GetNumber()));
     } else {
-        throw TypeError("Attempt to perform arithmetic on non-number values");
+        ArithSlowPath(a, left, right, MetaMethod::Pow);
     }
 }
 
 void VirtualMachine::ExecuteUNM(RegisterIndex a, int b) {
     // UNM A B: R(A) := -R(B)
-    LuaValue value = GetRegister(static_cast<RegisterIndex>(b));
+    const LuaValue& value = GetRegister(static_cast<RegisterIndex>(b));
     
     if (value.IsNumber()) {
-        SetRegister(a, LuaValue(-value.AsNumber()));
+        Register(a) = LuaValue(-value.GetNumber());
     } else {
-        throw TypeError("Attempt to perform arithmetic on non-number value");
+        ArithSlowPath(a, value, value, MetaMethod::Unm);
+    }
+}
+
+/* ========================================================================== */
+/* 算术慢路径与元方法 */
+/* ========================================================================== */
+
+void VirtualMachine::ArithSlowPath(RegisterIndex a, const LuaValue& lhs, const LuaValue& rhs,
+                                   MetaMethod event) {
+    // 字符串按数值语法转换
+    std::optional<double> x = lhs.ToNumber();
+    std::optional<double> y = rhs.ToNumber();
+    
+    if (x && y) {
+        if (*y == 0.0 && event == MetaMethod::Div) {
+            throw VMExecutionError("Division by zero");
+        }
+        if (*y == 0.0 && event == MetaMethod::Mod) {
+            throw VMExecutionError("Division by zero in modulo operation");
+        }
+        SetRegister(a, LuaValue(ArithNumber(event, *x, *y)));
+        return;
+    }
+    
+    // 先查左操作数的元方法，再查右操作数（call_binTM）
+    LuaValue handler = GetMetamethod(lhs, event);
+    if (handler.IsNil()) {
+        handler = GetMetamethod(rhs, event);
+    }
+    if (handler.IsNil()) {
+        const LuaValue& culprit = x ? rhs : lhs;
+        throw TypeError("Attempt to perform arithmetic on a " + culprit.TypeName() + " value");
+    }
+    
+    LuaValue result = CallMetamethod(handler, lhs, rhs);
+    SetRegister(a, result);
+}
+
+LuaValue VirtualMachine::GetMetamethod(const LuaValue& value, MetaMethod event) const {
+    TableObject* table = value.GetTable();
+    TableObject* metatable = table ? table->GetMetatable() : nullptr;
+    if (!metatable) {
+        return LuaValue();
+    }
+    
+    // 事件名在构造时驻留，查找只比较指针
+    return metatable->GetStr(metamethod_names_[static_cast<Size>(event)]);
+}
+
+LuaValue VirtualMachine::CallMetamethod(const LuaValue& handler, const LuaValue& lhs,
+                                        const LuaValue& rhs) {
+    const Proto* proto = handler.GetFunctionProto();
+    if (!proto) {
+        throw TypeError("Attempt to call a " + handler.TypeName() + " value");
+    }
+    
+    // 先复制：压栈可能重新分配栈存储，使指向寄存器的引用失效
+    LuaValue function = handler;
+    LuaValue arg1 = lhs;
+    LuaValue arg2 = rhs;
+    
+    Size func = GetStackTop();
+    Push(function);
+    Push(arg1);
+    Push(arg2);
+    
+    // 嵌套运行解释器循环，元方法返回到当前帧时退出
+    Size saved_stop_depth = call_stop_depth_;
+    Size caller_depth = call_frames_.GetCurrentIndex();
+    call_stop_depth_ = caller_depth;
+    try {
+        PrepareLuaCall(proto, func, 2, 1);
+        ContinueExecution();
+    } catch (...) {
+        call_stop_depth_ = saved_stop_depth;
+        throw;
+    }
+    call_stop_depth_ = saved_stop_depth;
+    
+    if (call_frames_.GetCurrentIndex() != caller_depth) {
+        throw VMExecutionError("Metamethod did not return");
+    }
+    
+    // RETURN把恰好一个返回值移到函数槽（没有返回值时补nil）
+    LuaValue result = GetStack(func);
+    SetStackTop(func);
+    return result;
+}
+
+void VirtualMachine::CoerceForLoopValues(RegisterIndex a) {
+    static const char* const kMessages[3] = {
+        "'for' initial value must be a number",
+        "'for' limit must be a number",
+        "'for' step must be a number"
+    };
+    
+    LuaValue* ra = &Register(a);
+    for (int i = 0; i < 3; ++i) {
+        if (ra[i].IsNumber()) {
+            continue;
+        }
+        std::optional<double> number = ra[i].ToNumber();
+        if (!number) {
+            throw TypeError(kMessages[i]);
+        }
+        ra[i] = LuaValue(*number);
     }
 }
 
@@ -310,20 +420,20 @@ void VirtualMachine::ExecuteUNM(RegisterIndex a, int b) {
 
 void VirtualMachine::ExecuteNOT(RegisterIndex a, int b) {
     // NOT A B: R(A) := not R(B)
-    LuaValue value = GetRegister(static_cast<RegisterIndex>(b));
+    const LuaValue& value = GetRegister(static_cast<RegisterIndex>(b));
     SetRegister(a, LuaValue(!value.IsTruthy()));
 }
 
 void VirtualMachine::ExecuteLEN(RegisterIndex a, int b) {
     // LEN A B: R(A) := length of R(B)
-    LuaValue value = GetRegister(static_cast<RegisterIndex>(b));
+    const LuaValue& value = GetRegister(static_cast<RegisterIndex>(b));
     
     if (value.IsString()) {
         SetRegister(a, LuaValue(static_cast<double>(value.GetString().length())));
     } else if (value.IsTable()) {
         auto table_ptr = value.GetTable();
         if (table_ptr) {
-            Size length = table_ptr->GetArraySize();
+            Size length = table_ptr->GetLength();
             SetRegister(a, LuaValue(static_cast<double>(length)));
         } else {
             SetRegister(a, LuaValue(0.0));
@@ -335,25 +445,69 @@ void VirtualMachine::ExecuteLEN(RegisterIndex a, int b) {
 
 void VirtualMachine::ExecuteCONCAT(RegisterIndex a, int b, int c) {
     // CONCAT A B C: R(A) := R(B).. ... ..R(C)
-    std::ostringstream result;
-    
+    // 第一遍：检查类型并计算结果总长度
+    char number[kNumberBufferSize];
+    Size total = 0;
     for (int i = b; i <= c; i++) {
-        LuaValue value = GetRegister(static_cast<RegisterIndex>(i));
-        
+        const LuaValue& value = GetRegister(static_cast<RegisterIndex>(i));
         if (value.IsString()) {
-            result << value.GetString();
-        } else if (value.IsNumber()) {
-            result << value.GetNumber();
-        } else if (value.IsBoolean()) {
-            result << (value.GetBoolean() ? "true" : "false");
-        } else if (value.IsNil()) {
-            result << "nil";
-        } else {
+            total += value.GetStringObject()->GetLength();
+        } else if (!value.IsNumber() && !value.IsBoolean() && !value.IsNil()) {
             throw TypeError("Attempt to concatenate a " + value.TypeName() + " value");
+        } else {
+            total += ConcatPiece(value, number).second;
         }
     }
     
-    SetRegister(a, LuaValue(result.str()));
+    const LuaValue& head = GetRegister(static_cast<RegisterIndex>(b));
+    if (config_.enable_concat_builder && total >= kConcatBuilderMinLength && head.IsString()) {
+        // 长结果：在左操作数的缓冲区末尾追加（s = s .. x 循环摊还O(n)），
+        // 缓冲区已被更长的字符串占用时新开一个并预留翻倍容量
+        StringObject* head_string = head.GetStringObject();
+        std::shared_ptr<std::string> buffer;
+        if (head_string->CanAppendInPlace()) {
+            buffer = head_string->GetBuilder();
+        } else {
+            buffer = std::make_shared<std::string>();
+            buffer->reserve(total * 2);
+            buffer->append(head_string->GetData(), head_string->GetLength());
+        }
+        if (buffer->capacity() < total) {
+            buffer->reserve(std::max(total, buffer->capacity() * 2));
+        }
+        
+        // 容量已足够，追加过程中缓冲区不会重新分配，操作数可以是同一缓冲区的视图
+        for (int i = b + 1; i <= c; i++) {
+            auto piece = ConcatPiece(GetRegister(static_cast<RegisterIndex>(i)), number);
+            buffer->append(piece.first, piece.second);
+        }
+        SetRegister(a, LuaValue(object_arena_.Allocate<StringObject>(std::move(buffer), total)));
+        return;
+    }
+    
+    // 第二遍：一次性写入复用缓冲区，短结果经NewString驻留
+    concat_buffer_.resize(total);
+    char* out = concat_buffer_.data();
+    for (int i = b; i <= c; i++) {
+        auto piece = ConcatPiece(GetRegister(static_cast<RegisterIndex>(i)), number);
+        std::memcpy(out, piece.first, piece.second);
+        out += piece.second;
+    }
+    SetRegister(a, LuaValue(NewString(concat_buffer_.data(), total)));
+}
+
+std::pair<const char*, Size> VirtualMachine::ConcatPiece(const LuaValue& value, char* number) {
+    if (value.IsString()) {
+        const StringObject* str = value.GetStringObject();
+        return {str->GetData(), str->GetLength()};
+    }
+    if (value.IsNumber()) {
+        return {number, FormatNumber(value.GetNumber(), number)};
+    }
+    if (value.IsBoolean()) {
+        return value.GetBoolean() ? std::make_pair("true", Size{4}) : std::make_pair("false", Size{5});
+    }
+    return {"nil", 3};
 }
 
 /* ========================================================================== */
@@ -362,25 +516,25 @@ void VirtualMachine::ExecuteCONCAT(RegisterIndex a, int b, int c) {
 
 void VirtualMachine::ExecuteJMP(int sbx) {
     // JMP sBx: pc += sBx
-    instruction_pointer_ += sbx;
+    call_frames_.Top().AdvanceInstructionPointer(sbx);
 }
 
 void VirtualMachine::ExecuteEQ(RegisterIndex a, int b, int c) {
     // EQ A B C: if ((RK(B) == RK(C)) ~= A) then pc++
-    LuaValue left = GetRK(b);
-    LuaValue right = GetRK(c);
+    const LuaValue& left = GetRK(b);
+    const LuaValue& right = GetRK(c);
     
     bool equal = (left == right);
     
     if ((equal ? 1 : 0) != a) {
-        instruction_pointer_++; // 跳过下一条指令
+        call_frames_.Top().AdvanceInstructionPointer(); // 跳过下一条指令
     }
 }
 
 void VirtualMachine::ExecuteLT(RegisterIndex a, int b, int c) {
     // LT A B C: if ((RK(B) < RK(C)) ~= A) then pc++
-    LuaValue left = GetRK(b);
-    LuaValue right = GetRK(c);
+    const LuaValue& left = GetRK(b);
+    const LuaValue& right = GetRK(c);
     
     bool less_than = false;
     
@@ -393,14 +547,14 @@ void VirtualMachine::ExecuteLT(RegisterIndex a, int b, int c) {
     }
     
     if ((less_than ? 1 : 0) != a) {
-        instruction_pointer_++;
+        call_frames_.Top().AdvanceInstructionPointer();
     }
 }
 
 void VirtualMachine::ExecuteLE(RegisterIndex a, int b, int c) {
     // LE A B C: if ((RK(B) <= RK(C)) ~= A) then pc++
-    LuaValue left = GetRK(b);
-    LuaValue right = GetRK(c);
+    const LuaValue& left = GetRK(b);
+    const LuaValue& right = GetRK(c);
     
     bool less_equal = false;
     
@@ -413,29 +567,29 @@ void VirtualMachine::ExecuteLE(RegisterIndex a, int b, int c) {
     }
     
     if ((less_equal ? 1 : 0) != a) {
-        instruction_pointer_++;
+        call_frames_.Top().AdvanceInstructionPointer();
     }
 }
 
 void VirtualMachine::ExecuteTEST(RegisterIndex a, int c) {
     // TEST A C: if not (R(A) <=> C) then pc++
-    LuaValue value = GetRegister(a);
+    const LuaValue& value = GetRegister(a);
     bool test_result = value.IsTruthy();
     
     if (test_result != (c != 0)) {
-        instruction_pointer_++;
+        call_frames_.Top().AdvanceInstructionPointer();
     }
 }
 
 void VirtualMachine::ExecuteTESTSET(RegisterIndex a, int b, int c) {
     // TESTSET A B C: if (R(B) <=> C) then R(A) := R(B) else pc++
-    LuaValue value = GetRegister(static_cast<RegisterIndex>(b));
+    const LuaValue& value = GetRegister(static_cast<RegisterIndex>(b));
     bool test_result = value.IsTruthy();
     
     if (test_result == (c != 0)) {
         SetRegister(a, value);
     } else {
-        instruction_pointer_++;
+        call_frames_.Top().AdvanceInstructionPointer();
     }
 }
 
@@ -445,24 +599,22 @@ void VirtualMachine::ExecuteTESTSET(RegisterIndex a, int b, int c) {
 
 void VirtualMachine::ExecuteCALL(RegisterIndex a, int b, int c) {
     // CALL A B C: R(A), ... ,R(A+C-2) := R(A)(R(A+1), ... ,R(A+B-1))
-    LuaValue function = GetRegister(a);
+    const LuaValue& function = GetRegister(a);
     
     if (!function.IsFunction()) {
         throw TypeError("Attempt to call a " + function.TypeName() + " value");
     }
     
-    // 准备参数
-    Size param_count = (b == 0) ? (GetStackTop() - GetCurrentBase() - a - 1) : (b - 1);
-    
     // 获取函数原型
     const Proto* proto = function.GetFunctionProto();
     if (!proto) {
         throw VMExecutionError("Invalid function proto");
     }
     
-    // 创建新的调用帧
-    Size new_base = GetCurrentBase() + a;
-    PushCallFrame(proto, new_base, param_count);
+    // 参数已在R(A+1)起，B=0时到开放栈顶为止；被调用者的帧直接建在其上
+    Size func = GetCurrentBase() + a;
+    Size param_count = (b == 0) ? (open_top_ - func - 1) : static_cast<Size>(b - 1);
+    PrepareLuaCall(proto, func, param_count, c - 1);
     
     // 统计信息
     statistics_.function_calls++;
@@ -470,76 +622,41 @@ void VirtualMachine::ExecuteCALL(RegisterIndex a, int b, int c) {
 
 void VirtualMachine::ExecuteTAILCALL(RegisterIndex a, int b, int c) {
     // TAILCALL A B C: return R(A)(R(A+1), ... ,R(A+B-1))
-    LuaValue function = GetRegister(a);
+    const LuaValue& function = GetRegister(a);
     
     if (!function.IsFunction()) {
         throw TypeError("Attempt to call a " + function.TypeName() + " value");
     }
     
-    // 准备参数
-    Size param_count = (b == 0) ? (GetStackTop() - GetCurrentBase() - a - 1) : (b - 1);
-    
     // 获取函数原型
     const Proto* proto = function.GetFunctionProto();
     if (!proto) {
         throw VMExecutionError("Invalid function proto");
     }
     
-    // 尾调用：复用当前调用帧
-    Size current_base = GetCurrentBase();
+    Size func = GetCurrentBase() + a;
+    Size param_count = (b == 0) ? (open_top_ - func - 1) : static_cast<Size>(b - 1);
     
-    // 移动参数到正确位置
-    for (Size i = 0; i < param_count; ++i) {
-        LuaValue param = GetRegister(a + 1 + i);
-        SetStack(current_base + i, std::move(param));
-    }
+    // 尾调用：函数和参数下移到当前帧的函数槽，以同一返回目标替换当前帧（不增加调用深度）
+    const CallFrame& frame = call_frames_.Top();
+    Size frame_func = frame.GetFunctionSlot();
+    int nresults = frame.GetExpectedResults();
     
-    // 更新当前函数和指令指针（不增加调用栈深度）
-    current_proto_ = proto;
-    instruction_pointer_ = 0;
+    LuaValue* data = stack_->GetData();
+    std::move(data + func, data + func + 1 + param_count, data + frame_func);
+    PopCallFrame();
+    PrepareLuaCall(proto, frame_func, param_count, nresults);
+    call_frames_.Top().SetFlag(VM_FRAME_TAIL_CALL);
     
     statistics_.function_calls++;
 }
 
 void VirtualMachine::ExecuteRETURN(RegisterIndex a, int b) {
     // RETURN A B: return R(A), ... ,R(A+B-2)
+    Size first = GetCurrentBase() + a;
+    Size count = (b == 0) ? open_top_ - first : static_cast<Size>(b - 1);
     
-    // 收集返回值
-    std::vector<LuaValue> return_values;
-    
-    if (b == 0) {
-        // 返回从A到栈顶的所有值
-        Size stack_top = GetStackTop();
-        Size base = GetCurrentBase();
-        Size start_index = base + a;
-        
-        for (Size i = start_index; i < stack_top; i++) {
-            return_values.push_back(GetStack(i));
-        }
-    } else {
-        // 返回指定数量的值
-        for (int i = 0; i < b - 1; i++) {
-            return_values.push_back(GetRegister(a + i));
-        }
-    }
-    
-    // 弹出当前调用帧
-    PopCallFrame();
-    
-    // 如果不是主函数，将返回值放到调用者的栈中
-    if (!call_stack_->IsEmpty()) {
-        // 将返回值放到调用者期望的位置
-        // 暂时简化处理：放到当前栈顶
-        for (const auto& value : return_values) {
-            Push(value);
-        }
-    } else {
-        // 主函数返回，清空栈然后放入返回值
-        SetStackTop(0);
-        for (const auto& value : return_values) {
-            Push(value);
-        }
-    }
+    FinishLuaCall(first, count);
 }
 
 /* ========================================================================== */
@@ -548,49 +665,33 @@ void VirtualMachine::ExecuteRETURN(RegisterIndex a, int b) {
 
 void VirtualMachine::ExecuteFORLOOP(RegisterIndex a, int sbx) {
     // FORLOOP A sBx: R(A) += R(A+2); if R(A) <?= R(A+1) then { pc += sBx; R(A+3) = R(A) }
-    LuaValue init = GetRegister(a);
-    LuaValue limit = GetRegister(a + 1);
-    LuaValue step = GetRegister(a + 2);
-    
-    if (!init.IsNumber() || !limit.IsNumber() || !step.IsNumber()) {
-        throw TypeError("For loop variables must be numbers");
-    }
-    
-    double new_init = init.GetNumber() + step.GetNumber();
-    SetRegister(a, LuaValue(new_init));
+    // FORPREP已保证三个控制变量都是数值，这里不再检查类型
+    LuaValue* ra = &Register(a);
+    double step = ra[2].GetNumber();
+    double index = ra[0].GetNumber() + step;
+    double limit = ra[1].GetNumber();
+    ra[0] = LuaValue(index);
     
-    bool continue_loop;
-    if (step.GetNumber() > 0) {
-        continue_loop = new_init <= limit.GetNumber();
-    } else {
-        continue_loop = new_init >= limit.GetNumber();
-    }
-    
-    if (continue_loop) {
-        instruction_pointer_ += sbx;
-        SetRegister(a + 3, LuaValue(new_init)); // 循环变量
+    if (step > 0 ? index <= limit : limit <= index) {
+        call_frames_.Top().AdvanceInstructionPointer(sbx);
+        ra[3] = LuaValue(index); // 循环变量
     }
 }
 
 void VirtualMachine::ExecuteFORPREP(RegisterIndex a, int sbx) {
     // FORPREP A sBx: R(A) -= R(A+2); pc += sBx
-    LuaValue init = GetRegister(a);
-    LuaValue step = GetRegister(a + 2);
-    
-    if (!init.IsNumber() || !step.IsNumber()) {
-        throw TypeError("For loop variables must be numbers");
-    }
+    CoerceForLoopValues(a);
     
-    double new_init = init.GetNumber() - step.GetNumber();
-    SetRegister(a, LuaValue(new_init));
+    LuaValue* ra = &Register(a);
+    ra[0] = LuaValue(ra[0].GetNumber() - ra[2].GetNumber());
     
-    instruction_pointer_ += sbx;
+    call_frames_.Top().AdvanceInstructionPointer(sbx);
 }
 
 void VirtualMachine::ExecuteTFORLOOP(RegisterIndex a, int c) {
     // TFORLOOP A C: R(A+3), ... ,R(A+2+C) := R(A)(R(A+1), R(A+2)); if R(A+3) ~= nil then R(A+2) = R(A+3) else pc++
     // TODO: 实现通用for循环
-    instruction_pointer_++; // 暂时跳过
+    call_frames_.Top().AdvanceInstructionPointer(); // 暂时跳过
 }
 
 /* ========================================================================== */
@@ -599,7 +700,7 @@ void VirtualMachine::ExecuteTFORLOOP(RegisterIndex a, int c) {
 
 void VirtualMachine::ExecuteSETLIST(RegisterIndex a, int b, int c) {
     // SETLIST A B C: R(A)[(C-1)*FPF+i] := R(A+i), 1 <= i <= B
-    LuaValue table = GetRegister(a);
+    const LuaValue& table = GetRegister(a);
     
     if (!table.IsTable()) {
         throw TypeError("Attempt to use SETLIST on non-table value");
@@ -614,12 +715,19 @@ void VirtualMachine::ExecuteSETLIST(RegisterIndex a, int b, int c) {
     constexpr Size FPF = 50;
     Size base_index = (c == 0) ? 0 : ((c - 1) * FPF);
     
-    Size count = (b == 0) ? (GetStackTop() - GetCurrentBase() - a - 1) : b;
+    Size count = (b == 0) ? (open_top_ - GetCurrentBase() - a - 1) : b;
+    
+    // 一次性扩展数组部分，后续写入直接落在数组槽上
+    Size last = base_index + count;
+    if (last > table_ptr->GetArraySize()) {
+        table_ptr->ResizeArray(last);
+    }
     
+    LuaTable& raw_table = table_ptr->GetTable();
     for (Size i = 1; i <= count; ++i) {
-        LuaValue value = GetRegister(a + i);
-        LuaValue index_key = LuaValue(static_cast<double>(base_index + i));
-        table_ptr->Set(index_key, std::move(value));
+        const LuaValue& value = GetRegister(a + i);
+        raw_table.SetInt(base_index + i, value);
+        table_ptr->WriteBarrier(value);
     }
     
     statistics_.table_operations++;
@@ -634,7 +742,8 @@ void VirtualMachine::ExecuteCLOSURE(RegisterIndex a, int bx) {
     // CLOSURE A Bx: R(A) := closure(KPROTO[Bx])
     // TODO: 实现闭包创建
     
-    if (!current_proto_ || bx >= current_proto_->protos.size()) {
+    if (!current_proto_ || (!current_proto_->IsVerified() &&
+                            static_cast<Size>(bx) >= current_proto_->GetSubProtoCount())) {
         throw VMExecutionError("Invalid proto index in CLOSURE");
     }
     
@@ -643,16 +752,28 @@ void VirtualMachine::ExecuteCLOSURE(RegisterIndex a, int bx) {
 }
 
 void VirtualMachine::ExecuteVARARG(RegisterIndex a, int b) {
-    // VARARG A B: R(A), R(A+1), ..., R(A+B-2) := vararg
-    // TODO: 实现变参处理
-    
+    // VARARG A B: R(A), R(A+1), ..., R(A+B-2) = vararg
+    // 变参位于函数槽和固定参数之后、帧基址之下（PrepareLuaCall移动固定参数时留下）
+    const CallFrame& frame = call_frames_.Top();
+    Size base = frame.GetBase();
+    Size first_vararg = frame.GetFunctionSlot() + 1 + current_proto_->GetParameterCount();
+    Size available = base > first_vararg ? base - first_vararg : 0;
+    
+    Size wanted;
     if (b == 0) {
-        // 将所有变参复制到寄存器
-    } else {
-        // 复制指定数量的变参
-        for (int i = 0; i < b - 1; i++) {
-            SetRegister(a + i, LuaValue()); // 暂时设为nil
+        wanted = available;
+        open_top_ = base + a + wanted;
+        if (GetStackTop() < open_top_) {
+            SetStackTop(open_top_);
         }
+    } else {
+        wanted = static_cast<Size>(b - 1);
+    }
+    
+    LuaValue* data = stack_->GetData();
+    LuaValue* ra = data + base + a;
+    for (Size i = 0; i < wanted; ++i) {
+        ra[i] = i < available ? data[first_vararg + i] : LuaValue();
     }
 }
 
@@ -0,0 +1,52 @@
+/**
+ * @file metamethod.h
+ * @brief 元方法事件
+ * @description 元方法事件枚举及其名称，对应Lua 5.1 ltm.h中的TMS
+ * @author Lua C++ Project
+ * @date 2025-09-27
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace lua_cpp {
+
+/**
+ * @brief 元方法事件（顺序与Lua 5.1的TMS一致）
+ */
+enum class MetaMethod {
+    Index,
+    NewIndex,
+    Gc,
+    Mode,
+    Eq,
+    Add,
+    Sub,
+    Mul,
+    Div,
+    Mod,
+    Pow,
+    Unm,
+    Len,
+    Lt,
+    Le,
+    Concat,
+    Call,
+    Count
+};
+
+/**
+ * @brief 获取元方法事件的键名（如"__add"）
+ */
+inline const char* GetMetaMethodName(MetaMethod event) {
+    static constexpr const char* kNames[static_cast<std::size_t>(MetaMethod::Count)] = {
+        "__index", "__newindex", "__gc", "__mode", "__eq",
+        "__add", "__sub", "__mul", "__div", "__mod",
+        "__pow", "__unm", "__len", "__lt", "__le",
+        "__concat", "__call"
+    };
+    return kNames[static_cast<std::size_t>(event)];
+}
+
+} // namespace lua_cpp
@@ -16,8 +16,8 @@ namespace lua_cpp {
 /* LuaStack构造和析构 */
 /* ========================================================================== */
 
-LuaStack::LuaStack(Size initial_size, Size max_size)
-    : max_size_(max_size), current_top_(0) {
+LuaStack::LuaStack(Size initial_size, Size max_size, MemoryManager& manager)
+    : stack_(StateAllocator<LuaValue>(manager)), max_size_(max_size), current_top_(0) {
     
     if (initial_size < VM_MIN_STACK_SIZE) {
         initial_size = VM_MIN_STACK_SIZE;
@@ -3,6 +3,7 @@
 #include "core/lua_common.h"
 #include "types/value.h"
 #include "core/lua_errors.h"
+#include "memory/state_allocator.h"
 #include <vector>
 #include <memory>
 
@@ -67,9 +68,11 @@ public:
      * @brief 构造函数
      * @param initial_size 初始堆栈大小
      * @param max_size 最大堆栈大小
+     * @param manager 分配堆栈存储的内存管理器（VM传入自己的管理器）
      */
     explicit LuaStack(Size initial_size = VM_DEFAULT_STACK_SIZE, 
-                     Size max_size = VM_MAX_STACK_SIZE);
+                     Size max_size = VM_MAX_STACK_SIZE,
+                     MemoryManager& manager = GetCurrentMemoryManager());
     
     /**
      * @brief 析构函数
@@ -161,6 +164,13 @@ public:
     const LuaValue& operator[](Size index) const { return Get(index); }
     LuaValue& operator[](Size index) { return Get(index); }
     
+    /**
+     * @brief 获取底层存储的首地址（不做边界检查）
+     * @note 任何可能扩展堆栈的操作都会使返回的指针失效
+     */
+    LuaValue* GetData() { return stack_.data(); }
+    const LuaValue* GetData() const { return stack_.data(); }
+    
     /* ====================================================================== */
     /* 堆栈状态查询 */
     /* ====================================================================== */
@@ -330,7 +340,7 @@ private:
     /* 成员变量 */
     /* ====================================================================== */
     
-    std::vector<LuaValue> stack_;   // 堆栈存储
+    std::vector<LuaValue, StateAllocator<LuaValue>> stack_;   // 堆栈存储（经宿主分配函数分配）
     Size top_;                      // 栈顶位置（元素数量）
     Size max_size_;                 // 最大堆栈大小
     Size initial_size_;             // 初始大小
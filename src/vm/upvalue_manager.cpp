@@ -12,9 +12,11 @@
 #include "../core/lua_common.h"
 #include "../core/lua_errors.h"
 #include "../memory/garbage_collector.h"
+#include "../memory/object_arena.h"
 #include <algorithm>
 #include <sstream>
 #include <iomanip>
+#include <new>
 
 namespace lua_cpp {
 
@@ -28,6 +30,7 @@ Upvalue::Upvalue(Size stack_index, LuaValue* stack_ptr)
     , stack_value_ptr_(stack_ptr)
     , closed_value_()
     , ref_count_(0)
+    , pool_(nullptr)
     , next_(nullptr)
     , prev_(nullptr) {
     
@@ -42,8 +45,27 @@ Upvalue::Upvalue(const LuaValue& closed_value)
     , stack_value_ptr_(nullptr)
     , closed_value_(closed_value)
     , ref_count_(0)
+    , pool_(nullptr)
     , next_(nullptr)
     , prev_(nullptr) {
+    NoteArenaValue();
+}
+
+Upvalue::~Upvalue() {
+    if (is_closed_) {
+        if (ObjectArena* arena = ObjectArena::GetActive()) {
+            arena->ForgetEscapedSlot(&closed_value_);
+        }
+    }
+}
+
+void Upvalue::NoteArenaValue() {
+    GCObject* obj = closed_value_.GetGCObject();
+    if (obj && obj->IsArenaAllocated()) {
+        if (ObjectArena* arena = ObjectArena::GetActive()) {
+            arena->RecordEscapedSlot(&closed_value_);
+        }
+    }
 }
 
 LuaValue& Upvalue::GetValue() {
@@ -71,6 +93,7 @@ const LuaValue& Upvalue::GetValue() const {
 void Upvalue::SetValue(const LuaValue& value) {
     if (is_closed_) {
         closed_value_ = value;
+        NoteArenaValue();
     } else {
         if (!stack_value_ptr_) {
             throw UpvalueAccessError("Invalid stack pointer for open upvalue");
@@ -82,6 +105,7 @@ void Upvalue::SetValue(const LuaValue& value) {
 void Upvalue::SetValue(LuaValue&& value) {
     if (is_closed_) {
         closed_value_ = std::move(value);
+        NoteArenaValue();
     } else {
         if (!stack_value_ptr_) {
             throw UpvalueAccessError("Invalid stack pointer for open upvalue");
@@ -120,9 +144,19 @@ void Upvalue::Close() {
         is_closed_ = true;
         stack_value_ptr_ = nullptr;
         stack_index_ = SIZE_MAX;
+        NoteArenaValue();
     }
 }
 
+bool Upvalue::ReleaseReference() {
+    if (RemoveReference() > 0 || !is_closed_ || !pool_) {
+        return false;
+    }
+    
+    pool_->Release(this);
+    return true;
+}
+
 bool Upvalue::PointsToStackIndex(Size stack_index) const {
     return !is_closed_ && stack_index_ == stack_index;
 }
@@ -137,10 +171,10 @@ Upvalue::UpvalueInfo Upvalue::GetInfo() const {
     info.value_type = value.TypeName();
     info.value_string = value.ToString();
     
-    // 计算内存使用
+    // 计算内存使用：闭合值内嵌在Upvalue中，额外计入其引用的GC对象
     info.memory_usage = sizeof(Upvalue);
-    if (is_closed_) {
-        info.memory_usage += value.GetMemoryUsage();
+    if (is_closed_ && value.IsGCObject() && value.GetGCObject() != nullptr) {
+        info.memory_usage += value.GetGCObject()->GetSize();
     }
     
     return info;
@@ -171,12 +205,65 @@ bool Upvalue::ValidateIntegrity() const {
         }
     }
     
-    // 检查引用计数
-    if (ref_count_ < 0) {
-        return false; // 引用计数不能为负
+    return true;
+}
+
+/* ========================================================================== */
+/* UpvaluePool类实现 */
+/* ========================================================================== */
+
+Upvalue* UpvaluePool::Acquire(Size stack_index, LuaValue* stack_ptr) {
+    if (!free_list_) {
+        Grow();
+    }
+    
+    Slot* slot = free_list_;
+    free_list_ = slot->next_free;
+    
+    Upvalue* upvalue;
+    try {
+        upvalue = new (slot->storage) Upvalue(stack_index, stack_ptr);
+    } catch (...) {
+        slot->next_free = free_list_;
+        free_list_ = slot;
+        throw;
     }
     
-    return true;
+    upvalue->pool_ = this;
+    live_count_++;
+    return upvalue;
+}
+
+void UpvaluePool::Release(Upvalue* upvalue) {
+    upvalue->~Upvalue();
+    
+    Slot* slot = reinterpret_cast<Slot*>(upvalue);
+    slot->next_free = free_list_;
+    free_list_ = slot;
+    live_count_--;
+    
+    if (detached_ && live_count_ == 0) {
+        delete this;
+    }
+}
+
+void UpvaluePool::Detach() {
+    detached_ = true;
+    if (live_count_ == 0) {
+        delete this;
+    }
+}
+
+void UpvaluePool::Grow() {
+    auto chunk = std::make_unique<Slot[]>(kChunkSize);
+    
+    // 逆序挂入，使分配顺序与地址顺序一致
+    for (Size i = kChunkSize; i > 0; --i) {
+        chunk[i - 1].next_free = free_list_;
+        free_list_ = &chunk[i - 1];
+    }
+    
+    chunks_.push_back(std::move(chunk));
 }
 
 /* ========================================================================== */
@@ -185,10 +272,11 @@ bool Upvalue::ValidateIntegrity() const {
 
 UpvalueManager::UpvalueManager(LuaStack* stack)
     : stack_(stack)
-    , upvalue_map_()
-    , open_upvalue_head_(nullptr)
-    , upvalue_cache_()
-    , cache_access_counter_(0)
+    , pool_(std::make_unique<UpvaluePool>())
+    , open_upvalues_(nullptr)
+    , open_count_(0)
+    , lookup_count_(0)
+    , lookup_hits_(0)
     , statistics_()
     , config_()
     , gc_() {
@@ -202,198 +290,115 @@ UpvalueManager::UpvalueManager(LuaStack* stack)
     config_.cleanup_threshold = 100;
     config_.enable_sharing_optimization = true;
     config_.enable_statistics = true;
-    config_.max_upvalue_cache_size = 1000;
     
     ResetStatistics();
 }
 
 UpvalueManager::~UpvalueManager() {
-    // 闭合所有开放的Upvalue
+    // 闭合所有开放的Upvalue；仍被闭包引用的留在池中，池随最后一个引用的释放而销毁
     CloseAllUpvalues();
-    
-    // 清理缓存
-    upvalue_cache_.clear();
-    
-    // 清空映射表
-    upvalue_map_.clear();
+    pool_.release()->Detach();
 }
 
 /* ========================================================================== */
 /* 核心Upvalue操作 */
 /* ========================================================================== */
 
-std::shared_ptr<Upvalue> UpvalueManager::GetUpvalue(Size stack_index) {
-    // 更新访问统计
-    cache_access_counter_++;
+Upvalue* UpvalueManager::GetUpvalue(Size stack_index) {
+    lookup_count_++;
+    
+    // 链表按栈索引降序，走到第一个不大于目标的节点即可确定是否已存在
+    Upvalue* prev = FindInsertionPoint(stack_index);
+    Upvalue* candidate = prev ? prev->next_ : open_upvalues_;
+    if (candidate && candidate->stack_index_ == stack_index) {
+        lookup_hits_++;
+        return candidate;
+    }
     
-    // 首先查找现有的Upvalue
-    auto existing = FindUpvalue(stack_index);
-    if (existing) {
-        UpdateAccessStatistics(existing, true);
-        return existing;
+    if (stack_index >= stack_->GetCapacity()) {
+        throw UpvalueError("Stack index out of bounds: " + std::to_string(stack_index));
     }
     
-    // 如果不存在，创建新的
-    auto new_upvalue = CreateUpvalue(stack_index);
-    UpdateAccessStatistics(new_upvalue, false);
+    Upvalue* upvalue = pool_->Acquire(stack_index, &stack_->Get(stack_index));
+    LinkOpenUpvalue(upvalue, prev);
     
-    return new_upvalue;
+    if (config_.enable_statistics) {
+        statistics_.upvalues_created++;
+        statistics_.peak_upvalue_count = std::max(statistics_.peak_upvalue_count,
+                                                pool_->GetLiveCount());
+    }
+    
+    return upvalue;
 }
 
-std::shared_ptr<Upvalue> UpvalueManager::CreateUpvalue(Size stack_index) {
+Upvalue* UpvalueManager::CreateUpvalue(Size stack_index) {
     // 验证栈索引
     if (stack_index >= stack_->GetCapacity()) {
         throw UpvalueError("Stack index out of bounds: " + std::to_string(stack_index));
     }
     
-    // 获取栈值指针
-    LuaValue* stack_ptr = &stack_->Get(stack_index);
-    
-    // 创建新的Upvalue
-    auto upvalue = std::make_shared<Upvalue>(stack_index, stack_ptr);
-    
-    // 插入到映射表中
-    upvalue_map_[stack_index] = upvalue;
+    Upvalue* prev = FindInsertionPoint(stack_index);
+    Upvalue* next = prev ? prev->next_ : open_upvalues_;
+    if (next && next->stack_index_ == stack_index) {
+        throw UpvalueError("Open upvalue already exists at index: " + std::to_string(stack_index));
+    }
     
-    // 插入到有序链表中（用于快速遍历和闭合）
-    InsertUpvalueOrdered(upvalue);
+    Upvalue* upvalue = pool_->Acquire(stack_index, &stack_->Get(stack_index));
+    LinkOpenUpvalue(upvalue, prev);
     
     // 更新统计
     if (config_.enable_statistics) {
         statistics_.upvalues_created++;
-        statistics_.total_upvalues++;
-        statistics_.open_upvalues++;
-        statistics_.peak_upvalue_count = std::max(statistics_.peak_upvalue_count, 
-                                                statistics_.total_upvalues);
-    }
-    
-    // 检查是否需要自动清理
-    if (config_.enable_automatic_cleanup && 
-        upvalue_map_.size() >= config_.cleanup_threshold) {
-        PerformAutomaticCleanup();
+        statistics_.peak_upvalue_count = std::max(statistics_.peak_upvalue_count,
+                                                pool_->GetLiveCount());
     }
     
     return upvalue;
 }
 
-std::shared_ptr<Upvalue> UpvalueManager::FindUpvalue(Size stack_index) {
-    // 首先检查缓存
-    auto cache_it = upvalue_cache_.find(stack_index);
-    if (cache_it != upvalue_cache_.end()) {
-        // 更新访问时间
-        cache_it->second.last_access_time = cache_access_counter_;
-        cache_it->second.access_count++;
-        return cache_it->second.upvalue;
-    }
-    
-    // 在主映射中查找
-    auto it = upvalue_map_.find(stack_index);
-    if (it != upvalue_map_.end()) {
-        // 添加到缓存
-        if (upvalue_cache_.size() < config_.max_upvalue_cache_size) {
-            UpvalueCacheEntry entry;
-            entry.upvalue = it->second;
-            entry.last_access_time = cache_access_counter_;
-            entry.access_count = 1;
-            upvalue_cache_[stack_index] = entry;
+Upvalue* UpvalueManager::FindUpvalue(Size stack_index) {
+    for (Upvalue* uv = open_upvalues_; uv && uv->stack_index_ >= stack_index; uv = uv->next_) {
+        if (uv->stack_index_ == stack_index) {
+            return uv;
         }
-        
-        return it->second;
     }
-    
     return nullptr;
 }
 
 void UpvalueManager::CloseUpvalues(Size level) {
-    std::vector<Size> to_close;
-    
-    // 收集需要闭合的Upvalue
-    for (auto& pair : upvalue_map_) {
-        Size stack_index = pair.first;
-        auto& upvalue = pair.second;
-        
-        if (!upvalue->IsClosed() && stack_index >= level) {
-            to_close.push_back(stack_index);
-        }
-    }
-    
-    // 闭合Upvalue
-    for (Size stack_index : to_close) {
-        auto it = upvalue_map_.find(stack_index);
-        if (it != upvalue_map_.end()) {
-            it->second->Close();
-            
-            // 更新统计
-            if (config_.enable_statistics) {
-                statistics_.upvalues_closed++;
-                statistics_.open_upvalues--;
-                statistics_.closed_upvalues++;
-            }
-            
-            // 从缓存中移除
-            upvalue_cache_.erase(stack_index);
-        }
+    // 链表头是栈索引最大的节点，遇到第一个低于level的节点即停止
+    while (open_upvalues_ && open_upvalues_->stack_index_ >= level) {
+        Upvalue* upvalue = open_upvalues_;
+        UnlinkOpenUpvalue(upvalue);
+        CloseAndRelease(upvalue);
     }
 }
 
 void UpvalueManager::CloseAllUpvalues() {
-    for (auto& pair : upvalue_map_) {
-        auto& upvalue = pair.second;
-        if (!upvalue->IsClosed()) {
-            upvalue->Close();
-            
-            // 更新统计
-            if (config_.enable_statistics) {
-                statistics_.upvalues_closed++;
-                statistics_.open_upvalues--;
-                statistics_.closed_upvalues++;
-            }
-        }
+    while (open_upvalues_) {
+        Upvalue* upvalue = open_upvalues_;
+        UnlinkOpenUpvalue(upvalue);
+        CloseAndRelease(upvalue);
     }
-    
-    // 清空缓存
-    upvalue_cache_.clear();
 }
 
-void UpvalueManager::RemoveUpvalue(std::shared_ptr<Upvalue> upvalue) {
+void UpvalueManager::RemoveUpvalue(Upvalue* upvalue) {
     if (!upvalue) {
         return;
     }
     
-    // 从映射表中查找并移除
-    for (auto it = upvalue_map_.begin(); it != upvalue_map_.end(); ++it) {
-        if (it->second == upvalue) {
-            Size stack_index = it->first;
-            
-            // 从链表中移除
-            RemoveUpvalueFromList(upvalue);
-            
-            // 从映射表中移除
-            upvalue_map_.erase(it);
-            
-            // 从缓存中移除
-            upvalue_cache_.erase(stack_index);
-            
-            // 更新统计
-            if (config_.enable_statistics) {
-                statistics_.total_upvalues--;
-                if (upvalue->IsClosed()) {
-                    statistics_.closed_upvalues--;
-                } else {
-                    statistics_.open_upvalues--;
-                }
-            }
-            
-            break;
-        }
+    if (!upvalue->IsClosed()) {
+        UnlinkOpenUpvalue(upvalue);
     }
+    
+    ReleaseUpvalue(upvalue);
 }
 
 /* ========================================================================== */
 /* 生命周期管理 */
 /* ========================================================================== */
 
-void UpvalueManager::AddReference(std::shared_ptr<Upvalue> upvalue) {
+void UpvalueManager::AddReference(Upvalue* upvalue) {
     if (upvalue) {
         upvalue->AddReference();
         
@@ -404,13 +409,11 @@ void UpvalueManager::AddReference(std::shared_ptr<Upvalue> upvalue) {
     }
 }
 
-bool UpvalueManager::RemoveReference(std::shared_ptr<Upvalue> upvalue) {
+bool UpvalueManager::RemoveReference(Upvalue* upvalue) {
     if (!upvalue) {
         return false;
     }
     
-    Size new_ref_count = upvalue->RemoveReference();
-    
     // 更新统计
     if (config_.enable_statistics) {
         if (statistics_.total_references > 0) {
@@ -418,70 +421,34 @@ bool UpvalueManager::RemoveReference(std::shared_ptr<Upvalue> upvalue) {
         }
     }
     
-    // 如果引用计数为零，考虑回收
-    if (new_ref_count == 0) {
-        // 检查是否应该立即回收
-        if (upvalue->IsClosed()) {
-            // 闭合的Upvalue没有引用时可以安全回收
-            RemoveUpvalue(upvalue);
-            
-            // 更新统计
-            if (config_.enable_statistics) {
-                statistics_.upvalues_collected++;
-            }
-            
-            return true;
-        }
+    // 闭合的Upvalue没有引用时归还所属的池；开放的留到闭合时回收
+    bool collected = upvalue->ReleaseReference();
+    if (collected && config_.enable_statistics) {
+        statistics_.upvalues_collected++;
     }
-    
-    return false;
+    return collected;
 }
 
 Size UpvalueManager::CleanupUnreferencedUpvalues() {
     Size cleaned_count = 0;
-    std::vector<std::shared_ptr<Upvalue>> to_remove;
     
-    // 收集无引用的Upvalue
-    for (auto& pair : upvalue_map_) {
-        auto& upvalue = pair.second;
-        if (!upvalue->HasReferences()) {
-            to_remove.push_back(upvalue);
+    // 闭合的Upvalue在引用归零时已经回收，这里只需处理开放链表
+    Upvalue* uv = open_upvalues_;
+    while (uv) {
+        Upvalue* next = uv->next_;
+        if (!uv->HasReferences()) {
+            UnlinkOpenUpvalue(uv);
+            ReleaseUpvalue(uv);
+            cleaned_count++;
         }
-    }
-    
-    // 移除无引用的Upvalue
-    for (auto& upvalue : to_remove) {
-        RemoveUpvalue(upvalue);
-        cleaned_count++;
-    }
-    
-    // 更新统计
-    if (config_.enable_statistics) {
-        statistics_.upvalues_collected += cleaned_count;
+        uv = next;
     }
     
     return cleaned_count;
 }
 
 Size UpvalueManager::ForceGarbageCollection() {
-    Size collected_count = 0;
-    
-    // 首先清理无引用的Upvalue
-    collected_count += CleanupUnreferencedUpvalues();
-    
-    // 清理缓存中的过期条目
-    auto cache_it = upvalue_cache_.begin();
-    while (cache_it != upvalue_cache_.end()) {
-        // 检查缓存条目是否过期或无效
-        if (!cache_it->second.upvalue || 
-            cache_access_counter_ - cache_it->second.last_access_time > 1000) {
-            cache_it = upvalue_cache_.erase(cache_it);
-        } else {
-            ++cache_it;
-        }
-    }
-    
-    return collected_count;
+    return CleanupUnreferencedUpvalues();
 }
 
 /* ========================================================================== */
@@ -495,55 +462,33 @@ void UpvalueManager::UpdateStackReferences(LuaValue* old_stack, LuaValue* new_st
     
     ptrdiff_t offset = new_stack - old_stack;
     
-    // 更新所有开放Upvalue的栈指针
-    for (auto& pair : upvalue_map_) {
-        auto& upvalue = pair.second;
-        if (!upvalue->IsClosed()) {
-            LuaValue* old_ptr = upvalue->GetValuePtr();
-            if (old_ptr >= old_stack && old_ptr < old_stack + stack_->GetCapacity()) {
-                // 更新指针到新位置
-                LuaValue* new_ptr = old_ptr + offset;
-                // 这里需要访问Upvalue的私有成员，实际实现中可能需要友元函数
-                // 或者提供专门的更新方法
-            }
-        }
+    // 只有开放Upvalue指向栈
+    for (Upvalue* uv = open_upvalues_; uv; uv = uv->next_) {
+        uv->stack_value_ptr_ += offset;
     }
 }
 
 void UpvalueManager::MigrateUpvalue(Size old_index, Size new_index) {
-    auto it = upvalue_map_.find(old_index);
-    if (it != upvalue_map_.end()) {
-        auto upvalue = it->second;
-        
-        // 更新映射表
-        upvalue_map_.erase(it);
-        upvalue_map_[new_index] = upvalue;
-        
-        // 更新缓存
-        auto cache_it = upvalue_cache_.find(old_index);
-        if (cache_it != upvalue_cache_.end()) {
-            UpvalueCacheEntry entry = cache_it->second;
-            upvalue_cache_.erase(cache_it);
-            upvalue_cache_[new_index] = entry;
-        }
-        
-        // 更新Upvalue内部的栈索引
-        if (!upvalue->IsClosed()) {
-            // 这里需要更新Upvalue内部状态
-            // 实际实现中需要提供相应的接口
-        }
+    Upvalue* upvalue = FindUpvalue(old_index);
+    if (!upvalue || old_index == new_index) {
+        return;
     }
+    
+    if (FindUpvalue(new_index)) {
+        throw UpvalueError("Open upvalue already exists at index: " + std::to_string(new_index));
+    }
+    
+    // 重新按新索引插入以保持链表有序
+    UnlinkOpenUpvalue(upvalue);
+    upvalue->stack_index_ = new_index;
+    upvalue->stack_value_ptr_ = &stack_->Get(new_index);
+    LinkOpenUpvalue(upvalue, FindInsertionPoint(new_index));
 }
 
 void UpvalueManager::Clear() {
     // 闭合所有Upvalue
     CloseAllUpvalues();
     
-    // 清空所有容器
-    upvalue_map_.clear();
-    upvalue_cache_.clear();
-    open_upvalue_head_.reset();
-    
     // 重置统计
     ResetStatistics();
 }
@@ -552,30 +497,10 @@ void UpvalueManager::Clear() {
 /* 查询和统计 */
 /* ========================================================================== */
 
-Size UpvalueManager::GetOpenUpvalueCount() const {
-    Size count = 0;
-    for (const auto& pair : upvalue_map_) {
-        if (!pair.second->IsClosed()) {
-            count++;
-        }
-    }
-    return count;
-}
-
-Size UpvalueManager::GetClosedUpvalueCount() const {
-    Size count = 0;
-    for (const auto& pair : upvalue_map_) {
-        if (pair.second->IsClosed()) {
-            count++;
-        }
-    }
-    return count;
-}
-
 Size UpvalueManager::GetTotalReferenceCount() const {
     Size total = 0;
-    for (const auto& pair : upvalue_map_) {
-        total += pair.second->GetReferenceCount();
+    for (const Upvalue* uv = open_upvalues_; uv; uv = uv->next_) {
+        total += uv->GetReferenceCount();
     }
     return total;
 }
@@ -590,7 +515,8 @@ Size UpvalueManager::GetMemoryUsage() const {
 
 void UpvalueManager::ResetStatistics() {
     statistics_ = UpvalueStatistics{};
-    cache_access_counter_ = 0;
+    lookup_count_ = 0;
+    lookup_hits_ = 0;
 }
 
 void UpvalueManager::UpdateStatistics() {
@@ -598,24 +524,18 @@ void UpvalueManager::UpdateStatistics() {
         return;
     }
     
-    statistics_.total_upvalues = upvalue_map_.size();
+    statistics_.total_upvalues = pool_->GetLiveCount();
     statistics_.open_upvalues = GetOpenUpvalueCount();
     statistics_.closed_upvalues = GetClosedUpvalueCount();
-    statistics_.total_references = GetTotalReferenceCount();
     statistics_.memory_usage = GetMemoryUsage();
     
-    // 计算无引用的Upvalue数量
+    // 闭合的Upvalue至少有一个引用（否则已被回收），只需统计开放链表
     statistics_.unreferenced_upvalues = 0;
-    for (const auto& pair : upvalue_map_) {
-        if (!pair.second->HasReferences()) {
-            statistics_.unreferenced_upvalues++;
-        }
-    }
-    
-    // 计算共享的Upvalue数量（引用计数 > 1）
     statistics_.shared_upvalues = 0;
-    for (const auto& pair : upvalue_map_) {
-        if (pair.second->GetReferenceCount() > 1) {
+    for (const Upvalue* uv = open_upvalues_; uv; uv = uv->next_) {
+        if (!uv->HasReferences()) {
+            statistics_.unreferenced_upvalues++;
+        } else if (uv->GetReferenceCount() > 1) {
             statistics_.shared_upvalues++;
         }
     }
@@ -626,13 +546,9 @@ void UpvalueManager::UpdateStatistics() {
                                         statistics_.total_upvalues;
     }
     
-    // 计算命中率（基于缓存访问）
-    if (cache_access_counter_ > 0) {
-        Size cache_hits = 0;
-        for (const auto& entry : upvalue_cache_) {
-            cache_hits += entry.second.access_count;
-        }
-        statistics_.hit_rate = static_cast<double>(cache_hits) / cache_access_counter_;
+    // 计算命中率（GetUpvalue复用已有开放Upvalue的比例）
+    if (lookup_count_ > 0) {
+        statistics_.hit_rate = static_cast<double>(lookup_hits_) / lookup_count_;
     }
 }
 
@@ -644,62 +560,28 @@ UpvalueManager::ValidationResult UpvalueManager::ValidateIntegrity() const {
     ValidationResult result;
     result.is_valid = true;
     
-    // 验证每个Upvalue的完整性
-    for (const auto& pair : upvalue_map_) {
-        const auto& upvalue = pair.second;
-        if (!upvalue->ValidateIntegrity()) {
+    // 验证每个开放Upvalue的完整性
+    for (const Upvalue* uv = open_upvalues_; uv; uv = uv->next_) {
+        if (!uv->ValidateIntegrity()) {
             result.is_valid = false;
             result.issues.push_back("Upvalue integrity check failed for index: " + 
-                                  std::to_string(pair.first));
+                                  std::to_string(uv->GetStackIndex()));
         }
     }
     
-    // 验证统计数据一致性
-    Size actual_open = GetOpenUpvalueCount();
-    Size actual_closed = GetClosedUpvalueCount();
-    Size actual_total = upvalue_map_.size();
-    
-    if (config_.enable_statistics) {
-        if (statistics_.open_upvalues != actual_open) {
-            result.warnings.push_back("Open upvalue count mismatch: recorded=" + 
-                                    std::to_string(statistics_.open_upvalues) + 
-                                    ", actual=" + std::to_string(actual_open));
-        }
-        
-        if (statistics_.closed_upvalues != actual_closed) {
-            result.warnings.push_back("Closed upvalue count mismatch: recorded=" + 
-                                    std::to_string(statistics_.closed_upvalues) + 
-                                    ", actual=" + std::to_string(actual_closed));
-        }
-        
-        if (statistics_.total_upvalues != actual_total) {
-            result.warnings.push_back("Total upvalue count mismatch: recorded=" + 
-                                    std::to_string(statistics_.total_upvalues) + 
-                                    ", actual=" + std::to_string(actual_total));
-        }
+    // 验证链表结构
+    if (!ValidateUpvalueList()) {
+        result.is_valid = false;
+        result.issues.push_back("Open upvalue list is not strictly ordered by stack index");
     }
     
-    // 验证缓存一致性
-    for (const auto& cache_entry : upvalue_cache_) {
-        Size stack_index = cache_entry.first;
-        auto map_it = upvalue_map_.find(stack_index);
-        
-        if (map_it == upvalue_map_.end() || 
-            map_it->second != cache_entry.second.upvalue) {
-            result.issues.push_back("Cache inconsistency for index: " + 
-                                  std::to_string(stack_index));
-            result.is_valid = false;
-        }
+    if (pool_->GetLiveCount() < open_count_) {
+        result.is_valid = false;
+        result.issues.push_back("Open upvalue count exceeds live pool objects");
     }
     
     // 性能建议
-    if (statistics_.hit_rate < 0.8 && cache_access_counter_ > 100) {
-        result.performance_tips.push_back("Low cache hit rate (" + 
-                                        std::to_string(statistics_.hit_rate * 100) + 
-                                        "%). Consider optimizing access patterns.");
-    }
-    
-    if (statistics_.unreferenced_upvalues > statistics_.total_upvalues * 0.2) {
+    if (statistics_.unreferenced_upvalues > open_count_ * 0.2) {
         result.performance_tips.push_back("High number of unreferenced upvalues (" + 
                                         std::to_string(statistics_.unreferenced_upvalues) + 
                                         "). Consider more frequent cleanup.");
@@ -711,11 +593,10 @@ UpvalueManager::ValidationResult UpvalueManager::ValidateIntegrity() const {
 std::string UpvalueManager::GetDebugInfo() const {
     std::stringstream ss;
     ss << "=== Upvalue Manager Debug Info ===\n";
-    ss << "Total Upvalues: " << upvalue_map_.size() << "\n";
+    ss << "Total Upvalues: " << GetUpvalueCount() << "\n";
     ss << "Open Upvalues: " << GetOpenUpvalueCount() << "\n";
     ss << "Closed Upvalues: " << GetClosedUpvalueCount() << "\n";
-    ss << "Cache Size: " << upvalue_cache_.size() << "\n";
-    ss << "Total References: " << GetTotalReferenceCount() << "\n";
+    ss << "Pool Capacity: " << pool_->GetCapacity() << "\n";
     ss << "Memory Usage: " << GetMemoryUsage() << " bytes\n";
     
     if (config_.enable_statistics) {
@@ -741,17 +622,16 @@ std::string UpvalueManager::GenerateReport() const {
     
     // 基础信息
     ss << "Basic Information:\n";
-    ss << "  Total Upvalues: " << upvalue_map_.size() << "\n";
+    ss << "  Total Upvalues: " << GetUpvalueCount() << "\n";
     ss << "  Open Upvalues: " << GetOpenUpvalueCount() << "\n";
     ss << "  Closed Upvalues: " << GetClosedUpvalueCount() << "\n";
-    ss << "  Total References: " << GetTotalReferenceCount() << "\n";
     ss << "  Memory Usage: " << GetMemoryUsage() << " bytes\n\n";
     
-    // 缓存信息
-    ss << "Cache Information:\n";
-    ss << "  Cache Size: " << upvalue_cache_.size() << "/" 
-       << config_.max_upvalue_cache_size << "\n";
-    ss << "  Cache Accesses: " << cache_access_counter_ << "\n";
+    // 对象池信息
+    ss << "Pool Information:\n";
+    ss << "  Live Objects: " << pool_->GetLiveCount() << "/" 
+       << pool_->GetCapacity() << "\n";
+    ss << "  Lookups: " << lookup_count_ << "\n";
     if (config_.enable_statistics) {
         ss << "  Hit Rate: " << (statistics_.hit_rate * 100) << "%\n";
     }
@@ -774,8 +654,7 @@ std::string UpvalueManager::GenerateReport() const {
     ss << "  Auto Cleanup: " << (config_.enable_automatic_cleanup ? "Enabled" : "Disabled") << "\n";
     ss << "  Cleanup Threshold: " << config_.cleanup_threshold << "\n";
     ss << "  Sharing Optimization: " << (config_.enable_sharing_optimization ? "Enabled" : "Disabled") << "\n";
-    ss << "  Statistics: " << (config_.enable_statistics ? "Enabled" : "Disabled") << "\n";
-    ss << "  Max Cache Size: " << config_.max_upvalue_cache_size << "\n\n";
+    ss << "  Statistics: " << (config_.enable_statistics ? "Enabled" : "Disabled") << "\n\n";
     
     // 验证结果
     auto validation = ValidateIntegrity();
@@ -807,94 +686,112 @@ std::string UpvalueManager::GenerateReport() const {
 
 std::vector<Upvalue::UpvalueInfo> UpvalueManager::ExportUpvalueStates() const {
     std::vector<Upvalue::UpvalueInfo> states;
-    states.reserve(upvalue_map_.size());
+    states.reserve(open_count_);
     
-    for (const auto& pair : upvalue_map_) {
-        states.push_back(pair.second->GetInfo());
+    for (const Upvalue* uv = open_upvalues_; uv; uv = uv->next_) {
+        states.push_back(uv->GetInfo());
     }
     
     return states;
 }
 
 bool UpvalueManager::CheckForMemoryLeaks() const {
-    // 检查是否有无引用但未回收的Upvalue
+    // 检查是否有无引用但仍挂在开放链表上的Upvalue
     Size unreferenced_count = 0;
-    for (const auto& pair : upvalue_map_) {
-        if (!pair.second->HasReferences()) {
+    for (const Upvalue* uv = open_upvalues_; uv; uv = uv->next_) {
+        if (!uv->HasReferences()) {
             unreferenced_count++;
         }
     }
     
     // 如果无引用的Upvalue超过20%，可能存在内存泄漏
-    return unreferenced_count > upvalue_map_.size() * 0.2;
+    return unreferenced_count > open_count_ * 0.2;
 }
 
 /* ========================================================================== */
 /* 私有方法 */
 /* ========================================================================== */
 
-void UpvalueManager::InsertUpvalueOrdered(std::shared_ptr<Upvalue> upvalue) {
-    // 简化实现：不维护有序链表
-    // 实际应用中可以维护按栈索引排序的链表以优化闭合操作
+void UpvalueManager::LinkOpenUpvalue(Upvalue* upvalue, Upvalue* prev) {
+    Upvalue* next = prev ? prev->next_ : open_upvalues_;
+    
+    upvalue->prev_ = prev;
+    upvalue->next_ = next;
+    if (next) {
+        next->prev_ = upvalue;
+    }
+    if (prev) {
+        prev->next_ = upvalue;
+    } else {
+        open_upvalues_ = upvalue;
+    }
+    
+    open_count_++;
 }
 
-void UpvalueManager::RemoveUpvalueFromList(std::shared_ptr<Upvalue> upvalue) {
-    // 简化实现：与InsertUpvalueOrdered对应
+void UpvalueManager::UnlinkOpenUpvalue(Upvalue* upvalue) {
+    if (upvalue->prev_) {
+        upvalue->prev_->next_ = upvalue->next_;
+    } else {
+        open_upvalues_ = upvalue->next_;
+    }
+    if (upvalue->next_) {
+        upvalue->next_->prev_ = upvalue->prev_;
+    }
+    
+    upvalue->next_ = nullptr;
+    upvalue->prev_ = nullptr;
+    open_count_--;
 }
 
-void UpvalueManager::UpdateAccessStatistics(std::shared_ptr<Upvalue> upvalue, bool is_hit) {
-    if (!config_.enable_statistics) {
-        return;
+Upvalue* UpvalueManager::FindInsertionPoint(Size stack_index) const {
+    Upvalue* prev = nullptr;
+    for (Upvalue* uv = open_upvalues_; uv && uv->stack_index_ > stack_index; uv = uv->next_) {
+        prev = uv;
     }
-    
-    // 更新命中率统计
-    // 实际实现中可以维护更详细的统计信息
+    return prev;
 }
 
-void UpvalueManager::PerformAutomaticCleanup() {
-    if (!config_.enable_automatic_cleanup) {
+void UpvalueManager::CloseAndRelease(Upvalue* upvalue) {
+    if (config_.enable_statistics) {
+        statistics_.upvalues_closed++;
+    }
+    
+    if (!upvalue->HasReferences()) {
+        ReleaseUpvalue(upvalue);
         return;
     }
     
-    // 执行清理操作
-    CleanupUnreferencedUpvalues();
+    upvalue->Close();
+}
+
+void UpvalueManager::ReleaseUpvalue(Upvalue* upvalue) {
+    pool_->Release(upvalue);
     
-    // 清理缓存
-    if (upvalue_cache_.size() > config_.max_upvalue_cache_size) {
-        // 移除最少使用的缓存条目
-        auto min_it = std::min_element(upvalue_cache_.begin(), upvalue_cache_.end(),
-            [](const auto& a, const auto& b) {
-                return a.second.last_access_time < b.second.last_access_time;
-            });
-        
-        if (min_it != upvalue_cache_.end()) {
-            upvalue_cache_.erase(min_it);
-        }
+    if (config_.enable_statistics) {
+        statistics_.upvalues_collected++;
     }
 }
 
 bool UpvalueManager::ValidateUpvalueList() const {
-    // 验证链表结构完整性（如果维护链表的话）
-    return true;
+    Size count = 0;
+    const Upvalue* prev = nullptr;
+    for (const Upvalue* uv = open_upvalues_; uv; uv = uv->next_) {
+        if (uv->prev_ != prev || uv->IsClosed()) {
+            return false;
+        }
+        if (prev && prev->stack_index_ <= uv->stack_index_) {
+            return false;
+        }
+        prev = uv;
+        count++;
+    }
+    return count == open_count_;
 }
 
 Size UpvalueManager::CalculateMemoryUsage() const {
-    Size total = sizeof(UpvalueManager);
-    
-    // Upvalue存储
-    total += upvalue_map_.size() * (sizeof(Size) + sizeof(std::shared_ptr<Upvalue>));
-    
-    for (const auto& pair : upvalue_map_) {
-        total += sizeof(Upvalue);
-        if (pair.second->IsClosed()) {
-            total += pair.second->GetValue().GetMemoryUsage();
-        }
-    }
-    
-    // 缓存存储
-    total += upvalue_cache_.size() * sizeof(UpvalueCacheEntry);
-    
-    return total;
+    // Upvalue全部位于对象池中，池容量即存储开销
+    return sizeof(UpvalueManager) + pool_->GetMemoryUsage();
 }
 
 /* ========================================================================== */
@@ -914,7 +811,6 @@ std::unique_ptr<UpvalueManager> CreateHighPerformanceUpvalueManager(LuaStack* st
     config.cleanup_threshold = 500;  // 更高的阈值
     config.enable_sharing_optimization = true;
     config.enable_statistics = false;  // 禁用统计以提升性能
-    config.max_upvalue_cache_size = 2000;  // 更大的缓存
     
     manager->SetConfig(config);
     return manager;
@@ -929,7 +825,6 @@ std::unique_ptr<UpvalueManager> CreateDebugUpvalueManager(LuaStack* stack) {
     config.cleanup_threshold = 50;   // 更低的阈值，更频繁清理
     config.enable_sharing_optimization = true;
     config.enable_statistics = true; // 启用详细统计
-    config.max_upvalue_cache_size = 100;  // 较小的缓存便于调试
     
     manager->SetConfig(config);
     return manager;
@@ -5,7 +5,6 @@
 #include "core/lua_errors.h"
 #include <memory>
 #include <vector>
-#include <unordered_map>
 #include <unordered_set>
 
 namespace lua_cpp {
@@ -16,6 +15,7 @@ namespace lua_cpp {
 
 class LuaStack;
 class GarbageCollector;
+class UpvaluePool;
 
 /* ========================================================================== */
 /* Upvalue错误类型 */
@@ -46,7 +46,10 @@ public:
 /**
  * @brief Upvalue实体
  * 
- * Lua闭包中的上值，可以是开放的（指向栈上的值）或闭合的（持有副本）
+ * Lua闭包中的上值，可以是开放的（指向栈上的值）或闭合的（持有副本）。
+ * 实例由UpvalueManager的内存池分配，开放状态时通过next_/prev_挂在
+ * 按栈索引降序排列的侵入式链表上。闭合后的存储由闭包的引用计数决定：
+ * 最后一个引用经ReleaseReference释放时归还所属的池，不依赖管理器存活。
  */
 class Upvalue {
 public:
@@ -64,15 +67,15 @@ public:
     explicit Upvalue(const LuaValue& closed_value);
     
     /**
-     * @brief 析构函数
+     * @brief 析构函数（撤销arena作用域中登记的值槽）
      */
-    ~Upvalue() = default;
+    ~Upvalue();
     
-    // 禁用拷贝，允许移动
+    // 禁用拷贝和移动（实例地址被链表和闭包直接引用）
     Upvalue(const Upvalue&) = delete;
     Upvalue& operator=(const Upvalue&) = delete;
-    Upvalue(Upvalue&&) = default;
-    Upvalue& operator=(Upvalue&&) = default;
+    Upvalue(Upvalue&&) = delete;
+    Upvalue& operator=(Upvalue&&) = delete;
     
     /* ====================================================================== */
     /* 值访问 */
@@ -144,6 +147,14 @@ public:
         return ref_count_; 
     }
     
+    /**
+     * @brief 闭包释放引用：已闭合且没有引用时归还所属对象池
+     * @return 是否已被回收
+     * @note 不经过UpvalueManager，管理器析构后闭包仍可安全释放；
+     *       开放的Upvalue留到闭合时由管理器回收
+     */
+    bool ReleaseReference();
+    
     /**
      * @brief 获取引用计数
      */
@@ -202,6 +213,14 @@ public:
     bool ValidateIntegrity() const;
 
 private:
+    friend class UpvalueManager;
+    friend class UpvaluePool;
+    
+    /**
+     * @brief 闭合值是arena对象时登记值槽，作用域结束时疏散
+     */
+    void NoteArenaValue();
+    
     /* ====================================================================== */
     /* 成员变量 */
     /* ====================================================================== */
@@ -211,10 +230,86 @@ private:
     LuaValue* stack_value_ptr_;         // 栈值指针（开放状态）
     LuaValue closed_value_;             // 闭合值（闭合状态）
     Size ref_count_;                    // 引用计数
+    UpvaluePool* pool_;                 // 所属对象池（独立构造的为nullptr）
+    
+    // 链表指针（开放链表按栈索引降序；空闲时next_复用为池的空闲链）
+    Upvalue* next_;                     // 下一个Upvalue（栈索引更小）
+    Upvalue* prev_;                     // 上一个Upvalue（栈索引更大）
+};
+
+/* ========================================================================== */
+/* Upvalue内存池 */
+/* ========================================================================== */
+
+/**
+ * @brief Upvalue对象池
+ * 
+ * 按块批量分配Upvalue存储，释放的槽位进入空闲链表供下次复用，
+ * 避免闭包密集代码中每个上值一次堆分配。块在池析构前不会归还。
+ * 
+ * 池由UpvalueManager在堆上创建；管理器析构时调用Detach，仍有闭包
+ * 引用的闭合Upvalue存活时池继续存在，最后一个Upvalue归还时销毁自身。
+ */
+class UpvaluePool {
+public:
+    UpvaluePool() = default;
+    ~UpvaluePool() = default;
+    
+    UpvaluePool(const UpvaluePool&) = delete;
+    UpvaluePool& operator=(const UpvaluePool&) = delete;
+    
+    /**
+     * @brief 分配并构造Upvalue
+     * @param stack_index 栈索引
+     * @param stack_ptr 栈值指针
+     */
+    Upvalue* Acquire(Size stack_index, LuaValue* stack_ptr);
+    
+    /**
+     * @brief 析构Upvalue并归还槽位（池已脱离且这是最后一个时销毁池）
+     */
+    void Release(Upvalue* upvalue);
+    
+    /**
+     * @brief 所有者放弃池：没有存活的Upvalue时立即销毁，否则由最后一次Release销毁
+     */
+    void Detach();
+    
+    /**
+     * @brief 获取存活的Upvalue数量
+     */
+    Size GetLiveCount() const { return live_count_; }
+    
+    /**
+     * @brief 获取池容量（已分配的槽位数）
+     */
+    Size GetCapacity() const { return chunks_.size() * kChunkSize; }
+    
+    /**
+     * @brief 获取池占用的字节数
+     */
+    Size GetMemoryUsage() const { return GetCapacity() * sizeof(Slot); }
+
+private:
+    static constexpr Size kChunkSize = 64;
+    
+    /**
+     * @brief 池槽位：空闲时存放空闲链指针，使用时存放Upvalue
+     */
+    union Slot {
+        Slot* next_free;
+        alignas(Upvalue) unsigned char storage[sizeof(Upvalue)];
+    };
+    
+    /**
+     * @brief 分配新块并把其槽位挂入空闲链表
+     */
+    void Grow();
     
-    // 链表指针（用于UpvalueManager的链式管理）
-    Upvalue* next_;                     // 下一个Upvalue
-    Upvalue* prev_;                     // 上一个Upvalue
+    std::vector<std::unique_ptr<Slot[]>> chunks_;   // 已分配的块
+    Slot* free_list_ = nullptr;                     // 空闲槽位链表
+    Size live_count_ = 0;                           // 存活数量
+    bool detached_ = false;                         // 所有者已析构
 };
 
 /* ========================================================================== */
@@ -229,6 +324,12 @@ private:
  * - 自动闭合管理
  * - 内存回收和垃圾收集
  * - 性能优化
+ * 
+ * 开放Upvalue保存在按栈索引降序排列的侵入式双向链表中（同Lua的
+ * openupval），查找从链表头走到目标位置即停止，CloseUpvalues(level)
+ * 只访问需要闭合的节点。Upvalue由管理器的对象池持有，引用计数归零
+ * 且已闭合时立即归还池中；管理器先于闭包析构时，对象池脱离管理器，
+ * 随最后一个闭合Upvalue的释放而销毁。
  */
 class UpvalueManager {
 public:
@@ -243,11 +344,11 @@ public:
      */
     ~UpvalueManager();
     
-    // 禁用拷贝，允许移动
+    // 禁用拷贝和移动（开放链表与池槽位地址绑定）
     UpvalueManager(const UpvalueManager&) = delete;
     UpvalueManager& operator=(const UpvalueManager&) = delete;
-    UpvalueManager(UpvalueManager&&) = default;
-    UpvalueManager& operator=(UpvalueManager&&) = default;
+    UpvalueManager(UpvalueManager&&) = delete;
+    UpvalueManager& operator=(UpvalueManager&&) = delete;
     
     /* ====================================================================== */
     /* 核心Upvalue操作 */
@@ -258,25 +359,29 @@ public:
      * @param stack_index 栈索引
      * @return Upvalue指针
      */
-    std::shared_ptr<Upvalue> GetUpvalue(Size stack_index);
+    Upvalue* GetUpvalue(Size stack_index);
     
     /**
      * @brief 创建新的Upvalue
      * @param stack_index 栈索引
      * @return Upvalue指针
+     * @note 调用方需保证该索引上没有开放Upvalue，否则应使用GetUpvalue
      */
-    std::shared_ptr<Upvalue> CreateUpvalue(Size stack_index);
+    Upvalue* CreateUpvalue(Size stack_index);
     
     /**
      * @brief 查找现有Upvalue
      * @param stack_index 栈索引
      * @return Upvalue指针，如果不存在返回nullptr
      */
-    std::shared_ptr<Upvalue> FindUpvalue(Size stack_index);
+    Upvalue* FindUpvalue(Size stack_index);
     
     /**
      * @brief 闭合指定级别以上的Upvalue
      * @param level 栈级别
+     * 
+     * 从链表头弹出栈索引 >= level 的节点，遇到第一个更低的节点即停止。
+     * 没有引用的Upvalue直接归还对象池。
      */
     void CloseUpvalues(Size level);
     
@@ -289,7 +394,7 @@ public:
      * @brief 移除Upvalue
      * @param upvalue Upvalue指针
      */
-    void RemoveUpvalue(std::shared_ptr<Upvalue> upvalue);
+    void RemoveUpvalue(Upvalue* upvalue);
     
     /* ====================================================================== */
     /* 生命周期管理 */
@@ -299,14 +404,14 @@ public:
      * @brief 添加Upvalue引用
      * @param upvalue Upvalue指针
      */
-    void AddReference(std::shared_ptr<Upvalue> upvalue);
+    void AddReference(Upvalue* upvalue);
     
     /**
      * @brief 移除Upvalue引用
      * @param upvalue Upvalue指针
      * @return 是否已被回收
      */
-    bool RemoveReference(std::shared_ptr<Upvalue> upvalue);
+    bool RemoveReference(Upvalue* upvalue);
     
     /**
      * @brief 清理无引用的Upvalue
@@ -350,17 +455,17 @@ public:
     /**
      * @brief 获取Upvalue数量
      */
-    Size GetUpvalueCount() const { return upvalue_map_.size(); }
+    Size GetUpvalueCount() const { return pool_->GetLiveCount(); }
     
     /**
      * @brief 获取开放Upvalue数量
      */
-    Size GetOpenUpvalueCount() const;
+    Size GetOpenUpvalueCount() const { return open_count_; }
     
     /**
      * @brief 获取闭合Upvalue数量
      */
-    Size GetClosedUpvalueCount() const;
+    Size GetClosedUpvalueCount() const { return pool_->GetLiveCount() - open_count_; }
     
     /**
      * @brief 获取总引用计数
@@ -376,7 +481,12 @@ public:
     /**
      * @brief 检查是否为空
      */
-    bool IsEmpty() const { return upvalue_map_.empty(); }
+    bool IsEmpty() const { return pool_->GetLiveCount() == 0; }
+    
+    /**
+     * @brief 获取开放链表头（栈索引最大的开放Upvalue）
+     */
+    Upvalue* GetOpenUpvalueHead() const { return open_upvalues_; }
     
     /* ====================================================================== */
     /* 性能统计 */
@@ -448,8 +558,8 @@ public:
     std::string GenerateReport() const;
     
     /**
-     * @brief 导出Upvalue状态
-     * @return Upvalue信息列表
+     * @brief 导出开放Upvalue状态
+     * @return Upvalue信息列表（按栈索引降序）
      */
     std::vector<Upvalue::UpvalueInfo> ExportUpvalueStates() const;
     
@@ -470,7 +580,6 @@ public:
         Size cleanup_threshold = 100;              // 清理阈值
         bool enable_sharing_optimization = true;   // 启用共享优化
         bool enable_statistics = true;             // 启用统计
-        Size max_upvalue_cache_size = 1000;       // 最大缓存大小
     };
     
     /**
@@ -484,53 +593,40 @@ public:
     const ManagerConfig& GetConfig() const { return config_; }
 
 private:
-    /* ====================================================================== */
-    /* 内部数据结构 */
-    /* ====================================================================== */
-    
-    /**
-     * @brief Upvalue缓存条目
-     */
-    struct UpvalueCacheEntry {
-        std::shared_ptr<Upvalue> upvalue;
-        Size last_access_time;
-        Size access_count;
-    };
-    
     /* ====================================================================== */
     /* 内部方法 */
     /* ====================================================================== */
     
     /**
-     * @brief 插入Upvalue到有序链表
+     * @brief 把Upvalue插入到prev之后（prev为nullptr时插入链表头）
      * @param upvalue 要插入的Upvalue
+     * @param prev 前驱节点（栈索引更大）
      */
-    void InsertUpvalueOrdered(std::shared_ptr<Upvalue> upvalue);
+    void LinkOpenUpvalue(Upvalue* upvalue, Upvalue* prev);
     
     /**
-     * @brief 从链表中移除Upvalue
+     * @brief 从开放链表中摘除Upvalue
      * @param upvalue 要移除的Upvalue
      */
-    void RemoveUpvalueFromList(std::shared_ptr<Upvalue> upvalue);
+    void UnlinkOpenUpvalue(Upvalue* upvalue);
     
     /**
      * @brief 查找插入位置
      * @param stack_index 栈索引
-     * @return 插入位置的迭代器
+     * @return 最后一个栈索引 > stack_index 的节点，没有则返回nullptr
      */
-    auto FindInsertionPoint(Size stack_index);
+    Upvalue* FindInsertionPoint(Size stack_index) const;
     
     /**
-     * @brief 更新访问统计
-     * @param upvalue 访问的Upvalue
-     * @param is_hit 是否命中缓存
+     * @brief 闭合开放Upvalue，无引用时直接回收
+     * @param upvalue 已从链表摘除的Upvalue
      */
-    void UpdateAccessStatistics(std::shared_ptr<Upvalue> upvalue, bool is_hit);
+    void CloseAndRelease(Upvalue* upvalue);
     
     /**
-     * @brief 执行自动清理
+     * @brief 归还Upvalue到对象池并更新统计
      */
-    void PerformAutomaticCleanup();
+    void ReleaseUpvalue(Upvalue* upvalue);
     
     /**
      * @brief 验证Upvalue链表完整性
@@ -548,13 +644,14 @@ private:
     
     LuaStack* stack_;                                           // 关联的栈
     
-    // Upvalue存储（按栈索引有序）
-    std::map<Size, std::shared_ptr<Upvalue>> upvalue_map_;      // 主要存储
-    std::shared_ptr<Upvalue> open_upvalue_head_;                // 开放Upvalue链表头
+    // Upvalue存储
+    std::unique_ptr<UpvaluePool> pool_;                         // 对象池（析构时脱离，见Detach）
+    Upvalue* open_upvalues_;                                    // 开放链表头（栈索引降序）
+    Size open_count_;                                           // 开放Upvalue数
     
-    // 缓存和优化
-    std::unordered_map<Size, UpvalueCacheEntry> upvalue_cache_; // 访问缓存
-    Size cache_access_counter_;                                 // 缓存访问计数
+    // 查找统计
+    Size lookup_count_;                                         // GetUpvalue调用次数
+    Size lookup_hits_;                                          // 命中已有开放Upvalue次数
     
     // 统计和配置
     UpvalueStatistics statistics_;                              // 统计信息
@@ -8,6 +8,7 @@
  */
 
 #include "virtual_machine.h"
+#include "bytecode_verifier.h"
 #include "../compiler/bytecode.h"
 #include "../core/lua_common.h"
 #include "../core/lua_errors.h"
@@ -17,6 +18,7 @@
 #include <chrono>
 #include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 
@@ -28,23 +30,34 @@ namespace lua_cpp {
 
 VirtualMachine::VirtualMachine(const VMConfig& config)
     : config_(config)
-    , stack_(std::make_unique<LuaStack>(config.initial_stack_size))
-    , call_frames_()
-    , current_frame_index_(0)
-    , max_call_depth_(config.max_call_depth)
+    , memory_manager_(std::make_unique<MemoryManager>())
+    , main_stack_(std::make_unique<LuaStack>(config.initial_stack_size, VM_MAX_STACK_SIZE,
+                                             *memory_manager_))
+    , stack_(main_stack_.get())
+    , call_frames_(config.max_call_depth)
     , execution_state_(ExecutionState::Ready)
-    , global_table_(std::make_shared<LuaTable>())
+    , global_table_(std::make_shared<LuaTable>(0, 0, *memory_manager_))
     , debug_hook_(nullptr)
     , statistics_()
     , instruction_count_(0) {
     
-    // 预分配初始调用帧空间（Lua 5.1.5 风格）
-    call_frames_.reserve(std::min<Size>(8, config.max_call_depth));
-    call_frames_.resize(1, CallFrame(nullptr, 0, 0, 0));  // 基础帧（类似 base_ci）
-    
     // 初始化统计信息
     statistics_ = ExecutionStatistics{};
     
+    // 本状态的对象由自己的收集器回收，根由MarkStacks/MarkGlobals等提供
+    GCConfig gc_config;
+    gc_config.initial_threshold = config_.gc_threshold;
+    gc_config.enable_auto_gc = config_.enable_auto_gc;
+    auto collector = std::make_unique<GarbageCollector>(this);
+    collector->SetConfig(gc_config);
+    memory_manager_->SetGarbageCollector(std::move(collector));
+    
+    // 元方法事件名只驻留一次，慢路径查找直接用缓存的字符串对象
+    for (Size i = 0; i < metamethod_names_.size(); ++i) {
+        const char* name = GetMetaMethodName(static_cast<MetaMethod>(i));
+        metamethod_names_[i] = memory_manager_->NewString(name, std::strlen(name));
+    }
+    
     Reset();
 }
 
@@ -61,13 +74,13 @@ std::vector<LuaValue> VirtualMachine::ExecuteProgram(const Proto* proto,
     // 重置虚拟机状态
     Reset();
     
-    // 创建主函数调用帧
-    PushCallFrame(proto, 0, args.size(), 0);
-    
-    // 将参数推入栈
+    // 函数槽和参数按调用约定放在栈底，主函数和普通Lua调用走同一路径
+    stack_->EnsureSpace(args.size() + 1);
+    stack_->Push(LuaValue());
     for (const auto& arg : args) {
-        Push(arg);
+        stack_->Push(arg);
     }
+    PrepareLuaCall(proto, 0, args.size(), VM_MULTRET);
     
     // 开始执行
     execution_state_ = ExecutionState::Running;
@@ -75,7 +88,7 @@ std::vector<LuaValue> VirtualMachine::ExecuteProgram(const Proto* proto,
     auto start_time = std::chrono::high_resolution_clock::now();
     
     try {
-        // 执行字节码直到完成
+        // 执行字节码直到完成或被抢占
         ContinueExecution();
         
         // 记录执行时间
@@ -83,14 +96,8 @@ std::vector<LuaValue> VirtualMachine::ExecuteProgram(const Proto* proto,
         auto duration = std::chrono::duration<double>(end_time - start_time);
         statistics_.execution_time = duration.count();
         
-        // 收集返回值
-        std::vector<LuaValue> results;
-        Size top = GetStackTop();
-        for (Size i = 0; i < top; ++i) {
-            results.push_back(GetStack(i));
-        }
-        
-        return results;
+        // 被抢占时返回值由完成执行的ResumeExecution给出
+        return preempted_ ? std::vector<LuaValue>{} : CollectResults();
         
     } catch (const LuaError& e) {
         execution_state_ = ExecutionState::Error;
@@ -99,6 +106,8 @@ std::vector<LuaValue> VirtualMachine::ExecuteProgram(const Proto* proto,
 }
 
 void VirtualMachine::ExecuteInstruction(Instruction instruction) {
+    MemoryManagerScope memory_scope(*memory_manager_);
+    
     if (execution_state_ != ExecutionState::Running) {
         throw VMExecutionError("VM is not in running state: " + 
                               std::to_string(static_cast<int>(execution_state_)));
@@ -137,10 +146,12 @@ void VirtualMachine::ExecuteInstruction(Instruction instruction) {
     // 更新指令统计
     statistics_.instruction_counts[static_cast<int>(opcode)]++;
     
+    Size frame_index = call_frames_.GetCurrentIndex();
+    
     // 调试钩子
     if (debug_hook_ && config_.enable_debug_info) {
         DebugInfo debug_info;
-        debug_info.instruction_pointer = instruction_pointer_;
+        debug_info.instruction_pointer = GetInstructionPointer();
         debug_info.current_function = current_proto_;
         debug_info.current_opcode = opcode;
         debug_info.current_instruction = instruction;
@@ -148,6 +159,11 @@ void VirtualMachine::ExecuteInstruction(Instruction instruction) {
         debug_hook_(debug_info);
     }
     
+    // 与快速循环一致：分派前先让pc指向下一条指令，跳转目标因此是pc+1+sBx，
+    // 条件跳过、CALL保存的返回地址和内联缓存槽位在两条路径上含义相同
+    call_frames_[frame_index].AdvanceInstructionPointer();
+    const Instruction* next_pc = call_frames_[frame_index].GetSavedPC();
+    
     // 执行指令
     switch (opcode) {
         case OpCode::MOVE:
@@ -306,10 +322,14 @@ void VirtualMachine::ExecuteInstruction(Instruction instruction) {
             throw InvalidInstructionError("Unknown opcode: " + std::to_string(static_cast<int>(opcode)));
     }
     
-    // 递增指令指针（除非被跳转指令修改）
-    if (opcode != OpCode::JMP && opcode != OpCode::FORLOOP && 
-        opcode != OpCode::FORPREP && opcode != OpCode::RETURN) {
-        instruction_pointer_++;
+    // 抢占计数点：回跳和调用（挂起后慢路径循环因状态改变而退出）；
+    // 同快速循环，FORLOOP只在继续循环时计数，退出循环的那一次不扣预算
+    bool backward_jump = (opcode == OpCode::JMP && sbx < 0) || opcode == OpCode::TFORLOOP ||
+                         (opcode == OpCode::FORLOOP &&
+                          call_frames_[frame_index].GetSavedPC() != next_pc);
+    if ((backward_jump || opcode == OpCode::CALL || opcode == OpCode::TAILCALL) &&
+        --preempt_budget_ <= 0) {
+        PreemptionPoint();
     }
 }
 
@@ -349,7 +369,19 @@ bool VirtualMachine::StepExecution() {
 }
 
 void VirtualMachine::ContinueExecution() {
-    while (execution_state_ == ExecutionState::Running) {
+    // 执行期间创建的字符串、表和容器存储都落在本状态的管理器上
+    MemoryManagerScope memory_scope(*memory_manager_);
+    
+    if (RequiresSlowPath()) {
+        ExecuteSlowLoop();
+    } else {
+        ExecuteFastLoop();
+    }
+}
+
+void VirtualMachine::ExecuteSlowLoop() {
+    while (execution_state_ == ExecutionState::Running &&
+           call_frames_.GetCurrentIndex() > call_stop_depth_) {
         if (!StepExecution()) {
             break;
         }
@@ -360,16 +392,130 @@ void VirtualMachine::Suspend() {
     execution_state_ = ExecutionState::Suspended;
 }
 
+void VirtualMachine::SetPreemptBudget(Size budget) {
+    config_.preempt_budget = budget;
+    RefillPreemptBudget();
+}
+
+std::vector<LuaValue> VirtualMachine::ResumeExecution() {
+    if (execution_state_ != ExecutionState::Suspended || !preempted_) {
+        throw VMExecutionError("VM was not suspended by preemption");
+    }
+    
+    preempted_ = false;
+    RefillPreemptBudget();
+    execution_state_ = ExecutionState::Running;
+    
+    try {
+        ContinueExecution();
+    } catch (const LuaError& e) {
+        execution_state_ = ExecutionState::Error;
+        throw;
+    }
+    
+    return preempted_ ? std::vector<LuaValue>{} : CollectResults();
+}
+
+void VirtualMachine::SwapThread(VMThreadState& thread) {
+    if (!thread.stack) {
+        throw VMExecutionError("Thread has no stack");
+    }
+    
+    std::swap(stack_, thread.stack);
+    std::swap(call_frames_, thread.call_frames);
+    std::swap(execution_state_, thread.execution_state);
+    std::swap(call_stop_depth_, thread.call_stop_depth);
+    std::swap(open_top_, thread.open_top);
+    std::swap(preempted_, thread.preempted);
+    RefreshFrameCache();
+}
+
+Size VirtualMachine::ResumeThread(const Proto* proto, Size nargs) {
+    if (IsCallStackEmpty()) {
+        if (!proto) {
+            throw VMExecutionError("Cannot resume thread with null proto");
+        }
+        if (execution_state_ != ExecutionState::Ready) {
+            throw VMExecutionError("Cannot resume a finished thread");
+        }
+        
+        // 首次恢复：栈上的值都是参数，其下插入函数槽，同ExecuteProgram从栈底调用
+        Size count = stack_->GetTop();
+        stack_->EnsureSpace(1);
+        stack_->Push(LuaValue());
+        LuaValue* data = stack_->GetData();
+        std::move_backward(data, data + count, data + count + 1);
+        data[0] = LuaValue();
+        PrepareLuaCall(proto, 0, count, VM_MULTRET);
+    } else {
+        if (execution_state_ != ExecutionState::Suspended || !preempted_) {
+            throw VMExecutionError("Thread was not suspended by preemption");
+        }
+        
+        // 抢占点没有接收值的位置，resume参数直接丢弃
+        SetStackTop(GetStackTop() - std::min(nargs, GetStackTop()));
+        preempted_ = false;
+    }
+    
+    RefillPreemptBudget();
+    execution_state_ = ExecutionState::Running;
+    
+    try {
+        ContinueExecution();
+    } catch (const LuaError& e) {
+        execution_state_ = ExecutionState::Error;
+        throw;
+    }
+    
+    return preempted_ ? 0 : GetStackTop();
+}
+
+std::vector<LuaValue> VirtualMachine::CollectResults() const {
+    std::vector<LuaValue> results;
+    Size top = GetStackTop();
+    results.reserve(top);
+    for (Size i = 0; i < top; ++i) {
+        results.push_back(GetStack(i));
+    }
+    return results;
+}
+
+bool VirtualMachine::PreemptionPoint() {
+    if (config_.preempt_budget == 0) {
+        RefillPreemptBudget();
+        return false;
+    }
+    
+    if (call_stop_depth_ != 0) {
+        preempt_budget_ = 1;
+        return false;
+    }
+    
+    preempted_ = true;
+    execution_state_ = ExecutionState::Suspended;
+    statistics_.preemptions++;
+    return true;
+}
+
+void VirtualMachine::RefillPreemptBudget() {
+    preempt_budget_ = config_.preempt_budget > 0
+        ? static_cast<int64_t>(config_.preempt_budget)
+        : INT64_MAX;
+}
+
 void VirtualMachine::Reset() {
     execution_state_ = ExecutionState::Ready;
     
     // 重置调用栈（保持一个基础帧）
-    current_frame_index_ = 0;
-    call_frames_.clear();
-    call_frames_.resize(1, CallFrame(nullptr, 0, 0, 0));
+    call_frames_.Clear();
+    call_stop_depth_ = 0;
+    open_top_ = 0;
     
     SetStackTop(0);
+    RefreshFrameCache();
     instruction_count_ = 0;
+    preempted_ = false;
+    RefillPreemptBudget();
     
     // 重置统计信息
     statistics_ = ExecutionStatistics();
@@ -412,12 +558,7 @@ Instruction VirtualMachine::GetNextInstruction() const {
         throw VMExecutionError("No more instructions to execute");
     }
     
-    const CallFrame& frame = GetCurrentCallFrame();
-    auto inst = frame.GetCurrentInstruction();
-    if (!inst.has_value()) {
-        throw VMExecutionError("No current instruction available");
-    }
-    return inst.value();
+    return GetCurrentCallFrame().GetCurrentInstruction();
 }
 
 int VirtualMachine::GetCurrentLine() const {
@@ -432,60 +573,46 @@ int VirtualMachine::GetCurrentLine() const {
 /* 堆栈管理 */
 /* ========================================================================== */
 
-void VirtualMachine::SetRegister(RegisterIndex reg, const LuaValue& value) {
-    Size stack_index = GetCurrentBase() + reg;
-    
-    // 检查寄存器索引合法性
-    if (reg > 255) { // Lua寄存器最大值
-        throw VMExecutionError("Register index out of range: " + std::to_string(reg));
-    }
-    
-    // 检查栈大小限制
-    Size required_size = stack_index + 1;
-    if (required_size > GetMaxStackSize()) {
-        throw VMExecutionError("Stack overflow: required " + std::to_string(required_size) + 
-                              ", max " + std::to_string(GetMaxStackSize()));
-    }
+void VirtualMachine::RefreshFrameCache() {
+    const CallFrame& frame = call_frames_.Top();
     
-    // 确保栈有足够空间
-    while (GetStackTop() <= stack_index) {
-        Push(LuaValue());
-    }
-    
-    SetStack(stack_index, value);
-    
-    // 更新峰值堆栈使用量
-    statistics_.peak_stack_usage = std::max(statistics_.peak_stack_usage, GetStackTop());
+    cached_stack_data_ = stack_->GetData();
+    register_base_ = stack_->GetData() + frame.GetBase();
+    current_proto_ = frame.GetProto();
 }
 
-LuaValue VirtualMachine::GetRegister(RegisterIndex reg) const {
-    // 检查寄存器索引合法性
-    if (reg > 255) { // Lua寄存器最大值
-        throw VMExecutionError("Register index out of range: " + std::to_string(reg));
-    }
-    
-    Size stack_index = GetCurrentBase() + reg;
-    
-    if (stack_index >= GetStackTop()) {
-        return LuaValue(); // 返回nil
-    }
-    
-    return GetStack(stack_index);
+void VirtualMachine::ThrowRegisterOutOfRange(RegisterIndex reg) {
+    throw VMExecutionError("Register index out of range: " + std::to_string(reg));
 }
 
-LuaValue VirtualMachine::GetRK(int rk) const {
-    if (IsConstant(rk)) {
-        // 常量
-        int const_index = RKToConstantIndex(rk);
-        const Proto* proto = GetCurrentCallFrame().GetProto();
-        if (!proto || const_index >= proto->GetConstantCount()) {
-            throw VMExecutionError("Invalid constant index");
+bool VirtualMachine::EnsureFrameWindow() {
+    const CallFrame& frame = call_frames_.Top();
+    const Proto* proto = frame.GetProto();
+    Size base = frame.GetBase();
+    bool full_window = true;
+    
+    Size required;
+    if (proto && proto->GetMaxStackSize() > 0) {
+        required = base + proto->GetMaxStackSize();
+        if (required > GetMaxStackSize()) {
+            throw VMExecutionError("Stack overflow: required " + std::to_string(required) + 
+                                  ", max " + std::to_string(GetMaxStackSize()));
         }
-        return proto->GetConstant(const_index);
     } else {
-        // 寄存器
-        return GetRegister(static_cast<RegisterIndex>(rk));
+        // 未设置max_stack_size的原型（手工构造）按最大寄存器数保留，受栈上限截断
+        required = base + static_cast<Size>(MAXARG_A) + 1;
+        if (required > GetMaxStackSize()) {
+            required = std::max(base, GetMaxStackSize());
+            full_window = false;
+        }
     }
+    if (stack_->GetTop() < required) {
+        stack_->SetTop(required);
+    }
+    
+    // 更新峰值堆栈使用量
+    statistics_.peak_stack_usage = std::max(statistics_.peak_stack_usage, GetStackTop());
+    return full_window;
 }
 
 Size VirtualMachine::GetCurrentBase() const {
@@ -500,19 +627,171 @@ Size VirtualMachine::GetCurrentBase() const {
 /* 函数调用管理 */
 /* ========================================================================== */
 
-void VirtualMachine::PopCallFrameInternal() {
-    // 获取返回地址
-    Size return_address = GetCurrentCallFrame().GetReturnAddress();
+void VirtualMachine::PrepareLuaCall(const Proto* proto, Size func, Size nargs, int nresults) {
+    // 函数第一次被调用时校验字节码（主函数会连同全部子函数一起校验），
+    // 不合法的代码在执行任何指令之前被拒绝
+    BytecodeVerifier::EnsureVerified(*proto);
+    
+    Size num_params = proto->GetParameterCount();
+    Size base = func + 1;
+    
+    if (proto->IsVariadic()) {
+        // 缺少的固定参数先补nil，再把固定参数移到全部实参之上（adjust_varargs）
+        Size actual = std::max(nargs, num_params);
+        base = func + 1 + actual;
+        if (stack_->GetTop() < base + num_params) {
+            stack_->SetTop(base + num_params);
+        }
+        
+        LuaValue* data = stack_->GetData();
+        LuaValue* fixed = data + func + 1;
+        std::fill(fixed + nargs, fixed + actual, LuaValue());
+        for (Size i = 0; i < num_params; ++i) {
+            data[base + i] = std::move(fixed[i]);
+            fixed[i] = LuaValue();
+        }
+    }
+    
+    PushCallFrame(proto, base, func, nresults);
+    
+    // 固定参数之后的寄存器（含多余实参）清为nil，同luaD_precall
+    Size fixed_count = proto->IsVariadic() ? num_params : std::min(nargs, num_params);
+    Size window = proto->GetMaxStackSize();
+    if (window > fixed_count) {
+        std::fill(register_base_ + fixed_count, register_base_ + window, LuaValue());
+    }
+}
+
+void VirtualMachine::FinishLuaCall(Size first, Size count) {
+    const CallFrame& frame = call_frames_.Top();
+    Size dest = frame.GetFunctionSlot();
+    int wanted = frame.GetExpectedResults();
     
-    // 弹出调用帧（简单递减索引）
+    PopCallFrame();
+    
+    // 返回值区在函数槽之上，前向移动即可处理重叠
+    LuaValue* data = stack_->GetData();
+    Size moved = (wanted == VM_MULTRET) ? count : std::min(count, static_cast<Size>(wanted));
+    std::move(data + first, data + first + moved, data + dest);
+    
+    Size end = dest + moved;
+    if (wanted == VM_MULTRET) {
+        open_top_ = end;
+    } else {
+        end = dest + static_cast<Size>(wanted);
+        std::fill(data + dest + moved, data + end, LuaValue());
+    }
+    
+    // 主函数返回：返回值即为栈上的全部内容
+    if (IsCallStackEmpty()) {
+        SetStackTop(end);
+    }
+}
+
+void VirtualMachine::PopCallFrameInternal() {
+    // 弹出调用帧（简单递减索引），调用者的pc保存在它自己的帧中
     PopCallFrame();
     
     if (IsCallStackEmpty()) {
         // 主函数返回，程序结束
         execution_state_ = ExecutionState::Finished;
-    } else {
-        // 恢复上一层函数的执行上下文
-        // 返回地址已包含在上一个CallFrame中
+    }
+}
+
+/* ========================================================================== */
+/* Arena作用域 */
+/* ========================================================================== */
+
+void VirtualMachine::EnterArenaScope() {
+    object_arena_.Enter();
+}
+
+Size VirtualMachine::ExitArenaScope() {
+    MemoryManagerScope memory_scope(*memory_manager_);
+    
+    if (object_arena_.GetDepth() == 1) {
+        // 栈上的值由VM直接修正。没有活动帧时栈顶以上都是死值，只清除
+        // 其中的arena引用；嵌套调用中（C函数内退出）保守地修正整个栈
+        LuaValue* data = stack_->GetData();
+        Size live = IsCallStackEmpty() ? stack_->GetTop() : stack_->GetCapacity();
+        for (Size i = 0; i < live; ++i) {
+            data[i] = object_arena_.Forward(data[i]);
+        }
+        for (Size i = live; i < stack_->GetCapacity(); ++i) {
+            GCObject* obj = data[i].GetGCObject();
+            if (obj && obj->IsArenaAllocated()) {
+                data[i] = LuaValue();
+            }
+        }
+        
+        if (object_arena_.HasGlobalEscape() && global_table_) {
+            object_arena_.ForwardTable(*global_table_);
+        }
+    }
+    return object_arena_.Exit();
+}
+
+/* ========================================================================== */
+/* GC根 */
+/* ========================================================================== */
+
+Size VirtualMachine::AddRootMarker(RootMarker marker) {
+    Size id = next_root_marker_id_++;
+    root_markers_.emplace_back(id, std::move(marker));
+    return id;
+}
+
+void VirtualMachine::RemoveRootMarker(Size id) {
+    root_markers_.erase(std::remove_if(root_markers_.begin(), root_markers_.end(),
+                                       [id](const auto& entry) { return entry.first == id; }),
+                        root_markers_.end());
+}
+
+void VirtualMachine::MarkStacks(GCMarker& marker) const {
+    if (stack_) {
+        MarkStack(marker, *stack_);
+    }
+    
+    // 协程运行时主线程的栈被换出，仍由VM持有
+    if (main_stack_ && main_stack_.get() != stack_) {
+        MarkStack(marker, *main_stack_);
+    }
+}
+
+void VirtualMachine::MarkGlobals(GCMarker& marker) const {
+    for (StringObject* name : metamethod_names_) {
+        marker.Mark(name);
+    }
+    if (!global_table_) {
+        return;
+    }
+    global_table_->ForEachSlotValue([&marker](const LuaValue& value) {
+        marker.Mark(value);
+    });
+}
+
+void VirtualMachine::MarkCallFrames(GCMarker& marker) const {
+    MarkFrames(marker, call_frames_);
+}
+
+void VirtualMachine::MarkExternalRoots(GCMarker& marker) const {
+    for (const auto& entry : root_markers_) {
+        entry.second(marker);
+    }
+}
+
+void VirtualMachine::MarkStack(GCMarker& marker, const LuaStack& stack) {
+    const LuaValue* data = stack.GetData();
+    for (Size i = 0; i < stack.GetCapacity(); ++i) {
+        marker.Mark(data[i]);
+    }
+}
+
+void VirtualMachine::MarkFrames(GCMarker& marker, const CallFrameStack& frames) {
+    for (Size i = 1; i <= frames.GetCurrentIndex(); ++i) {
+        if (const Proto* proto = frames[i].GetProto()) {
+            MarkProtoConstants(marker, *proto);
+        }
     }
 }
 
@@ -565,10 +844,10 @@ DebugInfo VirtualMachine::GetCurrentDebugInfo() const {
         info.instruction_pointer = frame.GetInstructionPointer();
         info.current_function = frame.GetProto();
         
-        auto inst = frame.GetCurrentInstruction();
-        if (inst.has_value()) {
-            info.current_opcode = GetOpCode(inst.value());
-            info.current_instruction = inst.value();
+        if (!frame.IsAtEnd()) {
+            Instruction inst = frame.GetCurrentInstruction();
+            info.current_opcode = GetOpCode(inst);
+            info.current_instruction = inst;
         } else {
             info.current_opcode = OpCode::MOVE; // 默认值
             info.current_instruction = 0;
@@ -2,15 +2,20 @@
 
 #include "stack.h"
 #include "call_frame.h"
+#include "metamethod.h"
 #include "compiler/bytecode.h"
 #include "core/lua_common.h"
 #include "types/value.h"
 #include "core/lua_errors.h"
+#include "memory/object_arena.h"
+#include <cstdint>
 #include <memory>
 #include <vector>
 #include <array>
 #include <functional>
 #include <unordered_map>
+#include <cmath>
+#include <utility>
 
 namespace lua_cpp {
 
@@ -20,6 +25,7 @@ namespace lua_cpp {
 
 class Proto;
 class LuaTable;
+class GCMarker;
 
 /* ========================================================================== */
 /* VM错误类型 */
@@ -91,10 +97,12 @@ struct VMConfig {
     Size max_instructions_per_step = 1000;             // 每步最大指令数
     bool enable_instruction_limit = false;             // 启用指令限制
     Size instruction_limit = 1000000;                  // 指令执行限制
+    Size preempt_budget = 0;                           // 抢占预算：每个时间片的回跳和调用次数（0表示不抢占）
     
     // 内存配置
     Size gc_threshold = 1024 * 1024;                   // GC触发阈值
     bool enable_auto_gc = true;                        // 启用自动GC
+    bool enable_concat_builder = true;                 // 长字符串CONCAT使用可追加缓冲区
 };
 
 /* ========================================================================== */
@@ -136,6 +144,44 @@ struct ExecutionStatistics {
     double execution_time = 0.0;                               // 执行时间（秒）
     Size peak_stack_usage = 0;                                 // 峰值堆栈使用
     Size peak_call_depth = 0;                                  // 峰值调用深度
+    Size inline_cache_hits = 0;                                // 内联缓存命中次数
+    Size inline_cache_misses = 0;                              // 内联缓存未命中次数
+    Size preemptions = 0;                                      // 预算耗尽被抢占的次数
+};
+
+/* ========================================================================== */
+/* 线程状态 */
+/* ========================================================================== */
+
+/**
+ * @brief 一个Lua线程（协程）的可切换执行状态，同lua_State中的stack/ci/status
+ * 
+ * 每个协程持有一份；VirtualMachine::SwapThread把它与VM当前使用的状态
+ * 整体交换，VM随即在协程自己的栈和调用帧上执行。交换的是栈指针、
+ * 帧栈和几个标量，栈上的值原地不动。
+ */
+struct VMThreadState {
+    LuaStack* stack = nullptr;                         // 线程的值栈（由协程上下文持有）
+    CallFrameStack call_frames;                        // 线程的调用帧
+    ExecutionState execution_state = ExecutionState::Ready;
+    Size call_stop_depth = 0;
+    Size open_top = 0;
+    bool preempted = false;
+    
+    explicit VMThreadState(LuaStack* thread_stack = nullptr,
+                           Size max_call_depth = VM_MAX_CALL_STACK_DEPTH)
+        : stack(thread_stack), call_frames(max_call_depth) {}
+    
+    /**
+     * @brief 丢弃全部调用帧，回到尚未开始执行的状态
+     */
+    void Reset() {
+        call_frames.Clear();
+        execution_state = ExecutionState::Ready;
+        call_stop_depth = 0;
+        open_top = 0;
+        preempted = false;
+    }
 };
 
 /* ========================================================================== */
@@ -166,11 +212,11 @@ public:
      */
     ~VirtualMachine() = default;
     
-    // 禁用拷贝，允许移动
+    // 禁用拷贝和移动（垃圾收集器通过地址引用VM来标记根）
     VirtualMachine(const VirtualMachine&) = delete;
     VirtualMachine& operator=(const VirtualMachine&) = delete;
-    VirtualMachine(VirtualMachine&&) = default;
-    VirtualMachine& operator=(VirtualMachine&&) = default;
+    VirtualMachine(VirtualMachine&&) = delete;
+    VirtualMachine& operator=(VirtualMachine&&) = delete;
     
     /* ====================================================================== */
     /* 执行控制 */
@@ -180,7 +226,7 @@ public:
      * @brief 执行完整程序
      * @param proto 主函数原型
      * @param args 程序参数
-     * @return 程序返回值
+     * @return 程序返回值（被抢占挂起时为空，见ResumeExecution）
      */
     std::vector<LuaValue> ExecuteProgram(const Proto* proto, 
                                         const std::vector<LuaValue>& args = {});
@@ -214,6 +260,52 @@ public:
      */
     void Suspend();
     
+    /**
+     * @brief 设置抢占预算（同Lua的计数钩子）
+     * 
+     * 预算只在回跳（负偏移的JMP、FORLOOP、TFORLOOP）和函数调用处扣减，
+     * 其余指令没有额外开销。耗尽时保存pc，以Suspended状态退出解释器循环，
+     * 由调度器让出当前协程。
+     * @param budget 每个时间片的计数点数量（0表示禁用抢占）
+     */
+    void SetPreemptBudget(Size budget);
+    
+    /**
+     * @brief 获取抢占预算
+     */
+    Size GetPreemptBudget() const { return config_.preempt_budget; }
+    
+    /**
+     * @brief 上次退出解释器循环是否因预算耗尽
+     */
+    bool WasPreempted() const { return preempted_; }
+    
+    /**
+     * @brief 从抢占点继续执行，预算重新填满
+     * @return 程序返回值（再次被抢占时为空，以WasPreempted()区分）
+     * @throws VMExecutionError 如果虚拟机不是被抢占挂起的
+     */
+    std::vector<LuaValue> ResumeExecution();
+    
+    /**
+     * @brief 与线程状态整体交换（协程恢复时换入，让出或出错时换回）
+     * 
+     * 交换后刷新寄存器窗口缓存；同一个thread连续交换两次即恢复原状。
+     */
+    void SwapThread(VMThreadState& thread);
+    
+    /**
+     * @brief 在当前线程上开始或继续执行协程体（lua_resume的执行部分）
+     * 
+     * 线程还没有调用帧时，栈上的全部值作为参数，以proto为函数体从栈底建立
+     * 第一帧；被抢占挂起时从保存的pc继续，栈顶nargs个resume参数被丢弃。
+     * @param proto 协程函数原型
+     * @param nargs 本次resume压入线程栈顶的参数数量
+     * @return 协程体返回时留在栈底的返回值数量；被抢占时为0，以WasPreempted()区分
+     * @throws VMExecutionError 如果线程已结束或不是被抢占挂起的
+     */
+    Size ResumeThread(const Proto* proto, Size nargs);
+    
     /**
      * @brief 重置虚拟机到初始状态
      */
@@ -265,8 +357,8 @@ public:
     /**
      * @brief 推入值到堆栈
      */
-    void Push(const LuaValue& value) { stack_->Push(value); }
-    void Push(LuaValue&& value) { stack_->Push(std::move(value)); }
+    void Push(const LuaValue& value) { stack_->Push(value); RevalidateRegisterBase(); }
+    void Push(LuaValue&& value) { stack_->Push(std::move(value)); RevalidateRegisterBase(); }
     
     /**
      * @brief 弹出堆栈顶部值
@@ -304,7 +396,7 @@ public:
     /**
      * @brief 设置堆栈顶部位置
      */
-    void SetStackTop(Size top) { stack_->SetTop(top); }
+    void SetStackTop(Size top) { stack_->SetTop(top); RevalidateRegisterBase(); }
     
     /**
      * @brief 获取最大堆栈大小
@@ -319,26 +411,21 @@ public:
      * @brief 推入调用帧（Lua 5.1.5 风格）
      * 
      * 类似 Lua 的 incr_ci()
-     */
-    void PushCallFrame(const Proto* proto, Size base, Size param_count, Size return_address = 0) {
-        // 检查深度
-        if (current_frame_index_ + 1 >= max_call_depth_) {
-            throw CallStackOverflowError("Call stack overflow");
-        }
-        
-        // 如果需要，扩容数组（类似 luaD_reallocCI）
-        if (current_frame_index_ + 1 >= call_frames_.size()) {
-            Size new_size = call_frames_.empty() ? 8 : call_frames_.size() * 2;
-            new_size = std::min(new_size, max_call_depth_);
-            call_frames_.resize(new_size, CallFrame(nullptr, 0, 0, 0));
-        }
+     * @param proto 函数原型
+     * @param base 堆栈基址
+     * @param func 函数槽位置
+     * @param expected_results 调用者期望的返回值数量（VM_MULTRET表示全部）
+     */
+    void PushCallFrame(const Proto* proto, Size base, Size func = 0,
+                       int expected_results = VM_MULTRET) {
+        call_frames_.Push(proto, base, func, expected_results);
         
-        // 递增索引并初始化帧
-        current_frame_index_++;
-        call_frames_[current_frame_index_] = CallFrame(proto, base, param_count, return_address);
+        // 新帧的寄存器窗口必须整体位于栈内，之后寄存器访问不再检查
+        EnsureFrameWindow();
+        RefreshFrameCache();
         
         // 更新统计
-        statistics_.peak_call_depth = std::max(statistics_.peak_call_depth, current_frame_index_ + 1);
+        statistics_.peak_call_depth = std::max(statistics_.peak_call_depth, call_frames_.GetDepth());
     }
     
     /**
@@ -347,42 +434,156 @@ public:
      * 类似 Lua 的 popi(L, 1)
      */
     CallFrame& PopCallFrame() {
-        if (current_frame_index_ == 0) {
-            throw CallFrameError("Cannot pop from empty call stack");
-        }
-        return call_frames_[current_frame_index_--];
+        CallFrame& popped = call_frames_.Pop();
+        RefreshFrameCache();
+        return popped;
     }
     
+    /**
+     * @brief 进入Lua函数（同luaD_precall）
+     * 
+     * 被调用者的寄存器窗口直接叠在调用者栈上，不复制参数：实参已位于
+     * func+1起，缺少的固定参数和窗口内其余寄存器补nil。可变参数函数把
+     * 固定参数移到全部实参之上作为新帧的基址，下方剩余的实参即为变参。
+     * @param proto 函数原型
+     * @param func 函数槽位置
+     * @param nargs 实参数量
+     * @param nresults 调用者期望的返回值数量（VM_MULTRET表示全部）
+     */
+    void PrepareLuaCall(const Proto* proto, Size func, Size nargs, int nresults);
+    
+    /**
+     * @brief 从Lua函数返回（同luaD_poscall）
+     * 
+     * 弹出当前帧，把first起的count个返回值下移到函数槽，按调用者期望的
+     * 数量截断或补nil；期望全部结果时更新开放栈顶。
+     * @param first 第一个返回值的栈位置
+     * @param count 返回值数量
+     */
+    void FinishLuaCall(Size first, Size count);
+    
     /**
      * @brief 获取当前调用帧
      * 
      * 类似 Lua 的 L->ci（当前调用信息）
      */
-    CallFrame& GetCurrentCallFrame() { 
-        if (current_frame_index_ >= call_frames_.size()) {
-            throw CallFrameError("No active call frame");
-        }
-        return call_frames_[current_frame_index_]; 
-    }
-    
-    const CallFrame& GetCurrentCallFrame() const { 
-        if (current_frame_index_ >= call_frames_.size()) {
-            throw CallFrameError("No active call frame");
-        }
-        return call_frames_[current_frame_index_]; 
-    }
+    CallFrame& GetCurrentCallFrame() { return call_frames_.Top(); }
+    const CallFrame& GetCurrentCallFrame() const { return call_frames_.Top(); }
     
     /**
      * @brief 获取调用帧数量（深度）
      * 
      * 类似 Lua 的 ci_depth(L) = (L->ci - L->base_ci)
      */
-    Size GetCallDepth() const { return current_frame_index_ + 1; }
+    Size GetCallDepth() const { return call_frames_.GetDepth(); }
     
     /**
      * @brief 检查调用栈是否为空
      */
-    bool IsCallStackEmpty() const { return current_frame_index_ == 0; }
+    bool IsCallStackEmpty() const { return call_frames_.IsEmpty(); }
+    
+    /**
+     * @brief 获取调用帧栈（供AdvancedCallStackManager挂接共享）
+     */
+    CallFrameStack& GetCallFrameStack() { return call_frames_; }
+    const CallFrameStack& GetCallFrameStack() const { return call_frames_; }
+    
+    /* ====================================================================== */
+    /* Arena作用域 */
+    /* ====================================================================== */
+    
+    /**
+     * @brief 进入arena作用域，之后NEWTABLE和长字符串拼接在arena中分配
+     *
+     * 适合一次请求执行一次脚本的服务端：作用域结束时只有写入全局变量、
+     * 上值或堆对象的值被复制到堆上，其余临时对象一次回滚释放。可嵌套，
+     * 内层作用域并入最外层。协程栈不被扫描，作用域内不应让arena对象
+     * 留在挂起的协程中。
+     */
+    void EnterArenaScope();
+    
+    /**
+     * @brief 退出arena作用域；最外层退出时修正栈和全局表后疏散并回滚
+     * @return 疏散到堆上的对象数量
+     * @throws GCError 没有匹配的EnterArenaScope
+     */
+    Size ExitArenaScope();
+    
+    /**
+     * @brief 检查是否在arena作用域内
+     */
+    bool IsInArenaScope() const { return object_arena_.IsActive(); }
+    
+    /**
+     * @brief 获取对象arena
+     */
+    ObjectArena& GetObjectArena() { return object_arena_; }
+    const ObjectArena& GetObjectArena() const { return object_arena_; }
+    
+    /**
+     * @brief 获取本状态的内存管理器
+     *
+     * 栈、全局表以及执行期间创建的字符串和表都从它分配，宿主分配函数
+     * （SetAllocFunction）和内存限制只作用于本状态。
+     */
+    MemoryManager& GetMemoryManager() { return *memory_manager_; }
+    const MemoryManager& GetMemoryManager() const { return *memory_manager_; }
+    
+    /**
+     * @brief 获取全局变量表
+     */
+    LuaTable& GetGlobalTable() { return *global_table_; }
+    const LuaTable& GetGlobalTable() const { return *global_table_; }
+    
+    /* ====================================================================== */
+    /* GC根 */
+    /* ====================================================================== */
+    
+    using RootMarker = std::function<void(GCMarker&)>;
+    
+    /**
+     * @brief 登记额外的根（如CoroutineSupport登记各协程的栈）
+     * @return 注销用的编号
+     */
+    Size AddRootMarker(RootMarker marker);
+    
+    /**
+     * @brief 注销额外的根
+     */
+    void RemoveRootMarker(Size id);
+    
+    /**
+     * @brief 标记当前线程和主线程的栈
+     */
+    void MarkStacks(GCMarker& marker) const;
+    
+    /**
+     * @brief 标记全局表的键和值，以及驻留的元方法事件名
+     */
+    void MarkGlobals(GCMarker& marker) const;
+    
+    /**
+     * @brief 标记当前线程各调用帧原型的常量
+     */
+    void MarkCallFrames(GCMarker& marker) const;
+    
+    /**
+     * @brief 调用登记的额外根
+     */
+    void MarkExternalRoots(GCMarker& marker) const;
+    
+    /**
+     * @brief 标记栈存储中的全部值
+     *
+     * 栈顶以上的槽位可能还留着已弹出的值，保守地一并标记，这样重新
+     * 露出的旧槽位不会指向已释放的对象。
+     */
+    static void MarkStack(GCMarker& marker, const LuaStack& stack);
+    
+    /**
+     * @brief 标记各调用帧原型的常量（常量池不在任何GC对象中）
+     */
+    static void MarkFrames(GCMarker& marker, const CallFrameStack& frames);
     
     /* ====================================================================== */
     /* 配置访问 */
@@ -501,6 +702,113 @@ private:
     void ExecuteCLOSURE(RegisterIndex a, int bx);
     void ExecuteVARARG(RegisterIndex a, int b);
     
+    /* ====================================================================== */
+    /* 算术慢路径与元方法 */
+    /* ====================================================================== */
+    
+    /**
+     * @brief 对两个数值执行算术事件（与快速路径使用相同的Lua语义）
+     */
+    static double ArithNumber(MetaMethod event, double x, double y) {
+        switch (event) {
+            case MetaMethod::Add: return x + y;
+            case MetaMethod::Sub: return x - y;
+            case MetaMethod::Mul: return x * y;
+            case MetaMethod::Div: return x / y;
+            case MetaMethod::Mod: return x - std::floor(x / y) * y;   // luai_nummod
+            case MetaMethod::Pow: return std::pow(x, y);
+            case MetaMethod::Unm: return -x;
+            default: return 0.0;
+        }
+    }
+    
+    /**
+     * @brief 算术慢路径：字符串转数值后计算，否则调用__add等元方法（luaV_arith）
+     * @param a 结果寄存器
+     */
+    void ArithSlowPath(RegisterIndex a, const LuaValue& lhs, const LuaValue& rhs, MetaMethod event);
+    
+    /**
+     * @brief 获取值的元方法，没有时返回nil
+     */
+    LuaValue GetMetamethod(const LuaValue& value, MetaMethod event) const;
+    
+    /**
+     * @brief 同步调用元方法handler(lhs, rhs)并返回第一个结果
+     * 
+     * 参数压在当前栈顶之上，嵌套运行解释器循环直到元方法返回。
+     */
+    LuaValue CallMetamethod(const LuaValue& handler, const LuaValue& lhs, const LuaValue& rhs);
+    
+    /**
+     * @brief CONCAT结果达到此长度且左操作数是字符串时使用可追加缓冲区
+     */
+    static constexpr Size kConcatBuilderMinLength = 128;
+    
+    /**
+     * @brief 获取CONCAT操作数的字符序列，数值格式化到number缓冲区（调用方已检查类型）
+     */
+    static std::pair<const char*, Size> ConcatPiece(const LuaValue& value, char* number);
+    
+    /**
+     * @brief FORPREP的一次性检查：把R(A)..R(A+2)转换为数值，失败时抛出错误
+     * 
+     * 循环控制变量是编译器分配的隐藏寄存器，检查后FORLOOP无需再做类型检查。
+     */
+    void CoerceForLoopValues(RegisterIndex a);
+    
+    /**
+     * @brief 获取当前指令的内联缓存槽
+     * 
+     * 快速循环和慢路径都在分派前推进pc，调用帧保存的pc指向下一条指令，当前指令为pc-1；
+     * 该位置的操作码与op不符时（如单独执行的指令）返回nullptr，不使用缓存。
+     */
+    InlineCache* FindInlineCache(OpCode op) const;
+    
+    /* ====================================================================== */
+    /* 主解释器循环 */
+    /* ====================================================================== */
+    
+    /**
+     * @brief 收集主函数留在栈上的返回值
+     */
+    std::vector<LuaValue> CollectResults() const;
+    
+    /**
+     * @brief 抢占预算耗尽时调用（冷路径）
+     * 
+     * 元方法等嵌套解释器循环不能跨边界让出（同Lua的C调用边界），此时只留
+     * 一个单位预算，回到最外层后的第一个计数点再抢占。
+     * @return 是否应挂起执行
+     */
+    bool PreemptionPoint();
+    
+    /**
+     * @brief 重新填满抢占预算，禁用抢占时设为永远不会耗尽的值
+     */
+    void RefillPreemptBudget();
+    
+    /**
+     * @brief 是否需要逐条检查的慢路径（指令限制、调试钩子、性能分析）
+     */
+    bool RequiresSlowPath() const {
+        return config_.enable_instruction_limit || config_.enable_profiling ||
+               (debug_hook_ && config_.enable_debug_info);
+    }
+    
+    /**
+     * @brief 快速解释器循环
+     * 
+     * GCC/Clang下使用computed goto线程化分派，MSVC下退化为switch。
+     * pc/base/常量表缓存在局部变量中，操作数按指令惰性解码。
+     */
+    void ExecuteFastLoop();
+    
+    /**
+     * @brief 慢路径循环：逐条经过ExecuteInstruction的全部检查
+     */
+    void ExecuteSlowLoop();
+    
     /* ====================================================================== */
     /* 虚拟机内部方法 */
     /* ====================================================================== */
@@ -520,20 +828,99 @@ private:
      */
     int GetCurrentLine() const;
     
+    /**
+     * @brief 写入全局变量前调用：arena对象写入全局表时登记，作用域结束时疏散
+     */
+    void NoteGlobalStore(const LuaValue& value) {
+        if (object_arena_.IsActive()) {
+            GCObject* obj = value.GetGCObject();
+            if (obj && obj->IsArenaAllocated()) {
+                object_arena_.RecordGlobalEscape();
+            }
+        }
+    }
+    
+    /* ====================================================================== */
+    /* 寄存器窗口 */
+    /* ====================================================================== */
+    
+    /**
+     * @brief 获取寄存器引用，直接指向LuaStack存储
+     * @note 引用在栈重新分配（Push/SetStackTop扩容、压入新帧）前有效
+     */
+    LuaValue& Register(RegisterIndex reg) {
+        CheckRegisterIndex(reg);
+        return register_base_[reg];
+    }
+    
     /**
      * @brief 设置寄存器值
      */
-    void SetRegister(RegisterIndex reg, const LuaValue& value);
+    void SetRegister(RegisterIndex reg, const LuaValue& value) { Register(reg) = value; }
+    
+    /**
+     * @brief 获取寄存器值（只读引用，不复制）
+     */
+    const LuaValue& GetRegister(RegisterIndex reg) const {
+        CheckRegisterIndex(reg);
+        return register_base_[reg];
+    }
+    
+    /**
+     * @brief 获取RK值（寄存器或常量）的只读引用
+     */
+    const LuaValue& GetRK(int rk) const {
+        if (IsConstant(rk)) {
+            return current_proto_->GetConstants()[RKToConstantIndex(rk)];
+        }
+        return GetRegister(static_cast<RegisterIndex>(rk));
+    }
+    
+    /**
+     * @brief 获取Bx常量操作数（LOADK/GETGLOBAL/SETGLOBAL）
+     * @param require_string 要求常量是字符串（全局变量名）
+     * @note 已校验的原型在加载时检查过索引和类型，这里只对未校验的原型检查
+     */
+    const LuaValue& ConstantOperand(int bx, const char* opname, bool require_string = false) const {
+        if (!current_proto_ || !current_proto_->IsVerified()) [[unlikely]] {
+            CheckConstantOperand(bx, opname, require_string);
+        }
+        return current_proto_->GetConstants()[bx];
+    }
+    
+    void CheckConstantOperand(int bx, const char* opname, bool require_string) const;
     
     /**
-     * @brief 获取寄存器值
+     * @brief 寄存器索引检查：拒绝非法编码以及超出当前栈顶（帧窗口）的寄存器
      */
-    LuaValue GetRegister(RegisterIndex reg) const;
+    void CheckRegisterIndex(RegisterIndex reg) const {
+        if (static_cast<uint32_t>(reg) > MAXARG_A ||
+            register_base_ + reg >= stack_->GetData() + stack_->GetTop()) [[unlikely]] {
+            ThrowRegisterOutOfRange(reg);
+        }
+    }
+    
+    [[noreturn]] static void ThrowRegisterOutOfRange(RegisterIndex reg);
+    
+    /**
+     * @brief 重新计算寄存器基址和当前函数（切换调用帧或栈重新分配后调用）
+     */
+    void RefreshFrameCache();
     
     /**
-     * @brief 获取RK值（寄存器或常量）
+     * @brief 栈存储地址变化时刷新寄存器基址
      */
-    LuaValue GetRK(int rk) const;
+    void RevalidateRegisterBase() {
+        if (stack_->GetData() != cached_stack_data_) {
+            RefreshFrameCache();
+        }
+    }
+    
+    /**
+     * @brief 扩展栈顶以容纳当前帧的全部寄存器（max_stack_size）
+     * @return 完整窗口是否可用（仅未设置max_stack_size的原型可能被栈上限截断）
+     */
+    bool EnsureFrameWindow();
     
     /**
      * @brief 获取当前调用帧的基址
@@ -563,20 +950,35 @@ private:
     // 配置
     VMConfig config_;
     
-    // 核心组件
-    std::unique_ptr<LuaStack> stack_;           // 值堆栈
+    // 核心组件（内存管理器最先构造、最后析构，栈和全局表的存储归还给它）
+    std::unique_ptr<MemoryManager> memory_manager_; // 本状态的内存管理器
+    std::unique_ptr<LuaStack> main_stack_;      // 主线程的值堆栈
+    LuaStack* stack_;                           // 当前线程的值堆栈（协程切换时改指向协程栈）
     
     // 调用栈管理（Lua 5.1.5 风格）
     // 类似 Lua 中的 lua_State::ci, base_ci, end_ci
-    std::vector<CallFrame> call_frames_;        // 调用帧数组
-    Size current_frame_index_;                  // 当前帧索引（类似 ci - base_ci）
-    Size max_call_depth_;                       // 最大调用深度
+    CallFrameStack call_frames_;                // 调用帧栈（前16帧内联）
+    
+    // 寄存器窗口缓存（切换调用帧或栈重新分配时刷新）
+    LuaValue* register_base_ = nullptr;         // 当前帧R(0)的地址
+    const Proto* current_proto_ = nullptr;      // 当前函数原型
+    const LuaValue* cached_stack_data_ = nullptr; // 计算register_base_时的栈存储地址
     
     // 执行状态
     ExecutionState execution_state_;            // 执行状态
+    Size call_stop_depth_ = 0;                  // 嵌套调用返回到此帧深度时解释器循环退出
+    Size open_top_ = 0;                         // 开放栈顶（同L->top）：C=0的CALL和B=0的VARARG
+                                                // 产生的值的末尾，供随后B=0的CALL/RETURN/SETLIST使用
+    std::string concat_buffer_;                 // CONCAT拼接短结果的复用缓冲区
+    int64_t preempt_budget_ = INT64_MAX;        // 剩余抢占预算（回跳和调用处扣减）
+    bool preempted_ = false;                    // 上次因预算耗尽而挂起
     
     // 全局状态
-    std::shared_ptr<LuaTable> global_table_;    // 全局变量表
+    std::shared_ptr<LuaTable> global_table_;    // 全局变量表（GC经MarkGlobals把内容作为根）
+    std::array<StringObject*, static_cast<Size>(MetaMethod::Count)> metamethod_names_{}; // 驻留的元方法事件名（同G(L)->tmname）
+    ObjectArena object_arena_;                  // 请求级临时对象arena
+    std::vector<std::pair<Size, RootMarker>> root_markers_; // 登记的额外根
+    Size next_root_marker_id_ = 1;
     
     // 调试和分析
     DebugHook debug_hook_;                      // 调试钩子
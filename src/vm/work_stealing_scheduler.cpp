@@ -0,0 +1,179 @@
+#include "work_stealing_scheduler.h"
+#include <algorithm>
+
+namespace lua_cpp {
+
+/* ========================================================================== */
+/* WorkStealingScheduler 实现 */
+/* ========================================================================== */
+
+WorkStealingScheduler::WorkStealingScheduler(Size worker_count, Size slice_resumes)
+    : slice_resumes_(std::max<Size>(slice_resumes, 1))
+    , running_(false)
+    , pending_states_(0) {
+
+    if (worker_count == 0) {
+        worker_count = std::max<Size>(std::thread::hardware_concurrency(), 1);
+    }
+
+    workers_.reserve(worker_count);
+    for (Size i = 0; i < worker_count; ++i) {
+        auto worker = std::make_unique<Worker>();
+        worker->random_state = 0x9E3779B97F4A7C15ULL * (i + 1);  // xorshift状态不能为0
+        workers_.push_back(std::move(worker));
+    }
+}
+
+/* ====================================================================== */
+/* 状态管理 */
+/* ====================================================================== */
+
+WorkStealingScheduler::StateId WorkStealingScheduler::CreateState() {
+    if (running_.load(std::memory_order_relaxed)) {
+        throw CoroutineError("Cannot add states while the work-stealing scheduler is running");
+    }
+
+    auto slot = std::make_unique<StateSlot>();
+    slot->memory_manager = std::make_unique<MemoryManager>();
+    slot->scheduler = std::make_unique<CoroutineScheduler>(*slot->memory_manager);
+    slot->scheduler->SetSchedulingPolicy(CoroutineScheduler::SchedulingPolicy::WORK_STEALING);
+    slot->id = states_.size();
+    states_.push_back(std::move(slot));
+    return states_.back()->id;
+}
+
+/* ====================================================================== */
+/* 执行 */
+/* ====================================================================== */
+
+void WorkStealingScheduler::Run() {
+    if (running_.exchange(true)) {
+        throw CoroutineError("Work-stealing scheduler is already running");
+    }
+
+    for (auto& worker : workers_) {
+        worker->stats = WorkStealingStats{};
+    }
+    first_error_ = nullptr;
+
+    // 线程启动前按轮转把有就绪协程的状态分配到各工作线程的队列
+    // （线程创建本身建立happens-before，这里的Push不与窃取并发）
+    Size pending = 0;
+    for (auto& slot : states_) {
+        if (slot->scheduler->HasReadyCoroutines()) {
+            workers_[pending % workers_.size()]->deque.Push(slot.get());
+            pending++;
+        }
+    }
+    pending_states_.store(pending, std::memory_order_relaxed);
+
+    // 调用线程充当0号工作线程
+    std::vector<std::thread> threads;
+    threads.reserve(workers_.size() - 1);
+    for (Size i = 1; i < workers_.size(); ++i) {
+        threads.emplace_back(&WorkStealingScheduler::WorkerLoop, this, i);
+    }
+    WorkerLoop(0);
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    running_.store(false);
+
+    if (first_error_) {
+        std::rethrow_exception(first_error_);
+    }
+}
+
+void WorkStealingScheduler::WorkerLoop(Size index) {
+    Worker& worker = *workers_[index];
+
+    while (pending_states_.load(std::memory_order_acquire) > 0) {
+        StateSlot* slot = worker.deque.Pop();
+        if (!slot) {
+            slot = TrySteal(index);
+            if (!slot) {
+                // 所有可运行状态都在其他线程上执行
+                std::this_thread::yield();
+                continue;
+            }
+        }
+
+        // 状态固定在本线程直到被放回队列，期间只有本线程访问它
+        if (RunSlice(worker, slot)) {
+            worker.deque.Push(slot);
+        } else {
+            pending_states_.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    }
+}
+
+WorkStealingScheduler::StateSlot* WorkStealingScheduler::TrySteal(Size index) {
+    Size worker_count = workers_.size();
+    if (worker_count <= 1) {
+        return nullptr;
+    }
+
+    Worker& worker = *workers_[index];
+
+    // xorshift64选择随机起点，避免所有空闲线程同时冲击同一个受害者
+    uint64_t x = worker.random_state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    worker.random_state = x;
+
+    Size start = static_cast<Size>(x % worker_count);
+    for (Size i = 0; i < worker_count; ++i) {
+        Size victim = (start + i) % worker_count;
+        if (victim == index) {
+            continue;
+        }
+
+        if (StateSlot* slot = workers_[victim]->deque.Steal()) {
+            worker.stats.steals++;
+            return slot;
+        }
+        worker.stats.failed_steals++;
+    }
+
+    return nullptr;
+}
+
+bool WorkStealingScheduler::RunSlice(Worker& worker, StateSlot* slot) {
+    CoroutineScheduler& scheduler = *slot->scheduler;
+    MemoryManagerScope memory_scope(*slot->memory_manager);
+
+    try {
+        worker.stats.resumes_executed += scheduler.RunReadyCoroutines(slice_resumes_);
+    } catch (...) {
+        // 出错的状态不再调度，其余状态继续运行，Run结束后抛出第一个错误
+        std::lock_guard<std::mutex> lock(error_mutex_);
+        if (!first_error_) {
+            first_error_ = std::current_exception();
+        }
+        worker.stats.slices_executed++;
+        return false;
+    }
+
+    worker.stats.slices_executed++;
+    return scheduler.HasReadyCoroutines();
+}
+
+/* ====================================================================== */
+/* 统计 */
+/* ====================================================================== */
+
+WorkStealingScheduler::WorkStealingStats WorkStealingScheduler::GetStats() const {
+    WorkStealingStats total;
+    for (const auto& worker : workers_) {
+        total.slices_executed += worker->stats.slices_executed;
+        total.resumes_executed += worker->stats.resumes_executed;
+        total.steals += worker->stats.steals;
+        total.failed_steals += worker->stats.failed_steals;
+    }
+    return total;
+}
+
+} // namespace lua_cpp
@@ -0,0 +1,325 @@
+#pragma once
+
+#include "coroutine_support.h"
+#include "core/lua_common.h"
+#include "memory/memory_manager.h"
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace lua_cpp {
+
+/* ========================================================================== */
+/* Chase-Lev工作窃取双端队列 */
+/* ========================================================================== */
+
+/**
+ * @brief Chase-Lev工作窃取双端队列
+ *
+ * 所有者线程在底部Push/Pop（LIFO），其他线程从顶部Steal（FIFO）。
+ * 只有队列剩一个元素时所有者才与窃取者竞争顶部CAS。扩容时旧缓冲区
+ * 保留到析构，因为并发的窃取者可能仍在读取它。内存序按Lê等人
+ * 《Correct and Efficient Work-Stealing for Weak Memory Models》。
+ *
+ * @tparam T 元素类型，必须是指针（空队列或竞争失败时返回nullptr）
+ */
+template<typename T>
+class WorkStealingDeque {
+    static_assert(std::is_pointer_v<T>, "WorkStealingDeque stores pointers");
+
+public:
+    explicit WorkStealingDeque(Size initial_capacity = 64)
+        : top_(0), bottom_(0) {
+        Size capacity = 1;
+        while (capacity < initial_capacity) {
+            capacity <<= 1;
+        }
+        buffers_.push_back(std::make_unique<Buffer>(capacity));
+        buffer_.store(buffers_.back().get(), std::memory_order_relaxed);
+    }
+
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    /**
+     * @brief 压入底部（仅所有者线程）
+     */
+    void Push(T item) {
+        int64_t bottom = bottom_.load(std::memory_order_relaxed);
+        int64_t top = top_.load(std::memory_order_acquire);
+        Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+
+        if (bottom - top > static_cast<int64_t>(buffer->mask)) {
+            buffer = Grow(buffer, top, bottom);
+        }
+
+        buffer->Put(bottom, item);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 从底部弹出（仅所有者线程）
+     * @return 元素，队列为空时返回nullptr
+     */
+    T Pop() {
+        int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+        Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+        bottom_.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = top_.load(std::memory_order_relaxed);
+
+        if (top > bottom) {
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        T item = buffer->Get(bottom);
+        if (top == bottom) {
+            // 最后一个元素：与窃取者竞争
+            if (!top_.compare_exchange_strong(top, top + 1,
+                                              std::memory_order_seq_cst,
+                                              std::memory_order_relaxed)) {
+                item = nullptr;
+            }
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    /**
+     * @brief 从顶部窃取（任意线程）
+     * @return 元素，队列为空或与其他线程竞争失败时返回nullptr
+     */
+    T Steal() {
+        int64_t top = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t bottom = bottom_.load(std::memory_order_acquire);
+
+        if (top >= bottom) {
+            return nullptr;
+        }
+
+        Buffer* buffer = buffer_.load(std::memory_order_acquire);
+        T item = buffer->Get(top);
+        if (!top_.compare_exchange_strong(top, top + 1,
+                                          std::memory_order_seq_cst,
+                                          std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return item;
+    }
+
+    /**
+     * @brief 获取近似元素数量（并发时仅供参考）
+     */
+    Size GetSizeApprox() const {
+        int64_t bottom = bottom_.load(std::memory_order_relaxed);
+        int64_t top = top_.load(std::memory_order_relaxed);
+        return bottom > top ? static_cast<Size>(bottom - top) : 0;
+    }
+
+private:
+    /**
+     * @brief 环形缓冲区，容量为2的幂
+     */
+    struct Buffer {
+        explicit Buffer(Size capacity)
+            : mask(capacity - 1), slots(new std::atomic<T>[capacity]) {}
+
+        T Get(int64_t index) const {
+            return slots[static_cast<Size>(index) & mask].load(std::memory_order_relaxed);
+        }
+
+        void Put(int64_t index, T item) {
+            slots[static_cast<Size>(index) & mask].store(item, std::memory_order_relaxed);
+        }
+
+        Size mask;
+        std::unique_ptr<std::atomic<T>[]> slots;
+    };
+
+    Buffer* Grow(Buffer* old_buffer, int64_t top, int64_t bottom) {
+        auto grown = std::make_unique<Buffer>((old_buffer->mask + 1) * 2);
+        for (int64_t i = top; i < bottom; ++i) {
+            grown->Put(i, old_buffer->Get(i));
+        }
+
+        Buffer* buffer = grown.get();
+        buffers_.push_back(std::move(grown));
+        buffer_.store(buffer, std::memory_order_release);
+        return buffer;
+    }
+
+    // 顶部和底部分处不同缓存行，减少所有者与窃取者之间的伪共享
+    alignas(64) std::atomic<int64_t> top_;
+    alignas(64) std::atomic<int64_t> bottom_;
+    std::atomic<Buffer*> buffer_;
+    std::vector<std::unique_ptr<Buffer>> buffers_;  // 仅所有者线程修改
+};
+
+/* ========================================================================== */
+/* 工作窃取调度器 */
+/* ========================================================================== */
+
+/**
+ * @brief 多线程工作窃取调度器
+ *
+ * 在N个工作线程上运行一组互相隔离的VM状态。每个状态有自己的
+ * MemoryManager和建立在其上的CoroutineScheduler（自己的协程、栈和执行器），
+ * 执行时片期间绑定为线程当前的内存管理器；同一时刻只被一个工作线程执行，
+ * 因此状态内部不需要任何锁。状态之间只共享只读的函数原型：原型须在
+ * 加入前通过BytecodeVerifier校验，内联缓存在校验时分配好，执行期只做
+ * 宽松原子的预测更新。
+ *
+ * 可运行的状态放在每个工作线程自己的Chase-Lev双端队列中：工作线程从
+ * 本地队列取出状态，执行一个时间片（最多slice_resumes次resume），仍有
+ * 就绪协程则放回本地队列；本地队列为空时从其他工作线程窃取整个状态。
+ * 状态在队列之间的转移由双端队列的原子操作建立happens-before关系。
+ */
+class WorkStealingScheduler {
+public:
+    using StateId = Size;
+
+    /**
+     * @brief 构造函数
+     * @param worker_count 工作线程数量（0表示使用硬件并发数）
+     * @param slice_resumes 每个时间片最多执行的resume次数
+     */
+    explicit WorkStealingScheduler(Size worker_count = 0, Size slice_resumes = 64);
+
+    /**
+     * @brief 析构函数
+     */
+    ~WorkStealingScheduler() = default;
+
+    // 禁用拷贝和移动（工作线程引用调度器地址）
+    WorkStealingScheduler(const WorkStealingScheduler&) = delete;
+    WorkStealingScheduler& operator=(const WorkStealingScheduler&) = delete;
+
+    /* ====================================================================== */
+    /* 状态管理 */
+    /* ====================================================================== */
+
+    /**
+     * @brief 创建一个隔离的VM状态（自己的内存管理器和协程调度器）
+     * @return 状态ID，经GetState设置执行器并调度协程，就绪队列即为待执行的工作
+     * @throws CoroutineError 调度器正在运行
+     */
+    StateId CreateState();
+
+    /**
+     * @brief 获取状态（Run期间不得访问）
+     */
+    CoroutineScheduler& GetState(StateId id) { return *states_[id]->scheduler; }
+
+    /**
+     * @brief 获取状态数量
+     */
+    Size GetStateCount() const { return states_.size(); }
+
+    /**
+     * @brief 获取工作线程数量
+     */
+    Size GetWorkerCount() const { return workers_.size(); }
+
+    /* ====================================================================== */
+    /* 执行 */
+    /* ====================================================================== */
+
+    /**
+     * @brief 启动工作线程并运行，直到所有状态的就绪队列都为空
+     * @throws 重新抛出任一状态执行中的第一个异常
+     */
+    void Run();
+
+    /* ====================================================================== */
+    /* 统计 */
+    /* ====================================================================== */
+
+    /**
+     * @brief 工作窃取统计信息（Run结束后汇总）
+     */
+    struct WorkStealingStats {
+        Size slices_executed = 0;       // 执行的时间片数
+        Size resumes_executed = 0;      // 执行的resume总数
+        Size steals = 0;                // 成功窃取次数
+        Size failed_steals = 0;         // 空队列或竞争失败的窃取次数
+    };
+
+    /**
+     * @brief 获取全部工作线程的汇总统计
+     */
+    WorkStealingStats GetStats() const;
+
+    /**
+     * @brief 获取单个工作线程的统计
+     */
+    const WorkStealingStats& GetWorkerStats(Size worker) const { return workers_[worker]->stats; }
+
+private:
+    /* ====================================================================== */
+    /* 内部数据结构 */
+    /* ====================================================================== */
+
+    /**
+     * @brief 隔离的VM状态
+     */
+    struct StateSlot {
+        std::unique_ptr<MemoryManager> memory_manager;      // 先于调度器构造，后于其析构
+        std::unique_ptr<CoroutineScheduler> scheduler;
+        StateId id;
+    };
+
+    /**
+     * @brief 工作线程数据
+     */
+    struct Worker {
+        WorkStealingDeque<StateSlot*> deque;
+        WorkStealingStats stats;        // 仅本线程写，Run结束后读取
+        uint64_t random_state;          // 选择窃取目标的xorshift状态
+    };
+
+    /* ====================================================================== */
+    /* 内部方法 */
+    /* ====================================================================== */
+
+    /**
+     * @brief 工作线程主循环
+     */
+    void WorkerLoop(Size index);
+
+    /**
+     * @brief 从随机起点依次尝试窃取其他工作线程的状态
+     */
+    StateSlot* TrySteal(Size index);
+
+    /**
+     * @brief 执行一个时间片
+     * @return 状态是否仍有就绪协程
+     */
+    bool RunSlice(Worker& worker, StateSlot* slot);
+
+    /* ====================================================================== */
+    /* 成员变量 */
+    /* ====================================================================== */
+
+    std::vector<std::unique_ptr<StateSlot>> states_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    Size slice_resumes_;
+
+    // 运行状态
+    std::atomic<bool> running_;
+    std::atomic<Size> pending_states_;   // 尚有就绪协程的状态数
+
+    // 第一个执行错误（罕见路径，加锁即可）
+    std::mutex error_mutex_;
+    std::exception_ptr first_error_;
+};
+
+} // namespace lua_cpp
@@ -2,13 +2,18 @@
 #include "vm/call_stack_advanced.h"
 #include "vm/upvalue_manager.h"
 #include "vm/coroutine_support.h"
+#include "vm/work_stealing_scheduler.h"
 #include "vm/virtual_machine.h"
 #include "core/proto.h"
 #include "core/lua_value.h"
 #include "vm/stack.h"
+#include "memory/garbage_collector.h"
+#include <algorithm>
 #include <memory>
+#include <mutex>
 #include <vector>
 #include <random>
+#include <thread>
 
 namespace lua_cpp {
 
@@ -38,20 +43,46 @@ private:
 /* ========================================================================== */
 
 static void BM_CallStack_PushPop(benchmark::State& state) {
-    AdvancedCallStack stack(1000);
+    // 参数0表示关闭剖析，否则为剖析的采样间隔
+    const Size sample_interval = state.range(0);
+    AdvancedCallStackManager stack(1000);
     Proto proto;
-    LuaValue func = LuaValue::Function(&proto);
-    std::vector<LuaValue> args = {LuaValue::Number(42)};
-    std::vector<LuaValue> result = {LuaValue::Number(84)};
+    
+    if (sample_interval > 0) {
+        stack.SetProfilingEnabled(true);
+        stack.SetProfileSampleInterval(sample_interval);
+    }
     
     for (auto _ : state) {
-        stack.PushFrame(func, args, 0);
-        stack.PopFrame(result);
+        stack.PushFrame(&proto, 1, 0);
+        auto frame = stack.PopFrame();
+        benchmark::DoNotOptimize(frame);
     }
     
+    state.SetLabel(sample_interval > 0 ? "profiling" : "no profiling");
     state.SetItemsProcessed(state.iterations() * 2);  // Push + Pop
 }
-BENCHMARK(BM_CallStack_PushPop);
+BENCHMARK(BM_CallStack_PushPop)->Arg(0)->Arg(1)->Arg(64);
+
+static void BM_CallFrameStack_NestedPushPop(benchmark::State& state) {
+    // 嵌套深度：16以内只使用内联缓冲区，超过后使用堆上数组
+    const Size depth = state.range(0);
+    CallFrameStack frames(1000);
+    Proto proto;
+    
+    for (auto _ : state) {
+        for (Size i = 0; i < depth; ++i) {
+            frames.Push(&proto, i + 1, i, 1);
+        }
+        for (Size i = 0; i < depth; ++i) {
+            benchmark::DoNotOptimize(frames.Pop());
+        }
+    }
+    
+    state.SetLabel(frames.IsInline() ? "inline" : "heap");
+    state.SetItemsProcessed(state.iterations() * depth * 2);
+}
+BENCHMARK(BM_CallFrameStack_NestedPushPop)->Arg(8)->Arg(15)->Arg(64);
 
 static void BM_CallStack_TailCallOptimization(benchmark::State& state) {
     AdvancedCallStack stack(1000);
@@ -262,6 +293,48 @@ static void BM_Upvalue_GarbageCollection(benchmark::State& state) {
 }
 BENCHMARK(BM_Upvalue_GarbageCollection);
 
+static void BM_Upvalue_ClosureFrameCycle(benchmark::State& state) {
+    // 模拟闭包密集代码：外层已有outer个长期存活的开放Upvalue，
+    // 每次迭代在更高的栈帧中捕获8个局部变量、闭包逃逸一半后返回。
+    // 有序链表下CloseUpvalues只访问本帧的节点，耗时不随outer增长。
+    const Size outer = state.range(0);
+    constexpr Size kLocals = 8;
+    
+    LuaStack stack(outer + 64);
+    for (Size i = 0; i < outer + 64; ++i) {
+        stack.Push(LuaValue::Number(i));
+    }
+    
+    UpvalueManager manager(&stack);
+    for (Size i = 0; i < outer; ++i) {
+        manager.AddReference(manager.GetUpvalue(i));
+    }
+    
+    const Size base = outer + 16;
+    Upvalue* escaped[kLocals];
+    
+    for (auto _ : state) {
+        for (Size i = 0; i < kLocals; ++i) {
+            // 两个闭包共享同一局部变量
+            Upvalue* upvalue = manager.GetUpvalue(base + i);
+            benchmark::DoNotOptimize(manager.GetUpvalue(base + i));
+            escaped[i] = (i % 2 == 0) ? upvalue : nullptr;
+            if (escaped[i]) {
+                manager.AddReference(upvalue);
+            }
+        }
+        
+        manager.CloseUpvalues(base);
+        
+        for (Size i = 0; i < kLocals; ++i) {
+            manager.RemoveReference(escaped[i]);
+        }
+    }
+    
+    state.SetItemsProcessed(state.iterations() * kLocals);
+}
+BENCHMARK(BM_Upvalue_ClosureFrameCycle)->Arg(0)->Range(8, 1024);
+
 /* ========================================================================== */
 /* CoroutineSupport 性能基准 */
 /* ========================================================================== */
@@ -317,6 +390,87 @@ static void BM_Coroutine_ContextSwitch(benchmark::State& state) {
 }
 BENCHMARK(BM_Coroutine_ContextSwitch);
 
+static void BM_Coroutine_PingPong(benchmark::State& state) {
+    CoroutineScheduler scheduler;
+    
+    // 协程体：取出传入值，加一后yield回去，模拟VM在自身栈上的执行
+    scheduler.SetExecutor([&scheduler](CoroutineContext& context) -> Size {
+        LuaStack& stack = context.GetLuaStack();
+        LuaValue value = stack.Pop();
+        stack.Push(LuaValue(value.GetNumber() + 1));
+        scheduler.Yield(1);
+        return 0;
+    });
+    
+    Proto proto;
+    auto id = scheduler.CreateCoroutine(&proto);
+    LuaStack& main_stack = scheduler.GetActiveContext().GetLuaStack();
+    
+    double value = 0;
+    for (auto _ : state) {
+        main_stack.Push(LuaValue(value));
+        scheduler.Resume(id, 1);
+        value = main_stack.Pop().GetNumber();
+    }
+    
+    benchmark::DoNotOptimize(value);
+    
+    // 每次迭代包含resume和yield两次切换
+    state.SetItemsProcessed(state.iterations() * 2);
+}
+BENCHMARK(BM_Coroutine_PingPong);
+
+static void BM_Coroutine_VMResumeYield(benchmark::State& state) {
+    // 真实的VM切换：协程体是一个死循环，预算为1时每次resume执行一次回跳即被
+    // 抢占让出，每次迭代包含栈和调用帧的换入、解释器进出和换回
+    VirtualMachine vm;
+    CoroutineSupport support(&vm);
+    CoroutineSupport::CoroutineConfig config;
+    config.enable_preemption = true;
+    config.preempt_budget = 1;
+    support.SetConfig(config);
+    
+    Proto proto("spin");
+    proto.AddInstruction(CreateAsBx(OpCode::JMP, 0, -1), 1);
+    proto.AddInstruction(CreateABC(OpCode::RETURN, 0, 1, 0), 1);
+    proto.SetMaxStackSize(1);
+    LuaValue func(AllocateGCObject<FunctionObject>(&proto));
+    LuaValue coroutine = support.CreateCoroutine(func);
+    
+    for (auto _ : state) {
+        auto results = support.Resume(coroutine);
+        benchmark::DoNotOptimize(results);
+    }
+    
+    state.SetItemsProcessed(state.iterations() * 2);
+}
+BENCHMARK(BM_Coroutine_VMResumeYield);
+
+static void BM_Coroutine_ShortLivedSpawn(benchmark::State& state) {
+    CoroutineScheduler scheduler;
+    scheduler.SetContextPoolLimits(static_cast<Size>(state.range(0)));
+    
+    // 每条消息一个协程：运行一次即结束
+    scheduler.SetExecutor([](CoroutineContext& context) -> Size {
+        return context.GetTransferCount();
+    });
+    
+    Proto proto;
+    LuaStack& main_stack = scheduler.GetActiveContext().GetLuaStack();
+    
+    for (auto _ : state) {
+        auto id = scheduler.CreateCoroutine(&proto);
+        main_stack.Push(LuaValue(1.0));
+        Size nresults = scheduler.Resume(id, 1);
+        main_stack.SetTop(main_stack.GetTop() - nresults);
+        scheduler.DestroyCoroutine(id);
+    }
+    
+    state.counters["PoolHitRate"] = scheduler.GetStats().GetContextPoolHitRate();
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Coroutine_ShortLivedSpawn)->Arg(0)->Arg(VM_COROUTINE_POOL_DEFAULT_SIZE);
+
 static void BM_Coroutine_MassCreation(benchmark::State& state) {
     const Size count = state.range(0);
     
@@ -366,6 +520,150 @@ static void BM_Coroutine_SchedulerOperations(benchmark::State& state) {
 }
 BENCHMARK(BM_Coroutine_SchedulerOperations);
 
+/* ========================================================================== */
+/* WorkStealingScheduler 性能基准 */
+/* ========================================================================== */
+
+static void BM_WorkStealing_ThroughputVsCores(benchmark::State& state) {
+    const Size worker_count = static_cast<Size>(state.range(0));
+    constexpr Size kStates = 64;
+    constexpr Size kCoroutinesPerState = 16;
+    constexpr Size kStepsPerCoroutine = 32;
+    
+    Proto proto;
+    Size total_resumes = 0;
+    
+    for (auto _ : state) {
+        state.PauseTiming();
+        WorkStealingScheduler scheduler(worker_count);
+        for (Size s = 0; s < kStates; ++s) {
+            CoroutineScheduler* session = &scheduler.GetState(scheduler.CreateState());
+            
+            // 每次resume做一段计算后yield，用指令指针记录已执行的步数
+            session->SetExecutor([session](CoroutineContext& context) -> Size {
+                double acc = static_cast<double>(context.GetInstructionPointer());
+                for (int i = 0; i < 256; ++i) {
+                    acc = acc * 1.0000001 + 0.5;
+                }
+                benchmark::DoNotOptimize(acc);
+                
+                Size step = context.GetInstructionPointer() + 1;
+                context.SetInstructionPointer(step);
+                if (step < kStepsPerCoroutine) {
+                    session->Yield(0);
+                }
+                return 0;
+            });
+            
+            for (Size c = 0; c < kCoroutinesPerState; ++c) {
+                session->Schedule(session->CreateCoroutine(&proto));
+            }
+        }
+        state.ResumeTiming();
+        
+        scheduler.Run();
+        
+        state.PauseTiming();
+        total_resumes += scheduler.GetStats().resumes_executed;
+        state.ResumeTiming();
+    }
+    
+    state.SetItemsProcessed(total_resumes);
+    state.counters["Workers"] = static_cast<double>(worker_count);
+}
+BENCHMARK(BM_WorkStealing_ThroughputVsCores)
+    ->RangeMultiplier(2)
+    ->Range(1, std::max<int>(static_cast<int>(std::thread::hardware_concurrency()), 1))
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+/* ========================================================================== */
+/* GarbageCollector 对象注册性能基准 */
+/* ========================================================================== */
+
+static GarbageCollector* g_registration_gc = nullptr;
+static std::mutex g_registration_mutex;
+
+// range(0): 0=单所有者模式，1=并发模式（线程本地链表），2=单所有者模式外加全局互斥锁（原实现的加锁方式）
+static void BM_GC_RegisterObject(benchmark::State& state) {
+    if (state.thread_index() == 0) {
+        GCConfig config;
+        config.enable_auto_gc = false;
+        config.threading_mode = state.range(0) == 1 ? GCThreadingMode::Concurrent
+                                                    : GCThreadingMode::SingleOwner;
+        g_registration_gc = new GarbageCollector();
+        g_registration_gc->SetConfig(config);
+    }
+    
+    for (auto _ : state) {
+        auto* obj = new UserDataObject(16);
+        if (state.range(0) == 2) {
+            std::lock_guard<std::mutex> lock(g_registration_mutex);
+            g_registration_gc->RegisterObject(obj);
+        } else {
+            g_registration_gc->RegisterObject(obj);
+        }
+    }
+    
+    state.SetItemsProcessed(state.iterations());
+    
+    if (state.thread_index() == 0) {
+        delete g_registration_gc;   // 析构时先拼接线程本地链表再释放全部对象
+        g_registration_gc = nullptr;
+    }
+}
+BENCHMARK(BM_GC_RegisterObject)->Arg(0)->Threads(1)->UseRealTime();
+BENCHMARK(BM_GC_RegisterObject)->Arg(1)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_GC_RegisterObject)->Arg(2)->ThreadRange(1, 8)->UseRealTime();
+
+/* ========================================================================== */
+/* GarbageCollector 标记性能基准 */
+/* ========================================================================== */
+
+// 100万个存活对象的全量收集：根表下range(0)个中间表，每个中间表挂满叶子表，
+// 叶子表再引用父表和根表，每个对象都有需要遍历的子引用
+static void BM_GC_FullCollection(benchmark::State& state) {
+    const Size fan_out = state.range(0);
+    const Size leaves_per_table = 1000000 / fan_out - 1;
+    
+    VirtualMachine vm;
+    GarbageCollector gc(&vm);
+    GCConfig config;
+    config.enable_auto_gc = false;
+    config.enable_incremental = false;
+    gc.SetConfig(config);
+    
+    TableObject* root = new TableObject(static_cast<Size>(fan_out), 0);
+    gc.RegisterObject(root);
+    vm.Push(LuaValue(root));
+    for (Size i = 1; i <= fan_out; ++i) {
+        TableObject* table = new TableObject(leaves_per_table, 0);
+        gc.RegisterObject(table);
+        root->Set(LuaValue(static_cast<double>(i)), LuaValue(table));
+        for (Size j = 1; j <= leaves_per_table; ++j) {
+            TableObject* leaf = new TableObject(2, 0);
+            gc.RegisterObject(leaf);
+            leaf->Set(LuaValue(1), LuaValue(table));
+            leaf->Set(LuaValue(2), LuaValue(root));
+            table->Set(LuaValue(static_cast<double>(j)), LuaValue(leaf));
+        }
+    }
+    
+    for (auto _ : state) {
+        gc.Collect();
+    }
+    
+    GCStatistics stats = gc.GetStatistics();
+    state.SetItemsProcessed(state.iterations() * gc.GetObjectCount());
+    state.counters["objects"] = static_cast<double>(gc.GetObjectCount());
+    state.counters["mark_stack_peak"] = static_cast<double>(stats.mark_stack_peak);
+    state.counters["mark_stack_overflows"] = static_cast<double>(stats.mark_stack_overflows);
+    
+    vm.Pop();
+}
+// 1000：标记栈只有几千个槽；1：一张表压入全部叶子，超出块数上限的部分走溢出链
+BENCHMARK(BM_GC_FullCollection)->Arg(1000)->Arg(1)->Unit(benchmark::kMillisecond);
+
 /* ========================================================================== */
 /* 集成性能基准 */
 /* ========================================================================== */
@@ -177,7 +177,7 @@ TEST_CASE("VM - 调用帧管理契约", "[vm][contract][callframe]") {
         proto->AddInstruction(CreateABCInstruction(OpCode::RETURN, 0, 1, 0));
         
         // 创建调用帧
-        vm.PushCallFrame(proto.get(), 0, 2); // base=0, param_count=2
+        vm.PushCallFrame(proto.get(), 0);
         
         REQUIRE(vm.GetCallFrameCount() == 1);
         
@@ -199,9 +199,9 @@ TEST_CASE("VM - 调用帧管理契约", "[vm][contract][callframe]") {
         auto proto3 = std::make_unique<Proto>();
         
         // 创建嵌套调用帧
-        vm.PushCallFrame(proto1.get(), 0, 0);
-        vm.PushCallFrame(proto2.get(), 5, 1);
-        vm.PushCallFrame(proto3.get(), 10, 2);
+        vm.PushCallFrame(proto1.get(), 0);
+        vm.PushCallFrame(proto2.get(), 5);
+        vm.PushCallFrame(proto3.get(), 10);
         
         REQUIRE(vm.GetCallFrameCount() == 3);
         
@@ -226,7 +226,7 @@ TEST_CASE("VM - 调用帧管理契约", "[vm][contract][callframe]") {
         // 创建过多的调用帧应该抛出异常
         REQUIRE_THROWS_AS([&]() {
             for (int i = 0; i < 1000; ++i) {
-                vm.PushCallFrame(proto.get(), i, 0);
+                vm.PushCallFrame(proto.get(), i);
             }
         }(), CallStackOverflowError);
     }
@@ -261,7 +261,7 @@ TEST_CASE("VM - 数据移动指令执行契约", "[vm][contract][instruction][mo
         Size const_idx = proto->AddConstant(TValue::CreateString("hello"));
         
         // 设置当前函数
-        vm.PushCallFrame(proto.get(), 0, 0);
+        vm.PushCallFrame(proto.get(), 0);
         
         // 执行LOADK指令: R(0) = K(const_idx)
         Instruction loadk_inst = CreateABxInstruction(OpCode::LOADK, 0, const_idx);
@@ -335,7 +335,7 @@ TEST_CASE("VM - 算术指令执行契约", "[vm][contract][instruction][arithmet
         // 添加常量
         Size const_idx = proto->AddConstant(TValue::CreateNumber(3.0));
         
-        vm.PushCallFrame(proto.get(), 0, 0);
+        vm.PushCallFrame(proto.get(), 0);
         vm.SetStack(1, TValue::CreateNumber(7.0));
         
         // 执行MUL指令: R(0) = R(1) * K(const_idx)
@@ -490,7 +490,7 @@ TEST_CASE("VM - 函数调用指令契约", "[vm][contract][instruction][call]")
         auto proto = std::make_unique<Proto>();
         
         // 创建调用帧
-        vm.PushCallFrame(proto.get(), 5, 0); // base = 5
+        vm.PushCallFrame(proto.get(), 5); // base = 5
         
         // 设置返回值
         vm.SetStack(5, TValue::CreateNumber(42.0));
@@ -515,7 +515,7 @@ TEST_CASE("VM - 函数调用指令契约", "[vm][contract][instruction][call]")
         auto proto2 = std::make_unique<Proto>();
         
         // 创建调用帧
-        vm.PushCallFrame(proto1.get(), 0, 0);
+        vm.PushCallFrame(proto1.get(), 0);
         
         // 设置尾调用
         TValue func = TValue::CreateFunction(proto2.get());
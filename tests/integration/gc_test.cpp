@@ -11,8 +11,12 @@
 #include <vector>
 #include <string>
 #include <chrono>
+#include <thread>
+#include <cstdlib>
 
 #include "memory/garbage_collector.h"
+#include "memory/memory_manager.h"
+#include "memory/object_arena.h"
 #include "vm/virtual_machine.h"
 #include "core/common.h"
 
@@ -33,23 +37,10 @@ public:
         std::cout << "Destroyed TestGCObject " << value_ << std::endl;
     }
     
-    void Mark(GarbageCollector* gc) override {
-        if (GetColor() != GCColor::White) {
-            return;
-        }
-        
-        SetColor(GCColor::Gray);
-        gc->AddToGrayList(this);
-    }
-    
-    std::vector<GCObject*> GetReferences() const override {
-        std::vector<GCObject*> refs;
+    void Traverse(GCMarker& marker) const override {
         for (auto* ref : references_) {
-            if (ref) {
-                refs.push_back(ref);
-            }
+            marker.Mark(ref);
         }
-        return refs;
     }
     
     void AddReference(TestGCObject* ref) {
@@ -73,16 +64,18 @@ private:
 void TestStringObjects() {
     std::cout << "\n=== Testing String Objects ===" << std::endl;
     
+    // 字符串只能经内存管理器创建，由管理器的收集器登记和释放
     VirtualMachine vm;
-    GarbageCollector gc(&vm);
+    MemoryManager manager;
+    manager.SetGarbageCollector(std::make_unique<GarbageCollector>(&vm));
+    GarbageCollector& gc = *manager.GetGarbageCollector();
     
     std::vector<StringObject*> strings;
     
     // 创建一些字符串对象
     for (int i = 0; i < 10; i++) {
         std::string str = "String_" + std::to_string(i);
-        StringObject* obj = new StringObject(str);
-        gc.RegisterObject(obj);
+        StringObject* obj = manager.NewString(str);
         strings.push_back(obj);
     }
     
@@ -97,11 +90,7 @@ void TestStringObjects() {
     std::cout << "Total memory: " << gc.GetTotalBytes() << " bytes" << std::endl;
     std::cout << "Object count: " << gc.GetObjectCount() << std::endl;
     
-    // 清理
-    for (auto* str : strings) {
-        gc.UnregisterObject(str);
-        delete str;
-    }
+    // 没有根引用的字符串已在收集中释放，其余随管理器析构
 }
 
 /**
@@ -111,14 +100,21 @@ void TestTableObjects() {
     std::cout << "\n=== Testing Table Objects ===" << std::endl;
     
     VirtualMachine vm;
-    GarbageCollector gc(&vm);
+    MemoryManager manager;
+    manager.SetGarbageCollector(std::make_unique<GarbageCollector>(&vm));
+    GarbageCollector& gc = *manager.GetGarbageCollector();
+    MemoryManagerScope scope(manager);
+    
+    // 表在填充期间没有根引用，只在显式收集时回收
+    GCConfig config;
+    config.enable_auto_gc = false;
+    gc.SetConfig(config);
     
     std::vector<TableObject*> tables;
     
     // 创建一些表对象
     for (int i = 0; i < 5; i++) {
-        TableObject* table = new TableObject(10, 10);
-        gc.RegisterObject(table);
+        TableObject* table = manager.AllocateGCObject<TableObject>(10, 10);
         tables.push_back(table);
         
         // 向表中添加一些值
@@ -140,11 +136,7 @@ void TestTableObjects() {
     std::cout << "Total memory: " << gc.GetTotalBytes() << " bytes" << std::endl;
     std::cout << "Object count: " << gc.GetObjectCount() << std::endl;
     
-    // 清理
-    for (auto* table : tables) {
-        gc.UnregisterObject(table);
-        delete table;
-    }
+    // 没有根引用的表和字符串已在收集中释放
 }
 
 /**
@@ -215,7 +207,9 @@ void TestIncrementalGC() {
     config.enable_incremental = true;
     config.initial_threshold = 1024;
     
-    GarbageCollector gc(&vm);
+    MemoryManager manager;
+    manager.SetGarbageCollector(std::make_unique<GarbageCollector>(&vm));
+    GarbageCollector& gc = *manager.GetGarbageCollector();
     gc.SetConfig(config);
     
     std::vector<StringObject*> objects;
@@ -223,8 +217,7 @@ void TestIncrementalGC() {
     // 创建足够多的对象来触发增量GC
     for (int i = 0; i < 100; i++) {
         std::string str = "IncrementalTest_" + std::to_string(i);
-        StringObject* obj = new StringObject(str);
-        gc.RegisterObject(obj);
+        StringObject* obj = manager.NewString(str);
         objects.push_back(obj);
         
         // 每隔几个对象执行一次增量步骤
@@ -244,11 +237,7 @@ void TestIncrementalGC() {
     std::cout << "Memory usage: " << gc.GetTotalBytes() << " bytes" << std::endl;
     std::cout << "Object count: " << gc.GetObjectCount() << std::endl;
     
-    // 清理
-    for (auto* obj : objects) {
-        gc.UnregisterObject(obj);
-        delete obj;
-    }
+    // 没有根引用的字符串已在收集中释放，其余随管理器析构
 }
 
 /**
@@ -257,14 +246,16 @@ void TestIncrementalGC() {
 void TestGCStatistics() {
     std::cout << "\n=== Testing GC Statistics ===" << std::endl;
     
+    // 字符串只能经内存管理器创建，由管理器的收集器登记和释放
     VirtualMachine vm;
-    GarbageCollector gc(&vm);
+    MemoryManager manager;
+    manager.SetGarbageCollector(std::make_unique<GarbageCollector>(&vm));
+    GarbageCollector& gc = *manager.GetGarbageCollector();
     
     // 创建一些对象
     std::vector<StringObject*> objects;
     for (int i = 0; i < 50; i++) {
-        StringObject* obj = new StringObject("StatTest_" + std::to_string(i));
-        gc.RegisterObject(obj);
+        StringObject* obj = manager.NewString("StatTest_" + std::to_string(i));
         objects.push_back(obj);
     }
     
@@ -278,11 +269,7 @@ void TestGCStatistics() {
         gc.DumpStats();
     }
     
-    // 清理
-    for (auto* obj : objects) {
-        gc.UnregisterObject(obj);
-        delete obj;
-    }
+    // 没有根引用的字符串已在收集中释放，其余随管理器析构
     
     std::cout << "\nAfter cleanup:" << std::endl;
     gc.DumpStats();
@@ -297,8 +284,11 @@ void TestGCPerformance() {
     const int num_objects = 10000;
     const int num_collections = 10;
     
+    // 字符串只能经内存管理器创建，由管理器的收集器登记和释放
     VirtualMachine vm;
-    GarbageCollector gc(&vm);
+    MemoryManager manager;
+    manager.SetGarbageCollector(std::make_unique<GarbageCollector>(&vm));
+    GarbageCollector& gc = *manager.GetGarbageCollector();
     
     std::vector<StringObject*> objects;
     objects.reserve(num_objects);
@@ -307,8 +297,7 @@ void TestGCPerformance() {
     auto start_time = std::chrono::high_resolution_clock::now();
     
     for (int i = 0; i < num_objects; i++) {
-        StringObject* obj = new StringObject("PerfTest_" + std::to_string(i));
-        gc.RegisterObject(obj);
+        StringObject* obj = manager.NewString("PerfTest_" + std::to_string(i));
         objects.push_back(obj);
     }
     
@@ -335,11 +324,7 @@ void TestGCPerformance() {
     std::cout << "Collections performed: " << stats.collections_performed << std::endl;
     std::cout << "Average pause time: " << stats.average_pause_time << " seconds" << std::endl;
     
-    // 清理
-    for (auto* obj : objects) {
-        gc.UnregisterObject(obj);
-        delete obj;
-    }
+    // 没有根引用的字符串已在收集中释放，其余随管理器析构
 }
 
 /**
@@ -348,15 +333,18 @@ void TestGCPerformance() {
 void TestGCConsistency() {
     std::cout << "\n=== Testing GC Consistency ===" << std::endl;
     
+    // 字符串只能经内存管理器创建，由管理器的收集器登记和释放
     VirtualMachine vm;
-    GarbageCollector gc(&vm);
+    MemoryManager manager;
+    manager.SetGarbageCollector(std::make_unique<GarbageCollector>(&vm));
+    GarbageCollector& gc = *manager.GetGarbageCollector();
     
-    // 创建一些对象
+    // 创建一些对象，压入VM栈作为根
     std::vector<StringObject*> objects;
     for (int i = 0; i < 20; i++) {
-        StringObject* obj = new StringObject("ConsistencyTest_" + std::to_string(i));
-        gc.RegisterObject(obj);
+        StringObject* obj = manager.NewString("ConsistencyTest_" + std::to_string(i));
         objects.push_back(obj);
+        vm.Push(LuaValue(obj));
     }
     
     std::cout << "Created objects, checking consistency..." << std::endl;
@@ -367,30 +355,376 @@ void TestGCConsistency() {
     gc.Collect();
     
     std::cout << "After GC, checking consistency..." << std::endl;
-    consistent = gc.CheckConsistency();
+    consistent = gc.CheckConsistency() && gc.GetObjectCount() == objects.size();
     std::cout << "Consistency check: " << (consistent ? "PASSED" : "FAILED") << std::endl;
     
-    // 清理一半对象
-    for (size_t i = 0; i < objects.size() / 2; i++) {
-        gc.UnregisterObject(objects[i]);
-        delete objects[i];
-    }
+    // 去掉一半根后收集
+    vm.SetStackTop(objects.size() / 2);
+    gc.Collect();
     
     std::cout << "After partial cleanup, checking consistency..." << std::endl;
-    consistent = gc.CheckConsistency();
+    consistent = gc.CheckConsistency() && gc.GetObjectCount() == objects.size() / 2;
     std::cout << "Consistency check: " << (consistent ? "PASSED" : "FAILED") << std::endl;
     
-    // 清理剩余对象
-    for (size_t i = objects.size() / 2; i < objects.size(); i++) {
-        gc.UnregisterObject(objects[i]);
-        delete objects[i];
-    }
+    // 去掉剩余的根后收集
+    vm.SetStackTop(0);
+    gc.Collect();
     
     std::cout << "After full cleanup, checking consistency..." << std::endl;
-    consistent = gc.CheckConsistency();
+    consistent = gc.CheckConsistency() && gc.GetObjectCount() == 0;
     std::cout << "Consistency check: " << (consistent ? "PASSED" : "FAILED") << std::endl;
 }
 
+/**
+ * @brief 测试分代收集：晋升、写屏障和记忆集
+ */
+void TestGenerationalGC() {
+    std::cout << "\n=== Testing Generational GC ===" << std::endl;
+    
+    VirtualMachine vm;
+    GarbageCollector gc(&vm);
+    
+    GCConfig config;
+    config.enable_generational = true;
+    config.enable_auto_gc = false;
+    config.promotion_age = 2;
+    config.initial_threshold = 1024 * 1024;   // 只做次要收集
+    gc.SetConfig(config);
+    
+    // 根表：放在VM栈上，两次次要收集后晋升老年代
+    TableObject* root = new TableObject(0, 4);
+    gc.RegisterObject(root);
+    vm.Push(LuaValue(root));
+    
+    gc.Collect();
+    gc.Collect();
+    std::cout << "Root promoted: " << (root->IsOld() ? "PASSED" : "FAILED") << std::endl;
+    
+    // 老表存入新对象的引用：写屏障把根表加入记忆集
+    TableObject* child = new TableObject();
+    gc.RegisterObject(child);
+    root->Set(LuaValue(1), LuaValue(child));
+    std::cout << "Root remembered: " << (root->IsRemembered() ? "PASSED" : "FAILED") << std::endl;
+    
+    // 短命对象：没有任何引用，在下一次次要收集中释放
+    for (int i = 0; i < 100; i++) {
+        gc.RegisterObject(new TableObject(4, 4));
+    }
+    Size before = gc.GetObjectCount();
+    gc.Collect();
+    
+    std::cout << "Minor freed garbage: " << (gc.GetObjectCount() == before - 100 ? "PASSED" : "FAILED") << std::endl;
+    std::cout << "Child kept via remembered set: " << (child->GetAge() == 1 ? "PASSED" : "FAILED") << std::endl;
+    
+    // 子对象晋升后根表不再需要留在记忆集
+    gc.Collect();
+    std::cout << "Child promoted: " << (child->IsOld() ? "PASSED" : "FAILED") << std::endl;
+    std::cout << "Root forgotten: " << (!root->IsRemembered() ? "PASSED" : "FAILED") << std::endl;
+    std::cout << "Consistency check: " << (gc.CheckConsistency() ? "PASSED" : "FAILED") << std::endl;
+    
+    auto stats = gc.GetStatistics();
+    std::cout << "Minor collections: " << stats.minor_collections << std::endl;
+    std::cout << "Major collections: " << stats.major_collections << std::endl;
+    std::cout << "Objects promoted: " << stats.objects_promoted << std::endl;
+    std::cout << "Minor pause p50/p99: " << stats.minor_pauses.Percentile(0.5) << " / "
+              << stats.minor_pauses.Percentile(0.99) << " seconds" << std::endl;
+    
+    vm.Pop();
+}
+
+/**
+ * @brief 测试并发模式：多线程注册到线程本地链表，安全点拼接
+ */
+void TestConcurrentRegistration() {
+    std::cout << "\n=== Testing Concurrent Registration ===" << std::endl;
+    
+    const int num_threads = 4;
+    const int objects_per_thread = 1000;
+    
+    GarbageCollector gc;
+    GCConfig config;
+    config.enable_auto_gc = false;
+    config.threading_mode = GCThreadingMode::Concurrent;
+    gc.SetConfig(config);
+    
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; t++) {
+        threads.emplace_back([&gc]() {
+            for (int i = 0; i < objects_per_thread; i++) {
+                gc.RegisterObject(new UserDataObject(16));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    
+    std::cout << "Pending before safepoint: " << (gc.GetObjectCount() == 0 ? "PASSED" : "FAILED") << std::endl;
+    
+    gc.Safepoint();
+    
+    std::cout << "Object count after safepoint: " << gc.GetObjectCount() << std::endl;
+    std::cout << "All objects spliced: "
+              << (gc.GetObjectCount() == static_cast<Size>(num_threads * objects_per_thread) ? "PASSED" : "FAILED")
+              << std::endl;
+    std::cout << "Consistency check: " << (gc.CheckConsistency() ? "PASSED" : "FAILED") << std::endl;
+}
+
+/**
+ * @brief 测试slab分配：GC对象按大小级别分配，清扫后内存回到slab复用
+ */
+void TestSlabAllocation() {
+    std::cout << "\n=== Testing Slab Allocation ===" << std::endl;
+    
+    const int num_objects = 1000;
+    
+    MemoryManager manager;
+    auto gc = std::make_unique<GarbageCollector>();
+    GCConfig config;
+    config.enable_auto_gc = false;
+    gc->SetConfig(config);
+    manager.SetGarbageCollector(std::move(gc));
+    
+    SlabAllocator& slab = manager.GetObjectAllocator();
+    std::cout << "Lock-free in single-owner mode: " << (!slab.IsThreadSafe() ? "PASSED" : "FAILED") << std::endl;
+    
+    for (int i = 0; i < num_objects; i++) {
+        manager.AllocateGCObject<TableObject>();
+        manager.AllocateGCObject<FunctionObject>(nullptr);
+    }
+    
+    auto before = slab.GetStats();
+    std::cout << "Bytes in use before collection: " << before.current_usage << std::endl;
+    for (const auto& size_class : before.size_classes) {
+        if (size_class.blocks_in_use > 0) {
+            std::cout << "  [" << size_class.block_size << "B] " << size_class.blocks_in_use
+                      << " blocks in " << size_class.slab_count << " slabs" << std::endl;
+        }
+    }
+    
+    // 没有根，全部对象被清扫并归还slab
+    manager.CollectGarbage();
+    auto after = slab.GetStats();
+    std::cout << "Sweep returned memory to slabs: " << (after.current_usage == 0 ? "PASSED" : "FAILED") << std::endl;
+    
+    // 再次分配同样多的对象复用空闲块，不申请新slab
+    for (int i = 0; i < num_objects; i++) {
+        manager.AllocateGCObject<TableObject>();
+        manager.AllocateGCObject<FunctionObject>(nullptr);
+    }
+    auto reused = slab.GetStats();
+    Size slabs_before = 0;
+    Size slabs_after = 0;
+    for (Size i = 0; i < before.size_classes.size(); i++) {
+        slabs_before += before.size_classes[i].slab_count;
+        slabs_after += reused.size_classes[i].slab_count;
+    }
+    std::cout << "Freed blocks reused: " << (slabs_after == slabs_before ? "PASSED" : "FAILED") << std::endl;
+}
+
+void TestArenaScope() {
+    std::cout << "\n=== Testing Arena Scope ===" << std::endl;
+    
+    const int num_temporaries = 1000;
+    
+    // 作用域外创建的堆对象
+    TableObject* holder = AllocateGCObject<TableObject>();
+    
+    ObjectArena arena;
+    arena.Enter();
+    
+    for (int i = 0; i < num_temporaries; i++) {
+        auto* temp = arena.Allocate<TableObject>();
+        temp->Set(LuaValue(1.0), LuaValue(arena.Allocate<StringObject>(std::string("temporary"))));
+    }
+    
+    // 存入堆对象的表（带自引用）和登记过的值槽逃逸出作用域
+    auto* kept = arena.Allocate<TableObject>();
+    kept->Set(LuaValue(1.0), LuaValue(arena.Allocate<StringObject>(std::string("kept value"))));
+    kept->Set(LuaValue(2.0), LuaValue(kept));
+    holder->Set(LuaValue(1.0), LuaValue(kept));
+    
+    LuaValue slot(arena.Allocate<StringObject>(std::string("slot value")));
+    arena.RecordEscapedSlot(&slot);
+    
+    std::cout << "Arena usage before exit: " << arena.GetUsage() << " bytes" << std::endl;
+    Size evacuated = arena.Exit();
+    const ArenaStats& stats = arena.GetStats();
+    
+    std::cout << "Escaped objects evacuated: " << (evacuated == 3 ? "PASSED" : "FAILED") << std::endl;
+    std::cout << "Temporaries released: "
+              << (stats.objects_released == static_cast<Size>(num_temporaries * 2 + 3) ? "PASSED" : "FAILED") << std::endl;
+    std::cout << "Arena rolled back: " << (arena.GetUsage() == 0 ? "PASSED" : "FAILED") << std::endl;
+    
+    TableObject* copy = holder->Get(LuaValue(1.0)).GetTable();
+    bool forwarded = copy && !copy->IsArenaAllocated() &&
+                     copy->Get(LuaValue(1.0)).GetStringObject()->GetString() == "kept value" &&
+                     copy->Get(LuaValue(2.0)).GetTable() == copy;
+    std::cout << "Heap references forwarded: " << (forwarded ? "PASSED" : "FAILED") << std::endl;
+    
+    StringObject* slot_copy = slot.GetStringObject();
+    bool slot_forwarded = slot_copy && !slot_copy->IsArenaAllocated() &&
+                          slot_copy->GetString() == "slot value";
+    std::cout << "Escaped slot forwarded: " << (slot_forwarded ? "PASSED" : "FAILED") << std::endl;
+}
+
+void TestIncrementalPacing() {
+    std::cout << "\n=== Testing Incremental Pacing ===" << std::endl;
+    
+    const int num_objects = 200000;
+    
+    GarbageCollector gc;
+    GCConfig config;
+    config.enable_incremental = true;
+    config.initial_threshold = 64 * 1024;
+    config.target_pause_time = 0.00002;  // 20us
+    gc.SetConfig(config);
+    
+    // 没有根，所有对象都是垃圾；收集速度由分配债务驱动
+    Size total_allocated = 0;
+    for (int i = 0; i < num_objects; i++) {
+        GCObject* obj = new TableObject();
+        total_allocated += obj->GetSize();
+        gc.RegisterObject(obj);
+    }
+    
+    GCStatistics stats = gc.GetStatistics();
+    std::cout << "Incremental steps: " << stats.incremental_steps << std::endl;
+    std::cout << "Completed cycles: " << stats.total_collections << std::endl;
+    std::cout << "Step size: " << stats.step_size << " bytes" << std::endl;
+    std::cout << "Step pause p50: " << stats.step_pause_p50 * 1e6 << " us, p99: "
+              << stats.step_pause_p99 * 1e6 << " us" << std::endl;
+    
+    bool paced = stats.incremental_steps > 0 && stats.total_collections > 0 &&
+                 stats.step_pauses.count == stats.incremental_steps;
+    std::cout << "Steps driven by allocation debt: " << (paced ? "PASSED" : "FAILED") << std::endl;
+    std::cout << "Percentiles ordered: "
+              << (stats.step_pause_p50 <= stats.step_pause_p99 ? "PASSED" : "FAILED") << std::endl;
+    std::cout << "Heap bounded by pacing: "
+              << (stats.peak_memory_usage < total_allocated / 4 ? "PASSED" : "FAILED") << std::endl;
+}
+
+void TestMarkStackOverflow() {
+    std::cout << "\n=== Testing Mark Stack Overflow ===" << std::endl;
+    
+    // 超过标记栈块数上限的宽表，多出的灰色对象挂到溢出链上
+    const Size num_children = GCMarker::kChunkCapacity * GCMarker::kMaxChunks + 1000;
+    const int num_garbage = 1000;
+    
+    VirtualMachine vm;
+    GarbageCollector gc(&vm);
+    
+    GCConfig config;
+    config.enable_auto_gc = false;
+    config.enable_incremental = false;
+    gc.SetConfig(config);
+    
+    TableObject* root = new TableObject(num_children, 0);
+    gc.RegisterObject(root);
+    vm.Push(LuaValue(root));
+    for (Size i = 1; i <= num_children; i++) {
+        TableObject* child = new TableObject();
+        gc.RegisterObject(child);
+        root->Set(LuaValue(static_cast<double>(i)), LuaValue(child));
+    }
+    for (int i = 0; i < num_garbage; i++) {
+        gc.RegisterObject(new TableObject());
+    }
+    
+    Size before = gc.GetObjectCount();
+    gc.Collect();
+    
+    GCStatistics stats = gc.GetStatistics();
+    std::cout << "Mark stack peak: " << stats.mark_stack_peak
+              << ", overflows: " << stats.mark_stack_overflows << std::endl;
+    std::cout << "Overflow path used: " << (stats.mark_stack_overflows > 0 ? "PASSED" : "FAILED") << std::endl;
+    std::cout << "Reachable objects kept, garbage freed: "
+              << (gc.GetObjectCount() == before - num_garbage ? "PASSED" : "FAILED") << std::endl;
+    
+    // 溢出链上的对象同样被遍历：子表里新放的对象在下一次收集中存活
+    TableObject* last = root->Get(LuaValue(static_cast<double>(num_children))).GetTable();
+    TableObject* grandchild = new TableObject();
+    gc.RegisterObject(grandchild);
+    last->Set(LuaValue(1.0), LuaValue(grandchild));
+    gc.Collect();
+    std::cout << "Overflowed object traversed: "
+              << (gc.GetObjectCount() == before - num_garbage + 1 ? "PASSED" : "FAILED") << std::endl;
+    
+    vm.Pop();
+    gc.Collect();
+}
+
+// 统计经过的字节数的分配函数（lua_Alloc约定）
+struct CountingAllocState {
+    long long bytes = 0;
+    Size calls = 0;
+};
+
+void* CountingAllocFunction(void* ud, void* ptr, Size osize, Size nsize) {
+    auto* state = static_cast<CountingAllocState*>(ud);
+    state->calls++;
+    if (nsize == 0) {
+        std::free(ptr);
+        state->bytes -= static_cast<long long>(osize);
+        return nullptr;
+    }
+    void* result = std::realloc(ptr, nsize);
+    if (result) {
+        state->bytes += static_cast<long long>(nsize) - (ptr ? static_cast<long long>(osize) : 0);
+    }
+    return result;
+}
+
+void TestAllocFunction() {
+    std::cout << "\n=== Testing Allocation Function ===" << std::endl;
+    
+    const int num_tables = 1000;
+    
+    // 分配函数只作用于所属VM的内存管理器，表的存储经作用域绑定到它
+    CountingAllocState state;
+    VirtualMachine vm;
+    MemoryManager& manager = vm.GetMemoryManager();
+    MemoryManagerScope scope(manager);
+    manager.SetAllocFunction(CountingAllocFunction, &state);
+    
+    void* default_userdata = nullptr;
+    bool isolated = GetGlobalMemoryManager().GetAllocFunction(&default_userdata) == DefaultAllocFunction;
+    std::cout << "Allocation function is per state: " << (isolated ? "PASSED" : "FAILED") << std::endl;
+    
+    Size usage_before = manager.GetCurrentUsage();
+    for (int i = 0; i < num_tables; i++) {
+        TableObject* table = AllocateGCObject<TableObject>();
+        for (int j = 1; j <= 16; j++) {
+            table->Set(LuaValue(static_cast<double>(j)), LuaValue(static_cast<double>(j)));
+        }
+    }
+    Size usage_after = manager.GetCurrentUsage();
+    
+    std::cout << "Allocation function calls: " << state.calls << std::endl;
+    bool accounted = state.calls > 0 &&
+                     static_cast<long long>(usage_after - usage_before) == state.bytes;
+    std::cout << "Usage matches allocation function: " << (accounted ? "PASSED" : "FAILED") << std::endl;
+    
+    // 内存限制按实际用量检查，表的存储也受限
+    manager.SetMemoryLimit(manager.GetCurrentUsage() + 4096);
+    bool limited = false;
+    try {
+        for (int i = 0; i < 100; i++) {
+            TableObject* table = AllocateGCObject<TableObject>();
+            table->ResizeArray(1024);
+        }
+    } catch (const OutOfMemoryError&) {
+        limited = true;
+    }
+    manager.SetMemoryLimit(0);
+    std::cout << "Memory limit covers table storage: " << (limited ? "PASSED" : "FAILED") << std::endl;
+    
+    manager.SetAllocFunction(nullptr, nullptr);
+    void* userdata = &state;
+    bool restored = manager.GetAllocFunction(&userdata) == DefaultAllocFunction && userdata == nullptr;
+    std::cout << "Default allocation function restored: " << (restored ? "PASSED" : "FAILED") << std::endl;
+}
+
 int main() {
     std::cout << "Lua C++ Garbage Collector Test Suite" << std::endl;
     std::cout << "=====================================" << std::endl;
@@ -403,6 +737,13 @@ int main() {
         TestGCStatistics();
         TestGCPerformance();
         TestGCConsistency();
+        TestGenerationalGC();
+        TestConcurrentRegistration();
+        TestSlabAllocation();
+        TestArenaScope();
+        TestAllocFunction();
+        TestIncrementalPacing();
+        TestMarkStackOverflow();
         
         std::cout << "\n=== All Tests Completed ===" << std::endl;
         
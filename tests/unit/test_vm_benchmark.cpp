@@ -8,14 +8,23 @@
 
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_approx.hpp>
 #include <chrono>
+#include <iostream>
 #include <random>
+#include <sstream>
+#include <limits>
+#include <string>
+#include <vector>
 
 #include "vm/virtual_machine.h"
 #include "compiler/bytecode.h"
+#include "types/lua_table.h"
 #include "core/lua_common.h"
+#include "memory/garbage_collector.h"
 
 using namespace lua_cpp;
+using Catch::Approx;
 
 /* ========================================================================== */
 /* 性能基准测试辅助函数 */
@@ -128,6 +137,67 @@ std::unique_ptr<Proto> CreateCallTestProgram() {
     return proto;
 }
 
+/**
+ * @brief 创建数值for循环测试程序（热循环，用于测量分派开销）
+ * @param iterations 循环次数
+ */
+std::unique_ptr<Proto> CreateForLoopTestProgram(int iterations) {
+    auto proto = std::make_unique<Proto>("forloop_test");
+    
+    proto->AddConstant(LuaValue(0.0));
+    proto->AddConstant(LuaValue(1.0));
+    proto->AddConstant(LuaValue(static_cast<double>(iterations)));
+    
+    // local sum = 0; for i = 1, iterations do sum = sum + i * 1 end; return sum
+    proto->AddInstruction(CreateABx(OpCode::LOADK, 0, 0), 1);     // R0 = 0 (sum)
+    proto->AddInstruction(CreateABx(OpCode::LOADK, 1, 1), 1);     // R1 = 1 (init)
+    proto->AddInstruction(CreateABx(OpCode::LOADK, 2, 2), 1);     // R2 = limit
+    proto->AddInstruction(CreateABx(OpCode::LOADK, 3, 1), 1);     // R3 = 1 (step)
+    proto->AddInstruction(CreateAsBx(OpCode::FORPREP, 1, 2), 1);
+    proto->AddInstruction(CreateABC(OpCode::MUL, 5, 4, ConstantIndexToRK(1)), 2);
+    proto->AddInstruction(CreateABC(OpCode::ADD, 0, 0, 5), 2);
+    proto->AddInstruction(CreateAsBx(OpCode::FORLOOP, 1, -3), 1);
+    proto->AddInstruction(CreateABC(OpCode::RETURN, 0, 2, 0), 3);
+    
+    proto->SetParameterCount(0);
+    proto->SetMaxStackSize(8);
+    
+    return proto;
+}
+
+/**
+ * @brief 创建递归fib测试程序（Lua到Lua调用开销）
+ * 
+ * 没有全局表和闭包，函数自身作为第一个参数传递：
+ * local function fib(f, n) if n < 2 then return n end return f(f, n-1) + f(f, n-2) end
+ */
+std::unique_ptr<Proto> CreateFibTestProgram() {
+    auto proto = std::make_unique<Proto>("fib_test");
+    
+    proto->AddConstant(LuaValue(2.0));
+    proto->AddConstant(LuaValue(1.0));
+    
+    proto->AddInstruction(CreateABC(OpCode::LT, 0, 1, ConstantIndexToRK(0)), 1);  // n < 2 时跳过JMP
+    proto->AddInstruction(CreateAsBx(OpCode::JMP, 0, 1), 1);
+    proto->AddInstruction(CreateABC(OpCode::RETURN, 1, 2, 0), 1);                 // return n
+    proto->AddInstruction(CreateABC(OpCode::MOVE, 2, 0, 0), 2);                   // R2 = f
+    proto->AddInstruction(CreateABC(OpCode::MOVE, 3, 0, 0), 2);                   // R3 = f
+    proto->AddInstruction(CreateABC(OpCode::SUB, 4, 1, ConstantIndexToRK(1)), 2); // R4 = n - 1
+    proto->AddInstruction(CreateABC(OpCode::CALL, 2, 3, 2), 2);                   // R2 = f(f, n - 1)
+    proto->AddInstruction(CreateABC(OpCode::MOVE, 3, 0, 0), 2);                   // R3 = f
+    proto->AddInstruction(CreateABC(OpCode::MOVE, 4, 0, 0), 2);                   // R4 = f
+    proto->AddInstruction(CreateABC(OpCode::SUB, 5, 1, ConstantIndexToRK(0)), 2); // R5 = n - 2
+    proto->AddInstruction(CreateABC(OpCode::CALL, 3, 3, 2), 2);                   // R3 = f(f, n - 2)
+    proto->AddInstruction(CreateABC(OpCode::ADD, 2, 2, 3), 2);
+    proto->AddInstruction(CreateABC(OpCode::RETURN, 2, 2, 0), 2);
+    proto->AddInstruction(CreateABC(OpCode::RETURN, 0, 1, 0), 3);
+    
+    proto->SetParameterCount(2);
+    proto->SetMaxStackSize(6);
+    
+    return proto;
+}
+
 /* ========================================================================== */
 /* 基本性能基准测试 */
 /* ========================================================================== */
@@ -153,7 +223,7 @@ TEST_CASE("VM Benchmark - 虚拟机基础操作性能", "[vm][benchmark][basic]"
     BENCHMARK("寄存器操作 - 设置/获取 1000次") {
         auto vm = CreateStandardVM();
         auto proto = std::make_unique<Proto>("benchmark");
-        vm->PushCallFrame(proto.get(), 0, 0, 0);
+        vm->PushCallFrame(proto.get(), 0);
         
         return [&vm]() {
             for (int i = 0; i < 1000; ++i) {
@@ -175,7 +245,7 @@ TEST_CASE("VM Benchmark - 指令执行性能", "[vm][benchmark][instruction]") {
     BENCHMARK("单条MOVE指令") {
         auto vm = CreateStandardVM();
         auto proto = std::make_unique<Proto>("move_test");
-        vm->PushCallFrame(proto.get(), 0, 0, 0);
+        vm->PushCallFrame(proto.get(), 0);
         
         vm->SetRegister(1, LuaValue(42.0));
         Instruction move_inst = CreateABC(OpCode::MOVE, 0, 1, 0);
@@ -188,7 +258,7 @@ TEST_CASE("VM Benchmark - 指令执行性能", "[vm][benchmark][instruction]") {
     BENCHMARK("单条ADD指令") {
         auto vm = CreateStandardVM();
         auto proto = std::make_unique<Proto>("add_test");
-        vm->PushCallFrame(proto.get(), 0, 0, 0);
+        vm->PushCallFrame(proto.get(), 0);
         
         vm->SetRegister(1, LuaValue(10.0));
         vm->SetRegister(2, LuaValue(5.0));
@@ -198,6 +268,75 @@ TEST_CASE("VM Benchmark - 指令执行性能", "[vm][benchmark][instruction]") {
             vm->ExecuteInstruction(add_inst);
         }();
     };
+
+    BENCHMARK("ADD数值快速路径 vs 字符串转换慢路径 - 各1000次") {
+        auto vm = CreateStandardVM();
+        auto proto = std::make_unique<Proto>("add_paths");
+        vm->PushCallFrame(proto.get(), 0);
+
+        vm->SetRegister(1, LuaValue(10.0));
+        vm->SetRegister(2, LuaValue(5.0));
+        vm->SetRegister(3, LuaValue("5"));
+        Instruction fast_add = CreateABC(OpCode::ADD, 0, 1, 2);
+        Instruction slow_add = CreateABC(OpCode::ADD, 0, 1, 3);
+
+        for (int i = 0; i < 1000; ++i) {
+            vm->ExecuteInstruction(fast_add);
+            vm->ExecuteInstruction(slow_add);
+        }
+        return vm->GetRegister(0).GetNumber();
+    };
+}
+
+TEST_CASE("VM Benchmark - 字符串拼接性能", "[vm][benchmark][concat]") {
+    // s = s .. "x" 循环10000次
+    auto run_append_loop = [](bool enable_builder) {
+        VMConfig config;
+        config.enable_concat_builder = enable_builder;
+        VirtualMachine vm(config);
+        auto proto = std::make_unique<Proto>("concat_append");
+        vm.PushCallFrame(proto.get(), 0);
+
+        vm.SetRegister(0, LuaValue(""));
+        vm.SetRegister(1, LuaValue("x"));
+        Instruction concat_inst = CreateABC(OpCode::CONCAT, 0, 0, 1);
+        for (int i = 0; i < 10000; ++i) {
+            vm.ExecuteInstruction(concat_inst);
+        }
+        return vm.GetRegister(0).GetStringObject()->GetLength();
+    };
+
+    BENCHMARK("追加缓冲区 - 10000次追加") {
+        return run_append_loop(true);
+    };
+
+    BENCHMARK("预计算长度一次写入 - 10000次追加") {
+        return run_append_loop(false);
+    };
+
+    BENCHMARK("ostringstream基线 - 10000次追加") {
+        std::string s;
+        for (int i = 0; i < 10000; ++i) {
+            std::ostringstream oss;
+            oss << s << "x";
+            s = oss.str();
+        }
+        return s.size();
+    };
+
+    BENCHMARK("数值拼接 - 1000次") {
+        auto vm = CreateStandardVM();
+        auto proto = std::make_unique<Proto>("concat_number");
+        vm->PushCallFrame(proto.get(), 0);
+
+        vm->SetRegister(1, LuaValue("n = "));
+        vm->SetRegister(2, LuaValue(3.14159));
+        Instruction concat_inst = CreateABC(OpCode::CONCAT, 0, 1, 2);
+        for (int i = 0; i < 1000; ++i) {
+            vm->ExecuteInstruction(concat_inst);
+        }
+        return vm->GetRegister(0).GetStringObject()->GetLength();
+    };
 }
 
 TEST_CASE("VM Benchmark - 表操作性能", "[vm][benchmark][table]") {
@@ -211,7 +350,7 @@ TEST_CASE("VM Benchmark - 表操作性能", "[vm][benchmark][table]") {
     BENCHMARK("单次表创建") {
         auto vm = CreateStandardVM();
         auto proto = std::make_unique<Proto>("newtable_test");
-        vm->PushCallFrame(proto.get(), 0, 0, 0);
+        vm->PushCallFrame(proto.get(), 0);
         
         Instruction newtable_inst = CreateABC(OpCode::NEWTABLE, 0, 3, 3);
         
@@ -219,6 +358,138 @@ TEST_CASE("VM Benchmark - 表操作性能", "[vm][benchmark][table]") {
             vm->ExecuteInstruction(newtable_inst);
         }();
     };
+    
+    BENCHMARK("数组部分顺序写入读取") {
+        LuaTable table;
+        double sum = 0.0;
+        for (Size i = 1; i <= 10000; ++i) {
+            table.SetInt(i, LuaValue(static_cast<double>(i)));
+        }
+        for (Size i = 1; i <= 10000; ++i) {
+            sum += table.GetInt(i).GetNumber();
+        }
+        return sum;
+    };
+    
+    BENCHMARK("字符串键哈希查找") {
+        static std::vector<LuaValue> keys = [] {
+            std::vector<LuaValue> result;
+            for (int i = 0; i < 1000; ++i) {
+                result.emplace_back("field" + std::to_string(i));
+            }
+            return result;
+        }();
+        
+        LuaTable table;
+        for (Size i = 0; i < keys.size(); ++i) {
+            table.Set(keys[i], LuaValue(static_cast<double>(i)));
+        }
+        double sum = 0.0;
+        for (const LuaValue& key : keys) {
+            sum += table.Get(key).GetNumber();
+        }
+        return sum;
+    };
+    
+    BENCHMARK("常量字符串键GETGLOBAL式查找") {
+        static LuaTable globals = [] {
+            LuaTable result;
+            for (int i = 0; i < 256; ++i) {
+                result.Set(LuaValue("global" + std::to_string(i)), LuaValue(static_cast<double>(i)));
+            }
+            return result;
+        }();
+        static StringObject* key = LuaValue("global128").GetStringObject();
+        
+        double sum = 0.0;
+        for (int i = 0; i < 1000; ++i) {
+            sum += globals.GetStr(key).GetNumber();
+        }
+        return sum;
+    };
+    
+    BENCHMARK("长度运算符") {
+        static LuaTable table = [] {
+            LuaTable result;
+            for (Size i = 1; i <= 1000; ++i) {
+                result.SetInt(i, LuaValue(static_cast<double>(i)));
+            }
+            return result;
+        }();
+        return table.Length();
+    };
+}
+
+TEST_CASE("VM Benchmark - 分派循环吞吐量", "[vm][benchmark][dispatch]") {
+    constexpr int kIterations = 1000000;
+    auto proto = CreateForLoopTestProgram(kIterations);
+    
+    SECTION("高性能VM指令/秒") {
+        auto vm = CreateHighPerformanceVM();
+        auto results = vm->ExecuteProgram(proto.get());
+        auto stats = vm->GetExecutionStatistics();
+        
+        REQUIRE(!results.empty());
+        REQUIRE(results[0].GetNumber() == Approx(static_cast<double>(kIterations) * (kIterations + 1) / 2));
+        REQUIRE(stats.total_instructions > static_cast<Size>(kIterations) * 3);
+        
+        std::cout << "分派循环吞吐量 (CreateHighPerformanceVM):" << std::endl;
+        std::cout << "总指令数: " << stats.total_instructions << std::endl;
+        std::cout << "执行时间: " << stats.execution_time * 1000 << " ms" << std::endl;
+        std::cout << "指令/秒: "
+                  << static_cast<Size>(stats.total_instructions / stats.execution_time) << std::endl;
+    }
+    
+    SECTION("慢路径与快速循环执行结果一致") {
+        // 慢路径的计时只有在两条路径执行同样的控制流时才有意义
+        auto fast_vm = CreateHighPerformanceVM();
+        auto debug_vm = CreateDebugVM();
+        auto fast_results = fast_vm->ExecuteProgram(proto.get());
+        auto debug_results = debug_vm->ExecuteProgram(proto.get());
+        
+        REQUIRE(fast_results.size() == 1);
+        REQUIRE(debug_results.size() == 1);
+        REQUIRE(debug_results[0].GetNumber() == Approx(fast_results[0].GetNumber()));
+        REQUIRE(debug_vm->GetExecutionStatistics().total_instructions ==
+                fast_vm->GetExecutionStatistics().total_instructions);
+    }
+    
+    BENCHMARK("高性能VM - 快速分派循环") {
+        auto vm = CreateHighPerformanceVM();
+        return vm->ExecuteProgram(proto.get());
+    };
+    
+    BENCHMARK("调试VM - 慢路径逐条检查") {
+        auto vm = CreateDebugVM();
+        return vm->ExecuteProgram(proto.get());
+    };
+}
+
+TEST_CASE("VM Benchmark - 函数调用性能", "[vm][benchmark][call]") {
+    auto proto = CreateFibTestProgram();
+    LuaValue fib(AllocateGCObject<FunctionObject>(proto.get()));
+    
+    SECTION("fib(30)调用/秒") {
+        auto vm = CreateHighPerformanceVM();
+        auto results = vm->ExecuteProgram(proto.get(), {fib, LuaValue(30.0)});
+        auto stats = vm->GetExecutionStatistics();
+        
+        REQUIRE(results.size() == 1);
+        REQUIRE(results[0].GetNumber() == Approx(832040.0));
+        // fib(30)共2*fib(31)-1次调用，最外层由ExecuteProgram发起不计入
+        REQUIRE(stats.function_calls == 2692536);
+        
+        std::cout << "递归fib(30) (CreateHighPerformanceVM):" << std::endl;
+        std::cout << "调用次数: " << stats.function_calls << std::endl;
+        std::cout << "执行时间: " << stats.execution_time * 1000 << " ms" << std::endl;
+        std::cout << "调用/秒: "
+                  << static_cast<Size>(stats.function_calls / stats.execution_time) << std::endl;
+    }
+    
+    BENCHMARK("高性能VM - fib(25)") {
+        auto vm = CreateHighPerformanceVM();
+        return vm->ExecuteProgram(proto.get(), {fib, LuaValue(25.0)});
+    };
 }
 
 /* ========================================================================== */
@@ -238,12 +509,12 @@ TEST_CASE("VM Benchmark - 内存管理性能", "[vm][benchmark][memory]") {
     };
     
     BENCHMARK("表对象创建和销毁") {
-        std::vector<std::shared_ptr<LuaTable>> tables;
+        std::vector<std::unique_ptr<LuaTable>> tables;
         tables.reserve(1000);
         
         return [&tables]() {
             for (int i = 0; i < 1000; ++i) {
-                tables.push_back(std::make_shared<LuaTable>());
+                tables.push_back(std::make_unique<LuaTable>());
                 tables.back()->Set(LuaValue("key" + std::to_string(i)), 
                                   LuaValue(static_cast<double>(i)));
             }
@@ -251,6 +522,114 @@ TEST_CASE("VM Benchmark - 内存管理性能", "[vm][benchmark][memory]") {
     };
 }
 
+/* ========================================================================== */
+/* LuaValue布局对比 */
+/* ========================================================================== */
+
+namespace {
+
+/**
+ * @brief 旧的LuaValue布局（类型标签 + bool/double联合体 + 内联std::string）
+ *
+ * 仅用于与NaN-boxing表示做对比
+ */
+struct LegacyLuaValue {
+    LuaType type = LuaType::Nil;
+    union {
+        bool boolean;
+        double number;
+    };
+    std::string string;
+
+    LegacyLuaValue() : number(0.0) {}
+    explicit LegacyLuaValue(double value) : type(LuaType::Number), number(value) {}
+    explicit LegacyLuaValue(const std::string& value)
+        : type(LuaType::String), number(0.0), string(value) {}
+
+    bool IsNumber() const { return type == LuaType::Number; }
+    double AsNumber() const { return number; }
+};
+
+} // namespace
+
+TEST_CASE("VM Benchmark - LuaValue布局对比", "[vm][benchmark][value]") {
+    SECTION("NaN-boxing值为8字节") {
+        REQUIRE(sizeof(LuaValue) == 8);
+        REQUIRE(sizeof(LegacyLuaValue) >= 6 * sizeof(LuaValue));
+
+        std::cout << "LuaValue布局:" << std::endl;
+        std::cout << "NaN-boxing: " << sizeof(LuaValue) << " bytes" << std::endl;
+        std::cout << "旧布局: " << sizeof(LegacyLuaValue) << " bytes" << std::endl;
+    }
+
+    SECTION("NaN-boxing语义保持不变") {
+        LuaValue number(3.5);
+        LuaValue nan(std::numeric_limits<double>::quiet_NaN());
+        LuaValue negative_nan(-std::numeric_limits<double>::quiet_NaN());
+
+        REQUIRE(number.IsNumber());
+        REQUIRE(number.AsNumber() == 3.5);
+        REQUIRE(nan.IsNumber());
+        REQUIRE(negative_nan.IsNumber());
+        REQUIRE(nan != nan);
+        REQUIRE(LuaValue(0.0) == LuaValue(-0.0));
+
+        REQUIRE_FALSE(LuaValue().IsTruthy());
+        REQUIRE_FALSE(LuaValue(false).IsTruthy());
+        REQUIRE(LuaValue(true).IsTruthy());
+        REQUIRE(LuaValue(0.0).IsTruthy());
+    }
+
+    const int kCount = 10000;
+    std::vector<LuaValue> boxed_source;
+    std::vector<LegacyLuaValue> legacy_source;
+    boxed_source.reserve(kCount);
+    legacy_source.reserve(kCount);
+    for (int i = 0; i < kCount; ++i) {
+        boxed_source.emplace_back(static_cast<double>(i));
+        legacy_source.emplace_back(static_cast<double>(i));
+    }
+
+    BENCHMARK("NaN-boxing - 拷贝10000个数值") {
+        std::vector<LuaValue> copy = boxed_source;
+        return copy.size();
+    };
+
+    BENCHMARK("旧布局 - 拷贝10000个数值") {
+        std::vector<LegacyLuaValue> copy = legacy_source;
+        return copy.size();
+    };
+
+    BENCHMARK("NaN-boxing - 数值求和10000次") {
+        double sum = 0.0;
+        for (const auto& value : boxed_source) {
+            if (value.IsNumber()) sum += value.AsNumber();
+        }
+        return sum;
+    };
+
+    BENCHMARK("旧布局 - 数值求和10000次") {
+        double sum = 0.0;
+        for (const auto& value : legacy_source) {
+            if (value.IsNumber()) sum += value.AsNumber();
+        }
+        return sum;
+    };
+
+    LuaValue shared_string("benchmark_string_value");
+    LegacyLuaValue legacy_string(std::string("benchmark_string_value"));
+
+    BENCHMARK("NaN-boxing - 字符串值拷贝1000次") {
+        std::vector<LuaValue> copies(1000, shared_string);
+        return copies.size();
+    };
+
+    BENCHMARK("旧布局 - 字符串值拷贝1000次") {
+        std::vector<LegacyLuaValue> copies(1000, legacy_string);
+        return copies.size();
+    };
+}
+
 /* ========================================================================== */
 /* 综合性能测试 */
 /* ========================================================================== */
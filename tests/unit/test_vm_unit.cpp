@@ -10,12 +10,21 @@
 #include <catch2/catch_approx.hpp>
 #include <catch2/generators/catch_generators.hpp>
 
+#include <cstdio>
+#include <limits>
+#include <string>
 #include "vm/virtual_machine.h"
 #include "vm/call_frame.h"
+#include "vm/call_stack_advanced.h"
+#include "vm/bytecode_verifier.h"
+#include "vm/coroutine_support.h"
 #include "compiler/bytecode.h"
 #include "core/lua_common.h"
 #include "core/lua_errors.h"
 #include "types/lua_table.h"
+#include "memory/garbage_collector.h"
+#include "memory/memory_manager.h"
+#include "memory/string_table.h"
 
 using namespace lua_cpp;
 using Catch::Approx;
@@ -115,7 +124,7 @@ TEST_CASE("VM Unit - 寄存器操作", "[vm][unit][register]") {
     
     // 创建简单的函数原型和调用帧
     auto proto = std::make_unique<Proto>("test");
-    vm->PushCallFrame(proto.get(), 0, 0, 0);
+    vm->PushCallFrame(proto.get(), 0);
     
     SECTION("寄存器读写") {
         vm->SetRegister(0, LuaValue(123.0));
@@ -127,6 +136,22 @@ TEST_CASE("VM Unit - 寄存器操作", "[vm][unit][register]") {
         REQUIRE(vm->GetRegister(2).GetBoolean() == false);
     }
 
+    SECTION("寄存器引用") {
+        vm->SetRegister(3, LuaValue(1.0));
+
+        // 引用直接指向栈存储，写入立即可见
+        LuaValue& reg = vm->Register(3);
+        reg = LuaValue(2.0);
+        REQUIRE(&vm->GetRegister(3) == &reg);
+        REQUIRE(vm->GetRegister(3).GetNumber() == Approx(2.0));
+
+        // 栈重新分配后寄存器基址自动刷新
+        for (int i = 0; i < 1000; ++i) {
+            vm->Push(LuaValue(0.0));
+        }
+        REQUIRE(vm->GetRegister(3).GetNumber() == Approx(2.0));
+    }
+
     SECTION("寄存器边界检查") {
         // 测试非法寄存器索引
         REQUIRE_THROWS_AS(vm->SetRegister(256, LuaValue()), VMExecutionError);
@@ -160,7 +185,7 @@ TEST_CASE("VM Unit - 数据移动指令", "[vm][unit][instruction][move]") {
     proto->AddConstant(LuaValue("constant_string"));
     proto->AddConstant(LuaValue(3.14));
     
-    vm->PushCallFrame(proto.get(), 0, 0, 0);
+    vm->PushCallFrame(proto.get(), 0);
     
     SECTION("MOVE指令") {
         vm->SetRegister(1, LuaValue(42.0));
@@ -206,7 +231,7 @@ TEST_CASE("VM Unit - 数据移动指令", "[vm][unit][instruction][move]") {
 TEST_CASE("VM Unit - 算术指令", "[vm][unit][instruction][arithmetic]") {
     auto vm = CreateStandardVM();
     auto proto = std::make_unique<Proto>("test");
-    vm->PushCallFrame(proto.get(), 0, 0, 0);
+    vm->PushCallFrame(proto.get(), 0);
     
     SECTION("基本算术操作") {
         vm->SetRegister(1, LuaValue(10.0));
@@ -248,6 +273,42 @@ TEST_CASE("VM Unit - 算术指令", "[vm][unit][instruction][arithmetic]") {
         REQUIRE(vm->GetRegister(0).GetBoolean() == true);
     }
 
+    SECTION("字符串转换为数值") {
+        vm->SetRegister(1, LuaValue("10"));
+        vm->SetRegister(2, LuaValue(3.0));
+
+        Instruction add_inst = CreateABC(OpCode::ADD, 0, 1, 2);
+        vm->ExecuteInstruction(add_inst);
+        REQUIRE(vm->GetRegister(0).GetNumber() == Approx(13.0));
+
+        vm->SetRegister(1, LuaValue("abc"));
+        REQUIRE_THROWS_AS(vm->ExecuteInstruction(add_inst), TypeError);
+    }
+
+    SECTION("__add元方法") {
+        // 元方法: function(a, b) return 99 end
+        auto meta_proto = std::make_unique<Proto>("__add");
+        meta_proto->AddConstant(LuaValue(99.0));
+        meta_proto->AddInstruction(CreateABx(OpCode::LOADK, 2, 0), 1);
+        meta_proto->AddInstruction(CreateABC(OpCode::RETURN, 2, 2, 0), 1);
+        meta_proto->SetParameterCount(2);
+        meta_proto->SetMaxStackSize(3);
+
+        TableObject* metatable = AllocateGCObject<TableObject>();
+        metatable->Set(LuaValue("__add"), LuaValue(AllocateGCObject<FunctionObject>(meta_proto.get())));
+        TableObject* object = AllocateGCObject<TableObject>();
+        object->SetMetatable(metatable);
+
+        vm->SetExecutionState(ExecutionState::Running);
+        vm->SetRegister(1, LuaValue(object));
+        vm->SetRegister(2, LuaValue(1.0));
+
+        Instruction add_inst = CreateABC(OpCode::ADD, 0, 1, 2);
+        vm->ExecuteInstruction(add_inst);
+        REQUIRE(vm->GetRegister(0).GetNumber() == Approx(99.0));
+        REQUIRE(vm->GetCallDepth() == 2);
+    }
+
     SECTION("除零错误处理") {
         vm->SetRegister(1, LuaValue(10.0));
         vm->SetRegister(2, LuaValue(0.0));
@@ -272,7 +333,7 @@ TEST_CASE("VM Unit - 算术指令", "[vm][unit][instruction][arithmetic]") {
 TEST_CASE("VM Unit - 表操作指令", "[vm][unit][instruction][table]") {
     auto vm = CreateStandardVM();
     auto proto = std::make_unique<Proto>("test");
-    vm->PushCallFrame(proto.get(), 0, 0, 0);
+    vm->PushCallFrame(proto.get(), 0);
     
     SECTION("NEWTABLE指令") {
         Instruction newtable_inst = CreateABC(OpCode::NEWTABLE, 0, 2, 1);
@@ -283,11 +344,15 @@ TEST_CASE("VM Unit - 表操作指令", "[vm][unit][instruction][table]") {
         
         auto table = result.GetTable();
         REQUIRE(table != nullptr);
+        
+        // B=2, C=1 按浮点字节解码为数组2、哈希1
+        REQUIRE(table->GetArraySize() == 2);
+        REQUIRE(table->GetHashSize() > 0);
     }
 
     SECTION("表索引操作") {
         // 创建表并设置值
-        auto table = std::make_shared<LuaTable>();
+        TableObject* table = AllocateGCObject<TableObject>();
         table->Set(LuaValue("key"), LuaValue(123.0));
         
         vm->SetRegister(1, LuaValue(table));
@@ -309,7 +374,7 @@ TEST_CASE("VM Unit - 表操作指令", "[vm][unit][instruction][table]") {
     }
 
     SECTION("SELF指令") {
-        auto table = std::make_shared<LuaTable>();
+        TableObject* table = AllocateGCObject<TableObject>();
         table->Set(LuaValue("method"), LuaValue("method_func"));
         
         vm->SetRegister(1, LuaValue(table));
@@ -326,14 +391,253 @@ TEST_CASE("VM Unit - 表操作指令", "[vm][unit][instruction][table]") {
     }
 }
 
+TEST_CASE("VM Unit - LuaTable混合结构", "[vm][unit][table]") {
+    SECTION("数组部分与哈希部分") {
+        LuaTable table;
+        for (int i = 1; i <= 100; ++i) {
+            table.Set(LuaValue(static_cast<double>(i)), LuaValue(static_cast<double>(i * 2)));
+        }
+        table.Set(LuaValue("name"), LuaValue("lua"));
+        table.Set(LuaValue(true), LuaValue(1.0));
+        table.Set(LuaValue(2.5), LuaValue(3.0));
+        
+        // 连续整数键经rehash后进入数组部分
+        REQUIRE(table.GetArraySize() >= 100);
+        REQUIRE(table.GetInt(50).GetNumber() == Approx(100.0));
+        REQUIRE(table.Get(LuaValue("name")).GetString() == "lua");
+        REQUIRE(table.Get(LuaValue(true)).GetNumber() == Approx(1.0));
+        REQUIRE(table.Get(LuaValue(2.5)).GetNumber() == Approx(3.0));
+        REQUIRE(table.Get(LuaValue("missing")).IsNil());
+        REQUIRE(table.GetSize() == 103);
+    }
+    
+    SECTION("删除与墓碑复用") {
+        LuaTable table;
+        for (int i = 0; i < 64; ++i) {
+            table.Set(LuaValue("k" + std::to_string(i)), LuaValue(static_cast<double>(i)));
+        }
+        for (int i = 0; i < 64; i += 2) {
+            table.Set(LuaValue("k" + std::to_string(i)), LuaValue());
+        }
+        
+        REQUIRE(table.GetSize() == 32);
+        REQUIRE(table.Get(LuaValue("k0")).IsNil());
+        REQUIRE(table.Get(LuaValue("k1")).GetNumber() == Approx(1.0));
+        
+        table.Set(LuaValue("k0"), LuaValue(42.0));
+        REQUIRE(table.Get(LuaValue("k0")).GetNumber() == Approx(42.0));
+    }
+    
+    SECTION("长度边界搜索") {
+        LuaTable table(4, 0);
+        REQUIRE(table.Length() == 0);
+        
+        for (int i = 1; i <= 10; ++i) {
+            table.SetInt(static_cast<Size>(i), LuaValue(static_cast<double>(i)));
+        }
+        REQUIRE(table.Length() == 10);
+        
+        table.SetInt(10, LuaValue());
+        REQUIRE(table.Length() == 9);
+    }
+    
+    SECTION("Next遍历") {
+        LuaTable table;
+        table.Set(LuaValue(1.0), LuaValue("a"));
+        table.Set(LuaValue(2.0), LuaValue("b"));
+        table.Set(LuaValue("x"), LuaValue("c"));
+        
+        Size count = 0;
+        LuaValue key;
+        LuaValue value;
+        while (table.Next(key, value)) {
+            count++;
+        }
+        REQUIRE(count == 3);
+    }
+    
+    SECTION("非法键") {
+        LuaTable table;
+        REQUIRE_THROWS(table.Set(LuaValue(), LuaValue(1.0)));
+        REQUIRE_THROWS(table.Set(LuaValue(std::numeric_limits<double>::quiet_NaN()), LuaValue(1.0)));
+    }
+    
+    SECTION("浮点字节编码") {
+        REQUIRE(FloatingByteToInt(IntToFloatingByte(7)) == 7);
+        REQUIRE(FloatingByteToInt(IntToFloatingByte(100)) >= 100);
+        REQUIRE(FloatingByteToInt(IntToFloatingByte(1000)) >= 1000);
+    }
+}
+
+TEST_CASE("VM Unit - 字符串驻留", "[vm][unit][string]") {
+    SECTION("短字符串共享同一对象") {
+        LuaValue a("interned_key");
+        LuaValue b(std::string("interned_") + "key");
+        
+        REQUIRE(a.GetStringObject() == b.GetStringObject());
+        REQUIRE(a.GetStringObject()->IsInterned());
+        REQUIRE(a.RawIdentical(b));
+        REQUIRE(a == b);
+    }
+    
+    SECTION("长字符串不驻留但内容相等") {
+        std::string text(StringObject::kMaxShortLength + 10, 'x');
+        LuaValue a(text);
+        LuaValue b(text);
+        
+        REQUIRE_FALSE(a.GetStringObject()->IsInterned());
+        REQUIRE(a.GetStringObject() != b.GetStringObject());
+        REQUIRE(a == b);
+        REQUIRE(a.GetStringObject()->GetHash() == b.GetStringObject()->GetHash());
+    }
+    
+    SECTION("常量字符串键查表") {
+        LuaTable table;
+        table.Set(LuaValue("print"), LuaValue(1.0));
+        
+        LuaValue key("print");
+        REQUIRE(table.GetStr(key.GetStringObject()).GetNumber() == Approx(1.0));
+        REQUIRE(table.GetStr(LuaValue("missing").GetStringObject()).IsNil());
+    }
+
+    SECTION("每个状态有自己的驻留表，跨状态的同内容键仍能查到") {
+        VirtualMachine vm;
+        LuaValue host_key("state_key");
+        LuaValue vm_key;
+        {
+            MemoryManagerScope scope(vm.GetMemoryManager());
+            vm_key = LuaValue(std::string("state_") + "key");
+            REQUIRE(vm_key.RawIdentical(LuaValue("state_key")));
+        }
+
+        REQUIRE(vm_key.GetStringObject()->IsInterned());
+        REQUIRE_FALSE(vm_key.RawIdentical(host_key));
+        REQUIRE(vm_key == host_key);
+
+        LuaTable table;
+        table.Set(host_key, LuaValue(1.0));
+        REQUIRE(table.GetStr(vm_key.GetStringObject()).GetNumber() == Approx(1.0));
+        table.Set(vm_key, LuaValue(2.0));
+        REQUIRE(table.GetStr(host_key.GetStringObject()).GetNumber() == Approx(2.0));
+    }
+
+    SECTION("弱清扫摘除未标记字符串") {
+        StringTable strings;
+        StringObject* str = AllocateGCObject<StringObject>("weak", 4,
+                                                           StringObject::ComputeHash("weak", 4));
+        strings.Insert(str);
+        REQUIRE(strings.Find("weak", 4, str->GetHash()) == str);
+        
+        str->SetColor(GCColor::White);
+        REQUIRE(strings.SweepDead() == 1);
+        REQUIRE(strings.Find("weak", 4, str->GetHash()) == nullptr);
+        REQUIRE_FALSE(str->IsInterned());
+    }
+}
+
 /* ========================================================================== */
 /* 比较和跳转指令单元测试 */
 /* ========================================================================== */
 
+TEST_CASE("VM Unit - 内联缓存", "[vm][unit][table][cache]") {
+    SECTION("常量键GETTABLE命中预测节点") {
+        // local t = {}; t.x = 1; local v; for i = 1, 100 do v = t.x end; return v
+        auto proto = std::make_unique<Proto>("inline_cache");
+        proto->AddConstant(LuaValue("x"));
+        proto->AddConstant(LuaValue(1.0));
+        proto->AddConstant(LuaValue(100.0));
+        proto->AddInstruction(CreateABC(OpCode::NEWTABLE, 0, 0, 1), 1);
+        proto->AddInstruction(CreateABC(OpCode::SETTABLE, 0, ConstantIndexToRK(0), ConstantIndexToRK(1)), 1);
+        proto->AddInstruction(CreateABx(OpCode::LOADK, 1, 1), 2);
+        proto->AddInstruction(CreateABx(OpCode::LOADK, 2, 2), 2);
+        proto->AddInstruction(CreateABx(OpCode::LOADK, 3, 1), 2);
+        proto->AddInstruction(CreateAsBx(OpCode::FORPREP, 1, 1), 2);
+        proto->AddInstruction(CreateABC(OpCode::GETTABLE, 5, 0, ConstantIndexToRK(0)), 3);
+        proto->AddInstruction(CreateAsBx(OpCode::FORLOOP, 1, -2), 2);
+        proto->AddInstruction(CreateABC(OpCode::RETURN, 5, 2, 0), 4);
+        proto->SetMaxStackSize(6);
+        
+        auto vm = CreateHighPerformanceVM();
+        auto results = vm->ExecuteProgram(proto.get());
+        const auto& stats = vm->GetExecutionStatistics();
+        
+        REQUIRE(results.size() == 1);
+        REQUIRE(results[0].GetNumber() == Approx(1.0));
+        // SETTABLE和第一次GETTABLE未命中，其余99次GETTABLE命中
+        REQUIRE(stats.inline_cache_misses == 2);
+        REQUIRE(stats.inline_cache_hits == 99);
+    }
+    
+    SECTION("慢路径按当前指令取缓存槽") {
+        // local t = {}; t.x = 1; t.y = 2; local a, b
+        // for i = 1, 100 do a = t.x; b = t.y end; return a + b
+        // 相邻的同类指令各有自己的槽位，不会互相覆盖预测节点
+        auto make_proto = [] {
+            auto proto = std::make_unique<Proto>("inline_cache_slow");
+            proto->AddConstant(LuaValue("x"));
+            proto->AddConstant(LuaValue(1.0));
+            proto->AddConstant(LuaValue(100.0));
+            proto->AddConstant(LuaValue("y"));
+            proto->AddConstant(LuaValue(2.0));
+            proto->AddInstruction(CreateABC(OpCode::NEWTABLE, 0, 0, 2), 1);
+            proto->AddInstruction(CreateABC(OpCode::SETTABLE, 0, ConstantIndexToRK(0), ConstantIndexToRK(1)), 1);
+            proto->AddInstruction(CreateABC(OpCode::SETTABLE, 0, ConstantIndexToRK(3), ConstantIndexToRK(4)), 1);
+            proto->AddInstruction(CreateABx(OpCode::LOADK, 1, 1), 2);
+            proto->AddInstruction(CreateABx(OpCode::LOADK, 2, 2), 2);
+            proto->AddInstruction(CreateABx(OpCode::LOADK, 3, 1), 2);
+            proto->AddInstruction(CreateAsBx(OpCode::FORPREP, 1, 2), 2);
+            proto->AddInstruction(CreateABC(OpCode::GETTABLE, 5, 0, ConstantIndexToRK(0)), 3);
+            proto->AddInstruction(CreateABC(OpCode::GETTABLE, 6, 0, ConstantIndexToRK(3)), 3);
+            proto->AddInstruction(CreateAsBx(OpCode::FORLOOP, 1, -3), 2);
+            proto->AddInstruction(CreateABC(OpCode::ADD, 5, 5, 6), 4);
+            proto->AddInstruction(CreateABC(OpCode::RETURN, 5, 2, 0), 4);
+            proto->SetMaxStackSize(7);
+            return proto;
+        };
+        
+        // 缓存槽挂在Proto上，两条路径各用一份新的Proto，从冷缓存开始
+        auto slow_proto = make_proto();
+        VMConfig slow_config;
+        slow_config.enable_profiling = true;
+        VirtualMachine slow_vm(slow_config);
+        auto slow_results = slow_vm.ExecuteProgram(slow_proto.get());
+        
+        auto fast_proto = make_proto();
+        auto fast_vm = CreateHighPerformanceVM();
+        auto fast_results = fast_vm->ExecuteProgram(fast_proto.get());
+        
+        REQUIRE(slow_results.size() == 1);
+        REQUIRE(slow_results[0].GetNumber() == Approx(3.0));
+        REQUIRE(fast_results[0].GetNumber() == Approx(3.0));
+        
+        // 两条SETTABLE和每条GETTABLE的第一次执行未命中，其余198次命中
+        const auto& slow_stats = slow_vm.GetExecutionStatistics();
+        const auto& fast_stats = fast_vm->GetExecutionStatistics();
+        REQUIRE(slow_stats.inline_cache_misses == 4);
+        REQUIRE(slow_stats.inline_cache_hits == 198);
+        REQUIRE(fast_stats.inline_cache_misses == slow_stats.inline_cache_misses);
+        REQUIRE(fast_stats.inline_cache_hits == slow_stats.inline_cache_hits);
+    }
+    
+    SECTION("预测节点失效后回退到完整查找") {
+        LuaTable table;
+        table.Set(LuaValue("a"), LuaValue(1.0));
+        StringObject* key = LuaValue("a").GetStringObject();
+        
+        uint32_t node = table.FindStrNodeIndex(key);
+        REQUIRE(node != LuaTable::kNoNode);
+        REQUIRE(table.GetNodeValueIfKey(node, key)->GetNumber() == Approx(1.0));
+        
+        // 其他键不会误命中该节点
+        REQUIRE(table.GetNodeValueIfKey(node, LuaValue("b").GetStringObject()) == nullptr);
+        REQUIRE(table.GetNodeValueIfKey(InlineCache::kEmpty, key) == nullptr);
+    }
+}
+
 TEST_CASE("VM Unit - 比较和跳转指令", "[vm][unit][instruction][comparison]") {
     auto vm = CreateStandardVM();
     auto proto = std::make_unique<Proto>("test");
-    vm->PushCallFrame(proto.get(), 0, 0, 0);
+    vm->PushCallFrame(proto.get(), 0);
     
     SECTION("EQ指令") {
         vm->SetRegister(1, LuaValue(42.0));
@@ -367,7 +671,8 @@ TEST_CASE("VM Unit - 比较和跳转指令", "[vm][unit][instruction][comparison
         Instruction jmp_inst = CreateAsBx(OpCode::JMP, 0, jump_offset);
         vm->ExecuteInstruction(jmp_inst);
         
-        REQUIRE(vm->GetInstructionPointer() == initial_pc + jump_offset);
+        // 跳转偏移相对下一条指令：pc+1+sBx
+        REQUIRE(vm->GetInstructionPointer() == initial_pc + 1 + jump_offset);
     }
 
     SECTION("TEST指令") {
@@ -391,7 +696,7 @@ TEST_CASE("VM Unit - 比较和跳转指令", "[vm][unit][instruction][comparison
 TEST_CASE("VM Unit - 字符串操作", "[vm][unit][instruction][string]") {
     auto vm = CreateStandardVM();
     auto proto = std::make_unique<Proto>("test");
-    vm->PushCallFrame(proto.get(), 0, 0, 0);
+    vm->PushCallFrame(proto.get(), 0);
     
     SECTION("LEN指令 - 字符串长度") {
         vm->SetRegister(1, LuaValue("hello"));
@@ -424,6 +729,47 @@ TEST_CASE("VM Unit - 字符串操作", "[vm][unit][instruction][string]") {
         REQUIRE(result.find("Number: ") == 0);
         REQUIRE(result.find("42") != std::string::npos);
     }
+
+    SECTION("数值格式化与%.14g一致") {
+        for (double value : {0.0, -0.0, 42.0, -7.0, 0.1, 3.14159265358979, 1e14, 1e100, -2.5e-8, 123456789012.5}) {
+            char expected[kNumberBufferSize];
+            int expected_length = std::snprintf(expected, sizeof(expected), "%.14g", value);
+            char actual[kNumberBufferSize];
+            Size actual_length = FormatNumber(value, actual);
+            REQUIRE(std::string(actual, actual_length) == std::string(expected, expected_length));
+        }
+    }
+
+    SECTION("CONCAT指令 - 长字符串追加缓冲区") {
+        std::string expected(200, 'a');
+        vm->SetRegister(1, LuaValue(expected));
+        vm->SetRegister(2, LuaValue("b"));
+        
+        // s = s .. "b" 循环：第一次新建缓冲区，之后都在同一缓冲区末尾追加
+        Instruction concat_inst = CreateABC(OpCode::CONCAT, 1, 1, 2);
+        for (int i = 0; i < 10; i++) {
+            vm->ExecuteInstruction(concat_inst);
+            expected += "b";
+        }
+        
+        StringObject* first = vm->GetRegister(1).GetStringObject();
+        REQUIRE(first->IsBuilder());
+        REQUIRE(first->GetLength() == expected.size());
+        
+        // 旧视图的前缀仍然有效；从它分叉时另开缓冲区
+        vm->SetRegister(3, vm->GetRegister(1));
+        vm->SetRegister(4, LuaValue("c"));
+        vm->ExecuteInstruction(CreateABC(OpCode::CONCAT, 0, 1, 2));
+        vm->ExecuteInstruction(CreateABC(OpCode::CONCAT, 5, 3, 4));
+        REQUIRE(vm->GetRegister(0).GetString() == expected + "b");
+        REQUIRE(vm->GetRegister(5).GetString() == expected + "c");
+        
+        // 首次读取std::string时展平，内容与哈希不变
+        uint64_t hash = first->GetHash();
+        REQUIRE(first->GetString() == expected);
+        REQUIRE_FALSE(first->IsBuilder());
+        REQUIRE(StringObject::ComputeHash(expected.data(), expected.size()) == hash);
+    }
 }
 
 /* ========================================================================== */
@@ -433,7 +779,7 @@ TEST_CASE("VM Unit - 字符串操作", "[vm][unit][instruction][string]") {
 TEST_CASE("VM Unit - 循环指令", "[vm][unit][instruction][loop]") {
     auto vm = CreateStandardVM();
     auto proto = std::make_unique<Proto>("test");
-    vm->PushCallFrame(proto.get(), 0, 0, 0);
+    vm->PushCallFrame(proto.get(), 0);
     
     SECTION("FORPREP指令") {
         vm->SetRegister(0, LuaValue(10.0));  // init
@@ -448,7 +794,7 @@ TEST_CASE("VM Unit - 循环指令", "[vm][unit][instruction][loop]") {
         
         // init = init - step = 10 - (-2) = 12
         REQUIRE(vm->GetRegister(0).GetNumber() == Approx(12.0));
-        REQUIRE(vm->GetInstructionPointer() == initial_pc + jump);
+        REQUIRE(vm->GetInstructionPointer() == initial_pc + 1 + jump);
     }
 
     SECTION("FORLOOP指令 - 继续循环") {
@@ -456,6 +802,7 @@ TEST_CASE("VM Unit - 循环指令", "[vm][unit][instruction][loop]") {
         vm->SetRegister(1, LuaValue(5.0));   // limit
         vm->SetRegister(2, LuaValue(1.0));   // step
         
+        vm->SetInstructionPointer(4);
         Size initial_pc = vm->GetInstructionPointer();
         int jump = -2;
         
@@ -465,7 +812,7 @@ TEST_CASE("VM Unit - 循环指令", "[vm][unit][instruction][loop]") {
         // init = init + step = 1 + 1 = 2
         REQUIRE(vm->GetRegister(0).GetNumber() == Approx(2.0));
         // 2 <= 5，所以继续循环
-        REQUIRE(vm->GetInstructionPointer() == initial_pc + jump);
+        REQUIRE(vm->GetInstructionPointer() == initial_pc + 1 + jump);
         // 循环变量
         REQUIRE(vm->GetRegister(3).GetNumber() == Approx(2.0));
     }
@@ -501,7 +848,7 @@ TEST_CASE("VM Unit - 错误处理", "[vm][unit][error]") {
 
     SECTION("无效操作码") {
         auto proto = std::make_unique<Proto>("test");
-        vm->PushCallFrame(proto.get(), 0, 0, 0);
+        vm->PushCallFrame(proto.get(), 0);
         
         // 创建无效指令
         Instruction invalid_inst = 0xFFFFFFFF;
@@ -515,7 +862,7 @@ TEST_CASE("VM Unit - 错误处理", "[vm][unit][error]") {
         VirtualMachine small_vm(config);
         
         auto proto = std::make_unique<Proto>("test");
-        small_vm.PushCallFrame(proto.get(), 0, 0, 0);
+        small_vm.PushCallFrame(proto.get(), 0);
         
         REQUIRE_THROWS_AS([&]() {
             for (int i = 0; i < 20; ++i) {
@@ -531,7 +878,7 @@ TEST_CASE("VM Unit - 错误处理", "[vm][unit][error]") {
         VirtualMachine limited_vm(config);
         
         auto proto = std::make_unique<Proto>("test");
-        limited_vm.PushCallFrame(proto.get(), 0, 0, 0);
+        limited_vm.PushCallFrame(proto.get(), 0);
         
         Instruction nop_inst = CreateABC(OpCode::LOADNIL, 0, 0, 0);
         
@@ -545,6 +892,589 @@ TEST_CASE("VM Unit - 错误处理", "[vm][unit][error]") {
     }
 }
 
+/* ========================================================================== */
+/* 调用帧栈单元测试 */
+/* ========================================================================== */
+
+TEST_CASE("VM Unit - 调用帧栈", "[vm][unit][callframe]") {
+    STATIC_REQUIRE(std::is_trivially_copyable_v<CallFrame>);
+    STATIC_REQUIRE(sizeof(CallFrame) <= 32);
+    
+    auto proto = std::make_unique<Proto>("frames");
+    
+    SECTION("前16帧位于内联缓冲区，更深时迁移到堆上") {
+        CallFrameStack frames(100);
+        REQUIRE(frames.IsEmpty());
+        
+        for (Size i = 1; i < VM_INLINE_CALL_FRAMES; ++i) {
+            frames.Push(proto.get(), i * 2, i * 2 - 1, 1);
+        }
+        REQUIRE(frames.IsInline());
+        
+        frames.Push(proto.get(), 100, 99, VM_MULTRET);
+        REQUIRE_FALSE(frames.IsInline());
+        REQUIRE(frames.GetDepth() == VM_INLINE_CALL_FRAMES + 1);
+        
+        // 迁移后已有帧内容保持不变
+        REQUIRE(frames[3].GetBase() == 6);
+        REQUIRE(frames[3].GetFunctionSlot() == 5);
+        REQUIRE(frames[3].GetExpectedResults() == 1);
+        REQUIRE(frames.Top().GetExpectedResults() == VM_MULTRET);
+        
+        frames.Clear();
+        REQUIRE(frames.IsEmpty());
+        REQUIRE_THROWS_AS(frames.Pop(), CallFrameError);
+    }
+    
+    SECTION("超过最大深度抛出溢出错误") {
+        CallFrameStack frames(4);
+        frames.Push(proto.get(), 1);
+        frames.Push(proto.get(), 2);
+        frames.Push(proto.get(), 3);
+        REQUIRE_THROWS_AS(frames.Push(proto.get(), 4), CallStackOverflowError);
+    }
+    
+    SECTION("VM与高级调用栈管理器共享帧栈") {
+        VirtualMachine vm;
+        AdvancedCallStackManager manager(vm.GetCallFrameStack());
+        
+        vm.PushCallFrame(proto.get(), 0);
+        REQUIRE(manager.GetDepth() == 2);
+        REQUIRE(manager.GetCurrentFrame().GetProto() == proto.get());
+        
+        manager.PushFrame(proto.get(), 4, 3, 1);
+        REQUIRE(vm.GetCallDepth() == 3);
+        REQUIRE(vm.GetCurrentCallFrame().GetBase() == 4);
+    }
+}
+
+/* ========================================================================== */
+/* 函数调用约定单元测试 */
+/* ========================================================================== */
+
+TEST_CASE("VM Unit - 函数调用约定", "[vm][unit][call]") {
+    // local function g(...) return ... end
+    auto vararg_proto = std::make_unique<Proto>("vararg");
+    vararg_proto->AddInstruction(CreateABC(OpCode::VARARG, 0, 0, 0), 1);
+    vararg_proto->AddInstruction(CreateABC(OpCode::RETURN, 0, 0, 0), 1);
+    vararg_proto->SetVariadic(true);
+    vararg_proto->SetMaxStackSize(2);
+    LuaValue g(AllocateGCObject<FunctionObject>(vararg_proto.get()));
+    
+    // main(f, x, y, z): return f(x, y, z)，结果个数由C决定
+    auto make_caller = [](int c) {
+        auto proto = std::make_unique<Proto>("caller");
+        proto->AddInstruction(CreateABC(OpCode::MOVE, 4, 0, 0), 1);
+        proto->AddInstruction(CreateABC(OpCode::MOVE, 5, 1, 0), 1);
+        proto->AddInstruction(CreateABC(OpCode::MOVE, 6, 2, 0), 1);
+        proto->AddInstruction(CreateABC(OpCode::MOVE, 7, 3, 0), 1);
+        proto->AddInstruction(CreateABC(OpCode::CALL, 4, 4, c), 1);
+        proto->AddInstruction(CreateABC(OpCode::RETURN, 4, c, 0), 1);
+        proto->SetParameterCount(4);
+        proto->SetMaxStackSize(8);
+        return proto;
+    };
+    
+    std::vector<LuaValue> args = {g, LuaValue(1.0), LuaValue(2.0), LuaValue(3.0)};
+    
+    SECTION("变参和多返回值经开放栈顶原样传递") {
+        auto caller = make_caller(0);
+        VirtualMachine vm;
+        auto results = vm.ExecuteProgram(caller.get(), args);
+        
+        REQUIRE(results.size() == 3);
+        REQUIRE(results[0].GetNumber() == Approx(1.0));
+        REQUIRE(results[2].GetNumber() == Approx(3.0));
+        REQUIRE(vm.GetExecutionStatistics().function_calls == 1);
+    }
+    
+    SECTION("固定结果数截断或补nil") {
+        auto one = make_caller(2);
+        VirtualMachine vm;
+        auto results = vm.ExecuteProgram(one.get(), args);
+        REQUIRE(results.size() == 1);
+        REQUIRE(results[0].GetNumber() == Approx(1.0));
+        
+        auto four = make_caller(5);
+        results = vm.ExecuteProgram(four.get(), args);
+        REQUIRE(results.size() == 4);
+        REQUIRE(results[2].GetNumber() == Approx(3.0));
+        REQUIRE(results[3].IsNil());
+    }
+}
+
+/* ========================================================================== */
+/* 抢占预算单元测试 */
+/* ========================================================================== */
+
+TEST_CASE("VM Unit - 抢占预算", "[vm][unit][preemption]") {
+    // local s = 0; for i = 1, 100 do s = s + i end; return s
+    auto proto = std::make_unique<Proto>("preempt");
+    proto->AddConstant(LuaValue(0.0));
+    proto->AddConstant(LuaValue(1.0));
+    proto->AddConstant(LuaValue(100.0));
+    proto->AddInstruction(CreateABx(OpCode::LOADK, 4, 0), 1);
+    proto->AddInstruction(CreateABx(OpCode::LOADK, 0, 1), 1);
+    proto->AddInstruction(CreateABx(OpCode::LOADK, 1, 2), 1);
+    proto->AddInstruction(CreateABx(OpCode::LOADK, 2, 1), 1);
+    proto->AddInstruction(CreateAsBx(OpCode::FORPREP, 0, 1), 1);
+    proto->AddInstruction(CreateABC(OpCode::ADD, 4, 4, 3), 1);
+    proto->AddInstruction(CreateAsBx(OpCode::FORLOOP, 0, -2), 1);
+    proto->AddInstruction(CreateABC(OpCode::RETURN, 4, 2, 0), 1);
+    proto->SetMaxStackSize(5);
+    
+    SECTION("预算只在回跳处扣减，耗尽后从保存的pc继续") {
+        VMConfig config;
+        config.preempt_budget = 10;
+        VirtualMachine vm(config);
+        
+        auto results = vm.ExecuteProgram(proto.get());
+        Size slices = 1;
+        while (vm.WasPreempted()) {
+            REQUIRE(vm.GetExecutionState() == ExecutionState::Suspended);
+            results = vm.ResumeExecution();
+            slices++;
+        }
+        
+        // 100次回跳，每10次抢占一次
+        REQUIRE(vm.GetExecutionStatistics().preemptions == 10);
+        REQUIRE(slices == 11);
+        REQUIRE(results.size() == 1);
+        REQUIRE(results[0].GetNumber() == Approx(5050.0));
+    }
+    
+    SECTION("慢路径与快速循环在同样的回跳处被抢占") {
+        // 预算101时只有把退出循环的FORLOOP也计数才会被抢占
+        for (Size budget : {Size{7}, Size{10}, Size{101}}) {
+            VMConfig fast_config;
+            fast_config.preempt_budget = budget;
+            VMConfig slow_config = fast_config;
+            slow_config.enable_profiling = true;
+            VirtualMachine fast_vm(fast_config);
+            VirtualMachine slow_vm(slow_config);
+            
+            auto fast_results = fast_vm.ExecuteProgram(proto.get());
+            while (fast_vm.WasPreempted()) {
+                fast_results = fast_vm.ResumeExecution();
+            }
+            auto slow_results = slow_vm.ExecuteProgram(proto.get());
+            while (slow_vm.WasPreempted()) {
+                slow_results = slow_vm.ResumeExecution();
+            }
+            
+            REQUIRE(slow_vm.GetExecutionStatistics().preemptions == 100 / budget);
+            REQUIRE(fast_vm.GetExecutionStatistics().preemptions == 100 / budget);
+            REQUIRE(slow_results[0].GetNumber() == Approx(5050.0));
+            REQUIRE(fast_results[0].GetNumber() == Approx(5050.0));
+        }
+    }
+    
+    SECTION("禁用时不抢占") {
+        VirtualMachine vm;
+        auto results = vm.ExecuteProgram(proto.get());
+        
+        REQUIRE_FALSE(vm.WasPreempted());
+        REQUIRE(vm.GetExecutionStatistics().preemptions == 0);
+        REQUIRE(results[0].GetNumber() == Approx(5050.0));
+        REQUIRE_THROWS_AS(vm.ResumeExecution(), VMExecutionError);
+    }
+}
+
+TEST_CASE("VM Unit - 协程在VM上切换", "[vm][unit][coroutine]") {
+    // local s = 0; for i = 1, limit do s = s + i end; return s
+    auto make_sum = [](double limit) {
+        auto proto = std::make_unique<Proto>("coroutine_sum");
+        proto->AddConstant(LuaValue(0.0));
+        proto->AddConstant(LuaValue(1.0));
+        proto->AddConstant(LuaValue(limit));
+        proto->AddInstruction(CreateABx(OpCode::LOADK, 4, 0), 1);
+        proto->AddInstruction(CreateABx(OpCode::LOADK, 0, 1), 1);
+        proto->AddInstruction(CreateABx(OpCode::LOADK, 1, 2), 1);
+        proto->AddInstruction(CreateABx(OpCode::LOADK, 2, 1), 1);
+        proto->AddInstruction(CreateAsBx(OpCode::FORPREP, 0, 1), 1);
+        proto->AddInstruction(CreateABC(OpCode::ADD, 4, 4, 3), 1);
+        proto->AddInstruction(CreateAsBx(OpCode::FORLOOP, 0, -2), 1);
+        proto->AddInstruction(CreateABC(OpCode::RETURN, 4, 2, 0), 1);
+        proto->SetMaxStackSize(5);
+        return proto;
+    };
+    
+    auto sum_100 = make_sum(100.0);
+    auto sum_200 = make_sum(200.0);
+    LuaValue func_100(AllocateGCObject<FunctionObject>(sum_100.get()));
+    LuaValue func_200(AllocateGCObject<FunctionObject>(sum_200.get()));
+    
+    VirtualMachine vm;
+    CoroutineSupport support(&vm);
+    CoroutineSupport::CoroutineConfig config;
+    config.enable_preemption = true;
+    config.preempt_budget = 10;
+    support.SetConfig(config);
+    
+    SECTION("交替恢复的协程各自在自己的栈和调用帧上继续") {
+        LuaValue co_100 = support.CreateCoroutine(func_100);
+        LuaValue co_200 = support.CreateCoroutine(func_200);
+        
+        std::vector<LuaValue> results_100;
+        std::vector<LuaValue> results_200;
+        Size resumes_100 = 0;
+        Size resumes_200 = 0;
+        while (support.GetCoroutineStatus(co_100) != "dead" ||
+               support.GetCoroutineStatus(co_200) != "dead") {
+            if (support.GetCoroutineStatus(co_100) == "suspended") {
+                results_100 = support.Resume(co_100);
+                resumes_100++;
+            }
+            if (support.GetCoroutineStatus(co_200) == "suspended") {
+                results_200 = support.Resume(co_200);
+                resumes_200++;
+            }
+        }
+        
+        // 100次和200次回跳，每10次让出一次
+        REQUIRE(resumes_100 == 11);
+        REQUIRE(resumes_200 == 21);
+        REQUIRE(results_100.size() == 1);
+        REQUIRE(results_100[0].GetNumber() == Approx(5050.0));
+        REQUIRE(results_200.size() == 1);
+        REQUIRE(results_200[0].GetNumber() == Approx(20100.0));
+        REQUIRE_FALSE(support.IsInCoroutine());
+    }
+    
+    SECTION("慢路径上被抢占的长循环恢复后结果正确") {
+        auto sum_1000 = make_sum(1000.0);
+        LuaValue func_1000(AllocateGCObject<FunctionObject>(sum_1000.get()));
+        
+        VMConfig slow_config;
+        slow_config.enable_profiling = true;
+        VirtualMachine slow_vm(slow_config);
+        CoroutineSupport slow_support(&slow_vm);
+        CoroutineSupport::CoroutineConfig slow_coroutine_config;
+        slow_coroutine_config.enable_preemption = true;
+        slow_coroutine_config.preempt_budget = 7;
+        slow_support.SetConfig(slow_coroutine_config);
+        
+        LuaValue co = slow_support.CreateCoroutine(func_1000);
+        std::vector<LuaValue> results;
+        Size resumes = 0;
+        while (slow_support.GetCoroutineStatus(co) == "suspended") {
+            results = slow_support.Resume(co);
+            resumes++;
+        }
+        
+        // 1000次回跳每7次让出一次，退出循环的FORLOOP不计数
+        REQUIRE(slow_vm.GetExecutionStatistics().preemptions == 142);
+        REQUIRE(resumes == 143);
+        REQUIRE(results.size() == 1);
+        REQUIRE(results[0].GetNumber() == Approx(500500.0));
+    }
+    
+    SECTION("主线程执行程序不影响挂起的协程") {
+        LuaValue co = support.CreateCoroutine(func_100);
+        REQUIRE(support.Resume(co).empty());
+        REQUIRE(support.GetCoroutineStatus(co) == "suspended");
+        
+        // 在主线程上运行另一个程序（会重置VM当前的栈和帧）
+        auto other = std::make_unique<Proto>("other");
+        other->AddConstant(LuaValue(7.0));
+        other->AddInstruction(CreateABx(OpCode::LOADK, 0, 0), 1);
+        other->AddInstruction(CreateABC(OpCode::RETURN, 0, 2, 0), 1);
+        other->SetMaxStackSize(1);
+        auto main_results = vm.ExecuteProgram(other.get());
+        REQUIRE(main_results.size() == 1);
+        REQUIRE(main_results[0].GetNumber() == Approx(7.0));
+        
+        std::vector<LuaValue> results;
+        while (support.GetCoroutineStatus(co) == "suspended") {
+            results = support.Resume(co);
+        }
+        REQUIRE(support.GetCoroutineStatus(co) == "dead");
+        REQUIRE(results.size() == 1);
+        REQUIRE(results[0].GetNumber() == Approx(5050.0));
+    }
+}
+
+/* ========================================================================== */
+/* 字节码校验和指令指针单元测试 */
+/* ========================================================================== */
+
+TEST_CASE("VM Unit - 字节码校验", "[vm][unit][verifier]") {
+    SECTION("合法代码连同子函数一起通过校验") {
+        auto proto = std::make_unique<Proto>("main");
+        auto child = std::make_unique<Proto>("child", 2);
+        child->AddInstruction(CreateABC(OpCode::RETURN, 0, 1, 0), 3);
+        const Proto* child_ptr = child.get();
+        proto->AddSubProto(std::move(child));
+        proto->AddInstruction(CreateABC(OpCode::LOADBOOL, 0, 1, 1), 1);
+        proto->AddInstruction(CreateABC(OpCode::LOADBOOL, 0, 0, 0), 1);
+        proto->AddInstruction(CreateABC(OpCode::RETURN, 0, 2, 0), 1);
+        proto->SetMaxStackSize(2);
+        
+        VirtualMachine vm;
+        auto results = vm.ExecuteProgram(proto.get());
+        
+        REQUIRE(proto->IsVerified());
+        REQUIRE(child_ptr->IsVerified());
+        REQUIRE(results.size() == 1);
+        REQUIRE(results[0].IsTruthy());
+    }
+    
+    SECTION("越界跳转在执行前被拒绝") {
+        auto proto = std::make_unique<Proto>("bad_jump");
+        proto->AddInstruction(CreateAsBx(OpCode::JMP, 0, 5), 1);
+        proto->AddInstruction(CreateABC(OpCode::RETURN, 0, 1, 0), 1);
+        
+        VirtualMachine vm;
+        REQUIRE_THROWS_AS(vm.ExecuteProgram(proto.get()), BytecodeVerificationError);
+        REQUIRE_FALSE(proto->IsVerified());
+        REQUIRE(vm.GetExecutionStatistics().total_instructions == 0);
+    }
+    
+    SECTION("条件指令之后必须是JMP") {
+        auto proto = std::make_unique<Proto>("bad_test");
+        proto->AddInstruction(CreateABC(OpCode::TEST, 0, 0, 0), 1);
+        proto->AddInstruction(CreateABC(OpCode::RETURN, 0, 1, 0), 1);
+        
+        REQUIRE_THROWS_AS(BytecodeVerifier::Verify(*proto), BytecodeVerificationError);
+    }
+    
+    SECTION("缺少结尾RETURN的代码被拒绝") {
+        auto proto = std::make_unique<Proto>("no_return");
+        proto->AddInstruction(CreateABC(OpCode::MOVE, 0, 1, 0), 1);
+        
+        REQUIRE_THROWS_AS(BytecodeVerifier::Verify(*proto), BytecodeVerificationError);
+    }
+    
+    SECTION("操作数越界在执行前被拒绝") {
+        // 每个函数只有一处非法操作数，其余部分都合法
+        auto make_proto = [](Instruction inst) {
+            auto proto = std::make_unique<Proto>("operands");
+            proto->AddConstant(LuaValue(1.0));
+            proto->AddInstruction(inst, 1);
+            proto->AddInstruction(CreateABC(OpCode::RETURN, 0, 1, 0), 1);
+            proto->SetMaxStackSize(4);
+            return proto;
+        };
+        
+        // 合法基线
+        REQUIRE_NOTHROW(BytecodeVerifier::Verify(*make_proto(CreateABC(OpCode::ADD, 3, 2, ConstantIndexToRK(0)))));
+        
+        auto bad_register = make_proto(CreateABC(OpCode::MOVE, 4, 0, 0));
+        auto bad_constant = make_proto(CreateABx(OpCode::LOADK, 0, 1));
+        auto bad_rk = make_proto(CreateABC(OpCode::ADD, 0, 1, ConstantIndexToRK(1)));
+        auto bad_global = make_proto(CreateABx(OpCode::GETGLOBAL, 0, 0));  // 名字不是字符串
+        auto bad_closure = make_proto(CreateABx(OpCode::CLOSURE, 0, 0));   // 没有子函数
+        auto bad_upvalue = make_proto(CreateABC(OpCode::GETUPVAL, 0, 0, 0));
+        auto bad_vararg = make_proto(CreateABC(OpCode::VARARG, 0, 2, 0));  // 非可变参数函数
+        auto bad_call = make_proto(CreateABC(OpCode::CALL, 2, 3, 1));       // 参数R(3)..R(4)
+        auto bad_forloop = make_proto(CreateAsBx(OpCode::FORPREP, 1, 0));  // 需要R(1)..R(4)
+        
+        for (Proto* proto : {bad_register.get(), bad_constant.get(), bad_rk.get(),
+                             bad_global.get(), bad_closure.get(), bad_upvalue.get(),
+                             bad_vararg.get(), bad_call.get(), bad_forloop.get()}) {
+            REQUIRE_THROWS_AS(BytecodeVerifier::Verify(*proto), BytecodeVerificationError);
+            REQUIRE_FALSE(proto->IsVerified());
+        }
+        
+        VirtualMachine vm;
+        REQUIRE_THROWS_AS(vm.ExecuteProgram(bad_constant.get()), BytecodeVerificationError);
+        REQUIRE(vm.GetExecutionStatistics().total_instructions == 0);
+    }
+}
+
+TEST_CASE("VM Unit - 调用帧指令指针", "[vm][unit][callstack]") {
+    auto proto = std::make_unique<Proto>("lines");
+    proto->AddInstruction(CreateABC(OpCode::MOVE, 0, 1, 0), 10);
+    proto->AddInstruction(CreateABC(OpCode::MOVE, 1, 0, 0), 11);
+    proto->AddInstruction(CreateABC(OpCode::RETURN, 0, 1, 0), 12);
+    
+    CallFrame frame(proto.get(), 1);
+    REQUIRE(frame.GetSavedPC() == proto->GetCode().data());
+    REQUIRE(frame.GetInstructionPointer() == 0);
+    
+    // 行号由保存的指针按需换算
+    frame.AdvanceInstructionPointer(2);
+    REQUIRE(frame.GetSavedPC() == proto->GetCode().data() + 2);
+    REQUIRE(frame.GetInstructionPointer() == 2);
+    REQUIRE(frame.GetCurrentLine() == 12);
+    REQUIRE(GetOpCode(frame.GetCurrentInstruction()) == OpCode::RETURN);
+    
+    frame.SetInstructionPointer(1);
+    REQUIRE(frame.GetCurrentLine() == 11);
+    REQUIRE_FALSE(frame.IsAtEnd());
+    
+    frame.AdvanceInstructionPointer(2);
+    REQUIRE(frame.IsAtEnd());
+}
+
+TEST_CASE("VM Unit - 快慢路径等价", "[vm][unit][dispatch]") {
+    // 同一段字节码分别走快速循环和慢路径（启用性能分析），结果必须一致
+    auto run_both = [](const Proto* proto) {
+        VirtualMachine fast_vm;
+        VMConfig slow_config;
+        slow_config.enable_profiling = true;
+        VirtualMachine slow_vm(slow_config);
+        
+        auto fast_results = fast_vm.ExecuteProgram(proto);
+        auto slow_results = slow_vm.ExecuteProgram(proto);
+        
+        REQUIRE(fast_results.size() == 1);
+        REQUIRE(slow_results.size() == 1);
+        REQUIRE(slow_results[0].GetNumber() == Approx(fast_results[0].GetNumber()));
+        return slow_results[0].GetNumber();
+    };
+    
+    SECTION("数值for循环：FORPREP/FORLOOP") {
+        // local s = 0; for i = 1, 100 do s = s + i end; return s
+        auto proto = std::make_unique<Proto>("for_loop");
+        proto->AddConstant(LuaValue(0.0));
+        proto->AddConstant(LuaValue(1.0));
+        proto->AddConstant(LuaValue(100.0));
+        proto->AddInstruction(CreateABx(OpCode::LOADK, 4, 0), 1);
+        proto->AddInstruction(CreateABx(OpCode::LOADK, 0, 1), 1);
+        proto->AddInstruction(CreateABx(OpCode::LOADK, 1, 2), 1);
+        proto->AddInstruction(CreateABx(OpCode::LOADK, 2, 1), 1);
+        proto->AddInstruction(CreateAsBx(OpCode::FORPREP, 0, 1), 1);
+        proto->AddInstruction(CreateABC(OpCode::ADD, 4, 4, 3), 1);
+        proto->AddInstruction(CreateAsBx(OpCode::FORLOOP, 0, -2), 1);
+        proto->AddInstruction(CreateABC(OpCode::RETURN, 4, 2, 0), 1);
+        proto->SetMaxStackSize(5);
+        
+        REQUIRE(run_both(proto.get()) == Approx(5050.0));
+    }
+    
+    SECTION("while循环：LT跳过和前后JMP") {
+        // local i, s = 0, 0; while i < 10 do s = s + i; i = i + 1 end; return s
+        auto proto = std::make_unique<Proto>("while_loop");
+        proto->AddConstant(LuaValue(0.0));
+        proto->AddConstant(LuaValue(1.0));
+        proto->AddConstant(LuaValue(10.0));
+        proto->AddInstruction(CreateABx(OpCode::LOADK, 0, 0), 1);
+        proto->AddInstruction(CreateABx(OpCode::LOADK, 1, 0), 1);
+        proto->AddInstruction(CreateABC(OpCode::LT, 0, 0, ConstantIndexToRK(2)), 2);
+        proto->AddInstruction(CreateAsBx(OpCode::JMP, 0, 3), 2);
+        proto->AddInstruction(CreateABC(OpCode::ADD, 1, 1, 0), 3);
+        proto->AddInstruction(CreateABC(OpCode::ADD, 0, 0, ConstantIndexToRK(1)), 3);
+        proto->AddInstruction(CreateAsBx(OpCode::JMP, 0, -5), 3);
+        proto->AddInstruction(CreateABC(OpCode::RETURN, 1, 2, 0), 4);
+        proto->SetMaxStackSize(2);
+        
+        REQUIRE(run_both(proto.get()) == Approx(45.0));
+    }
+}
+
+/* ========================================================================== */
+/* 上值生命周期单元测试 */
+/* ========================================================================== */
+
+TEST_CASE("VM Unit - 上值生命周期", "[vm][unit][upvalue]") {
+    LuaStack stack(16, VM_MAX_STACK_SIZE);
+    stack.Push(LuaValue(42.0));
+    
+    SECTION("闭合上值比管理器活得久") {
+        auto manager = std::make_unique<UpvalueManager>(&stack);
+        Upvalue* upvalue = manager->GetUpvalue(0);
+        manager->AddReference(upvalue);
+        
+        // 管理器析构时闭合上值，闭包仍持有引用
+        manager.reset();
+        REQUIRE(upvalue->IsClosed());
+        REQUIRE(upvalue->GetValue().GetNumber() == Approx(42.0));
+        
+        upvalue->SetValue(LuaValue(7.0));
+        REQUIRE(upvalue->GetValue().GetNumber() == Approx(7.0));
+        
+        // 最后一个引用释放时连同脱离的对象池一起回收
+        REQUIRE(upvalue->ReleaseReference());
+    }
+    
+    SECTION("管理器存活时释放最后一个引用归还槽位") {
+        UpvalueManager manager(&stack);
+        Upvalue* upvalue = manager.GetUpvalue(0);
+        manager.AddReference(upvalue);
+        manager.AddReference(upvalue);
+        manager.CloseUpvalues(0);
+        REQUIRE(manager.GetClosedUpvalueCount() == 1);
+        
+        REQUIRE_FALSE(manager.RemoveReference(upvalue));
+        REQUIRE(manager.RemoveReference(upvalue));
+        REQUIRE(manager.IsEmpty());
+    }
+}
+
+/* ========================================================================== */
+/* 垃圾回收根单元测试 */
+/* ========================================================================== */
+
+TEST_CASE("VM Unit - 垃圾回收根", "[vm][unit][gc]") {
+    VirtualMachine vm;
+    GarbageCollector* gc = vm.GetMemoryManager().GetGarbageCollector();
+    REQUIRE(gc != nullptr);
+    
+    SECTION("回收后全局字符串仍可读取") {
+        // greeting = "hello, " .. "world"; local garbage = "world" .. greeting
+        auto store = std::make_unique<Proto>("store_global");
+        store->AddConstant(LuaValue("greeting"));
+        store->AddConstant(LuaValue("hello, "));
+        store->AddConstant(LuaValue("world"));
+        store->AddInstruction(CreateABx(OpCode::LOADK, 0, 1), 1);
+        store->AddInstruction(CreateABx(OpCode::LOADK, 1, 2), 1);
+        store->AddInstruction(CreateABC(OpCode::CONCAT, 2, 0, 1), 1);
+        store->AddInstruction(CreateABx(OpCode::SETGLOBAL, 2, 0), 1);
+        store->AddInstruction(CreateABC(OpCode::CONCAT, 3, 1, 2), 2);
+        store->AddInstruction(CreateABC(OpCode::RETURN, 0, 1, 0), 2);
+        store->SetMaxStackSize(4);
+        
+        // 覆盖上一段程序留在栈上的值，全局变量只能经全局表存活
+        auto clobber = std::make_unique<Proto>("clobber_stack");
+        clobber->AddConstant(LuaValue(0.0));
+        for (int i = 0; i < 4; i++) {
+            clobber->AddInstruction(CreateABx(OpCode::LOADK, i, 0), 1);
+        }
+        clobber->AddInstruction(CreateABC(OpCode::RETURN, 0, 1, 0), 1);
+        clobber->SetMaxStackSize(4);
+        
+        // return greeting
+        auto load = std::make_unique<Proto>("load_global");
+        load->AddConstant(LuaValue("greeting"));
+        load->AddInstruction(CreateABx(OpCode::GETGLOBAL, 0, 0), 1);
+        load->AddInstruction(CreateABC(OpCode::RETURN, 0, 2, 0), 1);
+        load->SetMaxStackSize(1);
+        
+        vm.ExecuteProgram(store.get());
+        vm.ExecuteProgram(clobber.get());
+        
+        Size objects_before = gc->GetObjectCount();
+        gc->Collect();
+        // 只有临时拼接结果被回收（释放的内存留在池中，读取内容不足以证明存活）
+        REQUIRE(gc->GetObjectCount() == objects_before - 1);
+        
+        auto results = vm.ExecuteProgram(load.get());
+        REQUIRE(results.size() == 1);
+        REQUIRE(results[0].IsString());
+        REQUIRE(results[0].GetString() == "hello, world");
+    }
+    
+    SECTION("活动帧原型的嵌套原型常量是根") {
+        // 嵌套原型的常量只由原型引用，CLOSURE执行前没有闭包对象能标记它
+        auto outer = std::make_unique<Proto>("outer");
+        auto inner = std::make_unique<Proto>("inner");
+        {
+            MemoryManagerScope scope(vm.GetMemoryManager());
+            inner->AddConstant(LuaValue(std::string("nested_") + "constant"));
+        }
+        outer->AddSubProto(std::move(inner));
+        outer->SetMaxStackSize(1);
+        vm.PushCallFrame(outer.get(), 0);
+        
+        Size objects_before = gc->GetObjectCount();
+        gc->Collect();
+        REQUIRE(gc->GetObjectCount() == objects_before);
+        
+        vm.PopCallFrame();
+    }
+}
+
 /* ========================================================================== */
 /* 统计和诊断单元测试 */
 /* ========================================================================== */
@@ -552,7 +1482,7 @@ TEST_CASE("VM Unit - 错误处理", "[vm][unit][error]") {
 TEST_CASE("VM Unit - 统计和诊断", "[vm][unit][statistics]") {
     auto vm = CreateStandardVM();
     auto proto = std::make_unique<Proto>("test");
-    vm->PushCallFrame(proto.get(), 0, 0, 0);
+    vm->PushCallFrame(proto.get(), 0);
     
     SECTION("指令执行统计") {
         vm->ResetStatistics();